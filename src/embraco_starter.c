@@ -3,12 +3,29 @@
 #include <gui/gui.h>
 #include <gui/view_port.h>
 #include <gui/canvas.h>
+#include <gui/elements.h>
 #include <input/input.h>
 #include <notification/notification.h>
 #include <notification/notification_messages.h>
-#include <dialogs/dialogs.h>
+#include <storage/storage.h>
+#include <toolbox/saved_struct.h>
+#include <stm32wbxx_ll_tim.h>
+#include <stm32wbxx_ll_adc.h>
+#include <stm32wbxx_ll_dma.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "feature_flags.h"
+#include "recorder.h"
+#include "history.h"
+#if FEATURE_CLI
+#include <cli/cli.h>
+#include <toolbox/args.h>
+#endif
+
+#define TAG "EmbracoStarter"
 
 /*** PWM wiring (Flipper external header):
  *  + signal: PA7 (external pin "2 (A7)")
@@ -16,6 +33,22 @@
 ***/
 static const GpioPin* PWM_PIN = &gpio_ext_pa7;
 
+#if FEATURE_RACK
+/*** Relay mux (optional, "Rack test"): one relay channel per inverter, each
+ *  switching that unit's + and - onto PA7 / GND. Channel k is driven by
+ *  kRelayPins[k]. The pins stay Hi-Z (off on common relay boards) unless a
+ *  rack test is running.
+***/
+static const GpioPin* const kRelayPins[] = {
+    &gpio_ext_pa6,      /* 3 (A6)  -> unit 1 */
+    &gpio_ext_pb2,      /* 6 (B2)  -> unit 2 */
+    &gpio_usart_tx,     /* 13 (TX) -> unit 3 */
+    &gpio_usart_rx,     /* 14 (RX) -> unit 4 */
+};
+#define RELAY_COUNT       COUNT_OF(kRelayPins)
+#define RELAY_ACTIVE_HIGH false     /* most opto boards: IN pulled LOW = relay on */
+#endif
+
 /* ---------- Geometry / constants ---------- */
 enum {
     CANVAS_W        = 128,
@@ -31,6 +64,11 @@ enum {
     SCROLLBAR_Y1    = 62,
 
     TIMER_MARGIN    = 6,        /* gap from scrollbar to timer text */
+
+    HELP_TOP        = 10,       /* first help line baseline */
+    HELP_LINE_H     = 9,
+    HELP_DESCENT    = 3,        /* rows below a baseline */
+    HELP_GLIDE_PX   = 3,        /* held Up/Down: pixels per repeat */
 };
 
 /* ---------- Safe GPIO helpers ---------- */
@@ -44,6 +82,40 @@ static inline void pin_to_pp_low(void) {
     furi_hal_gpio_write(PWM_PIN, false);
 }
 
+#if FEATURE_RACK
+/* ---------- Relay mux ---------- */
+/* Level is written before the mode switch, so a pin never glitches to "on" */
+static void relays_all_off(void){
+    for(uint8_t k = 0; k < RELAY_COUNT; k++){
+        furi_hal_gpio_write(kRelayPins[k], !RELAY_ACTIVE_HIGH);
+        furi_hal_gpio_init(kRelayPins[k], GpioModeOutputPushPull, GpioPullNo, GpioSpeedLow);
+    }
+}
+/* Exactly one channel on: every other one is forced off in the same call */
+static void relay_select(uint8_t unit){
+    relays_all_off();
+    if(unit < RELAY_COUNT) furi_hal_gpio_write(kRelayPins[unit], RELAY_ACTIVE_HIGH);
+}
+static void relays_release(void){
+    for(uint8_t k = 0; k < RELAY_COUNT; k++){
+        furi_hal_gpio_write(kRelayPins[k], !RELAY_ACTIVE_HIGH);
+        furi_hal_gpio_init(kRelayPins[k], GpioModeInput, GpioPullNo, GpioSpeedLow);
+    }
+}
+/* The jitter loopback (2 (A7) -> 3 (A6)) ties unit 1's relay input to PA7:
+ * closing that relay would short two outputs. With every relay off, A6
+ * drives the off level; PA7, pulled the other way, reads it back only
+ * through a wire. Leaves PA7 Hi-Z and the relays off. */
+static bool relays_looped_to_pwm(void){
+    relays_all_off();
+    furi_hal_gpio_init(PWM_PIN, GpioModeInput, RELAY_ACTIVE_HIGH ? GpioPullUp : GpioPullDown, GpioSpeedLow);
+    furi_delay_us(10);
+    bool looped = furi_hal_gpio_read(PWM_PIN) != RELAY_ACTIVE_HIGH;
+    pin_to_hiz();
+    return looped;
+}
+#endif
+
 /* ---------- Hardware PWM on PA7 ---------- */
 #define PWM_CH FuriHalPwmOutputIdTim1PA7
 
@@ -60,6 +132,109 @@ static inline void pwm_hw_start_safe(uint32_t freq_hz, bool* running) {
     if(running) *running = true;
 }
 
+/* Emergency cut usable from any context (supervisor thread, ISR): no RTOS
+ * waits, no delays. TIM1 outputs off first, then PA7 to Hi-Z. The normal
+ * pwm_hw_stop_safe() still runs later from the main loop to release TIM1. */
+static inline void pwm_hw_kill(void){
+    LL_TIM_DisableAllOutputs(TIM1);
+    LL_TIM_DisableCounter(TIM1);
+    pin_to_hiz();
+}
+
+/* Counted run: TIM1 emits exactly `periods` more full periods and then stops
+ * by itself (one-pulse mode + repetition counter) with PA7 driven LOW, so a
+ * run can end on time with no code of ours resident. The switch is made right
+ * after a falling edge and restarts on a LOW half, so the waveform stays
+ * continuous; PWM2 keeps the output inactive once the counter stops at 0. */
+#define PWM_MAX_COUNTED 65536U  /* TIM1 RCR is 16-bit */
+
+/* Restart TIM1 on a LOW half for exactly `periods` periods (1..PWM_MAX_COUNTED);
+ * call with interrupts off */
+static inline void pwm_hw_counted_switch(uint32_t periods){
+    LL_TIM_DisableCounter(TIM1);
+    LL_TIM_OC_SetMode(TIM1, LL_TIM_CHANNEL_CH1, LL_TIM_OCMODE_PWM2);
+    LL_TIM_SetRepetitionCounter(TIM1, periods - 1);
+    LL_TIM_SetOnePulseMode(TIM1, LL_TIM_ONEPULSEMODE_SINGLE);
+    LL_TIM_GenerateEvent_UPDATE(TIM1);      /* CNT = 0, RCR loaded */
+    LL_TIM_ClearFlag_UPDATE(TIM1);
+    LL_TIM_EnableCounter(TIM1);
+}
+
+#if FEATURE_BURST
+/* Burst from a standing start: exactly `periods` HIGH pulses, then TIM1 stops
+ * with PA7 LOW. HAL start and switch run with interrupts off, so no thread or
+ * ISR can stretch the first period; the PWM1 output the HAL starts with is
+ * overridden within a few instructions (well under 1 us). */
+static bool pwm_hw_burst(uint32_t freq_hz, uint32_t periods, bool* running){
+    if(periods == 0 || periods > PWM_MAX_COUNTED) return false;
+    FURI_CRITICAL_ENTER();
+    furi_hal_pwm_start(PWM_CH, freq_hz, 50);
+    pwm_hw_counted_switch(periods);
+    FURI_CRITICAL_EXIT();
+    *running = true;
+    return true;
+}
+#endif
+
+#if FEATURE_BACKGROUND
+/* Busy-wait for TIM1's next CC1 match (PWM1: falling edge, PWM2: rising
+ * edge). Bounded by TIM1's own periods, not wall time: gives up after two
+ * counter wraps (<= 2 periods, ~36 ms at 55 Hz) or when the counter stops. */
+static bool pwm_hw_wait_cc1(void){
+    LL_TIM_ClearFlag_CC1(TIM1);
+    uint32_t last = LL_TIM_GetCounter(TIM1);
+    uint8_t wraps = 0;
+    while(!LL_TIM_IsActiveFlag_CC1(TIM1)){
+        if(!LL_TIM_IsEnabledCounter(TIM1)) return false;
+        uint32_t cnt = LL_TIM_GetCounter(TIM1);
+        if(cnt < last && ++wraps > 2) return false;
+        last = cnt;
+    }
+    return true;
+}
+
+static bool pwm_hw_arm_counted(uint32_t periods){
+    if(periods == 0) periods = 1;
+    if(periods > PWM_MAX_COUNTED) periods = PWM_MAX_COUNTED;
+    if(!LL_TIM_IsEnabledCounter(TIM1)) return false;
+    if(!pwm_hw_wait_cc1()) return false;
+
+    FURI_CRITICAL_ENTER();
+    pwm_hw_counted_switch(periods);
+    FURI_CRITICAL_EXIT();
+    return true;
+}
+
+/* Undo pwm_hw_arm_counted on a timer that is still counting: back to a
+ * continuous PWM1 run, as furi_hal_pwm left it. Switched right after a rising
+ * edge (CC1 in PWM2) with the counter restarted at 0, where PWM1 is HIGH
+ * too, so the HIGH half just goes on. */
+static bool pwm_hw_resume_continuous(void){
+    if(!pwm_hw_wait_cc1()) return false;
+    FURI_CRITICAL_ENTER();
+    LL_TIM_SetOnePulseMode(TIM1, LL_TIM_ONEPULSEMODE_REPETITIVE);
+    LL_TIM_SetRepetitionCounter(TIM1, 0);
+    LL_TIM_OC_SetMode(TIM1, LL_TIM_CHANNEL_CH1, LL_TIM_OCMODE_PWM1);
+    LL_TIM_SetCounter(TIM1, 0);
+    FURI_CRITICAL_EXIT();
+    return LL_TIM_IsEnabledCounter(TIM1);
+}
+#endif
+
+/* ---------- Idle declaration ---------- */
+/* Safe menu, inverter selection and Stand by need no clocks (PA7 is Hi-Z or a
+ * latched GPIO LOW), so the system may drop into deep sleep there. A running
+ * PWM needs TIM1 clocked, so insomnia is held for exactly that long. */
+static inline void power_hold_sync(bool* held, bool need){
+    if(need && !*held){
+        furi_hal_power_insomnia_enter();
+        *held = true;
+    } else if(!need && *held){
+        furi_hal_power_insomnia_exit();
+        *held = false;
+    }
+}
+
 /* ---------- Modes (powered menu) ---------- */
 /* "Stand by" = PP LOW (no PWM). Low/Mid/Max use PWM.
  * "Power off" — отдельный пункт меню (не в этом массиве), он переводит систему в Hi‑Z и в «безопасное меню».
@@ -69,16 +244,18 @@ typedef struct {
     uint32_t    freq_hz;        /* 0 = no PWM (Stand by) */
     uint8_t     led_blink_hz;   /* 0/1/2/4 */
     uint32_t    default_secs;   /* timeout when Limit=Yes (0 => unlimited per-mode) */
+    uint16_t    rpm;            /* nominal shaft speed (VNE), for the odometer */
 } Mode;
 
 static const Mode kModes[] = {
-    {"Stand by", 0,   0,   0},   /* 0 — PP LOW, без таймера */
-    {"Low speed", 55, 1, 120},   /* 1 — 2 min */
-    {"Mid speed", 100,2,  60},   /* 2 — 1 min */
-    {"Max speed", 160,4,  30},   /* 3 — 30 s */
+    {"Stand by", 0,   0,   0,    0},   /* 0 — PP LOW, без таймера */
+    {"Low speed", 55, 1, 120, 2000},   /* 1 — 2 min */
+    {"Mid speed", 100,2,  60, 3000},   /* 2 — 1 min */
+    {"Max speed", 160,4,  30, 4500},   /* 3 — 30 s */
 };
 #define MODE_COUNT (sizeof(kModes)/sizeof(kModes[0]))
 
+#if FEATURE_GUI
 /* ---------- Help text per inverter (no header) ---------- */
 static const char* HELP_EMBRACO[] = {
     "Connect wires as follows:",
@@ -122,10 +299,13 @@ static const char* HELP_EMBRACO[] = {
 };
 #define HELP_EMBRACO_COUNT (sizeof(HELP_EMBRACO)/sizeof(HELP_EMBRACO[0]))
 
+#if FEATURE_SAMSUNG
 static const char* HELP_SAMSUNG[] = {
     "In development",
 };
 #define HELP_SAMSUNG_COUNT (sizeof(HELP_SAMSUNG)/sizeof(HELP_SAMSUNG[0]))
+#endif
+#endif /* FEATURE_GUI */
 
 /* ---------- State machine ---------- */
 typedef enum {
@@ -133,13 +313,720 @@ typedef enum {
     ScreenMenu,                 /* главное меню (динамическое) */
     ScreenHelp,
     ScreenSettings,
+    ScreenPower,                /* per-mode battery draw (fuel gauge) */
+    ScreenRack,                 /* relay-mux sequential test */
+    ScreenOdometer,             /* run hours per unit */
+    ScreenBurst,                /* exact N-period burst */
+    ScreenSweep,                /* speed sweep + vibration plot */
+    ScreenSchedule,             /* delayed start (RTC alarm) */
+    ScreenTrend,                /* speed + measured value history */
+    ScreenJitter,               /* PWM period jitter under load */
+    ScreenHistory,              /* test records per unit serial */
 } ScreenId;
 
+/* Main menu rows: powered = kModes[] followed by kMenuPoweredTail[],
+ * safe = kMenuSafe[] */
+typedef enum {
+    MenuItemMode = 0,           /* powered only: kModes[row] */
+    MenuItemPowerOn,
+    MenuItemSchedule,           /* safe only */
+    MenuItemPowerOff,
+    MenuItemRack,               /* powered only */
+    MenuItemBurst,              /* powered only */
+    MenuItemSweep,              /* powered only */
+    MenuItemJitter,             /* powered only */
+    MenuItemSettings,
+    MenuItemPowerStats,
+    MenuItemTrend,
+    MenuItemOdometer,
+    MenuItemHistory,
+    MenuItemHelp,
+} MenuItem;
+
+#if FEATURE_GUI
+static const MenuItem kMenuSafe[] = {
+    MenuItemPowerOn,
+#if FEATURE_SCHEDULE
+    MenuItemSchedule,
+#endif
+    MenuItemSettings,
+#if FEATURE_POWER_STATS
+    MenuItemPowerStats,
+#endif
+#if FEATURE_TREND
+    MenuItemTrend,
+#endif
+#if FEATURE_ODOMETER
+    MenuItemOdometer,
+#endif
+#if FEATURE_HISTORY
+    MenuItemHistory,
+#endif
+    MenuItemHelp,
+};
+static const MenuItem kMenuPoweredTail[] = {
+    MenuItemPowerOff,
+#if FEATURE_RACK
+    MenuItemRack,
+#endif
+#if FEATURE_BURST
+    MenuItemBurst,
+#endif
+#if FEATURE_SWEEP
+    MenuItemSweep,
+#endif
+#if FEATURE_JITTER
+    MenuItemJitter,
+#endif
+    MenuItemSettings,
+#if FEATURE_POWER_STATS
+    MenuItemPowerStats,
+#endif
+#if FEATURE_TREND
+    MenuItemTrend,
+#endif
+#if FEATURE_ODOMETER
+    MenuItemOdometer,
+#endif
+#if FEATURE_HISTORY
+    MenuItemHistory,
+#endif
+    MenuItemHelp,
+};
+
+static uint8_t menu_row_total(bool powered){
+    return powered ? (uint8_t)(MODE_COUNT + COUNT_OF(kMenuPoweredTail)) : (uint8_t)COUNT_OF(kMenuSafe);
+}
+static MenuItem menu_item_at(bool powered, uint8_t row){
+    if(!powered) return (row < COUNT_OF(kMenuSafe)) ? kMenuSafe[row] : MenuItemHelp;
+    if(row < MODE_COUNT) return MenuItemMode;
+    row = (uint8_t)(row - MODE_COUNT);
+    return (row < COUNT_OF(kMenuPoweredTail)) ? kMenuPoweredTail[row] : MenuItemHelp;
+}
+static const char* menu_item_name(MenuItem item){
+    switch(item){
+        case MenuItemPowerOn:    return "Power on";
+        case MenuItemSchedule:   return "Delayed start";
+        case MenuItemPowerOff:   return "Power off";
+        case MenuItemRack:       return "Rack test";
+        case MenuItemBurst:      return "Pulse burst";
+        case MenuItemSweep:      return "Vibration sweep";
+        case MenuItemJitter:     return "PWM jitter";
+        case MenuItemSettings:   return "Settings";
+        case MenuItemPowerStats: return "Power stats";
+        case MenuItemTrend:      return "Trend";
+        case MenuItemOdometer:   return "Run hours";
+        case MenuItemHistory:    return "History";
+        case MenuItemHelp:       return "Help";
+        default:                 return "";
+    }
+}
+#endif /* FEATURE_GUI */
+
 typedef enum {
     InvEmbraco = 0,
     InvSamsung = 1,
 } InverterId;
 
+/* Settings rows (visual order) */
+typedef enum {
+    SetRowLimit = 0,            /* Limit run time Yes/No */
+    SetRowCaptcha,              /* Arrow captcha Yes/No */
+#if FEATURE_BACKGROUND
+    SetRowBackground,           /* Background run Yes/No */
+#endif
+#if FEATURE_POWER_SAVE
+    SetRowPowerSave,            /* Power save Off/Dim/Dark */
+#endif
+#if FEATURE_RECORDER
+    SetRowRecorder,             /* Recorder Off/10 Hz/100 Hz */
+#endif
+#if FEATURE_ODOMETER
+    SetRowUnit,                 /* unit the run hours go to, 1..ODO_UNITS */
+#endif
+#if FEATURE_PRESSURE
+    SetRowPressure,             /* Pressure Off/bar/psi */
+#endif
+#if FEATURE_ESTOP
+    SetRowEstop,                /* E-stop pin Off/On */
+#endif
+#if FEATURE_SAMSUNG
+    SetRowInvHeader,            /* "Inverter type" header, non-selectable */
+    SetRowEmbraco,
+    SetRowSamsung,
+#endif
+    SetRowCount,
+} SettingsRow;
+
+/* Display power policy while a PWM mode runs (screen mostly shows a countdown) */
+typedef enum {
+    PowerSaveOff = 0,           /* system default backlight handling */
+    PowerSaveDim,               /* dim after DISP_DIM_AFTER_MS */
+    PowerSaveDark,              /* dim, then backlight off after DISP_OFF_AFTER_MS */
+    PowerSaveCount,
+} PowerSave;
+
+/* State recorder sample rate (recorder.c); events are always exact */
+typedef enum {
+    RecRateOff = 0,
+    RecRate10Hz,
+    RecRate100Hz,
+    RecRateCount,
+} RecRate;
+
+typedef enum {
+    DispOn = 0,
+    DispDim,
+    DispOff,
+} DisplayState;
+
+/* Confirm overlays are drawn over the current screen by our own view port,
+ * so the main loop (timers, auto-off, redraws) keeps running while they are up. */
+typedef enum {
+    ConfirmNone = 0,
+    ConfirmPowerOn,             /* safe menu -> powered menu */
+    ConfirmLimitOff,            /* Settings: Limit run time Yes -> No */
+    ConfirmSchedule,            /* Delayed start: arm */
+    ConfirmBackground,          /* long BACK: leave the run to TIM1 */
+} ConfirmId;
+
+/* ---------- Main-loop events ---------- */
+/* Everything that wakes the main loop arrives through the queue, so it can
+ * block without a timeout (tickless idle) instead of polling flags. */
+typedef enum {
+    AppEventInput = 0,          /* key event from the view port */
+    AppEventTimeout,            /* off_timer fired (see timeout_expired) */
+    AppEventDisplay,            /* disp_timer fired: next power-save step */
+    AppEventHeartbeat,          /* hb_timer: proves timers + main loop alive */
+    AppEventSafety,             /* supervisor forced Hi-Z; resync the UI */
+    AppEventPowerSample,        /* power_timer: read the fuel gauge */
+    AppEventRecSpill,           /* rec_timer: move recorder ring to SD */
+    AppEventSeq,                /* a sequence's SEQ_WAIT_MS is over */
+    AppEventCli,                /* command from the "embraco" CLI command */
+    AppEventOdoFlush,           /* odo.flush_timer: write the run hours */
+    AppEventBurst,              /* burst.timer: burst should be over */
+    AppEventSweep,              /* sweep.timer: drain the sensor FIFO */
+    AppEventJitter,             /* jit.timer: drain the capture ring, add load */
+    AppEventPressure,           /* press.timer: refresh the live readings */
+    AppEventSchedule,           /* RTC alarm: delayed start is due */
+    AppEventTrend,              /* trend.timer: a column is complete */
+    AppEventEstop,              /* e-stop handler forced Hi-Z; resync the UI */
+    AppEventBoot,               /* draw_cb: first frame is out (launch timing) */
+} AppEventType;
+
+typedef struct {
+    AppEventType type;
+    union {
+        InputEvent input;       /* AppEventInput */
+        struct {
+            uint8_t cmd;        /* CliCmd */
+            uint8_t mode;       /* CliCmdBurst: kModes[] index */
+            int32_t arg;
+        } cli;                  /* AppEventCli */
+        uint8_t seq;            /* AppEventSeq: SeqId */
+    };
+} AppEvent;
+
+/* ---------- Sequences ---------- */
+/* Stackless coroutines run by the main loop. A body is written top to
+ * bottom; SEQ_WAIT_MS() stores the line it stopped at and arms the sequence's
+ * one-shot timer, which posts AppEventSeq, and the main loop calls the body
+ * again to carry on from that line. SEQ_AWAIT() stops without a timer, for a
+ * wake the owner delivers itself (seq_run). Between steps a sequence is a
+ * stopped timer: no thread, no stack, no polling, 12 bytes of state.
+ * Locals do not survive a wait (keep them in the owner's state), and there
+ * may be only one wait per source line. */
+typedef enum {
+    SeqRack = 0,                /* relay mux: release, settle, dwell per unit */
+    SeqHint,                    /* "hold BACK to exit" for HINT_MS */
+    SeqCount,
+} SeqId;
+
+typedef struct {
+    uint16_t line;              /* resume point, 0 = idle (or start) */
+    uint8_t  id;                /* SeqId, carried by AppEventSeq */
+    FuriMessageQueue* q;
+    FuriTimer* timer;           /* allocated on the first wait */
+} Seq;
+
+#define SEQ_BEGIN(sq)       switch((sq)->line){ case 0:
+#define SEQ_WAIT_MS(sq, ms) do{ (sq)->line = __LINE__; seq_arm((sq), (ms)); return; case __LINE__:; }while(0)
+#define SEQ_AWAIT(sq)       do{ (sq)->line = __LINE__; return; case __LINE__:; }while(0)
+#define SEQ_END(sq)         } (sq)->line = 0
+
+enum {
+    HINT_MS = 1500,
+};
+
+/* ---------- Safety supervisor ---------- */
+/* Independent of the main loop and the timer service: a highest-priority
+ * thread that only needs the kernel tick. While PWM is live (armed), the main
+ * loop must wake at least every SUP_STALL_MS (hb_timer posts heartbeats every
+ * SUP_HEARTBEAT_MS); otherwise PA7 is cut to Hi-Z within
+ * SUP_STALL_MS + SUP_POLL_MS + one thread switch.
+ * A crash of the app is a system crash: the MCU resets and PA7 comes up Hi-Z. */
+enum {
+    SUP_HEARTBEAT_MS = 250,
+    SUP_STALL_MS     = 1000,
+    SUP_POLL_MS      = 50,
+    SUP_BOUND_MS     = SUP_STALL_MS + SUP_POLL_MS,
+};
+
+#define SUP_FLAG_STOP (1U << 0)
+#define SUP_FLAG_ARM  (1U << 1)    /* wake from the untimed wait when disarmed */
+
+typedef struct {
+    FuriThread* thread;
+    FuriMessageQueue* q;            /* where AppEventSafety goes */
+    volatile uint32_t last_kick;    /* furi_get_tick() of last main-loop wake */
+    volatile bool armed;            /* PWM live: a stall is dangerous */
+    volatile bool tripped;          /* set by the supervisor, cleared by main loop */
+    volatile uint32_t trip_latency_ms; /* stall detected -> Hi-Z, for the log */
+} Supervisor;
+
+/* ---------- Emergency stop ---------- */
+/* Two triggers that cut PA7 without waiting for the main loop:
+ *  - an external normally-closed e-stop between 17 (1W) and 8 (GND). PB14
+ *    has a pull-up, so opening the loop (button hit, wire cut) is a rising
+ *    edge on EXTI14 and the interrupt handler itself runs pwm_hw_kill();
+ *  - the OK+BACK chord, seen in the input service thread through the input
+ *    events pubsub, before the GUI routes the keys to any view port.
+ * DWT is read on handler entry and after Hi-Z; the main loop only brings the
+ * UI and TIM1 ownership in line afterwards (AppEventEstop). With the pin
+ * enabled, a PWM start while the loop is already open is cut at once. */
+#define ESTOP_CHORD ((1U << InputKeyOk) | (1U << InputKeyBack))
+
+typedef enum {
+    EstopNone = 0,
+    EstopPin,
+    EstopKeys,
+} EstopSource;
+
+typedef struct {
+    bool     pin_enabled;       /* Settings: e-stop loop wired */
+    bool     pin_armed;         /* EXTI callback installed */
+    uint8_t  keys;              /* input thread only: keys held down */
+    /* handler -> main loop */
+    volatile bool pending;
+    volatile uint8_t source;    /* EstopSource */
+    volatile uint32_t entry_cyc, cut_cyc;
+    /* last trip, for the banner and the CLI */
+    uint8_t  last_source;
+    uint32_t cut_ns;            /* handler entry -> PA7 Hi-Z */
+    uint32_t ui_us;             /* PA7 Hi-Z -> safe menu */
+    uint16_t count;
+    bool     banner;            /* title shows the trip until the next key */
+    uint8_t  swallow;           /* chord keys ignored until their release */
+    FuriPubSub* input;
+    FuriPubSubSubscription* sub;
+    FuriMessageQueue* q;
+} Estop;
+
+/* ---------- Power profile ---------- */
+/* Running per-mode average of battery draw. One fuel-gauge read every
+ * POWER_SAMPLE_MS, only while PWM runs or the Power stats screen is open
+ * (idle stays tickless). Samples taken on USB power are skipped. */
+enum {
+    POWER_SAMPLE_MS = 2000,
+};
+
+typedef struct {
+    int32_t  sum_ma[MODE_COUNT];    /* discharge current, mA */
+    uint32_t n[MODE_COUNT];
+    int32_t  pol_sum_ma[PowerSaveCount];   /* same, per display policy while PWM runs */
+    uint32_t pol_n[PowerSaveCount];
+    bool     by_policy;             /* screen shows the policy rows */
+    int16_t  last_ma;
+    uint16_t last_mv;
+    uint16_t remaining_mah;
+    uint8_t  pct;
+    bool     charging;
+} PowerProfile;
+
+/* ---------- Rack test ---------- */
+/* Runs one mode on units 1..N of the relay mux in turn. Every switch is
+ * PA7 Hi-Z (PWM stopped) -> all relays off -> RELAY_RELEASE_MS -> one relay
+ * on -> RELAY_SETTLE_MS -> mode. Contacts never move with a signal on them,
+ * and a relay is engaged only after all others had their release time, so two
+ * units are never connected at once. The dwell runs on the normal countdown
+ * (off_timer), capped at the mode's limit while Limit run time is on. */
+enum {
+    RELAY_RELEASE_MS = 20,      /* drop-out + bounce of a typical 5 V relay */
+    RELAY_SETTLE_MS  = 30,      /* pick-up + bounce */
+};
+
+typedef enum {
+    RackIdle = 0,               /* setup rows */
+    RackRelease,                /* PA7 Hi-Z, all relays off, waiting */
+    RackSettle,                 /* one relay on, waiting */
+    RackRun,                    /* mode running, dwell countdown */
+    RackDone,
+    RackWired,                  /* refused: 3 (A6) looped to 2 (A7) */
+} RackPhase;
+
+typedef enum {
+    RackRowUnits = 0,
+    RackRowMode,
+    RackRowDwell,
+    RackRowStart,
+    RackRowCount,
+} RackRow;
+
+#if FEATURE_RACK
+static const uint16_t kRackDwellSecs[] = {10, 30, 60, 120};
+#endif
+
+typedef struct {
+    RackPhase phase;
+    uint8_t units;              /* 1..RELAY_COUNT */
+    uint8_t mode;               /* kModes[] index, never Stand by */
+    uint8_t dwell;              /* kRackDwellSecs[] index */
+    uint8_t unit;               /* current unit, 0-based */
+    uint8_t row;                /* RackRow on the setup screen */
+} RackTest;
+
+/* ---------- Pulse burst ---------- */
+/* Diagnostic: exactly N periods of one mode's frequency from Stand by, then
+ * LOW. TIM1 counts them itself (repetition counter + one-pulse mode), so UI
+ * load cannot add or drop a pulse; the main loop only notices the end
+ * (burst.timer) and returns TIM1 to the HAL. */
+typedef enum {
+    BurstIdle = 0,              /* setup rows */
+    BurstRunning,
+    BurstDone,                  /* result shown until BACK/OK */
+} BurstPhase;
+
+typedef enum {
+    BurstRowMode = 0,
+    BurstRowPulses,
+    BurstRowStart,
+    BurstRowCount,
+} BurstRow;
+
+#if FEATURE_BURST && FEATURE_GUI
+static const uint16_t kBurstPulses[] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000};
+#endif
+
+typedef struct {
+    BurstPhase phase;
+    uint8_t  mode;              /* kModes[] index, never Stand by */
+    uint8_t  preset;            /* kBurstPulses[] index */
+    uint8_t  row;               /* BurstRow on the setup screen */
+    uint32_t pulses;            /* current / last burst */
+    bool     aborted;           /* last burst was cut short */
+    FuriTimer* timer;           /* end of burst + margin */
+} BurstTest;
+
+/* ---------- Vibration sweep ---------- */
+/* Stepped run across the speed range with a LIS3DH accelerometer on the
+ * external I2C pins, to find cabinet resonances. Each step runs
+ * SWEEP_SETTLE_MS for the compressor to reach speed, then SWEEP_MEASURE_MS of
+ * samples. The sensor buffers up to 32 samples in its FIFO (80 ms at 400 Hz),
+ * and one burst read drains it every SWEEP_POLL_MS (about 12 ms of bus time at
+ * 100 kHz). The main loop is never parked on I2C longer than that, and PWM is
+ * TIM1's alone. Per step: AC RMS over all axes and Goertzel amplitudes at 1x
+ * and 2x shaft speed, all in integer math on the samples as they arrive. */
+enum {
+    SWEEP_STEPS      = 12,
+    SWEEP_F_MIN      = 55,      /* Hz: Low speed ... */
+    SWEEP_F_MAX      = 160,     /* ... Max speed */
+    SWEEP_SETTLE_MS  = 4000,
+    SWEEP_MEASURE_MS = 2000,
+    SWEEP_POLL_MS    = 50,
+    SWEEP_ODR_HZ     = 400,
+    SWEEP_FIFO       = 32,
+};
+
+typedef enum {
+    SweepIdle = 0,
+    SweepSettle,                /* new frequency, samples only track the offset */
+    SweepMeasure,
+    SweepDone,                  /* plot + table until the next start */
+} SweepPhase;
+
+typedef struct {
+    int32_t  dc_q8[3];          /* gravity/offset per axis, mg Q8 (~1 Hz high-pass) */
+    int64_t  sumsq;             /* AC energy, mg^2 */
+    int32_t  g[2][3][2];        /* Goertzel s1/s2 at 1x/2x per axis */
+    int32_t  coef_q14[2];       /* 2cos(2 pi f / fs) */
+    uint32_t n;
+} SweepAcc;
+
+typedef struct {
+    uint16_t freq_hz;
+    uint16_t rpm;
+    uint16_t rms_mg;
+    uint16_t amp_mg[2];         /* 1x, 2x shaft speed */
+} SweepPoint;
+
+typedef struct {
+    SweepPhase phase;
+    uint8_t  step;              /* running: current; done: steps completed */
+    uint8_t  cursor;            /* plot: selected step */
+    bool     no_sensor;         /* last start found no LIS3DH */
+    bool     aborted;
+    bool     overrun;           /* FIFO overflowed: some samples lost */
+    uint32_t phase_tick;
+    SweepAcc acc;
+    SweepPoint pts[SWEEP_STEPS];
+    FuriTimer* timer;           /* SWEEP_POLL_MS, only while running */
+} Sweep;
+
+/* ---------- PWM jitter ---------- */
+/* Waveform check under load. A wire from 2 (A7) to 3 (A6) loops PA7 back
+ * into TIM16 CH1, which latches the time of every rising edge in hardware
+ * (0.5 us steps); the capture interrupt only stores the 16-bit difference.
+ * Each scenario runs JITTER_PHASE_MS at Mid speed with one kind of load
+ * generated by the main loop (BLE: by the radio core, fed from the main
+ * loop), and every period's distance from the commanded one is kept, so
+ * p50/p99/max are exact rather than binned. The last
+ * scenario switches Mid <-> Max through apply_mode(), so the stop/start gap
+ * it leaves in the waveform shows up in its row. */
+enum {
+    JITTER_CLK_HZ    = 2000000, /* TIM16: 64 MHz / 32; 16 bits hold 32 ms (Low is 18 ms) */
+    JITTER_PSC       = 31,
+    JITTER_MODE      = 2,       /* kModes[] index the scenarios run at */
+    JITTER_ALT_MODE  = 3,       /* ... and the mode switch partner */
+    JITTER_PHASE_MS  = 6000,
+    JITTER_POLL_MS   = 20,      /* drain the ring + one unit of load */
+    JITTER_NOTIFY_MS = 100,
+    JITTER_SWITCH_MS = 1013,    /* prime: each switch lands at another point of the period */
+    JITTER_RING      = 32,      /* power of two; 160 Hz leaves ~4 per poll */
+    JITTER_SAMPLES   = 1024,    /* per scenario, 6 s at 160 Hz */
+    JITTER_SD_CHUNK  = 4096,
+    JITTER_SD_WRAP   = 256 * 1024,
+    JITTER_SPEAKER_MS = 100,
+    JITTER_BLE_ADV_MS = 20,     /* shortest advertising interval BLE allows */
+};
+
+typedef enum {
+    JitterIdle = 0,             /* the measurement alone */
+    JitterStorage,              /* 4 KB SD write every poll */
+    JitterGui,                  /* full frame every poll */
+    JitterNotify,               /* LED + backlight message every 100 ms */
+    JitterBle,                  /* extra beacon every 20 ms, payload rewritten every poll */
+    JitterModeSwitch,           /* apply_mode Mid <-> Max every second */
+    JitterScenarios,
+} JitterScenario;
+
+typedef struct {
+    uint16_t n;                 /* periods measured */
+    uint16_t missed;            /* ring full or capture overrun */
+    uint32_t p50_ns, p99_ns, max_ns;
+    bool     unloaded;          /* the load could not be generated (BLE off or beacon taken) */
+} JitterResult;
+
+typedef struct {
+    bool     running;
+    bool     done;              /* res[] valid up to `scenario` */
+    bool     aborted;
+    bool     no_signal;         /* not a single period: loopback wire missing */
+    uint8_t  scenario;          /* JitterScenario */
+    uint32_t phase_tick, load_tick;
+    uint32_t hz, alt_hz;        /* commanded now, and before the last switch */
+    /* capture ISR -> main loop */
+    uint16_t ring[JITTER_RING];
+    volatile uint8_t head;
+    uint8_t  tail;
+    volatile uint16_t missed;
+    uint16_t last;              /* ISR only: previous edge */
+    bool     primed;            /* ISR only: `last` is valid */
+    /* current scenario, heap only while running */
+    uint32_t* dev;              /* [JITTER_SAMPLES] |period - nominal|, ns */
+    uint16_t n;
+    File*    sd;                /* JitterStorage */
+    uint32_t sd_bytes;
+    bool     ble;               /* JitterBle: our beacon is advertising */
+    uint8_t  ble_seq;
+    JitterResult res[JitterScenarios];
+    FuriTimer* timer;           /* JITTER_POLL_MS, only while running */
+} Jitter;
+
+/* ---------- Pressure transducers ---------- */
+/* Suction and discharge from 0.5-4.5 V transducers through 1:2 dividers on
+ * PA4 (ADC1_IN9) and PC3 (ADC1_IN4). ADC1 scans both channels free-running
+ * with 256x hardware oversampling and DMA2 copies every result into a
+ * two-word circular buffer: no interrupt and no CPU work per sample. The UI
+ * only reads the latest pair, each already the mean of 256 conversions. */
+enum {
+    PRESS_VREF_MV   = 2500,     /* VREFBUF scale */
+    PRESS_DIV       = 2,        /* sensor mV per pin mV */
+    PRESS_ZERO_MV   = 500,      /* 0 bar (gauge) */
+    PRESS_SPAN_MV   = 4000,     /* 0.5 .. 4.5 V = 0 .. full scale */
+    PRESS_FAULT_MV  = 150,      /* this far outside the band: open or shorted */
+    PRESS_REDRAW_MS = 500,
+};
+
+typedef enum {
+    PressOff = 0,               /* ADC left alone */
+    PressBar,
+    PressPsi,
+    PressUnitCount,
+} PressUnit;
+
+typedef enum {
+    PressSuction = 0,
+    PressDischarge,
+    PressChannels,
+} PressChannel;
+
+typedef struct {
+    PressUnit unit;             /* Settings */
+    bool     running;           /* ADC1 + DMA are ours and converting */
+    volatile uint16_t raw[PressChannels];   /* DMA target, 12-bit means */
+    FuriHalAdcHandle* adc;
+    FuriTimer* timer;           /* menu refresh, only while running */
+} Pressure;
+
+/* ---------- Delayed start ---------- */
+/* Arms the RTC alarm for the next HH:MM and leaves everything else off: PA7
+ * Hi-Z, no timers, no insomnia, so the Flipper deep-sleeps until the alarm
+ * interrupt posts AppEventSchedule (1 s resolution). The start itself is a
+ * plain Power on + mode, so time limit, supervisor and run hours apply. */
+enum {
+    SCHED_STEP_MIN = 5,         /* ←/→ */
+    SCHED_FAST_MIN = 30,        /* ←/→ held */
+    SCHED_LEAD_S   = 60,        /* closer than this: tomorrow */
+    SCHED_DAY_S    = 24 * 60 * 60,
+};
+
+typedef enum {
+    SchedRowTime = 0,
+    SchedRowMode,
+    SchedRowArm,
+    SchedRowCount,
+} SchedRow;
+
+typedef struct {
+    bool     armed;
+    uint16_t minute;            /* start time, minutes after midnight */
+    uint8_t  mode;              /* kModes[] index, never Stand by */
+    uint8_t  row;
+    uint32_t at;                /* RTC timestamp the alarm is set for */
+} Schedule;
+
+/* ---------- Trend history ---------- */
+/* Commanded frequency and the measured values over the last minutes to hours.
+ * Level k keeps TREND_COLS min/max buckets of TREND_BASE_MS << (3 * k) each,
+ * merged from 8 buckets of the level below, so any zoom is drawn from at most
+ * TREND_COLS buckets however long the app has run. Nothing wakes the app for
+ * it: the frequency is taken after every main-loop event, pressure and battery
+ * draw when their own timers sample them, and a quiet stretch is filled in
+ * with the held values on the next wake. */
+enum {
+    TREND_COLS    = 100,        /* plot width, px */
+    TREND_LEVELS  = 4,          /* 1 s, 8 s, 64 s, 512 s per column */
+    TREND_SHIFT   = 3,          /* x8 per level */
+    TREND_BASE_MS = 1000,
+    TREND_HOLD_MS = 2500,       /* a sample stands this long, then a gap (power: every 2 s) */
+};
+
+typedef enum {
+    TrendSuction = 0,           /* 10 mbar units (fits int16 up to 500 psi) */
+    TrendDischarge,
+    TrendBattery,               /* discharge, mA */
+    TrendChannels,              /* on screen: speed only */
+} TrendChannel;
+
+typedef struct {
+    uint8_t hz_lo, hz_hi;       /* commanded, 0 = no PWM */
+    int16_t lo[TrendChannels];  /* lo > hi: nothing sampled */
+    int16_t hi[TrendChannels];
+} TrendBucket;
+
+typedef struct {
+    TrendBucket col[TREND_COLS];    /* ring, newest at head - 1 */
+    TrendBucket open;               /* the bucket being filled */
+    uint8_t head;
+    uint8_t count;
+} TrendLevel;
+
+typedef struct {
+    TrendLevel* lv;             /* [TREND_LEVELS], heap (5.6 KB) */
+    uint32_t origin;            /* tick where base bucket 0 starts */
+    uint32_t closed;            /* base buckets completed */
+    uint8_t  hz;                /* commanded since the last update */
+    int16_t  val[TrendChannels];
+    uint32_t until[TrendChannels];  /* tick where val[] stops counting */
+    uint8_t  fresh;             /* levels with a new column since the last frame */
+    uint8_t  zoom;              /* level on screen */
+    uint8_t  view;              /* kTrendViews[] index */
+    FuriTimer* timer;           /* next column of the zoom, only while on screen */
+} Trend;
+
+/* ---------- Pulse odometer ---------- */
+/* Every PA7 period is counted in hardware: TIM2 (32-bit) is clocked by TIM1's
+ * update event (TIM1 TRGO -> ITR0, external clock mode 1), so a run costs no
+ * CPU at all. The counter is only read when the output changes hands (mode
+ * change, background handoff, exit) and the difference goes to the unit and
+ * speed band that was running; time and revolutions are derived from pulses.
+ * Totals live in ODO_SLOTS rotating records (seq + CRC, the newest valid one
+ * wins), written at most every ODO_FLUSH_MS while dirty and on exit. */
+enum {
+    ODO_UNITS    = 8,
+    ODO_SLOTS    = 8,
+    ODO_FLUSH_MS = 10 * 60 * 1000,
+};
+#define ODO_BANDS (MODE_COUNT - 1)  /* Low/Mid/Max: kModes[band + 1] */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint64_t pulses[ODO_UNITS][ODO_BANDS];
+    uint32_t crc;               /* over everything above */
+} OdoRecord;
+
+typedef struct {
+    OdoRecord rec;
+    bool     loaded;            /* rec holds the stored totals (first use, not launch) */
+    bool     hw;                /* TIM2 is ours and counting */
+    bool     hw_tried;          /* TIM2 asked for once, at the first PWM start */
+    bool     dirty;             /* rec differs from the newest slot */
+    uint8_t  unit;              /* direct runs go here (Settings), 0-based */
+    uint8_t  run_unit;          /* owner of the pulses since `mark` */
+    uint8_t  run_band;          /* kModes[] index, 0 = nothing running */
+    uint32_t mark;              /* TIM2 CNT at the last collect */
+    uint8_t  view;              /* unit on the Run hours screen */
+    FuriTimer* flush_timer;
+} Odometer;
+
+/* ---------- Test history ---------- */
+/* Every finished run and test becomes one HistRecord (history.c) carrying
+ * the serial of its unit slot, the same slot the odometer books to. A run is
+ * PA7 in one mode from apply_mode until anything else happens to PA7;
+ * burst, sweep and jitter write their own record when they end. Records
+ * wait in RAM until PWM is off (supervisor disarmed): the first open of the
+ * store re-indexes, and SD writes block the main loop long enough to look
+ * like a stall. The store is never opened at launch. */
+enum {
+    HIST_MIN_MS = 1000,         /* a mode passed through faster is not a run */
+    HIST_VIEW   = 16,           /* records fetched for the History screen */
+    HIST_ROWS   = 3,            /* of which on screen */
+    HIST_DIGITS = 6,            /* serial editor: 000000..999999 */
+    HIST_PEND   = 16,           /* records held while PWM is live */
+};
+
+typedef struct {
+    History* db;
+    FuriMutex* lock;            /* db: main loop appends, CLI looks up */
+    uint32_t serial[ODO_UNITS]; /* per unit slot, 0 = not set */
+    HistResult end;             /* what ends the next run/test: HistStopped unless set */
+    uint8_t  seg_mode;          /* kModes[] index of the open run, 0 = none */
+    uint8_t  seg_unit;
+    uint32_t seg_tick, seg_time;
+    uint32_t test_tick, test_time;  /* burst / sweep / jitter start */
+    HistRecord* pend;           /* [HIST_PEND] not yet in the store (main loop only); heap */
+    uint8_t  pend_n;
+    /* History screen */
+    uint8_t  view;              /* unit slot shown */
+    uint8_t  top;
+    uint8_t  n;                 /* rows[] filled */
+    bool     deferred;          /* store not opened: PWM live */
+    bool     editing;           /* serial editor open ... */
+    uint8_t  digit;             /* ... on this digit, 0 = most significant */
+    HistRecord* rows;           /* [HIST_VIEW], newest first; heap, kept until exit */
+} TestHistory;
+
 /* ---------- App state ---------- */
 typedef struct {
     /* where we are */
@@ -160,23 +1047,82 @@ typedef struct {
     uint8_t active;         /* 0..MODE_COUNT-1 — selected powered mode (checkmark on right) */
 
     /* help scroll */
-    uint8_t help_top_line;
+    uint16_t help_top_px;   /* window offset into the help page */
 
     /* settings */
     bool limit_runtime;     /* Yes/No — per-mode timeout enforcement */
     bool arrow_captcha;     /* Yes/No — placeholder toggle (default Yes) */
+    bool background_run;    /* Yes/No — long BACK leaves a limited run in TIM1 */
 
-    /* LED blink */
-    NotificationApp* notif;
-    FuriTimer* led_timer;
-    bool led_on;
+    /* LED blink (runs in the LED driver; we only re-arm on change) */
+    NotificationApp* notif; /* opened on first use (app_notify) */
+    uint8_t led_blink_hz;   /* currently armed pattern, 0 = off */
 
     /* PWM running flag */
     bool pwm_running;
 
+    /* state recorder (allocated on first enable, paused when Off) */
+    RecRate rec_rate;
+    Recorder* rec;
+    FuriTimer* rec_timer;
+    uint32_t rec_samples;
+
+    /* battery draw per mode */
+    PowerProfile prof;
+    FuriTimer* power_timer;
+
+    /* safety supervisor + its heartbeat source */
+    Supervisor sup;
+    FuriTimer* hb_timer;
+
+    /* interrupt-level e-stop (pin + key chord) */
+    Estop estop;
+
+    /* relay-mux sequential test */
+    RackTest rack;
+
+    /* pulses per unit and speed band (TIM2) */
+    Odometer odo;
+
+    /* finished runs and tests, by unit serial */
+    TestHistory hist;
+
+    /* exact N-period burst */
+    BurstTest burst;
+
+    /* speed sweep with the accelerometer */
+    Sweep sweep;
+
+    /* loopback capture of PA7 under load */
+    Jitter jit;
+
+    /* suction/discharge transducers (ADC1 scan + DMA) */
+    Pressure press;
+
+    /* RTC-armed start */
+    Schedule sched;
+
+    /* min/max history for the Trend screen */
+    Trend trend;
+
+    /* insomnia held: TIM1 stops in deep sleep, so only idle while PWM is off */
+    bool power_hold;
+
+    /* display power policy */
+    PowerSave power_save;
+    DisplayState disp;
+    FuriTimer* disp_timer;
+    InputKey wake_key;      /* key that woke a dark screen ... */
+    bool wake_swallow;      /* ... is swallowed until its release */
+
+    /* confirm overlay (ConfirmNone when hidden) */
+    ConfirmId confirm;
+
     /* back-hint overlay */
     bool hint_visible;
-    FuriTimer* hint_timer;
+
+    /* multi-step sequences (SeqId) */
+    Seq seq[SeqCount];
 
     /* countdown / auto-off */
     FuriTimer* tick_timer;  /* 1 Hz UI update */
@@ -184,607 +1130,4059 @@ typedef struct {
     uint32_t remaining_ms;  /* 0 if none */
     bool timeout_expired;   /* event flag serviced in loop */
 
+    /* launch timing (DWT cycles at entry, us since entry) */
+    uint32_t boot_cyc;
+    uint32_t boot_pwm_ready_us;     /* main loop accepts keys: PA7 can be driven */
+    volatile uint32_t boot_frame_us;/* first draw_cb (GUI thread) */
+    bool boot_logged;
+
     /* IO */
     Gui* gui;
     ViewPort* vp;
     FuriMessageQueue* q;
 } AppState;
 
-/* ---------- LED helpers ---------- */
-static void led_set(NotificationApp* n, bool on){
-    if(!n) return;
-    if(on) notification_message(n, &sequence_set_green_255);
-    else   notification_message(n, &sequence_reset_rgb);
+/* Sweep and burst state exist in every variant; only their sequencing is optional */
+static inline bool sweep_busy(const AppState* s){
+    return s->sweep.phase == SweepSettle || s->sweep.phase == SweepMeasure;
 }
-static void led_timer_cb(void* ctx){
-    AppState* s = ctx;
-    s->led_on = !s->led_on;
-    led_set(s->notif, s->led_on);
+static inline bool burst_busy(const AppState* s){
+    return s->burst.phase == BurstRunning;
 }
-static void led_apply(AppState* s, uint8_t blink_hz){
-    if(s->led_timer){
-        furi_timer_stop(s->led_timer);
-        furi_timer_free(s->led_timer);
-        s->led_timer = NULL;
-    }
-    s->led_on = false;
-    led_set(s->notif, false);
-
-    if(blink_hz == 0) return;
-    uint32_t ms = 1000U / (blink_hz * 2U); /* toggle period for 50% blink */
-    if(ms == 0) ms = 1;
-    s->led_timer = furi_timer_alloc(led_timer_cb, FuriTimerTypePeriodic, s);
-    furi_timer_start(s->led_timer, furi_ms_to_ticks(ms));
+static inline bool jitter_busy(const AppState* s){
+    return s->jit.running;
 }
 
-/* ---------- Dotted scrollbar (Momentum-like) ---------- */
-static void draw_scrollbar_dotted(Canvas* c, uint16_t total_steps, uint16_t pos){
-    if(total_steps <= 1) return;
-
-    const uint16_t x  = SCROLLBAR_X;
-    const uint16_t y0 = SCROLLBAR_Y0;
-    const uint16_t y1 = SCROLLBAR_Y1;
-
-    /* rail (dotted) */
-    for(uint16_t y = y0; y <= y1; y += 3){
-        canvas_draw_dot(c, x, y);
-    }
+/* ---------- Output frequency ---------- */
+/* What PA7 is driven at right now; 0 without PWM. Sweeps and bursts drive
+ * PA7 with active left at Stand by, so active alone is not enough. */
+static inline uint32_t pwm_freq_now(const AppState* s){
+    if(!s->pwm_running) return 0;
+    if(sweep_busy(s)) return s->sweep.pts[s->sweep.step].freq_hz;
+    if(burst_busy(s)) return kModes[s->burst.mode].freq_hz;
+    return kModes[s->active].freq_hz;
+}
 
-    /* thumb position (instant to cursor) */
-    const uint16_t track_h = (uint16_t)(y1 - y0);
-    uint16_t denom = (total_steps > 1) ? (uint16_t)(total_steps - 1) : 1;
-    uint16_t thumb_y = (uint16_t)(y0 + (pos * track_h) / denom);
+/* ---------- Recorder hooks ---------- */
+#if FEATURE_RECORDER
+static inline void rec_note_timer(AppState* s, ErcTimerId t){
+    if(s->rec_rate != RecRateOff && s->rec) recorder_timer(s->rec, t);
+}
+static inline void rec_note_input(AppState* s, const InputEvent* ev){
+    if(s->rec_rate != RecRateOff && s->rec) recorder_input(s->rec, (uint8_t)ev->key, (uint8_t)ev->type);
+}
+#else
+static inline void rec_note_timer(AppState* s, ErcTimerId t){ UNUSED(s); UNUSED(t); }
+#endif
 
-    /* let the bottom of thumb "eat" last dot and rest on the screen bottom:
-       thumb is 4px high, we center it around thumb_y (-> top at thumb_y-1) */
-    if(thumb_y > (uint16_t)(y1 - 1)) thumb_y = (uint16_t)(y1 - 1);
-    if(thumb_y < y0) thumb_y = y0;
+/* ---------- Launch timing ---------- */
+static inline uint32_t boot_elapsed_us(const AppState* s){
+    return (DWT->CYCCNT - s->boot_cyc) / furi_hal_cortex_instructions_per_microsecond();
+}
 
-    canvas_draw_box(c, (uint16_t)(x - 1), (uint16_t)(thumb_y - 1), SCROLLBAR_W, 4);
+/* ---------- Redraw ---------- */
+static inline void app_redraw(AppState* s){
+#if FEATURE_GUI
+    if(s->vp) view_port_update(s->vp);
+#else
+    UNUSED(s);
+#endif
 }
 
-/* ---------- Pretty checkmark (7x7), lowered by 1px ---------- */
-static void draw_checkmark(Canvas* c, int x, int baseline_y){
-    /* draw as two joined 1px segments, visually balanced */
-    int y = baseline_y - 6; /* подняли на 2 px выше */
-    canvas_draw_line(c, x,     y+3, x+2, y+5);
-    canvas_draw_line(c, x+2,   y+5, x+7, y   );
+/* ---------- Sequence runner ---------- */
+/* Only the hint and the rack bodies wait on a timer */
+#if FEATURE_GUI || FEATURE_RACK
+static void seq_timer_cb(void* ctx){
+    Seq* sq = ctx;
+    AppEvent ev = {.type = AppEventSeq, .seq = sq->id};
+    furi_message_queue_put(sq->q, &ev, 0);
 }
 
-/* ---------- Countdown & auto-off ---------- */
-static void tick_timer_cb(void* ctx){
-    AppState* s = ctx;
-    if(s->remaining_ms >= 1000) s->remaining_ms -= 1000;
-    else s->remaining_ms = 0;
-    if(s->vp) view_port_update(s->vp);
+static void seq_arm(Seq* sq, uint32_t ms){
+    if(!sq->timer) sq->timer = furi_timer_alloc(seq_timer_cb, FuriTimerTypeOnce, sq);
+    furi_timer_start(sq->timer, furi_ms_to_ticks(ms));
 }
-static void off_timer_cb(void* ctx){
-    AppState* s = ctx;
-    s->remaining_ms = 0;
-    s->timeout_expired = true;
-    if(s->vp) view_port_update(s->vp);
+#endif
+
+/* Back to idle; a wake already queued finds line 0 and is dropped */
+static void seq_cancel(Seq* sq){
+    if(sq->timer) furi_timer_stop(sq->timer);
+    sq->line = 0;
 }
-static void stop_timers(AppState* s){
-    if(s->tick_timer) furi_timer_stop(s->tick_timer);
-    if(s->off_timer)  furi_timer_stop(s->off_timer);
+
+static inline bool seq_busy(const Seq* sq){
+    return sq->line != 0;
 }
-static void free_timers(AppState* s){
-    if(s->tick_timer){ furi_timer_free(s->tick_timer); s->tick_timer = NULL; }
-    if(s->off_timer){  furi_timer_free(s->off_timer);  s->off_timer  = NULL; }
+
+static void seq_free(Seq* sq){
+    seq_cancel(sq);
+    if(sq->timer){ furi_timer_free(sq->timer); sq->timer = NULL; }
 }
-static void start_tick_timer_if_needed(AppState* s){
-    stop_timers(s);
-    s->remaining_ms = 0;
-    s->timeout_expired = false;
 
-    if(!s->powered) return;          /* only in powered menu */
-    if(!s->limit_runtime) return;    /* unlimited => no timers */
-    if(s->active == 0) return;       /* Stand by => no countdown */
+/* ---------- Notification (lazy) ---------- */
+/* The record is opened on the first LED/backlight message, not on launch */
+static void app_notify(AppState* s, const NotificationSequence* seq){
+    if(!s->notif) s->notif = furi_record_open(RECORD_NOTIFICATION);
+    notification_message(s->notif, seq);
+}
 
-    uint32_t secs = kModes[s->active].default_secs;
-    if(secs == 0) return;
+/* ---------- LED helpers ---------- */
+/* 50% green blink executed by the LED driver's own engine: one message per
+ * mode change, no timer and no notification traffic while the mode runs. */
+#define LED_BLINK_MSG(period_ms)                        \
+    {                                                   \
+        .type = NotificationMessageTypeLedBlinkStart,   \
+        .data.led_blink.on_time = (period_ms) / 2,      \
+        .data.led_blink.period = (period_ms),           \
+        .data.led_blink.color = LightGreen,             \
+    }
 
-    s->remaining_ms = secs * 1000U;
+static const NotificationMessage led_blink_1hz = LED_BLINK_MSG(1000);
+static const NotificationMessage led_blink_2hz = LED_BLINK_MSG(500);
+static const NotificationMessage led_blink_4hz = LED_BLINK_MSG(250);
 
-    if(!s->tick_timer) s->tick_timer = furi_timer_alloc(tick_timer_cb, FuriTimerTypePeriodic, s);
-    if(!s->off_timer)  s->off_timer  = furi_timer_alloc(off_timer_cb,  FuriTimerTypeOnce,     s);
+static const NotificationSequence seq_led_blink_1hz = {
+    &led_blink_1hz, &message_blink_set_color_green, &message_do_not_reset, NULL,
+};
+static const NotificationSequence seq_led_blink_2hz = {
+    &led_blink_2hz, &message_blink_set_color_green, &message_do_not_reset, NULL,
+};
+static const NotificationSequence seq_led_blink_4hz = {
+    &led_blink_4hz, &message_blink_set_color_green, &message_do_not_reset, NULL,
+};
 
-    furi_timer_start(s->tick_timer, furi_ms_to_ticks(1000));
-    furi_timer_start(s->off_timer,  furi_ms_to_ticks(s->remaining_ms));
+static const NotificationSequence* led_blink_sequence(uint8_t blink_hz){
+    switch(blink_hz){
+        case 1:  return &seq_led_blink_1hz;
+        case 2:  return &seq_led_blink_2hz;
+        case 4:  return &seq_led_blink_4hz;
+        default: return NULL;
+    }
 }
 
+static void led_apply(AppState* s, uint8_t blink_hz){
+    if(blink_hz == s->led_blink_hz) return;     /* already armed */
+
+    const NotificationSequence* seq = led_blink_sequence(blink_hz);
+    if(seq){
+        app_notify(s, seq);                     /* restarts the engine with new timing */
+        s->led_blink_hz = blink_hz;
+    } else {
+        app_notify(s, &sequence_blink_stop);
+        s->led_blink_hz = 0;
+    }
+}
+
+/* ---------- Display power ---------- */
+#if FEATURE_POWER_SAVE
+enum {
+    DISP_DIM_AFTER_MS = 15000,  /* no key for 15 s while running => dim */
+    DISP_OFF_AFTER_MS = 30000,  /* then 30 s more => backlight off (Dark) */
+};
+
+static const NotificationMessage msg_display_dim_brightness = {
+    .type = NotificationMessageTypeForceDisplayBrightnessSetting,
+    .data.forced_settings.display_brightness = 0.1f,
+};
+static const NotificationSequence seq_display_dim = {
+    &msg_display_dim_brightness, &message_display_backlight_on, NULL,
+};
+
+static void disp_timer_cb(void* ctx){
+    AppState* s = ctx;
+    rec_note_timer(s, ErcTimerDisplay);
+    AppEvent ev = {.type = AppEventDisplay};
+    if(s->q) furi_message_queue_put(s->q, &ev, 0);
+}
+
+/* Full brightness and full-rate redraws; used on keys and safety-relevant changes */
+static void display_wake(AppState* s){
+    if(s->disp_timer) furi_timer_stop(s->disp_timer);
+    if(s->disp != DispOn){
+        s->disp = DispOn;
+        app_notify(s, &sequence_display_backlight_on);
+        app_redraw(s);
+    }
+}
+
+/* (Re)start the inactivity countdown if the policy applies right now */
+static void display_policy_sync(AppState* s){
+    if(s->power_save == PowerSaveOff || !s->pwm_running){
+        display_wake(s);
+        return;
+    }
+    if(s->disp != DispOn) return;
+    if(!s->disp_timer) s->disp_timer = furi_timer_alloc(disp_timer_cb, FuriTimerTypeOnce, s);
+    furi_timer_start(s->disp_timer, furi_ms_to_ticks(DISP_DIM_AFTER_MS));
+}
+
+/* AppEventDisplay: On -> Dim -> Off (Dark policy only) */
+static void display_step(AppState* s){
+    if(s->power_save == PowerSaveOff || !s->pwm_running) return;
+    if(s->disp == DispOn){
+        s->disp = DispDim;
+        app_notify(s, &seq_display_dim);
+        if(s->power_save == PowerSaveDark){
+            furi_timer_start(s->disp_timer, furi_ms_to_ticks(DISP_OFF_AFTER_MS));
+        }
+    } else if(s->disp == DispDim && s->power_save == PowerSaveDark){
+        s->disp = DispOff;
+        app_notify(s, &sequence_display_backlight_off);
+    }
+}
+
+/* Any key restores the display. The key that woke a dark screen is not acted
+ * on (the user could not see what it would do), except a long press. */
+static bool display_on_input(AppState* s, const InputEvent* ev){
+    if(ev->type == InputTypePress){
+        s->wake_swallow = (s->disp == DispOff);
+        s->wake_key = ev->key;
+    }
+    bool swallow = false;
+    if(s->wake_swallow && ev->key == s->wake_key){
+        swallow = (ev->type != InputTypeLong);
+        if(ev->type == InputTypeRelease) s->wake_swallow = false;
+    }
+    display_wake(s);
+    display_policy_sync(s);
+    return swallow;
+}
+
+/* With the backlight off, the 1 Hz countdown only redraws every 10 s and for the last 10 s */
+static bool display_tick_visible(const AppState* s){
+    if(s->disp != DispOff) return true;
+    uint32_t sec = (s->remaining_ms + 999U) / 1000U;
+    return (sec <= 10U) || (sec % 10U == 0U);
+}
+#else
+static inline void display_wake(AppState* s){ UNUSED(s); }
+static inline void display_policy_sync(AppState* s){ UNUSED(s); }
+static inline void display_step(AppState* s){ UNUSED(s); }
+static inline bool display_on_input(AppState* s, const InputEvent* ev){ UNUSED(s); UNUSED(ev); return false; }
+static inline bool display_tick_visible(const AppState* s){ UNUSED(s); return true; }
+#endif
+
+#if FEATURE_ESTOP
+/* ---------- Emergency stop ---------- */
+static const GpioPin* const ESTOP_PIN = &gpio_ibutton;  /* 17 (1W), PB14 / EXTI14 */
+
+/* Any context, any priority: Hi-Z first, bookkeeping after. While a trip is
+ * pending, a second one still cuts but keeps the first one's timing. */
+static void estop_cut(Estop* e, EstopSource src){
+    uint32_t entry = DWT->CYCCNT;
+    pwm_hw_kill();
+    uint32_t cut = DWT->CYCCNT;
+    if(e->pending) return;
+    e->entry_cyc = entry;
+    e->cut_cyc = cut;
+    e->source = (uint8_t)src;
+    e->pending = true;
+    AppEvent ev = {.type = AppEventEstop};
+    furi_message_queue_put(e->q, &ev, 0);
+}
+
+/* EXTI14: the normally-closed loop opened */
+static void estop_pin_isr(void* ctx){
+    estop_cut(ctx, EstopPin);
+}
+
+/* Input service thread: every key event in the system, whoever owns the screen */
+static void estop_input_cb(const void* msg, void* ctx){
+    const InputEvent* ev = msg;
+    Estop* e = ctx;
+    if(ev->key >= InputKeyMAX) return;
+    uint8_t bit = (uint8_t)(1U << ev->key);
+    if(ev->type == InputTypePress){
+        e->keys |= bit;
+        if((e->keys & ESTOP_CHORD) == ESTOP_CHORD) estop_cut(e, EstopKeys);
+    } else if(ev->type == InputTypeRelease){
+        e->keys &= (uint8_t)~bit;
+    }
+}
+
+/* PWM only runs into a closed loop: a start with it open (or unwired) is cut */
+static void estop_check_loop(AppState* s){
+    if(s->estop.pin_armed && s->pwm_running && furi_hal_gpio_read(ESTOP_PIN)){
+        estop_cut(&s->estop, EstopPin);
+    }
+}
+
+/* EXTI on PB14 follows the setting */
+static void estop_pin_sync(AppState* s){
+    Estop* e = &s->estop;
+    if(e->pin_enabled && !e->pin_armed){
+        furi_hal_gpio_init(ESTOP_PIN, GpioModeInterruptRise, GpioPullUp, GpioSpeedLow);
+        furi_hal_gpio_add_int_callback(ESTOP_PIN, estop_pin_isr, e);
+        e->pin_armed = true;
+        estop_check_loop(s);
+    } else if(!e->pin_enabled && e->pin_armed){
+        furi_hal_gpio_remove_int_callback(ESTOP_PIN);
+        furi_hal_gpio_init(ESTOP_PIN, GpioModeAnalog, GpioPullNo, GpioSpeedLow);
+        e->pin_armed = false;
+    }
+}
+
+static void estop_start(AppState* s){
+    Estop* e = &s->estop;
+    e->q = s->q;
+    e->input = furi_record_open(RECORD_INPUT_EVENTS);
+    e->sub = furi_pubsub_subscribe(e->input, estop_input_cb, e);
+    estop_pin_sync(s);
+}
+
+/* The setting itself survives (it is saved after this) */
+static void estop_stop(AppState* s){
+    Estop* e = &s->estop;
+    if(e->sub){
+        furi_pubsub_unsubscribe(e->input, e->sub);
+        furi_record_close(RECORD_INPUT_EVENTS);
+        e->sub = NULL;
+    }
+    bool enabled = e->pin_enabled;
+    e->pin_enabled = false;
+    estop_pin_sync(s);
+    e->pin_enabled = enabled;
+}
+#else
+static inline void estop_check_loop(AppState* s){ UNUSED(s); }
+static inline void estop_pin_sync(AppState* s){ UNUSED(s); }
+static inline void estop_start(AppState* s){ UNUSED(s); }
+static inline void estop_stop(AppState* s){ UNUSED(s); }
+#endif
+
+/* ---------- Safety supervisor ---------- */
+static int32_t supervisor_thread(void* ctx){
+    Supervisor* sup = ctx;
+    for(;;){
+        /* disarmed: sleep untimed so idle stays tickless */
+        uint32_t timeout = sup->armed ? furi_ms_to_ticks(SUP_POLL_MS) : FuriWaitForever;
+        uint32_t flags = furi_thread_flags_wait(SUP_FLAG_STOP | SUP_FLAG_ARM, FuriFlagWaitAny, timeout);
+        if(!(flags & FuriFlagError) && (flags & SUP_FLAG_STOP)) break;
+        if(!sup->armed || sup->tripped) continue;
+
+        uint32_t silent = furi_get_tick() - sup->last_kick;
+        if(silent <= furi_ms_to_ticks(SUP_STALL_MS)) continue;
+
+        pwm_hw_kill();
+        sup->armed = false;
+        sup->trip_latency_ms = silent;
+        sup->tripped = true;
+        FURI_LOG_E(TAG, "supervisor: main loop silent %lums, PA7 forced Hi-Z", (unsigned long)silent);
+
+        AppEvent ev = {.type = AppEventSafety};
+        furi_message_queue_put(sup->q, &ev, 0);
+    }
+    return 0;
+}
+
+static void supervisor_start(Supervisor* sup, FuriMessageQueue* q){
+    sup->q = q;
+    sup->last_kick = furi_get_tick();
+    sup->thread = furi_thread_alloc_ex("EmbracoSafety", 1024, supervisor_thread, sup);
+    furi_thread_set_priority(sup->thread, FuriThreadPriorityHighest);
+    furi_thread_start(sup->thread);
+}
+
+static void supervisor_stop(Supervisor* sup){
+    if(!sup->thread) return;
+    sup->armed = false;
+    furi_thread_flags_set(furi_thread_get_id(sup->thread), SUP_FLAG_STOP);
+    furi_thread_join(sup->thread);
+    furi_thread_free(sup->thread);
+    sup->thread = NULL;
+}
+
+static void hb_timer_cb(void* ctx){
+    AppState* s = ctx;
+    rec_note_timer(s, ErcTimerHeartbeat);
+    AppEvent ev = {.type = AppEventHeartbeat};
+    furi_message_queue_put(s->q, &ev, 0);
+}
+
+/* Arm while PWM is live; the heartbeat timer runs only then */
+static void supervisor_sync(AppState* s){
+    if(s->pwm_running){
+        s->sup.last_kick = furi_get_tick();
+        if(!s->sup.armed){
+            s->sup.armed = true;
+            furi_thread_flags_set(furi_thread_get_id(s->sup.thread), SUP_FLAG_ARM);
+        }
+        if(!s->hb_timer) s->hb_timer = furi_timer_alloc(hb_timer_cb, FuriTimerTypePeriodic, s);
+        if(!furi_timer_is_running(s->hb_timer)){
+            furi_timer_start(s->hb_timer, furi_ms_to_ticks(SUP_HEARTBEAT_MS));
+        }
+    } else {
+        s->sup.armed = false;
+        if(s->hb_timer) furi_timer_stop(s->hb_timer);
+    }
+    estop_check_loop(s);
+}
+
+/* ---------- Trend history ---------- */
+#if FEATURE_TREND
+static void trend_clear(TrendBucket* b){
+    b->hz_lo = UINT8_MAX;
+    b->hz_hi = 0;
+    for(uint8_t i = 0; i < TrendChannels; i++){
+        b->lo[i] = INT16_MAX;
+        b->hi[i] = INT16_MIN;
+    }
+}
+
+static void trend_merge(TrendBucket* d, const TrendBucket* b){
+    d->hz_lo = MIN(d->hz_lo, b->hz_lo);
+    d->hz_hi = MAX(d->hz_hi, b->hz_hi);
+    for(uint8_t i = 0; i < TrendChannels; i++){
+        d->lo[i] = MIN(d->lo[i], b->lo[i]);
+        d->hi[i] = MAX(d->hi[i], b->hi[i]);
+    }
+}
+
+/* Held values into the open base bucket; a sample that expired by `at` is left out */
+static void trend_hold(Trend* t, uint32_t at){
+    TrendBucket* b = &t->lv[0].open;
+    b->hz_lo = MIN(b->hz_lo, t->hz);
+    b->hz_hi = MAX(b->hz_hi, t->hz);
+    for(uint8_t i = 0; i < TrendChannels; i++){
+        if((int32_t)(t->until[i] - at) <= 0) continue;
+        b->lo[i] = MIN(b->lo[i], t->val[i]);
+        b->hi[i] = MAX(b->hi[i], t->val[i]);
+    }
+}
+
+/* Base bucket done: into level 0's ring, and up while a level's bucket is done too */
+static void trend_close(Trend* t){
+    t->closed++;
+    for(uint8_t k = 0; k < TREND_LEVELS; k++){
+        TrendLevel* l = &t->lv[k];
+        l->col[l->head] = l->open;
+        l->head = (uint8_t)((l->head + 1U) % TREND_COLS);
+        if(l->count < TREND_COLS) l->count++;
+        t->fresh |= (uint8_t)(1U << k);
+        if(k + 1U < TREND_LEVELS) trend_merge(&t->lv[k + 1U].open, &l->open);
+        trend_clear(&l->open);
+        if(t->closed & ((1UL << (TREND_SHIFT * (k + 1U))) - 1U)) break;
+    }
+}
+
+/* Closes every base bucket that ended since the last call with the values
+ * that held through it. O(elapsed) but capped: after a gap longer than the
+ * whole history only the last span is replayed, skipped in whole top-level
+ * buckets so every level stays aligned. */
+static void trend_advance(Trend* t){
+    const uint32_t base = furi_ms_to_ticks(TREND_BASE_MS);
+    const uint32_t top = 1UL << (TREND_SHIFT * (TREND_LEVELS - 1));
+    const uint32_t span = TREND_COLS * top;
+    uint32_t now = furi_get_tick();
+    uint32_t due = (now - t->origin) / base;
+    if(due - t->closed > span + top) t->closed += (due - t->closed - span) / top * top;
+    while(t->closed < due){
+        trend_hold(t, t->origin + t->closed * base);
+        trend_close(t);
+    }
+    trend_hold(t, now);
+}
+
+/* After every main-loop event: the frequency from now on */
+static void trend_set_hz(Trend* t, uint32_t hz){
+    if(!t->lv) return;
+    trend_advance(t);
+    t->hz = (uint8_t)MIN(hz, UINT8_MAX);
+    trend_hold(t, furi_get_tick());
+}
+
+static void trend_sample(Trend* t, TrendChannel ch, int32_t v){
+    if(!t->lv) return;
+    trend_advance(t);
+    t->val[ch] = (int16_t)MIN(MAX(v, INT16_MIN), INT16_MAX);
+    t->until[ch] = furi_get_tick() + furi_ms_to_ticks(TREND_HOLD_MS);
+    trend_hold(t, furi_get_tick());
+}
+
+static void trend_start(Trend* t){
+    t->lv = malloc(sizeof(TrendLevel) * TREND_LEVELS);
+    for(uint8_t k = 0; k < TREND_LEVELS; k++){
+        t->lv[k].head = 0;
+        t->lv[k].count = 0;
+        trend_clear(&t->lv[k].open);
+    }
+    t->origin = furi_get_tick();
+}
+
+static void trend_free(Trend* t){
+    if(t->timer){ furi_timer_stop(t->timer); furi_timer_free(t->timer); t->timer = NULL; }
+    free(t->lv);
+    t->lv = NULL;
+}
+
+static void trend_timer_cb(void* ctx){
+    AppState* s = ctx;
+    AppEvent ev = {.type = AppEventTrend};
+    furi_message_queue_put(s->q, &ev, 0);
+}
+
+/* On the Trend screen only: one wake when the zoom level's next column is complete */
+static void trend_sync(AppState* s){
+    Trend* t = &s->trend;
+    if(s->screen != ScreenTrend){
+        if(t->timer) furi_timer_stop(t->timer);
+        return;
+    }
+    uint32_t col = furi_ms_to_ticks(TREND_BASE_MS) << (TREND_SHIFT * t->zoom);
+    uint32_t into = (furi_get_tick() - t->origin) % col;
+    if(!t->timer) t->timer = furi_timer_alloc(trend_timer_cb, FuriTimerTypeOnce, s);
+    furi_timer_start(t->timer, col - into);
+}
+#else
+static inline void trend_set_hz(Trend* t, uint32_t hz){ UNUSED(t); UNUSED(hz); }
+static inline void trend_sample(Trend* t, TrendChannel ch, int32_t v){ UNUSED(t); UNUSED(ch); UNUSED(v); }
+static inline void trend_start(Trend* t){ UNUSED(t); }
+static inline void trend_free(Trend* t){ UNUSED(t); }
+static inline void trend_sync(AppState* s){ UNUSED(s); }
+#endif
+
+/* ---------- Power profile ---------- */
+#if FEATURE_POWER_STATS
+static void power_timer_cb(void* ctx){
+    AppState* s = ctx;
+    rec_note_timer(s, ErcTimerPower);
+    AppEvent ev = {.type = AppEventPowerSample};
+    furi_message_queue_put(s->q, &ev, 0);
+}
+
+/* AppEventPowerSample: one gauge read, O(1) accumulate into the active mode */
+static void power_sample(AppState* s){
+    PowerProfile* p = &s->prof;
+    float amps = furi_hal_power_get_battery_current(FuriHalPowerICFuelGauge);
+    float volts = furi_hal_power_get_battery_voltage(FuriHalPowerICFuelGauge);
+
+    p->last_ma = (int16_t)(-amps * 1000.0f);    /* gauge reports discharge as negative */
+    p->last_mv = (uint16_t)(volts * 1000.0f);
+    p->pct = furi_hal_power_get_pct();
+    p->remaining_mah = (uint16_t)furi_hal_power_get_battery_remaining_capacity();
+    p->charging = furi_hal_power_is_charging();
+    trend_sample(&s->trend, TrendBattery, p->last_ma);
+
+    if(p->charging || p->last_ma <= 0 || !s->powered || s->active >= MODE_COUNT) return;
+    /* sweeps and bursts drive PA7 with active at Stand by: their draw is no mode's */
+    if(sweep_busy(s) || burst_busy(s)) return;
+    p->sum_ma[s->active] += p->last_ma;
+    p->n[s->active]++;
+    /* the policy only acts on a running mode, so only those samples compare */
+    if(s->pwm_running){
+        p->pol_sum_ma[s->power_save] += p->last_ma;
+        p->pol_n[s->power_save]++;
+    }
+}
+
+static void power_profile_sync(AppState* s){
+    bool need = s->pwm_running || s->screen == ScreenPower;
+    if(!need){
+        if(s->power_timer) furi_timer_stop(s->power_timer);
+        return;
+    }
+    if(!s->power_timer) s->power_timer = furi_timer_alloc(power_timer_cb, FuriTimerTypePeriodic, s);
+    if(!furi_timer_is_running(s->power_timer)){
+        furi_timer_start(s->power_timer, furi_ms_to_ticks(POWER_SAMPLE_MS));
+    }
+}
+
+/* "4h10m" / "35m" / "--" from remaining capacity at an average draw */
+static void power_format_runtime(char* out, size_t n, uint16_t remaining_mah, int32_t avg_ma){
+    if(avg_ma <= 0){
+        snprintf(out, n, "--");
+        return;
+    }
+    uint32_t mins = ((uint32_t)remaining_mah * 60U) / (uint32_t)avg_ma;
+    if(mins >= 60U) snprintf(out, n, "%luh%02lum", (unsigned long)(mins / 60U), (unsigned long)(mins % 60U));
+    else snprintf(out, n, "%lum", (unsigned long)mins);
+}
+#else
+static inline void power_sample(AppState* s){ UNUSED(s); }
+static inline void power_profile_sync(AppState* s){ UNUSED(s); }
+#endif
+
+/* ---------- Pressure acquisition ---------- */
+#if FEATURE_PRESSURE
+/*** Transducer wiring (Flipper external header), each through a 1:2 divider:
+ *  suction:   4 (A4)
+ *  discharge: 7 (C3)
+ *  sensor GND to 8/11/18 (GND), sensor supply 5 V from outside
+***/
+#define PRESS_DMA       DMA2
+#define PRESS_DMA_CH    LL_DMA_CHANNEL_6
+
+static const GpioPin* const kPressPins[PressChannels] = {&gpio_ext_pa4, &gpio_ext_pc3};
+static const uint32_t kPressAdcCh[PressChannels] = {LL_ADC_CHANNEL_9, LL_ADC_CHANNEL_4};
+static const uint32_t kPressFsMbar[PressChannels] = {10342, 34474};    /* 150 / 500 psi */
+static const char* const kPressUnitNames[PressUnitCount] = {"Off", "bar", "psi"};
+
+static void press_timer_cb(void* ctx){
+    AppState* s = ctx;
+    AppEvent ev = {.type = AppEventPressure};
+    furi_message_queue_put(s->q, &ev, 0);
+}
+
+static void press_start(Pressure* p){
+    for(uint8_t i = 0; i < PressChannels; i++){
+        furi_hal_gpio_init(kPressPins[i], GpioModeAnalog, GpioPullNo, GpioSpeedLow);
+        p->raw[i] = 0;
+    }
+    /* VREFBUF, clock, calibration and oversampling from the HAL; it leaves
+     * ADC1 enabled and idle, so only the sequence and DMA are ours to set */
+    p->adc = furi_hal_adc_acquire();
+    furi_hal_adc_configure_ex(p->adc, FuriHalAdcScale2500, FuriHalAdcClockSync64, FuriHalAdcOversample256,
+        FuriHalAdcSamplingtime640_5);
+    LL_ADC_REG_SetSequencerLength(ADC1, LL_ADC_REG_SEQ_SCAN_ENABLE_2RANKS);
+    LL_ADC_REG_SetSequencerRanks(ADC1, LL_ADC_REG_RANK_1, kPressAdcCh[PressSuction]);
+    LL_ADC_REG_SetSequencerRanks(ADC1, LL_ADC_REG_RANK_2, kPressAdcCh[PressDischarge]);
+    for(uint8_t i = 0; i < PressChannels; i++){
+        LL_ADC_SetChannelSamplingTime(ADC1, kPressAdcCh[i], LL_ADC_SAMPLINGTIME_640CYCLES_5);
+    }
+    LL_ADC_REG_SetContinuousMode(ADC1, LL_ADC_REG_CONV_CONTINUOUS);
+    LL_ADC_REG_SetOverrun(ADC1, LL_ADC_REG_OVR_DATA_OVERWRITTEN);
+    LL_ADC_REG_SetDMATransfer(ADC1, LL_ADC_REG_DMA_TRANSFER_UNLIMITED);
+
+    LL_DMA_ConfigTransfer(PRESS_DMA, PRESS_DMA_CH,
+        LL_DMA_DIRECTION_PERIPH_TO_MEMORY | LL_DMA_MODE_CIRCULAR | LL_DMA_PERIPH_NOINCREMENT |
+        LL_DMA_MEMORY_INCREMENT | LL_DMA_PDATAALIGN_HALFWORD | LL_DMA_MDATAALIGN_HALFWORD | LL_DMA_PRIORITY_LOW);
+    LL_DMA_ConfigAddresses(PRESS_DMA, PRESS_DMA_CH, LL_ADC_DMA_GetRegAddr(ADC1, LL_ADC_DMA_REG_REGULAR_DATA),
+        (uint32_t)(uintptr_t)p->raw, LL_DMA_DIRECTION_PERIPH_TO_MEMORY);
+    LL_DMA_SetDataLength(PRESS_DMA, PRESS_DMA_CH, PressChannels);
+    LL_DMA_SetPeriphRequest(PRESS_DMA, PRESS_DMA_CH, LL_DMAMUX_REQ_ADC1);
+    LL_DMA_EnableChannel(PRESS_DMA, PRESS_DMA_CH);
+    LL_ADC_REG_StartConversion(ADC1);
+    p->running = true;
+}
+
+/* Back to the HAL's single-conversion setup before handing ADC1 back */
+static void press_stop(Pressure* p){
+    LL_ADC_REG_StopConversion(ADC1);
+    while(LL_ADC_REG_IsStopConversionOngoing(ADC1)){}
+    LL_DMA_DisableChannel(PRESS_DMA, PRESS_DMA_CH);
+    LL_ADC_REG_SetDMATransfer(ADC1, LL_ADC_REG_DMA_TRANSFER_NONE);
+    LL_ADC_REG_SetContinuousMode(ADC1, LL_ADC_REG_CONV_SINGLE);
+    LL_ADC_REG_SetSequencerLength(ADC1, LL_ADC_REG_SEQ_SCAN_DISABLE);
+    furi_hal_adc_release(p->adc);
+    p->adc = NULL;
+    p->running = false;
+}
+
+/* Converting while powered with a unit selected; the menu refreshes twice a second */
+static void press_sync(AppState* s){
+    Pressure* p = &s->press;
+    bool need = s->powered && p->unit != PressOff;
+    if(need == p->running) return;
+    if(need){
+        press_start(p);
+        if(!p->timer) p->timer = furi_timer_alloc(press_timer_cb, FuriTimerTypePeriodic, s);
+        furi_timer_start(p->timer, furi_ms_to_ticks(PRESS_REDRAW_MS));
+    } else {
+        if(p->timer) furi_timer_stop(p->timer);
+        press_stop(p);
+    }
+}
+
+/* Gauge pressure from the latest DMA word; false outside the sensor's band */
+static bool press_mbar(const Pressure* p, PressChannel ch, int32_t* out){
+    int32_t mv = (int32_t)((uint32_t)p->raw[ch] * PRESS_VREF_MV * PRESS_DIV / 4095U);
+    if(mv < PRESS_ZERO_MV - PRESS_FAULT_MV || mv > PRESS_ZERO_MV + PRESS_SPAN_MV + PRESS_FAULT_MV) return false;
+    *out = (mv - PRESS_ZERO_MV) * (int32_t)kPressFsMbar[ch] / PRESS_SPAN_MV;
+    return true;
+}
+
+/* AppEventPressure: the latest pair into the trend, 10 mbar units */
+static void press_trend(AppState* s){
+    for(uint8_t i = 0; i < PressChannels; i++){
+        int32_t mbar;
+        if(press_mbar(&s->press, (PressChannel)i, &mbar)) trend_sample(&s->trend, (TrendChannel)(TrendSuction + i), mbar / 10);
+    }
+}
+
+/* "12.3" bar, "178" psi, "--" */
+static void press_format(const Pressure* p, PressChannel ch, char* out, size_t n){
+    int32_t mbar;
+    if(!press_mbar(p, ch, &mbar)){
+        snprintf(out, n, "--");
+    } else if(p->unit == PressPsi){
+        int64_t psi_x10k = (int64_t)mbar * 145038;     /* 1 mbar = 0.0145038 psi */
+        snprintf(out, n, "%ld", (long)((psi_x10k + (psi_x10k < 0 ? -5000000 : 5000000)) / 10000000));
+    } else {
+        int32_t dbar = (mbar + (mbar < 0 ? -50 : 50)) / 100;
+        int32_t mag = (dbar < 0) ? -dbar : dbar;
+        snprintf(out, n, "%s%ld.%ld", (dbar < 0) ? "-" : "", (long)(mag / 10), (long)(mag % 10));
+    }
+}
+#else
+static inline void press_sync(AppState* s){ UNUSED(s); }
+static inline void press_stop(Pressure* p){ UNUSED(p); }
+static inline void press_trend(AppState* s){ UNUSED(s); }
+#endif
+
+#if FEATURE_GUI
+/* ---------- Dotted scrollbar (Momentum-like) ---------- */
+static void draw_scrollbar_dotted(Canvas* c, uint16_t total_steps, uint16_t pos){
+    if(total_steps <= 1) return;
+
+    const uint16_t x  = SCROLLBAR_X;
+    const uint16_t y0 = SCROLLBAR_Y0;
+    const uint16_t y1 = SCROLLBAR_Y1;
+
+    /* rail (dotted) */
+    for(uint16_t y = y0; y <= y1; y += 3){
+        canvas_draw_dot(c, x, y);
+    }
+
+    /* thumb position (instant to cursor) */
+    const uint16_t track_h = (uint16_t)(y1 - y0);
+    uint16_t denom = (total_steps > 1) ? (uint16_t)(total_steps - 1) : 1;
+    uint16_t thumb_y = (uint16_t)(y0 + (pos * track_h) / denom);
+
+    /* let the bottom of thumb "eat" last dot and rest on the screen bottom:
+       thumb is 4px high, we center it around thumb_y (-> top at thumb_y-1) */
+    if(thumb_y > (uint16_t)(y1 - 1)) thumb_y = (uint16_t)(y1 - 1);
+    if(thumb_y < y0) thumb_y = y0;
+
+    canvas_draw_box(c, (uint16_t)(x - 1), (uint16_t)(thumb_y - 1), SCROLLBAR_W, 4);
+}
+
+/* ---------- Pretty checkmark (7x7), lowered by 1px ---------- */
+static void draw_checkmark(Canvas* c, int x, int baseline_y){
+    /* draw as two joined 1px segments, visually balanced */
+    int y = baseline_y - 6; /* подняли на 2 px выше */
+    canvas_draw_line(c, x,     y+3, x+2, y+5);
+    canvas_draw_line(c, x+2,   y+5, x+7, y   );
+}
+#endif
+
+/* ---------- Countdown & auto-off ---------- */
+static void tick_timer_cb(void* ctx){
+    AppState* s = ctx;
+    rec_note_timer(s, ErcTimerTick);
+    if(s->remaining_ms >= 1000) s->remaining_ms -= 1000;
+    else s->remaining_ms = 0;
+    /* the Trend screen has no countdown and redraws per column */
+    if(display_tick_visible(s) && s->screen != ScreenTrend) app_redraw(s);
+}
+static void off_timer_cb(void* ctx){
+    AppState* s = ctx;
+    rec_note_timer(s, ErcTimerOff);
+    s->remaining_ms = 0;
+    s->timeout_expired = true;
+    /* wake the main loop; the flag guards against a stale event after a mode change */
+    AppEvent ev = {.type = AppEventTimeout};
+    if(s->q) furi_message_queue_put(s->q, &ev, 0);
+}
+static void stop_timers(AppState* s){
+    if(s->tick_timer) furi_timer_stop(s->tick_timer);
+    if(s->off_timer)  furi_timer_stop(s->off_timer);
+}
+static void free_timers(AppState* s){
+    if(s->tick_timer){ furi_timer_free(s->tick_timer); s->tick_timer = NULL; }
+    if(s->off_timer){  furi_timer_free(s->off_timer);  s->off_timer  = NULL; }
+}
+static void start_countdown(AppState* s, uint32_t ms){
+    stop_timers(s);
+    s->timeout_expired = false;
+    s->remaining_ms = ms;
+
+    if(!s->tick_timer) s->tick_timer = furi_timer_alloc(tick_timer_cb, FuriTimerTypePeriodic, s);
+    if(!s->off_timer)  s->off_timer  = furi_timer_alloc(off_timer_cb,  FuriTimerTypeOnce,     s);
+
+    furi_timer_start(s->tick_timer, furi_ms_to_ticks(1000));
+    furi_timer_start(s->off_timer,  furi_ms_to_ticks(s->remaining_ms));
+}
+static void start_tick_timer_if_needed(AppState* s){
+    stop_timers(s);
+    s->remaining_ms = 0;
+    s->timeout_expired = false;
+
+    if(!s->powered) return;          /* only in powered menu */
+    if(!s->limit_runtime) return;    /* unlimited => no timers */
+    if(s->active == 0) return;       /* Stand by => no countdown */
+
+    uint32_t secs = kModes[s->active].default_secs;
+    if(secs == 0) return;
+
+    start_countdown(s, secs * 1000U);
+}
+
+/* ---------- State recorder ---------- */
+#if FEATURE_RECORDER
+enum {
+    REC_SPILL_MS = 2000,        /* ring -> SD cadence */
+};
+
+static void rec_snapshot(const AppState* s, ErcState* out){
+    out->freq_hz = pwm_freq_now(s);
+    out->remaining_ms = s->remaining_ms;
+    out->running = s->pwm_running;
+    out->screen = (uint8_t)s->screen;
+    out->active = s->active;
+}
+
+static uint32_t rec_period_ms(RecRate rate){
+    return (rate == RecRate100Hz) ? 10U : 100U;
+}
+
+/* Timer thread: one compare per field; a record only when something changed */
+static void rec_timer_cb(void* ctx){
+    AppState* s = ctx;
+    if(s->rec_rate == RecRateOff) return;
+    ErcState st;
+    rec_snapshot(s, &st);
+    recorder_state(s->rec, &st);
+    if(++s->rec_samples % (REC_SPILL_MS / rec_period_ms(s->rec_rate)) == 0){
+        AppEvent ev = {.type = AppEventRecSpill};
+        furi_message_queue_put(s->q, &ev, 0);
+    }
+}
+
+/* Start/stop sampling for s->rec_rate; the recorder itself lives until exit */
+static void rec_apply(AppState* s){
+    if(s->rec_rate == RecRateOff){
+        if(s->rec_timer) furi_timer_stop(s->rec_timer);
+        if(s->rec) recorder_spill(s->rec);
+        return;
+    }
+    ErcState st;
+    rec_snapshot(s, &st);
+    if(!s->rec) s->rec = recorder_alloc(&st);
+    else recorder_state(s->rec, &st);
+    if(!s->rec_timer) s->rec_timer = furi_timer_alloc(rec_timer_cb, FuriTimerTypePeriodic, s);
+    furi_timer_start(s->rec_timer, furi_ms_to_ticks(rec_period_ms(s->rec_rate)));
+}
+
+static void rec_spill(AppState* s){
+    if(s->rec) recorder_spill(s->rec);
+}
+
+/* Exit, every timer freed: last state (PWM off / handed off) and final spill */
+static void rec_close(AppState* s){
+    if(!s->rec) return;
+    ErcState st;
+    rec_snapshot(s, &st);
+    recorder_state(s->rec, &st);
+    recorder_free(s->rec);
+    s->rec = NULL;
+}
+#else
+static inline void rec_apply(AppState* s){ UNUSED(s); }
+static inline void rec_spill(AppState* s){ UNUSED(s); }
+static inline void rec_close(AppState* s){ UNUSED(s); }
+#endif
+
+/* ---------- Pulse odometer ---------- */
+#if FEATURE_ODOMETER
+#define ODO_PATH  APP_DATA_PATH("odometer.bin")
+#define ODO_MAGIC 0x4F444F31U      /* "ODO1" */
+
+static uint32_t odo_crc(const OdoRecord* r){
+    /* CRC-32 (IEEE), bitwise: runs once per slot on load and once per write */
+    const uint8_t* p = (const uint8_t*)r;
+    uint32_t crc = 0xFFFFFFFFU;
+    for(size_t i = 0; i < offsetof(OdoRecord, crc); i++){
+        crc ^= p[i];
+        for(uint8_t b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+    return ~crc;
+}
+
+/* Newest valid slot; a torn write only costs the batch it was carrying.
+ * Slots are scanned in `out` and the winner read again: this runs from
+ * odo_add, deep in the mode paths, so no second record on the stack */
+static void odo_load(OdoRecord* out){
+    Storage* st = furi_record_open(RECORD_STORAGE);
+    File* f = storage_file_alloc(st);
+    int8_t best = -1;
+    uint32_t best_seq = 0;
+    if(storage_file_open(f, ODO_PATH, FSAM_READ, FSOM_OPEN_EXISTING)){
+        for(uint8_t i = 0; i < ODO_SLOTS; i++){
+            if(storage_file_read(f, out, sizeof(*out)) != sizeof(*out)) break;
+            if(out->magic != ODO_MAGIC || out->crc != odo_crc(out)) continue;
+            if(best < 0 || (int32_t)(out->seq - best_seq) > 0){ best = (int8_t)i; best_seq = out->seq; }
+        }
+    }
+    if(!(best >= 0 && storage_file_seek(f, (uint32_t)best * sizeof(*out), true) &&
+         storage_file_read(f, out, sizeof(*out)) == sizeof(*out) && out->crc == odo_crc(out))){
+        memset(out, 0, sizeof(*out));
+    }
+    storage_file_close(f);
+    storage_file_free(f);
+    furi_record_close(RECORD_STORAGE);
+}
+
+/* Stored totals on first use: launch does not wait on the SD card */
+static void odo_need(Odometer* o){
+    if(o->loaded) return;
+    odo_load(&o->rec);
+    o->loaded = true;
+}
+
+/* Next slot in turn, so each one sees 1/ODO_SLOTS of the writes */
+static void odo_save(Odometer* o){
+    odo_need(o);
+    o->rec.magic = ODO_MAGIC;
+    o->rec.seq++;
+    o->rec.crc = odo_crc(&o->rec);
+    Storage* st = furi_record_open(RECORD_STORAGE);
+    File* f = storage_file_alloc(st);
+    bool ok = storage_file_open(f, ODO_PATH, FSAM_READ_WRITE, FSOM_OPEN_ALWAYS) &&
+              storage_file_seek(f, (o->rec.seq % ODO_SLOTS) * (uint32_t)sizeof(OdoRecord), true) &&
+              storage_file_write(f, &o->rec, sizeof(o->rec)) == sizeof(o->rec);
+    storage_file_close(f);
+    storage_file_free(f);
+    furi_record_close(RECORD_STORAGE);
+    if(ok) o->dirty = false;
+    else FURI_LOG_W(TAG, "odometer: write failed, kept for the next flush");
+}
+
+static void odo_flush_cb(void* ctx){
+    AppState* s = ctx;
+    AppEvent ev = {.type = AppEventOdoFlush};
+    furi_message_queue_put(s->q, &ev, 0);
+}
+
+/* First change after a write arms the batch; later ones ride along */
+static void odo_arm(AppState* s){
+    Odometer* o = &s->odo;
+    if(!o->flush_timer) o->flush_timer = furi_timer_alloc(odo_flush_cb, FuriTimerTypeOnce, s);
+    if(!furi_timer_is_running(o->flush_timer)) furi_timer_start(o->flush_timer, furi_ms_to_ticks(ODO_FLUSH_MS));
+}
+
+static void odo_add(AppState* s, uint8_t unit, uint8_t band, int64_t pulses){
+    Odometer* o = &s->odo;
+    if(pulses == 0 || band == 0 || band >= MODE_COUNT || unit >= ODO_UNITS) return;
+    odo_need(o);
+    uint64_t* p = &o->rec.pulses[unit][band - 1];
+    *p = (pulses < 0 && (uint64_t)(-pulses) > *p) ? 0 : (uint64_t)((int64_t)*p + pulses);
+    o->dirty = true;
+    odo_arm(s);
+}
+
+/* Pulses TIM2 counted since the last collect, not yet in rec */
+static uint32_t odo_pending(const Odometer* o){
+    return o->hw ? (LL_TIM_GetCounter(TIM2) - o->mark) : 0;
+}
+
+static void odo_collect(AppState* s){
+    Odometer* o = &s->odo;
+    uint32_t n = odo_pending(o);
+    o->mark += n;
+    odo_add(s, o->run_unit, o->run_band, n);
+}
+
+/* First PWM start: TIM2 as a 32-bit slave counter of TIM1 */
+static void odo_claim(Odometer* o){
+    o->hw_tried = true;
+    if(furi_hal_bus_is_enabled(FuriHalBusTIM2)){
+        FURI_LOG_W(TAG, "odometer: TIM2 in use, pulses not counted");
+        return;
+    }
+    furi_hal_bus_enable(FuriHalBusTIM2);
+    LL_TIM_SetPrescaler(TIM2, 0);
+    LL_TIM_SetAutoReload(TIM2, 0xFFFFFFFFU);
+    LL_TIM_SetTriggerInput(TIM2, LL_TIM_TS_ITR0);                /* ITR0 = TIM1 TRGO */
+    LL_TIM_SetClockSource(TIM2, LL_TIM_CLOCKSOURCE_EXT_MODE1);
+    LL_TIM_SetCounter(TIM2, 0);
+    LL_TIM_EnableCounter(TIM2);
+    o->mark = 0;
+    o->hw = true;
+}
+
+/* Right after furi_hal_pwm_start: the pulses so far belong to the old owner */
+static void odo_begin(AppState* s, uint8_t unit, uint8_t band){
+    if(!s->odo.hw_tried) odo_claim(&s->odo);
+    odo_collect(s);
+    s->odo.run_unit = unit;
+    s->odo.run_band = band;
+    /* furi_hal_pwm_start re-inits TIM1, TRGO included */
+    if(s->odo.hw) LL_TIM_SetTriggerOutput(TIM1, LL_TIM_TRGO_UPDATE);
+    /* a long run is checkpointed: odo_flush collects and re-arms */
+    odo_arm(s);
+}
+
+/* Exit, before a background handoff re-arms TIM1: last count, TIM2 released */
+static void odo_release(AppState* s){
+    Odometer* o = &s->odo;
+    odo_collect(s);
+    o->run_band = 0;
+    if(!o->hw) return;
+    LL_TIM_DisableCounter(TIM2);
+    furi_hal_bus_disable(FuriHalBusTIM2);
+    o->hw = false;
+}
+
+/* AppEventOdoFlush: the batch is due (collecting a running mode re-arms it) */
+static void odo_flush(AppState* s){
+    odo_collect(s);
+    if(s->odo.dirty) odo_save(&s->odo);
+}
+
+static void odo_close(AppState* s){
+    Odometer* o = &s->odo;
+    if(o->flush_timer){ furi_timer_stop(o->flush_timer); furi_timer_free(o->flush_timer); o->flush_timer = NULL; }
+    if(o->dirty) odo_save(o);
+}
+
+/* Whole seconds in a band: pulses / frequency */
+static uint32_t odo_secs(uint64_t pulses, uint8_t band){
+    return (uint32_t)(pulses / kModes[band].freq_hz);
+}
+
+/* Live totals for one unit from `rec` (any thread; a torn read skews one frame) */
+static void odo_unit_totals(const Odometer* o, const OdoRecord* rec, uint8_t unit, uint64_t out[ODO_BANDS], uint64_t* revs){
+    *revs = 0;
+    for(uint8_t b = 0; b < ODO_BANDS; b++){
+        out[b] = rec->pulses[unit][b];
+        if(o->run_unit == unit && o->run_band == b + 1) out[b] += odo_pending(o);
+        const Mode* m = &kModes[b + 1];
+        *revs += out[b] * m->rpm / (60U * m->freq_hz);
+    }
+}
+#else
+static inline void odo_begin(AppState* s, uint8_t unit, uint8_t band){ UNUSED(s); UNUSED(unit); UNUSED(band); }
+static inline void odo_add(AppState* s, uint8_t unit, uint8_t band, int64_t pulses){ UNUSED(s); UNUSED(unit); UNUSED(band); UNUSED(pulses); }
+static inline void odo_release(AppState* s){ UNUSED(s); }
+static inline void odo_flush(AppState* s){ UNUSED(s); }
+static inline void odo_close(AppState* s){ UNUSED(s); }
+#endif
+
+/* ---------- Test history ---------- */
+#if FEATURE_HISTORY
+static const char* const kHistKind[HistKindCount] = {"run", "burst", "sweep", "jitter"};
+static const char* const kHistResult[HistResultCount] = {"ok", "stop", "abort", "e-stop", "trip"};
+
+static void hist_start(TestHistory* h){
+    h->lock = furi_mutex_alloc(FuriMutexTypeNormal);
+    h->end = HistStopped;
+}
+
+/* Caller holds h->lock; NULL without an SD card, or while PWM is live and
+ * the store is not open yet */
+static History* hist_db(TestHistory* h, bool pwm_live){
+    if(!h->db && !pwm_live) h->db = history_open();
+    return h->db;
+}
+
+static void hist_add(AppState* s, HistKind kind, HistResult result, uint8_t mode, uint8_t unit,
+                     uint32_t time, uint32_t tick, uint32_t value){
+    TestHistory* h = &s->hist;
+    HistRecord r = {
+        .time = time,
+        .serial = h->serial[unit],
+        .duration_s = (furi_get_tick() - tick) / 1000U,
+        .value = value,
+        .kind = (uint8_t)kind,
+        .result = (uint8_t)result,
+        .mode = mode,
+        .unit = unit,
+    };
+    if(h->pend_n == HIST_PEND){
+        FURI_LOG_W(TAG, "history: %s record lost", kHistKind[kind]);
+        return;
+    }
+    if(!h->pend) h->pend = malloc(sizeof(HistRecord) * HIST_PEND);
+    h->pend[h->pend_n++] = r;
+}
+
+/* Main loop with the supervisor disarmed, and at exit */
+static void hist_flush(AppState* s){
+    TestHistory* h = &s->hist;
+    if(!h->pend_n || s->sup.armed) return;
+    uint8_t lost = 0;
+    furi_mutex_acquire(h->lock, FuriWaitForever);
+    History* db = hist_db(h, false);
+    for(uint8_t i = 0; i < h->pend_n; i++){
+        if(!db || !history_append(db, &h->pend[i])) lost++;
+    }
+    furi_mutex_release(h->lock);
+    h->pend_n = 0;
+    if(lost) FURI_LOG_W(TAG, "history: %u records lost", lost);
+}
+
+/* apply_mode, PWM branch: burst, sweep and jitter drive modes of their own */
+static void hist_seg_open(AppState* s, uint8_t idx){
+    TestHistory* h = &s->hist;
+    if(s->burst.phase == BurstRunning || sweep_busy(s) || jitter_busy(s)) return;
+    h->seg_mode = idx;
+    h->seg_unit = (s->rack.phase == RackRun) ? s->rack.unit : s->odo.unit;
+    h->seg_tick = furi_get_tick();
+    h->seg_time = furi_hal_rtc_get_timestamp();
+}
+
+/* Anything that moves PA7 off the mode ends the run, with h->end as result */
+static void hist_seg_close(AppState* s){
+    TestHistory* h = &s->hist;
+    if(!h->seg_mode) return;
+    uint8_t mode = h->seg_mode;
+    h->seg_mode = 0;
+    if(furi_get_tick() - h->seg_tick < HIST_MIN_MS) return;
+    hist_add(s, HistRun, h->end, mode, h->seg_unit, h->seg_time, h->seg_tick, 0);
+}
+
+static void hist_test_begin(AppState* s){
+    s->hist.test_tick = furi_get_tick();
+    s->hist.test_time = furi_hal_rtc_get_timestamp();
+}
+
+/* An abort keeps the e-stop / trip that caused it */
+static void hist_test_end(AppState* s, HistKind kind, bool aborted, uint8_t mode, uint32_t value){
+    HistResult r = HistOk;
+    if(aborted) r = (s->hist.end == HistEstop || s->hist.end == HistTrip) ? s->hist.end : HistAborted;
+    hist_add(s, kind, r, mode, s->odo.unit, s->hist.test_time, s->hist.test_tick, value);
+}
+
+#if FEATURE_GUI
+/* History screen: newest records of the viewed unit's serial */
+static void hist_view_load(AppState* s){
+    TestHistory* h = &s->hist;
+    if(!h->rows) h->rows = malloc(sizeof(HistRecord) * HIST_VIEW);
+    furi_mutex_acquire(h->lock, FuriWaitForever);
+    History* db = hist_db(h, s->sup.armed);
+    h->n = db ? (uint8_t)history_by_serial(db, h->serial[h->view], h->rows, HIST_VIEW) : 0;
+    furi_mutex_release(h->lock);
+    h->deferred = !db && s->sup.armed;
+    h->top = 0;
+}
+
+/* Serial editor: one decimal digit up or down, wrapping within the digit */
+static void hist_digit_step(TestHistory* h, int8_t d){
+    uint32_t pow = 1;
+    for(uint8_t i = h->digit + 1U; i < HIST_DIGITS; i++) pow *= 10U;
+    uint32_t* v = &h->serial[h->view];
+    uint8_t cur = (uint8_t)((*v / pow) % 10U);
+    *v -= cur * pow;
+    *v += (uint32_t)((cur + ((d > 0) ? 1U : 9U)) % 10U) * pow;
+}
+#endif
+
+static void hist_close(AppState* s){
+    TestHistory* h = &s->hist;
+    hist_seg_close(s);
+    hist_flush(s);
+    if(h->db) history_close(h->db);
+    h->db = NULL;
+    free(h->rows);
+    h->rows = NULL;
+    free(h->pend);
+    h->pend = NULL;
+    furi_mutex_free(h->lock);
+    h->lock = NULL;
+}
+#else
+static inline void hist_start(TestHistory* h){ UNUSED(h); }
+static inline void hist_seg_open(AppState* s, uint8_t idx){ UNUSED(s); UNUSED(idx); }
+static inline void hist_seg_close(AppState* s){ UNUSED(s); }
+static inline void hist_flush(AppState* s){ UNUSED(s); }
+static inline void hist_test_begin(AppState* s){ UNUSED(s); }
+static inline void hist_test_end(AppState* s, HistKind kind, bool aborted, uint8_t mode, uint32_t value){
+    UNUSED(s); UNUSED(kind); UNUSED(aborted); UNUSED(mode); UNUSED(value);
+}
+static inline void hist_close(AppState* s){ UNUSED(s); }
+#endif
+
 /* ---------- Apply powered mode (Stand by / Low / Mid / Max) ---------- */
 static void apply_mode(AppState* s, uint8_t idx){
     if(idx >= MODE_COUNT) return;
     s->active = idx;
+    hist_seg_close(s);
+
+    const Mode* m = &kModes[idx];
+
+    if(m->freq_hz == 0){
+        /* Stand by: stop PWM and actively hold LOW (safe) */
+        pwm_hw_stop_safe(&s->pwm_running);
+        pin_to_pp_low();
+        stop_timers(s);
+        s->remaining_ms = 0;
+        s->timeout_expired = false;
+    } else {
+        /* PWM run */
+        pwm_hw_stop_safe(&s->pwm_running);
+        pwm_hw_start_safe(m->freq_hz, &s->pwm_running);
+        odo_begin(s, (s->rack.phase == RackRun) ? s->rack.unit : s->odo.unit, idx);
+        hist_seg_open(s, idx);
+        start_tick_timer_if_needed(s);
+    }
+    power_hold_sync(&s->power_hold, s->pwm_running);
+    led_apply(s, m->led_blink_hz);
+    supervisor_sync(s);
+    power_profile_sync(s);
+    press_sync(s);
+    display_policy_sync(s);
+}
+
+#if FEATURE_GUI
+/* ---------- Back hint ---------- */
+/* Restarted by every short BACK, so the hint stays HINT_MS after the last one */
+static void hint_seq(AppState* s, Seq* sq){
+    SEQ_BEGIN(sq);
+    s->hint_visible = true;
+    SEQ_WAIT_MS(sq, HINT_MS);
+    rec_note_timer(s, ErcTimerHint);
+    s->hint_visible = false;
+    SEQ_END(sq);
+}
+
+/* ---------- Alerts (in-app overlays) ---------- */
+typedef struct {
+    const char* text;
+    uint8_t     x;
+    Align       h_align;
+} ConfirmText;
+
+static const ConfirmText kConfirmTexts[] = {
+    [ConfirmPowerOn] = {
+        "Check your wiring!\n"
+        "All pins will be activated!\n"
+        "Check help!",
+        64, AlignCenter,
+    },
+    [ConfirmLimitOff] = {
+        "Long run without condenser\n"
+        "and evaporator fans may\n"
+        "damage compressor parts.",
+        6, AlignLeft,
+    },
+    [ConfirmSchedule] = {
+        "Compressor will start\n"
+        "unattended at the set time.\n"
+        "Check wiring and help!",
+        64, AlignCenter,
+    },
+    [ConfirmBackground] = {
+        "Run goes on after exit.\n"
+        "No deep sleep, TIM1 held\n"
+        "until the app is relaunched",
+        64, AlignCenter,
+    },
+};
+
+static void draw_confirm(Canvas* c, ConfirmId id){
+    if(id == ConfirmNone) return;
+    const ConfirmText* t = &kConfirmTexts[id];
+
+    /* same layout DialogsApp used: full-screen, header on top, Cancel/Confirm buttons */
+    canvas_set_color(c, ColorWhite);
+    canvas_draw_box(c, 0, 0, CANVAS_W, CANVAS_H);
+    canvas_set_color(c, ColorBlack);
+
+    canvas_set_font(c, FontPrimary);
+    canvas_draw_str_aligned(c, 64, 2, AlignCenter, AlignTop, "Alert");
+
+    canvas_set_font(c, FontSecondary);
+    elements_multiline_text_aligned(c, t->x, 16, t->h_align, AlignTop, t->text);
+
+    elements_button_left(c, "Cancel");
+    elements_button_right(c, "Confirm");
+}
+
+/* ---------- Help layout ---------- */
+static const char* const* help_lines(const AppState* s, uint8_t* count){
+#if FEATURE_SAMSUNG
+    if(s->inverter != InvEmbraco){
+        *count = HELP_SAMSUNG_COUNT;
+        return HELP_SAMSUNG;
+    }
+#else
+    UNUSED(s);
+#endif
+    *count = HELP_EMBRACO_COUNT;
+    return HELP_EMBRACO;
+}
+
+static inline uint16_t help_page_rows(uint8_t lines){
+    return (uint16_t)(HELP_TOP + (lines - 1U) * HELP_LINE_H + HELP_DESCENT);
+}
+
+static inline uint16_t help_max_top_px(uint8_t lines){
+    uint16_t rows = help_page_rows(lines);
+    return (rows > CANVAS_H) ? (uint16_t)(rows - CANVAS_H) : 0;
+}
+
+/* ---------- Title helper ---------- */
+static void draw_countdown(Canvas* c, const AppState* s){
+    /* right-aligned timer (if counting) with fixed margin from scrollbar */
+    if(s->remaining_ms > 0){
+        char tbuf[16];
+        unsigned long sec = (unsigned long)((s->remaining_ms + 999)/1000);
+        snprintf(tbuf, sizeof(tbuf), "%lus", sec);
+        uint16_t w = canvas_string_width(c, tbuf);
+        uint16_t right_x = (uint16_t)(SCROLLBAR_X - TIMER_MARGIN);
+        uint16_t x = (w <= right_x) ? (uint16_t)(right_x - w) : 2;
+        canvas_draw_str(c, x, TITLE_Y, tbuf);
+    }
+}
+
+static void draw_title(Canvas* c, const AppState* s){
+#if FEATURE_ESTOP
+    /* the last trip stays up until the next key */
+    if(s->estop.banner){
+        canvas_set_font(c, FontPrimary);
+        canvas_set_color(c, ColorBlack);
+        canvas_draw_str(c, 4, TITLE_Y, (s->estop.last_source == EstopPin) ? "E-STOP: loop open" : "E-STOP: OK+BACK");
+        draw_countdown(c, s);
+        return;
+    }
+#endif
+#if FEATURE_PRESSURE
+    /* live suction/discharge replace the name while the transducers are on */
+    if(s->press.running){
+        char suct[8], disch[8], line[32];
+        press_format(&s->press, PressSuction, suct, sizeof(suct));
+        press_format(&s->press, PressDischarge, disch, sizeof(disch));
+        snprintf(line, sizeof(line), "S %s D %s %s", suct, disch, kPressUnitNames[s->press.unit]);
+        canvas_set_font(c, FontSecondary);
+        canvas_set_color(c, ColorBlack);
+        canvas_draw_str(c, 4, TITLE_Y, line);
+        draw_countdown(c, s);
+        return;
+    }
+#endif
+    canvas_set_font(c, FontPrimary);
+    canvas_set_color(c, ColorBlack);
+
+    const char* inv_name = (s->inverter == InvEmbraco) ? "Embraco" : "Samsung";
+    char title[32];
+    snprintf(title, sizeof(title), "%s Starter", inv_name);
+    canvas_draw_str(c, 4, TITLE_Y, title);
+    draw_countdown(c, s);
+}
+
+#if FEATURE_SAMSUNG
+/* ---------- Draw: Select Inverter (initial screen) ---------- */
+static void draw_select_inverter(Canvas* c, const AppState* s){
+    canvas_clear(c);
+    canvas_set_color(c, ColorBlack);
+
+    /* Title */
+    canvas_set_font(c, FontPrimary);
+    canvas_draw_str(c, 4, TITLE_Y, "Inverter type");
+
+    /* options */
+    canvas_set_font(c, FontSecondary);
+    int y = ROW_Y0;
+    canvas_draw_str(c, 2, y, (s->cursor == 0) ? ">" : " ");
+    canvas_draw_str(c, 14, y, "Embraco");
+    y += ROW_DY;
+    canvas_draw_str(c, 2, y, (s->cursor == 1) ? ">" : " ");
+    canvas_draw_str(c, 14, y, "Samsung");
+
+    /* scrollbar (2 items) */
+    draw_scrollbar_dotted(c, 2, s->cursor);
+}
+#endif
+
+/* ---------- Draw: Menu ---------- */
+static void draw_menu(Canvas* c, const AppState* s){
+    canvas_clear(c);
+    draw_title(c, s);
+
+    canvas_set_font(c, FontSecondary);
+    const uint8_t MAX_ROWS = 4;
+
+    /* Build dynamic list depending on powered flag */
+    const bool powered = s->powered;
+    uint8_t row_total = menu_row_total(powered);
+
+    /* adjust first_visible to bounds */
+    uint8_t first_visible = s->first_visible;
+    if(first_visible + MAX_ROWS > row_total){
+        first_visible = (row_total > MAX_ROWS) ? (uint8_t)(row_total - MAX_ROWS) : 0;
+    }
+
+    /* draw rows */
+    for(uint8_t i = 0; i < MAX_ROWS; i++){
+        uint8_t row = (uint8_t)(first_visible + i);
+        if(row >= row_total) break;
+        int y = ROW_Y0 + i*ROW_DY;
+
+        if(row == s->cursor) canvas_draw_str(c, 2, y, ">");
+        else canvas_draw_str(c, 2, y, " ");
+
+        MenuItem item = menu_item_at(powered, row);
+        if(item == MenuItemMode){
+            canvas_draw_str(c, 14, y, kModes[row].name);
+            if(row == s->active){
+                int check_x = (int)SCROLLBAR_X - TIMER_MARGIN - 10;
+                if(check_x < 90) check_x = 90;
+                draw_checkmark(c, check_x, y);
+            }
+        } else {
+            canvas_draw_str(c, 14, y, menu_item_name(item));
+        }
+    }
+
+    draw_scrollbar_dotted(c, row_total, s->cursor);
+
+    /* bottom hint (short BACK): left-aligned to menu text (x=14) */
+    if(s->hint_visible){
+        const char* msg = "Long press back to exit";
+        uint16_t text_h = 10;
+        uint16_t text_y = (uint16_t)(CANVAS_H - 2);
+
+        canvas_set_color(c, ColorBlack);
+        canvas_draw_box(c, 0, (uint16_t)(text_y - text_h), CANVAS_W, (uint16_t)(text_h + 4));
+        canvas_set_color(c, ColorWhite);
+        canvas_draw_str(c, 14, text_y, msg);
+        canvas_set_color(c, ColorBlack);
+    }
+}
+
+/* ---------- Draw: Help (per inverter) ---------- */
+/* Only lines reaching into the 64-row window at help_top_px are drawn, so a
+ * frame costs at most eight lines however long the text is. Lines cut by
+ * the window edges are clipped by the canvas. */
+static void draw_help(Canvas* c, const AppState* s){
+    canvas_clear(c);
+    canvas_set_font(c, FontSecondary);
+    canvas_set_color(c, ColorBlack);
+
+    uint8_t n;
+    const char* const* lines = help_lines(s, &n);
+    const uint16_t max_top = help_max_top_px(n);
+    uint16_t top = (s->help_top_px > max_top) ? max_top : s->help_top_px;
+    for(uint8_t i = 0; i < n; i++){
+        int32_t y = (int32_t)(HELP_TOP + i * HELP_LINE_H) - top;
+        if(y >= CANVAS_H + HELP_LINE_H) break;
+        if(!lines[i][0] || y + HELP_DESCENT <= 0) continue;
+        canvas_draw_str(c, 2, y, lines[i]);
+    }
+
+    /* scrollbar follows the pixel offset */
+    draw_scrollbar_dotted(c, (uint16_t)(max_top + 1U), top);
+}
+
+/* ---------- Draw: Settings ---------- */
+/* Visual rows (SettingsRow):
+ * "> Limit run time"   (selectable)
+ * "> Arrow captcha"    (selectable)
+ * "> Background run"   (selectable)
+ * "> Power save"       (selectable, Off/Dim/Dark)
+ * "> Recorder"         (selectable, Off/10 Hz/100 Hz)
+ * "> Unit"             (selectable, 1..8: run hours owner)
+ *   Inverter type      (header, non-selectable, aligned with title)
+ * "> Embraco"          (selectable)
+ * "> Samsung"          (selectable)
+ */
+#if FEATURE_POWER_SAVE
+static const char* const kPowerSaveNames[PowerSaveCount] = {"Off", "Dim", "Dark"};
+#endif
+#if FEATURE_RECORDER
+static const char* const kRecRateNames[RecRateCount] = {"Off", "10 Hz", "100 Hz"};
+#endif
+
+static void draw_value_right(Canvas* c, int y, const char* val){
+    uint16_t w = canvas_string_width(c, val);
+    uint16_t right_x = (uint16_t)(SCROLLBAR_X - TIMER_MARGIN);
+    uint16_t x = (w <= right_x) ? (uint16_t)(right_x - w) : 2;
+    canvas_draw_str(c, x, y, val);
+}
+
+static void draw_settings(Canvas* c, const AppState* s){
+    canvas_clear(c);
+
+    /* Title */
+    canvas_set_font(c, FontPrimary);
+    canvas_set_color(c, ColorBlack);
+    canvas_draw_str(c, 4, TITLE_Y, "Settings");
+
+    /* Body */
+    canvas_set_font(c, FontSecondary);
+
+    const uint8_t MAX_ROWS = 4;
+    const uint8_t ROW_TOTAL = SetRowCount;
+
+    uint8_t first_visible = s->first_visible;
+    if(first_visible + MAX_ROWS > ROW_TOTAL){
+        first_visible = (ROW_TOTAL > MAX_ROWS) ? (uint8_t)(ROW_TOTAL - MAX_ROWS) : 0;
+    }
+
+    for(uint8_t i=0;i<MAX_ROWS;i++){
+        uint8_t row = (uint8_t)(first_visible + i);
+        if(row >= ROW_TOTAL) break;
+        int y = ROW_Y0 + i*ROW_DY;
+
+#if FEATURE_SAMSUNG
+        /* header "Inverter type" non-selectable (no caret) */
+        if(row == SetRowInvHeader){
+            canvas_draw_str(c, 4, y, "Inverter type");
+            continue;
+        }
+#endif
+
+        /* caret for selectable rows */
+        canvas_draw_str(c, 2, y, (s->cursor == row) ? ">" : " ");
+
+        if(row == SetRowLimit){
+            canvas_draw_str(c, 14, y, "Limit run time");
+            draw_value_right(c, y, s->limit_runtime ? "Yes" : "No");
+        } else if(row == SetRowCaptcha){
+            canvas_draw_str(c, 14, y, "Arrow captcha");
+            draw_value_right(c, y, s->arrow_captcha ? "Yes" : "No");
+#if FEATURE_BACKGROUND
+        } else if(row == SetRowBackground){
+            canvas_draw_str(c, 14, y, "Background run");
+            draw_value_right(c, y, s->background_run ? "Yes" : "No");
+#endif
+#if FEATURE_POWER_SAVE
+        } else if(row == SetRowPowerSave){
+            canvas_draw_str(c, 14, y, "Power save");
+            draw_value_right(c, y, kPowerSaveNames[s->power_save]);
+#endif
+#if FEATURE_RECORDER
+        } else if(row == SetRowRecorder){
+            canvas_draw_str(c, 14, y, "Recorder");
+            draw_value_right(c, y, kRecRateNames[s->rec_rate]);
+#endif
+#if FEATURE_ODOMETER
+        } else if(row == SetRowUnit){
+            char buf[8];
+            canvas_draw_str(c, 14, y, "Unit");
+            snprintf(buf, sizeof(buf), "%u", s->odo.unit + 1);
+            draw_value_right(c, y, buf);
+#endif
+#if FEATURE_PRESSURE
+        } else if(row == SetRowPressure){
+            canvas_draw_str(c, 14, y, "Pressure");
+            draw_value_right(c, y, kPressUnitNames[s->press.unit]);
+#endif
+#if FEATURE_ESTOP
+        } else if(row == SetRowEstop){
+            canvas_draw_str(c, 14, y, "E-stop pin");
+            draw_value_right(c, y, s->estop.pin_enabled ? "On" : "Off");
+#endif
+#if FEATURE_SAMSUNG
+        } else if(row == SetRowEmbraco){
+            canvas_draw_str(c, 14, y, "Embraco");
+            if(s->inverter == InvEmbraco){
+                int check_x = (int)SCROLLBAR_X - TIMER_MARGIN - 10;
+                if(check_x < 90) check_x = 90;
+                draw_checkmark(c, check_x, y);
+            }
+        } else if(row == SetRowSamsung){
+            canvas_draw_str(c, 14, y, "Samsung");
+            if(s->inverter == InvSamsung){
+                int check_x = (int)SCROLLBAR_X - TIMER_MARGIN - 10;
+                if(check_x < 90) check_x = 90;
+                draw_checkmark(c, check_x, y);
+            }
+#endif
+        }
+    }
+
+    draw_scrollbar_dotted(c, ROW_TOTAL, s->cursor);
+}
+
+#if FEATURE_POWER_STATS
+/* ---------- Draw: Power stats ---------- */
+static void draw_power_row(Canvas* c, int y, bool current, const char* name, const PowerProfile* p, int32_t sum, uint32_t n){
+    char buf[16];
+    canvas_draw_str(c, 2, y, current ? ">" : " ");
+    canvas_draw_str(c, 10, y, name);
+
+    int32_t avg = n ? (sum / (int32_t)n) : 0;
+    if(avg > 0) snprintf(buf, sizeof(buf), "%ldmA", (long)avg);
+    else snprintf(buf, sizeof(buf), "--");
+    canvas_draw_str_aligned(c, 82, y, AlignRight, AlignBottom, buf);
+
+    power_format_runtime(buf, sizeof(buf), p->remaining_mah, avg);
+    canvas_draw_str_aligned(c, SCROLLBAR_X - 2, y, AlignRight, AlignBottom, buf);
+}
+
+/* Title: live voltage / charge. Rows: mode (or, after Left/Right, the Power
+ * save policy of a running mode), average draw, projected run time on the
+ * remaining capacity. OK resets the averages. */
+static void draw_power(Canvas* c, const AppState* s){
+    canvas_clear(c);
+    const PowerProfile* p = &s->prof;
+
+    canvas_set_font(c, FontPrimary);
+    canvas_set_color(c, ColorBlack);
+    canvas_draw_str(c, 4, TITLE_Y, "Power");
+
+    char buf[32];
+    canvas_set_font(c, FontSecondary);
+    if(p->last_mv){
+        snprintf(buf, sizeof(buf), p->charging ? "%u.%02uV USB" : "%u.%02uV %u%%",
+            p->last_mv / 1000U, (p->last_mv % 1000U) / 10U, p->pct);
+    } else {
+        snprintf(buf, sizeof(buf), "sampling...");
+    }
+    canvas_draw_str_aligned(c, SCROLLBAR_X - TIMER_MARGIN, TITLE_Y, AlignRight, AlignBottom, buf);
+
+    if(p->by_policy){
+        static const char* const kRowNames[PowerSaveCount] = {"Save Off", "Save Dim", "Save Dark"};
+        for(uint8_t i = 0; i < PowerSaveCount; i++){
+            draw_power_row(c, ROW_Y0 + i * ROW_DY, s->pwm_running && i == s->power_save, kRowNames[i],
+                p, p->pol_sum_ma[i], p->pol_n[i]);
+        }
+        return;
+    }
+    for(uint8_t i = 0; i < MODE_COUNT; i++){
+        draw_power_row(c, ROW_Y0 + i * ROW_DY, s->powered && i == s->active, kModes[i].name,
+            p, p->sum_ma[i], p->n[i]);
+    }
+}
+
+#endif
+
+#if FEATURE_RACK
+/* ---------- Draw: Rack test ---------- */
+static uint32_t rack_dwell_secs(const AppState* s){
+    uint32_t secs = kRackDwellSecs[s->rack.dwell];
+    uint32_t limit = kModes[s->rack.mode].default_secs;
+    if(s->limit_runtime && limit && secs > limit) secs = limit;
+    return secs;
+}
+
+static void draw_rack(Canvas* c, const AppState* s){
+    canvas_clear(c);
+    const RackTest* r = &s->rack;
+
+    canvas_set_font(c, FontPrimary);
+    canvas_set_color(c, ColorBlack);
+    canvas_draw_str(c, 4, TITLE_Y, "Rack test");
+    draw_countdown(c, s);
+
+    char buf[24];
+    canvas_set_font(c, FontSecondary);
+
+    if(r->phase == RackIdle){
+        static const char* const labels[RackRowCount] = {"Units", "Mode", "Dwell", "Start"};
+        for(uint8_t row = 0; row < RackRowCount; row++){
+            int y = ROW_Y0 + row * ROW_DY;
+            canvas_draw_str(c, 2, y, (r->row == row) ? ">" : " ");
+            canvas_draw_str(c, 14, y, labels[row]);
+            if(row == RackRowUnits){
+                snprintf(buf, sizeof(buf), "%u", r->units);
+                draw_value_right(c, y, buf);
+            } else if(row == RackRowMode){
+                draw_value_right(c, y, kModes[r->mode].name);
+            } else if(row == RackRowDwell){
+                snprintf(buf, sizeof(buf), "%lus", (unsigned long)rack_dwell_secs(s));
+                draw_value_right(c, y, buf);
+            }
+        }
+        draw_scrollbar_dotted(c, RackRowCount, r->row);
+    } else if(r->phase == RackDone){
+        snprintf(buf, sizeof(buf), "Done: %u units", r->units);
+        canvas_draw_str(c, 14, ROW_Y0, buf);
+        canvas_draw_str(c, 14, ROW_Y0 + ROW_DY, "Relays off, PA7 Hi-Z");
+        canvas_draw_str(c, 14, ROW_Y0 + 3 * ROW_DY, "BACK to menu");
+    } else if(r->phase == RackWired){
+        canvas_draw_str(c, 14, ROW_Y0, "A6 is tied to A7");
+        canvas_draw_str(c, 14, ROW_Y0 + ROW_DY, "Remove jitter wire");
+        canvas_draw_str(c, 14, ROW_Y0 + 3 * ROW_DY, "BACK to menu");
+    } else {
+        snprintf(buf, sizeof(buf), "Unit %u of %u", r->unit + 1, r->units);
+        canvas_draw_str(c, 14, ROW_Y0, buf);
+        canvas_draw_str(c, 14, ROW_Y0 + ROW_DY, (r->phase == RackRun) ? kModes[r->mode].name : "Switching...");
+        elements_progress_bar(c, 14, ROW_Y0 + ROW_DY + 4, 100, (float)r->unit / (float)r->units);
+        canvas_draw_str(c, 14, ROW_Y0 + 3 * ROW_DY, "BACK to stop");
+    }
+}
+#endif
+
+#if FEATURE_ODOMETER
+/* ---------- Draw: Run hours ---------- */
+/* Title: unit (Left/Right). Rows: time per speed band, then revolutions. */
+static void odo_format_secs(char* out, size_t n, uint32_t secs){
+    if(secs < 3600U) snprintf(out, n, "%lum%02lus", (unsigned long)(secs / 60U), (unsigned long)(secs % 60U));
+    else snprintf(out, n, "%luh%02lum", (unsigned long)(secs / 3600U), (unsigned long)((secs / 60U) % 60U));
+}
+
+static void draw_odometer(Canvas* c, const AppState* s){
+    canvas_clear(c);
+    const Odometer* o = &s->odo;
+
+    canvas_set_font(c, FontPrimary);
+    canvas_set_color(c, ColorBlack);
+    canvas_draw_str(c, 4, TITLE_Y, "Run hours");
+
+    char buf[24];
+    canvas_set_font(c, FontSecondary);
+    snprintf(buf, sizeof(buf), "< Unit %u >", o->view + 1);
+    canvas_draw_str_aligned(c, SCROLLBAR_X - TIMER_MARGIN, TITLE_Y, AlignRight, AlignBottom, buf);
+
+    uint64_t pulses[ODO_BANDS];
+    uint64_t revs;
+    odo_unit_totals(o, &o->rec, o->view, pulses, &revs);
+
+    for(uint8_t b = 0; b < ODO_BANDS; b++){
+        int y = ROW_Y0 + b * ROW_DY;
+        canvas_draw_str(c, 2, y, (o->run_unit == o->view && o->run_band == b + 1 && s->pwm_running) ? ">" : " ");
+        canvas_draw_str(c, 10, y, kModes[b + 1].name);
+        odo_format_secs(buf, sizeof(buf), odo_secs(pulses[b], b + 1));
+        draw_value_right(c, y, buf);
+    }
+    int y = ROW_Y0 + ODO_BANDS * ROW_DY;
+    canvas_draw_str(c, 10, y, "Revolutions");
+    if(revs < 1000000U) snprintf(buf, sizeof(buf), "%lu", (unsigned long)revs);
+    else snprintf(buf, sizeof(buf), "%lu.%02luM", (unsigned long)(revs / 1000000U), (unsigned long)((revs / 10000U) % 100U));
+    draw_value_right(c, y, buf);
+}
+#endif
+
+#if FEATURE_HISTORY
+/* ---------- Draw: History ---------- */
+static void draw_history(Canvas* c, const AppState* s){
+    canvas_clear(c);
+    const TestHistory* h = &s->hist;
+
+    canvas_set_font(c, FontPrimary);
+    canvas_set_color(c, ColorBlack);
+    canvas_draw_str(c, 4, TITLE_Y, "History");
+
+    char buf[24];
+    canvas_set_font(c, FontSecondary);
+    snprintf(buf, sizeof(buf), "< Unit %u >", h->view + 1);
+    canvas_draw_str_aligned(c, SCROLLBAR_X - TIMER_MARGIN, TITLE_Y, AlignRight, AlignBottom, buf);
+
+    /* serial; the digit being edited is underlined */
+    snprintf(buf, sizeof(buf), "S/N %0*lu", HIST_DIGITS, (unsigned long)h->serial[h->view]);
+    canvas_draw_str(c, 10, ROW_Y0, buf);
+    if(h->editing){
+        char part[HIST_DIGITS + 1];
+        snprintf(part, sizeof(part), "%.*s", h->digit, buf + 4);
+        uint16_t x = (uint16_t)(10 + canvas_string_width(c, "S/N ") + canvas_string_width(c, part));
+        snprintf(part, sizeof(part), "%c", buf[4 + h->digit]);
+        canvas_draw_line(c, x, ROW_Y0 + 2, x + canvas_string_width(c, part) - 1, ROW_Y0 + 2);
+        draw_value_right(c, ROW_Y0, "OK: done");
+    } else {
+        snprintf(buf, sizeof(buf), (h->n == HIST_VIEW) ? "%u+" : "%u", h->n);
+        draw_value_right(c, ROW_Y0, h->n ? buf : (h->deferred ? "PWM on" : "none"));
+    }
+
+    for(uint8_t i = 0; i < HIST_ROWS && h->top + i < h->n; i++){
+        const HistRecord* r = &h->rows[h->top + i];
+        int y = ROW_Y0 + (i + 1) * ROW_DY;
+        DateTime dt;
+        datetime_timestamp_to_datetime(r->time, &dt);
+        /* "Low speed" -> "Low"; tests by kind */
+        bool run = (r->kind == HistRun && r->mode < MODE_COUNT);
+        snprintf(buf, sizeof(buf), "%02u-%02u %02u:%02u %.*s", dt.month, dt.day, dt.hour, dt.minute,
+            run ? 3 : 6, run ? kModes[r->mode].name : kHistKind[r->kind % HistKindCount]);
+        canvas_draw_str(c, 2, y, buf);
+        draw_value_right(c, y, kHistResult[r->result % HistResultCount]);
+    }
+    if(h->n > HIST_ROWS) draw_scrollbar_dotted(c, (uint16_t)(h->n - HIST_ROWS + 1), h->top);
+}
+#endif
+
+#if FEATURE_BURST
+/* ---------- Draw: Pulse burst ---------- */
+static void draw_burst(Canvas* c, const AppState* s){
+    canvas_clear(c);
+    const BurstTest* b = &s->burst;
+
+    canvas_set_font(c, FontPrimary);
+    canvas_set_color(c, ColorBlack);
+    canvas_draw_str(c, 4, TITLE_Y, "Pulse burst");
+
+    char buf[32];
+    canvas_set_font(c, FontSecondary);
+
+    if(b->phase == BurstIdle){
+        static const char* const labels[BurstRowCount] = {"Mode", "Pulses", "Start"};
+        for(uint8_t row = 0; row < BurstRowCount; row++){
+            int y = ROW_Y0 + row * ROW_DY;
+            canvas_draw_str(c, 2, y, (b->row == row) ? ">" : " ");
+            canvas_draw_str(c, 14, y, labels[row]);
+            if(row == BurstRowMode){
+                draw_value_right(c, y, kModes[b->mode].name);
+            } else if(row == BurstRowPulses){
+                snprintf(buf, sizeof(buf), "%u", kBurstPulses[b->preset]);
+                draw_value_right(c, y, buf);
+            }
+        }
+        draw_scrollbar_dotted(c, BurstRowCount, b->row);
+    } else {
+        const bool running = (b->phase == BurstRunning);
+        snprintf(buf, sizeof(buf), running ? "Sending %lu periods" : (b->aborted ? "Aborted: %lu periods" : "Sent %lu periods"),
+            (unsigned long)b->pulses);
+        canvas_draw_str(c, 14, ROW_Y0, buf);
+        snprintf(buf, sizeof(buf), running ? "at %luHz" : "at %luHz, PA7 LOW", (unsigned long)kModes[b->mode].freq_hz);
+        canvas_draw_str(c, 14, ROW_Y0 + ROW_DY, buf);
+        canvas_draw_str(c, 14, ROW_Y0 + 3 * ROW_DY, running ? "BACK to abort" : "BACK to setup");
+    }
+}
+#endif
+
+#if FEATURE_SWEEP
+/* ---------- Draw: Vibration sweep ---------- */
+enum {
+    SWEEP_PLOT_X0 = 6,
+    SWEEP_PLOT_W  = 110,        /* 10 px per step */
+    SWEEP_PLOT_Y0 = 18,
+    SWEEP_PLOT_Y1 = 52,
+};
+
+static void draw_sweep(Canvas* c, const AppState* s){
+    canvas_clear(c);
+    const Sweep* w = &s->sweep;
+    char buf[32];
+    canvas_set_color(c, ColorBlack);
+
+    if(w->phase == SweepIdle){
+        canvas_set_font(c, FontPrimary);
+        canvas_draw_str(c, 4, TITLE_Y, "Vibration sweep");
+        canvas_set_font(c, FontSecondary);
+        snprintf(buf, sizeof(buf), "%u-%uHz, %u steps, %us", SWEEP_F_MIN, SWEEP_F_MAX, SWEEP_STEPS,
+            SWEEP_STEPS * (SWEEP_SETTLE_MS + SWEEP_MEASURE_MS) / 1000U);
+        canvas_draw_str(c, 4, ROW_Y0, buf);
+        canvas_draw_str(c, 4, ROW_Y0 + ROW_DY, "LIS3DH: SCL 16, SDA 15");
+        canvas_draw_str(c, 4, ROW_Y0 + 3 * ROW_DY, w->no_sensor ? "No sensor at 0x18" : "OK to start");
+        return;
+    }
+
+    /* Title: progress while running, the cursor's point when done */
+    canvas_set_font(c, FontSecondary);
+    const bool running = sweep_busy(s);
+    if(running){
+        snprintf(buf, sizeof(buf), "%s %u/%u  %uHz", (w->phase == SweepSettle) ? "Settle" : "Measure",
+            w->step + 1, SWEEP_STEPS, w->pts[w->step].freq_hz);
+    } else if(w->step){
+        const SweepPoint* p = &w->pts[w->cursor];
+        snprintf(buf, sizeof(buf), "%uHz %urpm %umg", p->freq_hz, p->rpm, p->rms_mg);
+    } else {
+        snprintf(buf, sizeof(buf), "No data");
+    }
+    canvas_draw_str(c, 2, 9, buf);
+
+    /* RMS per step, scaled to the largest */
+    uint16_t peak = 1;
+    for(uint8_t i = 0; i < w->step; i++) peak = MAX(peak, w->pts[i].rms_mg);
+    canvas_draw_line(c, SWEEP_PLOT_X0, SWEEP_PLOT_Y1, SWEEP_PLOT_X0 + SWEEP_PLOT_W, SWEEP_PLOT_Y1);
+    int px = 0, py = 0;
+    for(uint8_t i = 0; i < w->step; i++){
+        int x = SWEEP_PLOT_X0 + i * SWEEP_PLOT_W / (SWEEP_STEPS - 1);
+        int y = SWEEP_PLOT_Y1 - (int)w->pts[i].rms_mg * (SWEEP_PLOT_Y1 - SWEEP_PLOT_Y0) / peak;
+        if(i) canvas_draw_line(c, px, py, x, y);
+        canvas_draw_dot(c, x, SWEEP_PLOT_Y1 + 1);
+        if(!running && i == w->cursor){
+            canvas_draw_frame(c, x - 2, y - 2, 5, 5);
+            canvas_draw_line(c, x, SWEEP_PLOT_Y1 + 1, x, SWEEP_PLOT_Y1 + 3);
+        }
+        px = x;
+        py = y;
+    }
+
+    if(running){
+        canvas_draw_str(c, 2, 63, w->overrun ? "BACK to abort  FIFO ovr" : "BACK to abort");
+    } else if(w->step){
+        const SweepPoint* p = &w->pts[w->cursor];
+        snprintf(buf, sizeof(buf), "%s1x %umg 2x %umg", w->aborted ? "Abort " : "", p->amp_mg[0], p->amp_mg[1]);
+        canvas_draw_str(c, 2, 63, buf);
+    }
+}
+#endif
+
+#if FEATURE_JITTER
+/* ---------- Draw: PWM jitter ---------- */
+static const char* const kJitterNames[JitterScenarios] = {"Idle", "SD", "GUI", "Notify", "BLE", "Mode"};
+
+/* us with one decimal below 10 us, whole us above (max 32768) */
+static void jitter_format_us(uint32_t ns, char* buf, size_t n){
+    if(ns < 10000U) snprintf(buf, n, "%lu.%lu", (unsigned long)(ns / 1000U), (unsigned long)(ns / 100U % 10U));
+    else snprintf(buf, n, "%lu", (unsigned long)((ns + 500U) / 1000U));
+}
+
+enum {
+    JITTER_ROW_Y0 = 18,
+    JITTER_ROW_DY = 9,
+};
+
+static void draw_jitter(Canvas* c, const AppState* s){
+    canvas_clear(c);
+    const Jitter* j = &s->jit;
+    char buf[32];
+    canvas_set_color(c, ColorBlack);
+
+    if(!j->running && (!j->done || j->no_signal)){
+        canvas_set_font(c, FontPrimary);
+        canvas_draw_str(c, 4, TITLE_Y, "PWM jitter");
+        canvas_set_font(c, FontSecondary);
+        canvas_draw_str(c, 4, ROW_Y0, "Wire 2 (A7) to 3 (A6)");
+        snprintf(buf, sizeof(buf), "%u loads x %us at %luHz", JitterScenarios, JITTER_PHASE_MS / 1000U,
+            (unsigned long)kModes[JITTER_MODE].freq_hz);
+        canvas_draw_str(c, 4, ROW_Y0 + ROW_DY, buf);
+        canvas_draw_str(c, 4, ROW_Y0 + 3 * ROW_DY, j->no_signal ? "No edges on 3 (A6)" : "OK to start");
+        return;
+    }
+
+    /* six rows leave no line for a header: status left, column heads right */
+    canvas_set_font(c, FontSecondary);
+    if(j->running){
+        snprintf(buf, sizeof(buf), "%s %u/%u", kJitterNames[j->scenario], j->scenario + 1U, JitterScenarios);
+    } else {
+        snprintf(buf, sizeof(buf), "%s", j->aborted ? "Aborted" : "Done, us");
+    }
+    canvas_draw_str(c, 2, 8, buf);
+    canvas_draw_str_aligned(c, 70, 8, AlignRight, AlignBottom, "p50");
+    canvas_draw_str_aligned(c, 98, 8, AlignRight, AlignBottom, "p99");
+    canvas_draw_str_aligned(c, 126, 8, AlignRight, AlignBottom, "max");
+    canvas_draw_line(c, 0, 10, 127, 10);
+
+    for(uint8_t i = 0; i < JitterScenarios; i++){
+        int y = JITTER_ROW_Y0 + i * JITTER_ROW_DY;
+        const JitterResult* r = &j->res[i];
+        /* '*' = periods lost to overrun: max may hide a worse one; '?' = no load */
+        snprintf(buf, sizeof(buf), "%s%s%s", kJitterNames[i], r->missed ? "*" : "", r->unloaded ? "?" : "");
+        canvas_draw_str(c, 2, y, buf);
+        if(i >= j->scenario){
+            if(j->running && i == j->scenario) canvas_draw_str_aligned(c, 70, y, AlignRight, AlignBottom, "...");
+            continue;
+        }
+        const uint32_t v[3] = {r->p50_ns, r->p99_ns, r->max_ns};
+        for(uint8_t k = 0; k < 3; k++){
+            jitter_format_us(v[k], buf, sizeof(buf));
+            canvas_draw_str_aligned(c, 70 + k * 28, y, AlignRight, AlignBottom, buf);
+        }
+    }
+}
+#endif
+
+#if FEATURE_SCHEDULE
+/* ---------- Draw: Delayed start ---------- */
+static void draw_schedule(Canvas* c, const AppState* s){
+    canvas_clear(c);
+    const Schedule* w = &s->sched;
+
+    canvas_set_font(c, FontPrimary);
+    canvas_set_color(c, ColorBlack);
+    canvas_draw_str(c, 4, TITLE_Y, "Delayed start");
+
+    char buf[32];
+    canvas_set_font(c, FontSecondary);
+
+    if(!w->armed){
+        static const char* const labels[SchedRowCount] = {"Start at", "Mode", "Arm"};
+        for(uint8_t row = 0; row < SchedRowCount; row++){
+            int y = ROW_Y0 + row * ROW_DY;
+            canvas_draw_str(c, 2, y, (w->row == row) ? ">" : " ");
+            canvas_draw_str(c, 14, y, labels[row]);
+            if(row == SchedRowTime){
+                snprintf(buf, sizeof(buf), "%02u:%02u", w->minute / 60U, w->minute % 60U);
+                draw_value_right(c, y, buf);
+            } else if(row == SchedRowMode){
+                draw_value_right(c, y, kModes[w->mode].name);
+            }
+        }
+        draw_scrollbar_dotted(c, SchedRowCount, w->row);
+    } else {
+        /* no refresh timer while armed: nothing may wake the Flipper early */
+        snprintf(buf, sizeof(buf), "%s at %02u:%02u", kModes[w->mode].name, w->minute / 60U, w->minute % 60U);
+        canvas_draw_str(c, 14, ROW_Y0, buf);
+        canvas_draw_str(c, 14, ROW_Y0 + ROW_DY, "PA7 Hi-Z until then");
+        canvas_draw_str(c, 14, ROW_Y0 + 3 * ROW_DY, "BACK to cancel");
+    }
+}
+#endif
+
+#if FEATURE_TREND
+/* ---------- Draw: Trend ---------- */
+/* Header: trace (Up/Down) and window (Left/Right). Completed columns of the
+ * zoom level, newest on the right, each a min..max line so a short spike
+ * still shows at 512 s per column. Speed on top (0 to Max speed), the
+ * measured trace below, scaled to what is on screen. */
+enum {
+    TREND_X0     = CANVAS_W - TREND_COLS,   /* labels to the left */
+    TREND_HZ_Y0  = 11,
+    TREND_HZ_Y1  = 26,
+    TREND_VAL_Y0 = 30,
+    TREND_VAL_Y1 = 63,
+};
+
+static const TrendChannel kTrendViews[] = {
+    TrendChannels,              /* speed only, full height */
+#if FEATURE_PRESSURE
+    TrendSuction,
+    TrendDischarge,
+#endif
+#if FEATURE_POWER_STATS
+    TrendBattery,
+#endif
+};
+
+static void trend_format(const AppState* s, TrendChannel ch, int32_t v, char* out, size_t n){
+    if(ch == TrendBattery){
+        snprintf(out, n, "%ldmA", (long)v);
+    } else if(s->press.unit == PressPsi){
+        snprintf(out, n, "%ld", (long)((v * 145038 + (v < 0 ? -500000 : 500000)) / 1000000));
+    } else {
+        int32_t dbar = (v + (v < 0 ? -5 : 5)) / 10;
+        int32_t mag = (dbar < 0) ? -dbar : dbar;
+        snprintf(out, n, "%s%ld.%ld", (dbar < 0) ? "-" : "", (long)(mag / 10), (long)(mag % 10));
+    }
+}
+
+static void draw_trend(Canvas* c, const AppState* s){
+    canvas_clear(c);
+    canvas_set_color(c, ColorBlack);
+    canvas_set_font(c, FontSecondary);
+    const Trend* t = &s->trend;
+    const TrendLevel* l = &t->lv[t->zoom];
+    const TrendChannel ch = kTrendViews[t->view];
+    static const char* const kNames[TrendChannels + 1] = {"Suction", "Discharge", "Battery", "Speed"};
+    char buf[24];
+
+    if(ch == TrendBattery || ch == TrendChannels) snprintf(buf, sizeof(buf), "%s", kNames[ch]);
+    else snprintf(buf, sizeof(buf), "%s %s", kNames[ch], (s->press.unit == PressPsi) ? "psi" : "bar");
+    canvas_draw_str(c, 2, 8, buf);
+    uint32_t secs = (uint32_t)TREND_COLS * (TREND_BASE_MS / 1000U) << (TREND_SHIFT * t->zoom);
+    if(secs < 3600U) snprintf(buf, sizeof(buf), "< %lum%02lus >", (unsigned long)(secs / 60U), (unsigned long)(secs % 60U));
+    else snprintf(buf, sizeof(buf), "< %luh%02lum >", (unsigned long)(secs / 3600U), (unsigned long)((secs / 60U) % 60U));
+    canvas_draw_str_aligned(c, CANVAS_W, 8, AlignRight, AlignBottom, buf);
+
+    /* speed band: the whole plot when there is no measured trace */
+    const int hz_y1 = (ch == TrendChannels) ? TREND_VAL_Y1 : TREND_HZ_Y1;
+    const int32_t hz_fs = (int32_t)kModes[MODE_COUNT - 1].freq_hz;
+    canvas_draw_line(c, TREND_X0 - 1, TREND_HZ_Y0, TREND_X0 - 1, hz_y1);
+    snprintf(buf, sizeof(buf), "%ld", (long)hz_fs);
+    canvas_draw_str(c, 2, TREND_HZ_Y0 + 7, buf);
+    canvas_draw_str(c, 2, hz_y1, "Hz");
+
+    /* measured range over the columns on screen */
+    int32_t lo = INT16_MAX, hi = INT16_MIN;
+    if(ch != TrendChannels){
+        for(uint8_t i = 0; i < l->count; i++){
+            lo = MIN(lo, (int32_t)l->col[i].lo[ch]);
+            hi = MAX(hi, (int32_t)l->col[i].hi[ch]);
+        }
+        canvas_draw_line(c, TREND_X0 - 1, TREND_VAL_Y0, TREND_X0 - 1, TREND_VAL_Y1);
+        if(lo > hi){
+            canvas_draw_str(c, TREND_X0 + 4, (TREND_VAL_Y0 + TREND_VAL_Y1) / 2 + 4, "no samples");
+        } else {
+            trend_format(s, ch, hi, buf, sizeof(buf));
+            canvas_draw_str(c, 2, TREND_VAL_Y0 + 7, buf);
+            trend_format(s, ch, lo, buf, sizeof(buf));
+            canvas_draw_str(c, 2, TREND_VAL_Y1, buf);
+            if(hi == lo) hi = lo + 1;
+        }
+    }
+
+    for(uint8_t i = 0; i < l->count; i++){
+        const TrendBucket* b = &l->col[(l->head + TREND_COLS - 1U - i) % TREND_COLS];
+        const int x = CANVAS_W - 1 - i;
+        if(b->hz_lo <= b->hz_hi){
+            int y0 = hz_y1 - (int)((int32_t)b->hz_hi * (hz_y1 - TREND_HZ_Y0) / hz_fs);
+            int y1 = hz_y1 - (int)((int32_t)b->hz_lo * (hz_y1 - TREND_HZ_Y0) / hz_fs);
+            canvas_draw_line(c, x, MAX(y0, TREND_HZ_Y0), x, y1);
+        }
+        if(ch != TrendChannels && b->lo[ch] <= b->hi[ch]){
+            int y0 = TREND_VAL_Y1 - (int)((b->hi[ch] - lo) * (TREND_VAL_Y1 - TREND_VAL_Y0) / (hi - lo));
+            int y1 = TREND_VAL_Y1 - (int)((b->lo[ch] - lo) * (TREND_VAL_Y1 - TREND_VAL_Y0) / (hi - lo));
+            canvas_draw_line(c, x, y0, x, y1);
+        }
+    }
+}
+#endif
+
+/* ---------- Draw dispatcher ---------- */
+static void draw_cb(Canvas* c, void* ctx){
+    AppState* s = ctx;
+    if(!s->boot_frame_us){
+        uint32_t us = boot_elapsed_us(s);
+        s->boot_frame_us = us ? us : 1U;    /* 0 means "not yet" */
+        AppEvent ev = {.type = AppEventBoot};
+        furi_message_queue_put(s->q, &ev, 0);
+    }
+    /* one read of the screen: the main loop may switch it meanwhile */
+    ScreenId screen = s->screen;
+    switch(screen){
+#if FEATURE_SAMSUNG
+        case ScreenSelectInverter: draw_select_inverter(c, s); break;
+#endif
+        case ScreenMenu:           draw_menu(c, s); break;
+        case ScreenHelp:           draw_help(c, s); break;
+        case ScreenSettings:       draw_settings(c, s); break;
+#if FEATURE_POWER_STATS
+        case ScreenPower:          draw_power(c, s); break;
+#endif
+#if FEATURE_RACK
+        case ScreenRack:           draw_rack(c, s); break;
+#endif
+#if FEATURE_ODOMETER
+        case ScreenOdometer:       draw_odometer(c, s); break;
+#endif
+#if FEATURE_BURST
+        case ScreenBurst:          draw_burst(c, s); break;
+#endif
+#if FEATURE_SWEEP
+        case ScreenSweep:          draw_sweep(c, s); break;
+#endif
+#if FEATURE_JITTER
+        case ScreenJitter:         draw_jitter(c, s); break;
+#endif
+#if FEATURE_SCHEDULE
+        case ScreenSchedule:       draw_schedule(c, s); break;
+#endif
+#if FEATURE_TREND
+        case ScreenTrend:          draw_trend(c, s); break;
+#endif
+#if FEATURE_HISTORY
+        case ScreenHistory:        draw_history(c, s); break;
+#endif
+        default:                   draw_menu(c, s); break;
+    }
+    draw_confirm(c, s->confirm);
+}
+
+/* ---------- Input queue plumbing ---------- */
+typedef struct { FuriMessageQueue* q; } InputCtx;
+static void vp_input_cb(InputEvent* e, void* ctx){
+    InputCtx* ic = ctx;
+    AppEvent ev = {.type = AppEventInput, .input = *e};
+    furi_message_queue_put(ic->q, &ev, 0);
+}
+#endif /* FEATURE_GUI */
+
+/* ---------- Power transitions ---------- */
+/* Disconnect the line (Hi-Z) and stop PWM/LED/timers; menu state untouched */
+static void output_cut(AppState* s){
+    hist_seg_close(s);
+    pwm_hw_stop_safe(&s->pwm_running);
+    pin_to_hiz();
+    power_hold_sync(&s->power_hold, false);
+    led_apply(s, 0);
+    stop_timers(s);
+    s->remaining_ms = 0;
+    s->timeout_expired = false;
+    supervisor_sync(s);
+    power_profile_sync(s);
+    press_sync(s);
+    display_policy_sync(s);
+}
+
+static void enter_safe_menu(AppState* s){
+    /* safe: disconnect line (Hi-Z), stop PWM/LED/timers, show minimal menu */
+    s->powered = false;
+    s->cursor = 0;
+    s->first_visible = 0;
+    output_cut(s);
+}
+
+static void enter_powered_menu_standby(AppState* s){
+    /* after confirmation: powered menu with Stand by selected */
+    s->powered = true;
+    s->cursor = 0;                 /* caret on "Stand by" */
+    s->first_visible = 0;
+    apply_mode(s, 0);              /* Stand by — PP LOW, no timer */
+}
+
+/* Setup rows: one step of v in lo..hi, wrapping */
+static inline uint8_t step_wrap(uint8_t v, int8_t d, uint8_t lo, uint8_t hi){
+    if(d > 0) return (v >= hi) ? lo : (uint8_t)(v + 1);
+    return (v <= lo) ? hi : (uint8_t)(v - 1);
+}
+
+/* ---------- Rack test sequencing ---------- */
+#if FEATURE_RACK
+static inline bool rack_busy(const AppState* s){
+    return s->rack.phase != RackIdle && s->rack.phase != RackDone && s->rack.phase != RackWired;
+}
+
+/* Abort or finish: back to the safe menu with the relay pins released */
+static void rack_stop(AppState* s, RackPhase end){
+    seq_cancel(&s->seq[SeqRack]);
+    /* the unit running when the test is cut short is logged as aborted */
+    HistResult why = s->hist.end;
+    if(end == RackIdle && why == HistStopped) s->hist.end = HistAborted;
+    enter_safe_menu(s);
+    s->hist.end = why;
+    relays_release();
+    s->rack.phase = end;
+}
 
-    const Mode* m = &kModes[idx];
+/* SeqRack; the dwell is the normal countdown, whose timeout resumes it */
+static void rack_seq(AppState* s, Seq* sq){
+    RackTest* r = &s->rack;
+    SEQ_BEGIN(sq);
+    output_cut(s);
+    s->active = 0;
+    if(relays_looped_to_pwm()){
+        FURI_LOG_W(TAG, "rack: 3 (A6) is wired to 2 (A7), refused");
+        rack_stop(s, RackWired);
+        return;
+    }
+    FURI_LOG_I(TAG, "rack: %u units, %s, %lus each", r->units,
+        kModes[r->mode].name, (unsigned long)rack_dwell_secs(s));
+    for(r->unit = 0; r->unit < r->units; r->unit++){
+        /* PA7 Hi-Z first, then every contact opens */
+        r->phase = RackRelease;
+        output_cut(s);
+        s->active = 0;
+        relays_all_off();
+        SEQ_WAIT_MS(sq, RELAY_RELEASE_MS);
 
-    if(m->freq_hz == 0){
-        /* Stand by: stop PWM and actively hold LOW (safe) */
-        pwm_hw_stop_safe(&s->pwm_running);
-        pin_to_pp_low();
-        stop_timers(s);
-        s->remaining_ms = 0;
-        s->timeout_expired = false;
-    } else {
-        /* PWM run */
-        pwm_hw_stop_safe(&s->pwm_running);
-        pwm_hw_start_safe(m->freq_hz, &s->pwm_running);
-        start_tick_timer_if_needed(s);
+        r->phase = RackSettle;
+        relay_select(r->unit);
+        SEQ_WAIT_MS(sq, RELAY_SETTLE_MS);
+
+        r->phase = RackRun;
+        apply_mode(s, r->mode);
+        start_countdown(s, rack_dwell_secs(s) * 1000U);
+        SEQ_AWAIT(sq);
     }
+    rack_stop(s, RackDone);
+    SEQ_END(sq);
+}
+
+static void rack_adjust(RackTest* r, int8_t d){
+    if(r->row == RackRowUnits)      r->units = step_wrap(r->units, d, 1, RELAY_COUNT);
+    else if(r->row == RackRowMode)  r->mode = step_wrap(r->mode, d, 1, MODE_COUNT - 1);
+    else if(r->row == RackRowDwell) r->dwell = step_wrap(r->dwell, d, 0, COUNT_OF(kRackDwellSecs) - 1);
+}
+#else
+static inline bool rack_busy(const AppState* s){ UNUSED(s); return false; }
+static inline void rack_stop(AppState* s, RackPhase end){ UNUSED(s); UNUSED(end); }
+#endif
+
+/* ---------- Pulse burst sequencing ---------- */
+#if FEATURE_BURST
+enum {
+    BURST_MARGIN_MS = 5,        /* end check this long after the computed length */
+};
+
+static void burst_timer_cb(void* ctx){
+    AppState* s = ctx;
+    AppEvent ev = {.type = AppEventBurst};
+    furi_message_queue_put(s->q, &ev, 0);
+}
+
+/* From the powered menu only: Stand by (PA7 LOW), then the whole burst in TIM1 */
+static bool burst_start(AppState* s, uint8_t mode, uint32_t pulses){
+    BurstTest* b = &s->burst;
+    if(!s->powered || rack_busy(s) || burst_busy(s) || sweep_busy(s) || jitter_busy(s) || mode == 0 || mode >= MODE_COUNT) return false;
+    const Mode* m = &kModes[mode];
+
+    apply_mode(s, 0);
+    if(!pwm_hw_burst(m->freq_hz, pulses, &s->pwm_running)) return false;
+    /* TIM2 sees one update per burst (RCR), so the odometer books it here;
+     * an aborted burst stays booked in full */
+    odo_begin(s, s->odo.unit, 0);
+    odo_add(s, s->odo.unit, mode, pulses);
+
+    b->phase = BurstRunning;
+    b->mode = mode;
+    b->pulses = pulses;
+    b->aborted = false;
+    hist_test_begin(s);
+    power_hold_sync(&s->power_hold, true);
     led_apply(s, m->led_blink_hz);
+    supervisor_sync(s);
+
+    uint32_t ms = (uint32_t)(((uint64_t)pulses * 1000U + m->freq_hz - 1U) / m->freq_hz) + BURST_MARGIN_MS;
+    if(!b->timer) b->timer = furi_timer_alloc(burst_timer_cb, FuriTimerTypeOnce, s);
+    furi_timer_start(b->timer, furi_ms_to_ticks(ms));
+    FURI_LOG_I(TAG, "burst: %lu periods at %luHz", (unsigned long)pulses, (unsigned long)m->freq_hz);
+    return true;
+}
+
+/* Back to Stand by; unless aborted, TIM1 has already ended LOW by itself */
+static void burst_finish(AppState* s, bool aborted){
+    if(s->burst.timer) furi_timer_stop(s->burst.timer);
+    s->burst.phase = BurstDone;
+    s->burst.aborted = aborted;
+    if(!aborted && s->pwm_running){
+        /* PA7 stays LOW: straight from TIM1 to the GPIO, no Hi-Z pause */
+        furi_hal_pwm_stop(PWM_CH);
+        pin_to_pp_low();
+        s->pwm_running = false;
+    }
+    apply_mode(s, 0);
+    hist_test_end(s, HistBurst, aborted, s->burst.mode, s->burst.pulses);
+}
+
+/* AppEventBurst: one-pulse mode clears CEN after the last period */
+static void burst_step(AppState* s){
+    if(!burst_busy(s)) return;      /* stale event after an abort */
+    if(LL_TIM_IsEnabledCounter(TIM1)){
+        furi_timer_start(s->burst.timer, furi_ms_to_ticks(BURST_MARGIN_MS));
+        return;
+    }
+    burst_finish(s, false);
+}
+#else
+static inline void burst_finish(AppState* s, bool aborted){ UNUSED(s); UNUSED(aborted); }
+static inline void burst_step(AppState* s){ UNUSED(s); }
+#endif
+
+/* ---------- Vibration sweep sequencing ---------- */
+#if FEATURE_SWEEP
+/*** LIS3DH wiring (Flipper external header):
+ *  SCL: 16 (C0), SDA: 15 (C1), VCC: 9 (3V3), GND: 18 (GND), SDO/SA0 to GND
+***/
+#define LIS3DH_ADDR         (0x18 << 1)
+#define LIS3DH_WHO_AM_I     0x0F
+#define LIS3DH_ID           0x33
+#define LIS3DH_CTRL_REG1    0x20
+#define LIS3DH_CTRL_REG4    0x23
+#define LIS3DH_CTRL_REG5    0x24
+#define LIS3DH_OUT_X_L      0x28
+#define LIS3DH_FIFO_CTRL    0x2E
+#define LIS3DH_FIFO_SRC     0x2F
+#define LIS3DH_AUTO_INC     0x80
+#define SWEEP_I2C_TIMEOUT   20      /* ms; covers a full 192-byte FIFO burst at 100 kHz */
+#define SWEEP_PATH          APP_DATA_PATH("sweep.csv")
+
+static bool lis3dh_start(void){
+    FuriHalI2cBusHandle* h = &furi_hal_i2c_handle_external;
+    uint8_t id = 0;
+    furi_hal_i2c_acquire(h);
+    bool ok = furi_hal_i2c_is_device_ready(h, LIS3DH_ADDR, SWEEP_I2C_TIMEOUT) &&
+              furi_hal_i2c_read_reg_8(h, LIS3DH_ADDR, LIS3DH_WHO_AM_I, &id, SWEEP_I2C_TIMEOUT) && id == LIS3DH_ID &&
+              furi_hal_i2c_write_reg_8(h, LIS3DH_ADDR, LIS3DH_CTRL_REG1, 0x77, SWEEP_I2C_TIMEOUT) &&  /* 400 Hz, XYZ */
+              furi_hal_i2c_write_reg_8(h, LIS3DH_ADDR, LIS3DH_CTRL_REG4, 0x88, SWEEP_I2C_TIMEOUT) &&  /* BDU, HR: 1 mg/digit at 2 g */
+              furi_hal_i2c_write_reg_8(h, LIS3DH_ADDR, LIS3DH_CTRL_REG5, 0x40, SWEEP_I2C_TIMEOUT) &&  /* FIFO on */
+              furi_hal_i2c_write_reg_8(h, LIS3DH_ADDR, LIS3DH_FIFO_CTRL, 0x00, SWEEP_I2C_TIMEOUT) &&  /* bypass: empty it */
+              furi_hal_i2c_write_reg_8(h, LIS3DH_ADDR, LIS3DH_FIFO_CTRL, 0x80, SWEEP_I2C_TIMEOUT);   /* stream */
+    furi_hal_i2c_release(h);
+    return ok;
 }
 
-/* ---------- Back-hint timer ---------- */
-static void hint_timer_cb(void* ctx){
+static void lis3dh_stop(void){
+    FuriHalI2cBusHandle* h = &furi_hal_i2c_handle_external;
+    furi_hal_i2c_acquire(h);
+    furi_hal_i2c_write_reg_8(h, LIS3DH_ADDR, LIS3DH_CTRL_REG1, 0x00, SWEEP_I2C_TIMEOUT);      /* power down */
+    furi_hal_i2c_release(h);
+}
+
+/* One batch: FIFO level, then every stored sample in one auto-increment read */
+static uint8_t lis3dh_drain(int16_t out[SWEEP_FIFO][3], bool* overrun){
+    FuriHalI2cBusHandle* h = &furi_hal_i2c_handle_external;
+    uint8_t raw[SWEEP_FIFO * 6];
+    uint8_t src = 0, n = 0;
+    furi_hal_i2c_acquire(h);
+    if(furi_hal_i2c_read_reg_8(h, LIS3DH_ADDR, LIS3DH_FIFO_SRC, &src, SWEEP_I2C_TIMEOUT)){
+        n = (src & 0x40) ? SWEEP_FIFO : (src & 0x1F);     /* OVRN: all 32 slots full */
+        if(n && !furi_hal_i2c_read_mem(h, LIS3DH_ADDR, LIS3DH_OUT_X_L | LIS3DH_AUTO_INC, raw, n * 6U, SWEEP_I2C_TIMEOUT)) n = 0;
+    }
+    furi_hal_i2c_release(h);
+    if(src & 0x40) *overrun = true;
+    for(uint8_t i = 0; i < n; i++){
+        for(uint8_t k = 0; k < 3; k++){
+            out[i][k] = (int16_t)((uint16_t)raw[i * 6 + k * 2] | ((uint16_t)raw[i * 6 + k * 2 + 1] << 8)) >> 4;
+        }
+    }
+    return n;
+}
+
+static void sweep_timer_cb(void* ctx){
     AppState* s = ctx;
-    s->hint_visible = false;
-    if(s->vp) view_port_update(s->vp);
+    AppEvent ev = {.type = AppEventSweep};
+    furi_message_queue_put(s->q, &ev, 0);
 }
 
-/* ---------- Alerts ---------- */
-static bool show_limit_alert_confirm(void){
-    DialogsApp* dialogs = furi_record_open(RECORD_DIALOGS);
-    DialogMessage* msg = dialog_message_alloc();
+/* Nominal shaft speed, linear between the mode points */
+static uint16_t sweep_rpm(uint32_t freq_hz){
+    uint8_t i = 2;
+    while(i < MODE_COUNT - 1 && freq_hz > kModes[i].freq_hz) i++;
+    const Mode* a = &kModes[i - 1];
+    const Mode* b = &kModes[i];
+    return (uint16_t)((int32_t)a->rpm +
+        ((int32_t)freq_hz - (int32_t)a->freq_hz) * ((int32_t)b->rpm - (int32_t)a->rpm) / ((int32_t)b->freq_hz - (int32_t)a->freq_hz));
+}
 
-    dialog_message_set_header(msg, "Alert", 64, 2, AlignCenter, AlignTop);
-    dialog_message_set_text(
-        msg,
-        "Long run without condenser\n"
-        "and evaporator fans may\n"
-        "damage compressor parts.",
-        6, 16, AlignLeft, AlignTop);
-    dialog_message_set_buttons(msg, "Cancel", NULL, "Confirm");
+/* Odometer band for an in-between frequency: the nearest mode */
+static uint8_t sweep_band(uint32_t freq_hz){
+    uint8_t best = 1;
+    for(uint8_t i = 2; i < MODE_COUNT; i++){
+        uint32_t d = (freq_hz > kModes[i].freq_hz) ? freq_hz - kModes[i].freq_hz : kModes[i].freq_hz - freq_hz;
+        uint32_t db = (freq_hz > kModes[best].freq_hz) ? freq_hz - kModes[best].freq_hz : kModes[best].freq_hz - freq_hz;
+        if(d < db) best = i;
+    }
+    return best;
+}
 
-    DialogMessageButton res = dialog_message_show(dialogs, msg);
+static uint32_t isqrt64(uint64_t v){
+    uint64_t r = 0, bit = 1ULL << 62;
+    while(bit > v) bit >>= 2;
+    while(bit){
+        if(v >= r + bit){
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)r;
+}
 
-    dialog_message_free(msg);
-    furi_record_close(RECORD_DIALOGS);
-    return (res == DialogMessageButtonRight);
+/* Per sample: offset tracking always, energy and Goertzel while measuring */
+static void sweep_feed(SweepAcc* a, const int16_t xyz[3], bool measure){
+    int32_t ac[3];
+    for(uint8_t k = 0; k < 3; k++){
+        int32_t x = (int32_t)xyz[k] * 256;
+        a->dc_q8[k] += (x - a->dc_q8[k]) / 64;
+        ac[k] = (x - a->dc_q8[k]) / 256;
+    }
+    if(!measure) return;
+    for(uint8_t k = 0; k < 3; k++){
+        a->sumsq += (int64_t)ac[k] * ac[k];
+        for(uint8_t h = 0; h < 2; h++){
+            int32_t* g = a->g[h][k];
+            int32_t s0 = ac[k] + (int32_t)(((int64_t)a->coef_q14[h] * g[0]) >> 14) - g[1];
+            g[1] = g[0];
+            g[0] = s0;
+        }
+    }
+    a->n++;
 }
 
-static bool show_power_on_confirm(void){
-    DialogsApp* dialogs = furi_record_open(RECORD_DIALOGS);
-    DialogMessage* msg = dialog_message_alloc();
+static void sweep_close_step(Sweep* w){
+    const SweepAcc* a = &w->acc;
+    SweepPoint* p = &w->pts[w->step];
+    if(a->n == 0) return;
+    p->rms_mg = (uint16_t)MIN(isqrt64((uint64_t)(a->sumsq / a->n)), UINT16_MAX);
+    for(uint8_t h = 0; h < 2; h++){
+        int64_t power = 0;
+        for(uint8_t k = 0; k < 3; k++){
+            int64_t s1 = a->g[h][k][0], s2 = a->g[h][k][1];
+            power += s1 * s1 + s2 * s2 - ((a->coef_q14[h] * s1) >> 14) * s2;
+        }
+        /* |X(f)| = sqrt(power); a sine of amplitude A gives A * n / 2 */
+        p->amp_mg[h] = (uint16_t)MIN(2U * isqrt64(power > 0 ? (uint64_t)power : 0) / a->n, UINT16_MAX);
+    }
+}
 
-    dialog_message_set_header(msg, "Alert", 64, 2, AlignCenter, AlignTop);
-    dialog_message_set_text(
-        msg,
-        "Check your wiring!\n"
-        "All pins will be activated!\n"
-        "Check help!",
-        64, 16, AlignCenter, AlignTop);
-    dialog_message_set_buttons(msg, "Cancel", NULL, "Confirm");
+/* Next frequency: retuned in place (no stop/start gap) after the first step */
+static void sweep_set_step(AppState* s){
+    Sweep* w = &s->sweep;
+    SweepPoint* p = &w->pts[w->step];
+    memset(p, 0, sizeof(*p));
+    p->freq_hz = (uint16_t)(SWEEP_F_MIN + (SWEEP_F_MAX - SWEEP_F_MIN) * w->step / (SWEEP_STEPS - 1));
+    p->rpm = sweep_rpm(p->freq_hz);
+    if(s->pwm_running) furi_hal_pwm_set_params(PWM_CH, p->freq_hz, 50);
+    else pwm_hw_start_safe(p->freq_hz, &s->pwm_running);
+    odo_begin(s, s->odo.unit, sweep_band(p->freq_hz));
+    w->phase = SweepSettle;
+    w->phase_tick = furi_get_tick();
+}
 
-    DialogMessageButton res = dialog_message_show(dialogs, msg);
+static void sweep_save_csv(const Sweep* w){
+    Storage* st = furi_record_open(RECORD_STORAGE);
+    File* f = storage_file_alloc(st);
+    if(storage_file_open(f, SWEEP_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS)){
+        char line[48];
+        int n = snprintf(line, sizeof(line), "freq_hz,rpm,rms_mg,amp_1x_mg,amp_2x_mg\n");
+        storage_file_write(f, line, (size_t)n);
+        for(uint8_t i = 0; i < w->step; i++){
+            const SweepPoint* p = &w->pts[i];
+            n = snprintf(line, sizeof(line), "%u,%u,%u,%u,%u\n", p->freq_hz, p->rpm, p->rms_mg, p->amp_mg[0], p->amp_mg[1]);
+            storage_file_write(f, line, (size_t)n);
+        }
+    }
+    storage_file_close(f);
+    storage_file_free(f);
+    furi_record_close(RECORD_STORAGE);
+}
 
-    dialog_message_free(msg);
-    furi_record_close(RECORD_DIALOGS);
-    return (res == DialogMessageButtonRight);
+/* Done or aborted: sensor off, Stand by (PA7 LOW), cursor on the peak */
+static void sweep_stop(AppState* s, bool aborted){
+    Sweep* w = &s->sweep;
+    if(w->timer) furi_timer_stop(w->timer);
+    lis3dh_stop();
+    w->phase = SweepDone;
+    w->aborted = aborted;
+    w->cursor = 0;
+    for(uint8_t i = 1; i < w->step; i++){
+        if(w->pts[i].rms_mg > w->pts[w->cursor].rms_mg) w->cursor = i;
+    }
+    apply_mode(s, 0);
+    if(w->step){
+        sweep_save_csv(w);
+        const SweepPoint* pk = &w->pts[w->cursor];
+        hist_test_end(s, HistSweep, aborted, 0, ((uint32_t)pk->freq_hz << 16) | pk->rms_mg);
+    }
 }
 
-/* ---------- Help layout (lines/limits) ---------- */
-static inline void help_layout_params(uint8_t total_lines, uint8_t* out_max_lines, uint8_t* out_max_top_line){
-    const uint8_t top = 10;
-    const uint8_t line_h = 9;
-    uint8_t ml = (uint8_t)((CANVAS_H - top) / line_h);
-    if(ml < 1) ml = 1;
-    uint8_t mtl = (total_lines > ml) ? (uint8_t)(total_lines - ml) : 0;
-    if(out_max_lines) *out_max_lines = ml;
-    if(out_max_top_line) *out_max_top_line = mtl;
+/* From the powered menu only; false (and no_sensor) without a LIS3DH */
+static bool sweep_start(AppState* s){
+    Sweep* w = &s->sweep;
+    if(!s->powered || rack_busy(s) || burst_busy(s) || sweep_busy(s) || jitter_busy(s)) return false;
+    apply_mode(s, 0);
+    w->no_sensor = !lis3dh_start();
+    if(w->no_sensor){
+        w->phase = SweepIdle;
+        return false;
+    }
+    memset(&w->acc, 0, sizeof(w->acc));
+    w->step = 0;
+    w->cursor = 0;
+    w->aborted = false;
+    w->overrun = false;
+    hist_test_begin(s);
+    sweep_set_step(s);
+    power_hold_sync(&s->power_hold, true);
+    led_apply(s, kModes[1].led_blink_hz);
+    supervisor_sync(s);
+    if(!w->timer) w->timer = furi_timer_alloc(sweep_timer_cb, FuriTimerTypePeriodic, s);
+    furi_timer_start(w->timer, furi_ms_to_ticks(SWEEP_POLL_MS));
+    return true;
 }
 
-/* ---------- Title helper ---------- */
-static void draw_title(Canvas* c, const AppState* s){
-    canvas_set_font(c, FontPrimary);
-    canvas_set_color(c, ColorBlack);
+/* AppEventSweep: drain the FIFO, advance on time; true when the plot changed */
+static bool sweep_poll(AppState* s){
+    Sweep* w = &s->sweep;
+    if(!sweep_busy(s)) return false;    /* stale event after a stop */
 
-    const char* inv_name = (s->inverter == InvEmbraco) ? "Embraco" : "Samsung";
-    char title[32];
-    snprintf(title, sizeof(title), "%s Starter", inv_name);
-    canvas_draw_str(c, 4, TITLE_Y, title);
+    int16_t xyz[SWEEP_FIFO][3];
+    uint8_t n = lis3dh_drain(xyz, &w->overrun);
+    for(uint8_t i = 0; i < n; i++) sweep_feed(&w->acc, xyz[i], w->phase == SweepMeasure);
 
-    /* right-aligned timer (if counting) with fixed margin from scrollbar */
-    if(s->remaining_ms > 0){
-        char tbuf[16];
-        unsigned long sec = (unsigned long)((s->remaining_ms + 999)/1000);
-        snprintf(tbuf, sizeof(tbuf), "%lus", sec);
-        uint16_t w = canvas_string_width(c, tbuf);
-        uint16_t right_x = (uint16_t)(SCROLLBAR_X - TIMER_MARGIN);
-        uint16_t x = (w <= right_x) ? (uint16_t)(right_x - w) : 2;
-        canvas_draw_str(c, x, TITLE_Y, tbuf);
+    uint32_t dt = furi_get_tick() - w->phase_tick;
+    if(w->phase == SweepSettle && dt >= furi_ms_to_ticks(SWEEP_SETTLE_MS)){
+        SweepAcc* a = &w->acc;
+        uint16_t rpm = w->pts[w->step].rpm;
+        a->sumsq = 0;
+        a->n = 0;
+        memset(a->g, 0, sizeof(a->g));
+        for(uint8_t h = 0; h < 2; h++){
+            float f = (float)rpm * (float)(h + 1) / 60.0f;
+            a->coef_q14[h] = (int32_t)(2.0f * cosf(6.2831853f * f / (float)SWEEP_ODR_HZ) * 16384.0f);
+        }
+        w->phase = SweepMeasure;
+        w->phase_tick = furi_get_tick();
+        return true;
+    }
+    if(w->phase == SweepMeasure && dt >= furi_ms_to_ticks(SWEEP_MEASURE_MS)){
+        sweep_close_step(w);
+        if(++w->step < SWEEP_STEPS) sweep_set_step(s);
+        else sweep_stop(s, false);
+        return true;
     }
+    return false;
 }
+#else
+static inline void sweep_stop(AppState* s, bool aborted){ UNUSED(s); UNUSED(aborted); }
+static inline bool sweep_poll(AppState* s){ UNUSED(s); return false; }
+#endif
 
-/* ---------- Draw: Select Inverter (initial screen) ---------- */
-static void draw_select_inverter(Canvas* c, const AppState* s){
-    canvas_clear(c);
-    canvas_set_color(c, ColorBlack);
+/* ---------- PWM jitter sequencing ---------- */
+#if FEATURE_JITTER
+/*** Loopback wiring (Flipper external header):
+ *  2 (A7) -> 3 (A6). A6 is TIM16 CH1 (AF14); unit 1's relay input shares it,
+ *  so the relay board comes off for this test.
+ *  TIM16 belongs to the speaker: holding the speaker keeps the notification
+ *  service off it, and PB8 (the speaker's CH1 pin) is parked meanwhile.
+***/
+#define JITTER_PIN      (&gpio_ext_pa6)
+#define JITTER_SD_PATH  APP_DATA_PATH("jitter.tmp")
 
-    /* Title */
-    canvas_set_font(c, FontPrimary);
-    canvas_draw_str(c, 4, TITLE_Y, "Inverter type");
+/* TIM1_UP_TIM16: only CC1 is enabled; nothing here but the subtraction */
+static void jitter_isr(void* ctx){
+    Jitter* j = ctx;
+    if(!LL_TIM_IsActiveFlag_CC1(TIM16)) return;
+    uint16_t cap = (uint16_t)LL_TIM_IC_GetCaptureCH1(TIM16);       /* clears CC1IF */
+    if(LL_TIM_IsActiveFlag_CC1OVR(TIM16)){
+        /* an edge was overwritten: this difference spans two periods */
+        LL_TIM_ClearFlag_CC1OVR(TIM16);
+        j->missed++;
+        j->primed = false;
+    }
+    if(j->primed){
+        uint8_t h = j->head;
+        if((uint8_t)(h - j->tail) < JITTER_RING){
+            j->ring[h % JITTER_RING] = (uint16_t)(cap - j->last);
+            j->head = (uint8_t)(h + 1U);
+        } else {
+            j->missed++;
+        }
+    }
+    j->last = cap;
+    j->primed = true;
+}
 
-    /* options */
-    canvas_set_font(c, FontSecondary);
-    int y = ROW_Y0;
-    canvas_draw_str(c, 2, y, (s->cursor == 0) ? ">" : " ");
-    canvas_draw_str(c, 14, y, "Embraco");
-    y += ROW_DY;
-    canvas_draw_str(c, 2, y, (s->cursor == 1) ? ">" : " ");
-    canvas_draw_str(c, 14, y, "Samsung");
+static bool jitter_capture_start(Jitter* j){
+    if(!furi_hal_speaker_acquire(JITTER_SPEAKER_MS)) return false;  /* a sound is playing */
+    furi_hal_gpio_init(&gpio_speaker, GpioModeAnalog, GpioPullNo, GpioSpeedLow);
+    furi_hal_gpio_init_ex(JITTER_PIN, GpioModeAltFunctionPushPull, GpioPullNo, GpioSpeedVeryHigh, GpioAltFn14TIM16);
+    LL_TIM_SetPrescaler(TIM16, JITTER_PSC);
+    LL_TIM_SetAutoReload(TIM16, 0xFFFF);
+    LL_TIM_IC_SetActiveInput(TIM16, LL_TIM_CHANNEL_CH1, LL_TIM_ACTIVEINPUT_DIRECTTI);
+    LL_TIM_IC_SetPrescaler(TIM16, LL_TIM_CHANNEL_CH1, LL_TIM_ICPSC_DIV1);
+    LL_TIM_IC_SetFilter(TIM16, LL_TIM_CHANNEL_CH1, LL_TIM_IC_FILTER_FDIV1);
+    LL_TIM_IC_SetPolarity(TIM16, LL_TIM_CHANNEL_CH1, LL_TIM_IC_POLARITY_RISING);
+    LL_TIM_CC_EnableChannel(TIM16, LL_TIM_CHANNEL_CH1);
+    j->head = j->tail = 0;
+    j->primed = false;
+    furi_hal_interrupt_set_isr(FuriHalInterruptIdTim1UpTim16, jitter_isr, j);
+    LL_TIM_EnableIT_CC1(TIM16);
+    LL_TIM_EnableCounter(TIM16);
+    return true;
+}
 
-    /* scrollbar (2 items) */
-    draw_scrollbar_dotted(c, 2, s->cursor);
+static void jitter_capture_stop(void){
+    LL_TIM_DisableIT_CC1(TIM16);
+    LL_TIM_DisableCounter(TIM16);
+    LL_TIM_CC_DisableChannel(TIM16, LL_TIM_CHANNEL_CH1);
+    furi_hal_interrupt_set_isr(FuriHalInterruptIdTim1UpTim16, NULL, NULL);
+    furi_hal_gpio_init(JITTER_PIN, GpioModeAnalog, GpioPullNo, GpioSpeedLow);
+    furi_hal_speaker_release();     /* PB8 back to analog, TIM16 clock off */
 }
 
-/* ---------- Draw: Menu ---------- */
-static void draw_menu(Canvas* c, const AppState* s){
-    canvas_clear(c);
-    draw_title(c, s);
+/* Forget everything captured so far; the next edge only primes `last` */
+static void jitter_capture_reset(Jitter* j){
+    LL_TIM_DisableIT_CC1(TIM16);
+    j->tail = j->head;
+    j->primed = false;
+    j->missed = 0;
+    LL_TIM_EnableIT_CC1(TIM16);
+}
 
-    canvas_set_font(c, FontSecondary);
-    const uint8_t MAX_ROWS = 4;
+static void jitter_timer_cb(void* ctx){
+    AppState* s = ctx;
+    AppEvent ev = {.type = AppEventJitter};
+    furi_message_queue_put(s->q, &ev, 0);
+}
 
-    /* Build dynamic list depending on powered flag */
-    const bool powered = s->powered;
-    uint8_t row_total = powered ? (uint8_t)(MODE_COUNT /*4*/ + 3 /*Power off + Settings + Help*/) 
-                                : 3 /*Power on + Settings + Help*/;
+/* Distance to the nearer commanded period (both sides of a mode switch) */
+static uint32_t jitter_dev_ns(const Jitter* j, uint16_t counts){
+    int64_t p = (int64_t)counts * (1000000000 / JITTER_CLK_HZ);
+    int64_t a = p - 1000000000LL / j->hz;
+    int64_t b = p - 1000000000LL / j->alt_hz;
+    if(a < 0) a = -a;
+    if(b < 0) b = -b;
+    return (uint32_t)MIN(MIN(a, b), (int64_t)UINT32_MAX);
+}
 
-    /* adjust first_visible to bounds */
-    uint8_t first_visible = s->first_visible;
-    if(first_visible + MAX_ROWS > row_total){
-        first_visible = (row_total > MAX_ROWS) ? (uint8_t)(row_total - MAX_ROWS) : 0;
+static void jitter_drain(Jitter* j){
+    while(j->tail != j->head){
+        uint16_t p = j->ring[j->tail % JITTER_RING];
+        j->tail++;
+        if(j->n < JITTER_SAMPLES) j->dev[j->n++] = jitter_dev_ns(j, p);
     }
+}
 
-    /* draw rows */
-    for(uint8_t i = 0; i < MAX_ROWS; i++){
-        uint8_t row = (uint8_t)(first_visible + i);
-        if(row >= row_total) break;
-        int y = ROW_Y0 + i*ROW_DY;
+static int jitter_cmp(const void* a, const void* b){
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
 
-        if(row == s->cursor) canvas_draw_str(c, 2, y, ">");
-        else canvas_draw_str(c, 2, y, " ");
+/* Scenario over: exact percentiles from the sorted deviations */
+static void jitter_close_phase(Jitter* j){
+    JitterResult* r = &j->res[j->scenario];
+    memset(r, 0, sizeof(*r));
+    r->n = j->n;
+    r->missed = j->missed;
+    r->unloaded = (j->scenario == JitterBle && !j->ble);
+    if(j->n){
+        qsort(j->dev, j->n, sizeof(j->dev[0]), jitter_cmp);
+        r->p50_ns = j->dev[j->n / 2U];
+        r->p99_ns = j->dev[(uint32_t)j->n * 99U / 100U];
+        r->max_ns = j->dev[j->n - 1U];
+    }
+}
 
-        if(powered){
-            /* indices: 0..3 => modes; 4 => Power off; 5 => Settings; 6 => Help */
-            if(row < MODE_COUNT){
-                canvas_draw_str(c, 14, y, kModes[row].name);
-                if(row == s->active){
-                    int check_x = (int)SCROLLBAR_X - TIMER_MARGIN - 10;
-                    if(check_x < 90) check_x = 90;
-                    draw_checkmark(c, check_x, y);
-                }
-            } else if(row == MODE_COUNT){
-                canvas_draw_str(c, 14, y, "Power off");
-            } else if(row == MODE_COUNT + 1){
-                canvas_draw_str(c, 14, y, "Settings");
-            } else {
-                canvas_draw_str(c, 14, y, "Help");
-            }
-        } else {
-            /* indices: 0 => Power on; 1 => Settings; 2 => Help */
-            if(row == 0) canvas_draw_str(c, 14, y, "Power on");
-            else if(row == 1) canvas_draw_str(c, 14, y, "Settings");
-            else canvas_draw_str(c, 14, y, "Help");
+static void jitter_sd_close(Jitter* j){
+    if(!j->sd) return;
+    storage_file_close(j->sd);
+    storage_file_free(j->sd);
+    j->sd = NULL;
+    storage_common_remove(furi_record_open(RECORD_STORAGE), JITTER_SD_PATH);
+    furi_record_close(RECORD_STORAGE);
+}
+
+/* Manufacturer data under the 0xFFFF (no company) id; the counter makes
+ * every update a real change */
+static bool jitter_ble_data(Jitter* j){
+    const uint8_t adv[] = {5, 0xFF, 0xFF, 0xFF, 'E', j->ble_seq++};
+    return furi_hal_bt_extra_beacon_set_data(adv, sizeof(adv));
+}
+
+/* The extra beacon is advertised by the radio core on its own; a beacon
+ * already running belongs to someone else and is left alone */
+static void jitter_ble_start(Jitter* j){
+    if(furi_hal_bt_extra_beacon_is_active()) return;
+    const GapExtraBeaconConfig cfg = {
+        .min_adv_interval_ms = JITTER_BLE_ADV_MS,
+        .max_adv_interval_ms = JITTER_BLE_ADV_MS,
+        .adv_channel_map = GapAdvChannelMapAll,
+        .adv_power_level = GapAdvPowerLevel_0dBm,
+        .address_type = GapAddressTypeRandom,
+        /* static random: top two bits set at both ends, whichever byte order the stack uses */
+        .address = {0xC5, 0x17, 0x4A, 0x31, 0x9E, 0xC5},
+    };
+    j->ble_seq = 0;
+    j->ble = furi_hal_bt_extra_beacon_set_config(&cfg) && jitter_ble_data(j) &&
+        furi_hal_bt_extra_beacon_start();
+}
+
+static void jitter_ble_stop(Jitter* j){
+    if(!j->ble) return;
+    furi_hal_bt_extra_beacon_stop();
+    j->ble = false;
+}
+
+/* Fresh Mid run (which also re-arms the mode's time limit), then load */
+static void jitter_set_phase(AppState* s){
+    Jitter* j = &s->jit;
+    apply_mode(s, JITTER_MODE);
+    j->hz = j->alt_hz = kModes[JITTER_MODE].freq_hz;
+    j->n = 0;
+    j->phase_tick = j->load_tick = furi_get_tick();
+    jitter_capture_reset(j);
+    if(j->scenario == JitterStorage){
+        j->sd = storage_file_alloc(furi_record_open(RECORD_STORAGE));
+        j->sd_bytes = 0;
+        if(!storage_file_open(j->sd, JITTER_SD_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS)){
+            storage_file_free(j->sd);
+            j->sd = NULL;
+            furi_record_close(RECORD_STORAGE);
         }
+    } else if(j->scenario == JitterBle){
+        jitter_ble_start(j);
     }
+}
 
-    draw_scrollbar_dotted(c, row_total, s->cursor);
+/* Done or aborted: capture off, temp file gone, Stand by (PA7 LOW) */
+static void jitter_stop(AppState* s, bool aborted){
+    Jitter* j = &s->jit;
+    if(j->timer) furi_timer_stop(j->timer);
+    jitter_capture_stop();
+    jitter_sd_close(j);
+    jitter_ble_stop(j);
+    free(j->dev);
+    j->dev = NULL;
+    j->running = false;
+    j->done = true;
+    j->aborted = aborted;
+    apply_mode(s, 0);
+    uint32_t worst = 0;
+    for(uint8_t i = 0; i < JitterScenarios; i++) worst = MAX(worst, j->res[i].p99_ns);
+    hist_test_end(s, HistJitter, aborted, JITTER_MODE, worst);
+}
 
-    /* bottom hint (short BACK): left-aligned to menu text (x=14) */
-    if(s->hint_visible){
-        const char* msg = "Long press back to exit";
-        uint16_t text_h = 10;
-        uint16_t text_y = (uint16_t)(CANVAS_H - 2);
+/* From the powered menu only; false if TIM16 is busy or memory is short */
+static bool jitter_start(AppState* s){
+    Jitter* j = &s->jit;
+    if(!s->powered || rack_busy(s) || burst_busy(s) || sweep_busy(s) || jitter_busy(s)) return false;
+    j->dev = malloc(JITTER_SAMPLES * sizeof(j->dev[0]));
+    if(!j->dev) return false;
+    if(!jitter_capture_start(j)){
+        free(j->dev);
+        j->dev = NULL;
+        return false;
+    }
+    memset(j->res, 0, sizeof(j->res));
+    j->running = true;
+    j->done = j->aborted = j->no_signal = false;
+    j->scenario = JitterIdle;
+    hist_test_begin(s);
+    jitter_set_phase(s);
+    if(!j->timer) j->timer = furi_timer_alloc(jitter_timer_cb, FuriTimerTypePeriodic, s);
+    furi_timer_start(j->timer, furi_ms_to_ticks(JITTER_POLL_MS));
+    return true;
+}
 
-        canvas_set_color(c, ColorBlack);
-        canvas_draw_box(c, 0, (uint16_t)(text_y - text_h), CANVAS_W, (uint16_t)(text_h + 4));
-        canvas_set_color(c, ColorWhite);
-        canvas_draw_str(c, 14, text_y, msg);
-        canvas_set_color(c, ColorBlack);
+/* One poll's worth of the scenario's load */
+static void jitter_load(AppState* s){
+    Jitter* j = &s->jit;
+    uint32_t now = furi_get_tick();
+    switch((JitterScenario)j->scenario){
+        case JitterStorage:
+            /* contents don't matter: the deviation buffer is at hand */
+            if(!j->sd) break;
+            if(j->sd_bytes >= JITTER_SD_WRAP){
+                storage_file_seek(j->sd, 0, true);
+                j->sd_bytes = 0;
+            }
+            j->sd_bytes += (uint32_t)storage_file_write(j->sd, j->dev, JITTER_SD_CHUNK);
+            break;
+        case JitterGui:
+            app_redraw(s);
+            break;
+        case JitterNotify:
+            if(now - j->load_tick < furi_ms_to_ticks(JITTER_NOTIFY_MS)) break;
+            j->load_tick = now;
+            app_notify(s, (now / JITTER_NOTIFY_MS) & 1U ? &sequence_set_green_255 : &sequence_reset_green);
+            app_notify(s, &sequence_display_backlight_on);
+            break;
+        case JitterBle:
+            if(j->ble) jitter_ble_data(j);
+            break;
+        case JitterModeSwitch:
+            if(now - j->load_tick < furi_ms_to_ticks(JITTER_SWITCH_MS)) break;
+            j->load_tick = now;
+            jitter_drain(j);        /* periods so far belong to the old mode */
+            apply_mode(s, (s->active == JITTER_MODE) ? JITTER_ALT_MODE : JITTER_MODE);
+            j->alt_hz = j->hz;
+            j->hz = kModes[s->active].freq_hz;
+            break;
+        default:
+            break;
     }
 }
 
-/* ---------- Draw: Help (per inverter) ---------- */
-static void draw_help(Canvas* c, const AppState* s){
-    canvas_clear(c);
-    canvas_set_font(c, FontSecondary);
-    canvas_set_color(c, ColorBlack);
+/* AppEventJitter: collect, load, advance on time; true when the table changed */
+static bool jitter_poll(AppState* s){
+    Jitter* j = &s->jit;
+    if(!jitter_busy(s)) return false;   /* stale event after a stop */
+
+    jitter_drain(j);
+    if(furi_get_tick() - j->phase_tick < furi_ms_to_ticks(JITTER_PHASE_MS)){
+        jitter_load(s);
+        return false;
+    }
+    jitter_close_phase(j);
+    jitter_sd_close(j);
+    jitter_ble_stop(j);
+    if(j->scenario == JitterIdle && j->n == 0){
+        j->no_signal = true;
+        jitter_stop(s, true);
+    } else if(++j->scenario < JitterScenarios){
+        jitter_set_phase(s);
+    } else {
+        jitter_stop(s, false);
+    }
+    return true;
+}
+#else
+static inline void jitter_stop(AppState* s, bool aborted){ UNUSED(s); UNUSED(aborted); }
+static inline bool jitter_poll(AppState* s){ UNUSED(s); return false; }
+#endif
+
+/* ---------- Delayed start sequencing ---------- */
+#if FEATURE_SCHEDULE
+static void sched_alarm_cb(void* ctx){
+    AppState* s = ctx;
+    AppEvent ev = {.type = AppEventSchedule};
+    furi_message_queue_put(s->q, &ev, 0);      /* RTC interrupt: never block */
+}
+
+static uint32_t sched_now(void){
+    DateTime dt;
+    furi_hal_rtc_get_datetime(&dt);
+    return datetime_datetime_to_timestamp(&dt);
+}
+
+/* Safe menu only; the alarm is daily-masked, so `at` is always < 24 h away */
+static bool sched_arm(AppState* s){
+    Schedule* w = &s->sched;
+    if(s->powered || w->armed || w->mode == 0 || w->mode >= MODE_COUNT) return false;
+    uint32_t now = sched_now();
+    uint32_t at = now - now % SCHED_DAY_S + w->minute * 60U;
+    if(at < now + SCHED_LEAD_S) at += SCHED_DAY_S;
+    DateTime dt;
+    datetime_timestamp_to_datetime(at, &dt);
+    furi_hal_rtc_set_alarm_callback(sched_alarm_cb, s);
+    furi_hal_rtc_set_alarm(&dt, true);
+    w->at = at;
+    w->armed = true;
+    FURI_LOG_I(TAG, "delayed start: %s at %02u:%02u, in %lus", kModes[w->mode].name,
+        w->minute / 60U, w->minute % 60U, (unsigned long)(at - now));
+    return true;
+}
+
+static void sched_cancel(AppState* s){
+    if(!s->sched.armed) return;
+    furi_hal_rtc_set_alarm(NULL, false);
+    furi_hal_rtc_set_alarm_callback(NULL, NULL);
+    s->sched.armed = false;
+}
+
+/* AppEventSchedule: same as Power on, Confirm, then the mode */
+static void sched_fire(AppState* s){
+    if(!s->sched.armed) return;     /* cancelled after the interrupt */
+    uint8_t mode = s->sched.mode;
+    sched_cancel(s);
+    s->confirm = ConfirmNone;
+    s->screen = ScreenMenu;
+    enter_powered_menu_standby(s);
+    apply_mode(s, mode);
+    s->cursor = mode;
+    display_wake(s);
+    FURI_LOG_I(TAG, "delayed start: %s, %lds off the set time", kModes[mode].name,
+        (long)((int32_t)(sched_now() - s->sched.at)));
+}
+#else
+static inline void sched_cancel(AppState* s){ UNUSED(s); }
+static inline void sched_fire(AppState* s){ UNUSED(s); }
+#endif
+
+/* ---------- Sequence dispatch ---------- */
+/* Carries a body on from where it stopped: AppEventSeq, or a wake of the owner */
+static void seq_run(AppState* s, SeqId id){
+    Seq* sq = &s->seq[id];
+    switch(id){
+#if FEATURE_RACK
+        case SeqRack: rack_seq(s, sq); break;
+#endif
+#if FEATURE_GUI
+        case SeqHint: hint_seq(s, sq); break;
+#endif
+        default: sq->line = 0; break;
+    }
+}
+
+#if FEATURE_GUI
+/* From the top; one that is already running starts over (menu actions only) */
+static void seq_start(AppState* s, SeqId id){
+    Seq* sq = &s->seq[id];
+    seq_cancel(sq);
+    sq->id = (uint8_t)id;
+    sq->q = s->q;
+    seq_run(s, id);
+}
+#endif
+
+/* ---------- Safe stop ---------- */
+/* Every sequence ended, PA7 Hi-Z, safe menu: Power off, supervisor and e-stop.
+ * `why` goes into the history record of whatever was running. */
+static void safe_stop_all(AppState* s, HistResult why){
+    s->hist.end = why;
+    if(rack_busy(s)) rack_stop(s, RackIdle);
+    if(burst_busy(s)) burst_finish(s, true);
+    if(sweep_busy(s)) sweep_stop(s, true);
+    if(jitter_busy(s)) jitter_stop(s, true);
+    enter_safe_menu(s);
+    s->hist.end = HistStopped;
+    s->screen = ScreenMenu;
+}
+
+#if FEATURE_ESTOP
+/* Main loop after a trip: PA7 is already Hi-Z, the rest follows here */
+static void estop_service(AppState* s){
+    Estop* e = &s->estop;
+    uint32_t ipus = furi_hal_cortex_instructions_per_microsecond();
+    uint32_t entry = e->entry_cyc;
+    uint32_t cut = e->cut_cyc;
+    EstopSource src = (EstopSource)e->source;
+
+    sched_cancel(s);
+    s->confirm = ConfirmNone;
+    safe_stop_all(s, HistEstop);
+
+    e->ui_us = (DWT->CYCCNT - cut) / ipus;
+    e->cut_ns = (uint32_t)((uint64_t)(cut - entry) * 1000U / ipus);
+    e->last_source = (uint8_t)src;
+    e->count++;
+    e->banner = true;
+    if(src == EstopKeys) e->swallow = ESTOP_CHORD;
+    e->pending = false;
+
+    rec_note_timer(s, ErcTimerEstop);
+    FURI_LOG_W(TAG, "e-stop (%s): PA7 Hi-Z %luns after entry, safe menu %luus later",
+        (src == EstopPin) ? "pin" : "keys", (unsigned long)e->cut_ns, (unsigned long)e->ui_us);
+    display_wake(s);
+}
+
+#if FEATURE_GUI
+/* Chord keys do nothing until released; any other press clears the banner */
+static bool estop_on_input(AppState* s, const InputEvent* ev){
+    Estop* e = &s->estop;
+    uint8_t bit = (uint8_t)(1U << ev->key);
+    if(e->swallow & bit){
+        if(ev->type == InputTypeRelease) e->swallow &= (uint8_t)~bit;
+        return true;
+    }
+    if(ev->type == InputTypePress) e->banner = false;
+    return false;
+}
+#endif
+#else
+static inline void estop_service(AppState* s){ UNUSED(s); }
+static inline bool estop_on_input(AppState* s, const InputEvent* ev){ UNUSED(s); UNUSED(ev); return false; }
+#endif
+
+/* ---------- Background run ---------- */
+/* A .fap is unloaded when it exits, so nothing of ours may stay resident: the
+ * "service" is TIM1 itself plus a tiny record left in the firmware's record
+ * registry. Only limited runs are handed off: the remaining time becomes a
+ * counted run, so the hardware enforces default_secs. TIM1's last update
+ * then clears MOE through a DMA write (OSSI=0), so the timer lets go of PA7
+ * and the pin floats, as after Power off. An unlimited run would have no
+ * supervisor, e-stop or limit, so it stops with the app.
+ *
+ * Releasing the TIM1 clock and the insomnia hold needs code to run after the
+ * end, and none of ours is left: both stay until the app is relaunched (it
+ * adopts and frees the record) or the Flipper reboots. The alert raised by
+ * the long BACK says so before the handoff. */
+#if FEATURE_BACKGROUND
+#define RECORD_EMBRACO_RUN "embraco_run"
+#define BG_RUN_MAGIC 0x45524E32U   /* "ERN2" */
+#define BG_DMA      DMA2
+#define BG_DMA_CH   LL_DMA_CHANNEL_7
+
+typedef struct {
+    uint32_t magic;
+    uint32_t deadline_tick;     /* furi_get_tick() at end of counted run */
+    uint32_t bdtr_off;          /* TIM1 BDTR with MOE clear: the DMA source */
+    uint8_t  inverter;
+    uint8_t  active;            /* mode running in TIM1 */
+    uint8_t  unit;              /* odometer owner of the run */
+} BgRun;
+
+/* Would a long BACK hand the run off? */
+static bool bg_run_possible(const AppState* s){
+    if(!s->background_run || !s->pwm_running) return false;
+    if(s->active == 0 || s->active >= MODE_COUNT) return false;
+    /* unlimited: nothing would ever stop it */
+    if(s->remaining_ms == 0) return false;
+    /* nothing would watch the e-stop loop; a trip not yet serviced wins too */
+    return !s->estop.pin_enabled && !s->estop.pending;
+}
+
+/* Float PA7 at the end of the counted run: TIM1's final update (the one that
+ * stops it in one-pulse mode) requests one word into BDTR with MOE clear.
+ * The source lives in the record, which outlives the app. */
+static void bg_run_float_arm(BgRun* run){
+    LL_TIM_SetOffStates(TIM1, LL_TIM_OSSI_DISABLE, LL_TIM_OSSR_DISABLE);
+    run->bdtr_off = TIM1->BDTR & ~TIM_BDTR_MOE;
+    LL_DMA_ConfigTransfer(BG_DMA, BG_DMA_CH,
+        LL_DMA_DIRECTION_MEMORY_TO_PERIPH | LL_DMA_MODE_NORMAL | LL_DMA_PERIPH_NOINCREMENT |
+        LL_DMA_MEMORY_NOINCREMENT | LL_DMA_PDATAALIGN_WORD | LL_DMA_MDATAALIGN_WORD | LL_DMA_PRIORITY_HIGH);
+    LL_DMA_ConfigAddresses(BG_DMA, BG_DMA_CH, (uint32_t)(uintptr_t)&run->bdtr_off,
+        (uint32_t)(uintptr_t)&TIM1->BDTR, LL_DMA_DIRECTION_MEMORY_TO_PERIPH);
+    LL_DMA_SetDataLength(BG_DMA, BG_DMA_CH, 1);
+    LL_DMA_SetPeriphRequest(BG_DMA, BG_DMA_CH, LL_DMAMUX_REQ_TIM1_UP);
+    LL_DMA_EnableChannel(BG_DMA, BG_DMA_CH);
+    /* after the switch's own UG, so only the end of the run triggers it */
+    LL_TIM_EnableDMAReq_UPDATE(TIM1);
+}
+
+static void bg_run_float_disarm(void){
+    LL_TIM_DisableDMAReq_UPDATE(TIM1);
+    LL_DMA_DisableChannel(BG_DMA, BG_DMA_CH);
+}
+
+static bool bg_run_handoff(AppState* s){
+    if(!bg_run_possible(s)) return false;
+    const Mode* m = &kModes[s->active];
+
+    BgRun* run = malloc(sizeof(BgRun));
+    run->magic = BG_RUN_MAGIC;
+    run->inverter = (uint8_t)s->inverter;
+    run->active = s->active;
+    run->unit = s->odo.run_unit;
+
+    uint32_t periods = (uint32_t)(((uint64_t)s->remaining_ms * m->freq_hz) / 1000U);
+    if(periods > PWM_MAX_COUNTED) periods = PWM_MAX_COUNTED;
+    if(!pwm_hw_arm_counted(periods)){
+        free(run);
+        return false;
+    }
+    bg_run_float_arm(run);
+    run->deadline_tick = furi_get_tick() + furi_ms_to_ticks((uint32_t)(((uint64_t)periods * 1000U) / m->freq_hz));
+    /* TIM2 is released by now: book the whole counted run up front */
+    odo_add(s, run->unit, run->active, periods);
+
+    furi_record_create(RECORD_EMBRACO_RUN, run);
+    /* TIM1, PA7 and the insomnia hold now belong to the record */
+    s->pwm_running = false;
+    s->power_hold = false;
+    return true;
+}
+
+/* Adopt a run left by bg_run_handoff; returns true if PWM is still live */
+static bool bg_run_reattach(AppState* s){
+    if(!furi_record_exists(RECORD_EMBRACO_RUN)) return false;
+
+    BgRun* rec = furi_record_open(RECORD_EMBRACO_RUN);
+    BgRun run = *rec;
+    furi_record_close(RECORD_EMBRACO_RUN);
+    /* nothing may be left for the DMA to read once the record is freed */
+    bg_run_float_disarm();
+    if(furi_record_destroy(RECORD_EMBRACO_RUN)) free(rec);
+    if(run.magic != BG_RUN_MAGIC || run.active == 0 || run.active >= MODE_COUNT) return false;
+
+    s->inverter = (InverterId)run.inverter;
+    s->powered = true;
+    s->screen = ScreenMenu;
+    s->cursor = run.active;
+    s->first_visible = 0;
+    s->active = run.active;
+    s->pwm_running = true;          /* TIM1 is ours again (running or stopped) */
+    s->power_hold = true;
+    s->background_run = true;
+
+    int32_t left = (int32_t)(run.deadline_tick - furi_get_tick());
+    bool live = left > 0 && pwm_hw_resume_continuous();
+    if(!live){
+        /* counted run already ended in hardware: same as a foreground auto-off */
+        apply_mode(s, 0);
+        return false;
+    }
+    /* booked in full at handoff; give back what the hardware won't run */
+    odo_add(s, run.unit, run.active, -(int64_t)(((uint64_t)left * kModes[run.active].freq_hz) / 1000U));
+
+    odo_begin(s, run.unit, run.active);
+    led_apply(s, kModes[run.active].led_blink_hz);
+    supervisor_sync(s);
+    power_profile_sync(s);
+    press_sync(s);
+    /* software auto-off takes over for the time the hardware had left */
+    start_countdown(s, (uint32_t)left);
+    return true;
+}
+#else
+static inline bool bg_run_possible(const AppState* s){ UNUSED(s); return false; }
+static inline bool bg_run_handoff(AppState* s){ UNUSED(s); return false; }
+static inline bool bg_run_reattach(AppState* s){ UNUSED(s); return false; }
+#endif
+
+/* ---------- CLI ("embraco ...") ---------- */
+#if FEATURE_CLI
+/* Parsed in the CLI thread, executed by the main loop (AppEventCli), so PA7
+ * and the timers are only ever touched from one thread. "on" is the same
+ * step as Confirm on the Power on alert. */
+#define CLI_COMMAND "embraco"
+
+typedef enum {
+    CliCmdOn = 0,               /* safe -> powered, Stand by */
+    CliCmdOff,                  /* Power off: Hi-Z */
+    CliCmdMode,                 /* arg: kModes[] index, powered only */
+    CliCmdLimit,                /* arg: 0/1 */
+    CliCmdBurst,                /* mode: kModes[] index, arg: periods */
+    CliCmdSweep,
+    CliCmdJitter,
+    CliCmdSchedule,             /* mode: kModes[] index, arg: minute of day, -1 = cancel */
+    CliCmdEstop,                /* arg: e-stop pin 0/1 */
+    CliCmdSerial,               /* mode: unit slot, arg: serial */
+    CliCmdExit,
+} CliCmd;
+
+static void cli_usage(void){
+    printf("Usage: " CLI_COMMAND " on | off | mode <0-%u> | limit <on|off> | burst <1-%u> <1-%lu> | sweep [start] | jitter [start] | schedule <hh:mm> <1-%u>|off | estop [on|off] | serial [<1-%u> <n>] | history <serial>|since <yyyy-mm-dd> | status | odo | exit\r\n",
+        (unsigned)(MODE_COUNT - 1), (unsigned)(MODE_COUNT - 1), (unsigned long)PWM_MAX_COUNTED, (unsigned)(MODE_COUNT - 1),
+        (unsigned)ODO_UNITS);
+}
+
+/* Status reads a few words the main loop owns; a torn read only skews one line */
+static void cli_status(const AppState* s){
+    printf("powered: %s\r\nmode: %s\r\npwm: %luHz\r\nlimit: %s\r\nremaining: %lus\r\n",
+        s->powered ? "yes" : "no",
+        s->powered ? kModes[s->active].name : "Hi-Z",
+        (unsigned long)pwm_freq_now(s),
+        s->limit_runtime ? "on" : "off",
+        (unsigned long)((s->remaining_ms + 999U) / 1000U));
+#if FEATURE_BURST
+    const BurstTest* b = &s->burst;
+    if(b->phase != BurstIdle){
+        printf("burst: %s %lu at %luHz\r\n",
+            (b->phase == BurstRunning) ? "sending" : (b->aborted ? "aborted" : "sent"),
+            (unsigned long)b->pulses, (unsigned long)kModes[b->mode].freq_hz);
+    }
+#endif
+#if FEATURE_SCHEDULE
+    if(s->sched.armed){
+        printf("schedule: %s at %02u:%02u\r\n", kModes[s->sched.mode].name, s->sched.minute / 60U, s->sched.minute % 60U);
+    }
+#endif
+#if FEATURE_PRESSURE
+    if(s->press.running){
+        char suct[8], disch[8];
+        press_format(&s->press, PressSuction, suct, sizeof(suct));
+        press_format(&s->press, PressDischarge, disch, sizeof(disch));
+        printf("pressure: suction %s, discharge %s %s\r\n", suct, disch, kPressUnitNames[s->press.unit]);
+    }
+#endif
+#if FEATURE_SWEEP
+    const Sweep* w = &s->sweep;
+    if(sweep_busy(s)){
+        printf("sweep: step %u/%u at %uHz\r\n", w->step + 1, SWEEP_STEPS, w->pts[w->step].freq_hz);
+    }
+#endif
+#if FEATURE_JITTER
+    if(jitter_busy(s)){
+        printf("jitter: %s load, %u/%u\r\n", kJitterNames[s->jit.scenario], s->jit.scenario + 1U, JitterScenarios);
+    }
+#endif
+#if FEATURE_ESTOP
+    printf("estop pin: %s\r\n", s->estop.pin_enabled ? "on" : "off");
+#endif
+#if FEATURE_HISTORY
+    printf("unit %u s/n: %lu\r\n", s->odo.unit + 1, (unsigned long)s->hist.serial[s->odo.unit]);
+#endif
+}
 
-    const char* const* LINES = (s->inverter == InvEmbraco) ? HELP_EMBRACO : HELP_SAMSUNG;
-    const uint8_t LINES_COUNT = (s->inverter == InvEmbraco) ? HELP_EMBRACO_COUNT : HELP_SAMSUNG_COUNT;
+#if FEATURE_SWEEP
+/* Last sweep as a table; the same rows go to sweep.csv */
+static void cli_sweep(const AppState* s){
+    const Sweep* w = &s->sweep;
+    if(w->phase == SweepIdle){
+        printf(w->no_sensor ? "no LIS3DH on the external I2C pins\r\n" : "no sweep yet\r\n");
+        return;
+    }
+    printf("freq_hz   rpm  rms_mg  1x_mg  2x_mg\r\n");
+    for(uint8_t i = 0; i < w->step && i < SWEEP_STEPS; i++){
+        const SweepPoint* p = &w->pts[i];
+        printf("%7u %5u %7u %6u %6u\r\n", p->freq_hz, p->rpm, p->rms_mg, p->amp_mg[0], p->amp_mg[1]);
+    }
+    if(sweep_busy(s)) printf("running: step %u/%u\r\n", w->step + 1, SWEEP_STEPS);
+    else if(w->aborted) printf("aborted\r\n");
+    if(w->overrun) printf("FIFO overrun: some samples were lost\r\n");
+}
+#endif
 
-    uint8_t max_lines, max_top_line;
-    help_layout_params(LINES_COUNT, &max_lines, &max_top_line);
+#if FEATURE_JITTER
+/* Finished scenarios; deviation from the commanded period, us */
+static void cli_jitter(const AppState* s){
+    const Jitter* j = &s->jit;
+    if(!j->running && !j->done){
+        printf("no jitter test yet\r\n");
+        return;
+    }
+    if(j->no_signal){
+        printf("no edges on 3 (A6): wire it to 2 (A7)\r\n");
+        return;
+    }
+    printf("load       n  missed   p50_us   p99_us   max_us\r\n");
+    for(uint8_t i = 0; i < j->scenario && i < JitterScenarios; i++){
+        const JitterResult* r = &j->res[i];
+        char v[3][8];
+        jitter_format_us(r->p50_ns, v[0], sizeof(v[0]));
+        jitter_format_us(r->p99_ns, v[1], sizeof(v[1]));
+        jitter_format_us(r->max_ns, v[2], sizeof(v[2]));
+        printf("%-6s %5u %7u %8s %8s %8s\r\n", kJitterNames[i], r->n, r->missed, v[0], v[1], v[2]);
+    }
+    if(j->scenario > JitterBle && j->res[JitterBle].unloaded){
+        printf("BLE ran unloaded: Bluetooth off or the extra beacon in use\r\n");
+    }
+    if(j->running) printf("running: %s load\r\n", kJitterNames[j->scenario]);
+    else if(j->aborted) printf("aborted\r\n");
+}
+#endif
 
-    const uint8_t top = 10;
-    const uint8_t line_h = 9;
+#if FEATURE_ESTOP
+/* Pin state and the last trip's two latencies */
+static void cli_estop(const AppState* s){
+    const Estop* e = &s->estop;
+    printf("pin: %s, loop %s\r\n", e->pin_enabled ? "on" : "off",
+        !e->pin_armed ? "not watched" : (furi_hal_gpio_read(ESTOP_PIN) ? "OPEN" : "closed"));
+    if(!e->count){
+        printf("no trips yet\r\n");
+        return;
+    }
+    printf("trips: %u, last by %s\r\n", e->count, (e->last_source == EstopPin) ? "pin" : "keys");
+    printf("entry -> Hi-Z: %luns\r\nHi-Z -> safe menu: %luus\r\n",
+        (unsigned long)e->cut_ns, (unsigned long)e->ui_us);
+}
+#endif
 
-    for(uint8_t i=0;i<max_lines;i++){
-        uint8_t idx = (uint8_t)(s->help_top_line + i);
-        if(idx >= LINES_COUNT) break;
-        canvas_draw_str(c, 2, (uint8_t)(top + i*line_h), LINES[idx]);
+#if FEATURE_ODOMETER
+/* Per unit: seconds at each band's frequency, then revolutions */
+static void cli_odo(const AppState* s){
+    /* CLI thread: before the first use the stored totals are read into a
+     * copy, on the heap to keep it off every cli_cb frame */
+    OdoRecord* stored = NULL;
+    const OdoRecord* rec = &s->odo.rec;
+    if(!s->odo.loaded){
+        stored = malloc(sizeof(OdoRecord));
+        odo_load(stored);
+        rec = stored;
     }
-
-    /* scrollbar reflects top line (instant) */
-    uint16_t total_steps = (uint16_t)(max_top_line + 1);
-    if(total_steps < 1) total_steps = 1;
-    draw_scrollbar_dotted(c, total_steps, s->help_top_line);
+    bool any = false;
+    for(uint8_t u = 0; u < ODO_UNITS; u++){
+        uint64_t pulses[ODO_BANDS];
+        uint64_t revs;
+        odo_unit_totals(&s->odo, rec, u, pulses, &revs);
+        if(revs == 0) continue;
+        any = true;
+        printf("unit %u:", u + 1);
+        for(uint8_t b = 0; b < ODO_BANDS; b++){
+            printf(" %luHz %lus", (unsigned long)kModes[b + 1].freq_hz, (unsigned long)odo_secs(pulses[b], b + 1));
+        }
+        printf(" revs %llu\r\n", (unsigned long long)revs);
+    }
+    if(!any) printf("no runs recorded\r\n");
+    free(stored);
 }
+#endif
 
-/* ---------- Draw: Settings ---------- */
-/* Visual rows:
- * 0: "> Limit run time"   (selectable)
- * 1: "> Arrow captcha"    (selectable)
- * 2:   Inverter type      (header, non-selectable, aligned with title)
- * 3: "> Embraco"          (selectable)
- * 4: "> Samsung"          (selectable)
- */
-static void draw_settings(Canvas* c, const AppState* s){
-    canvas_clear(c);
+#if FEATURE_HISTORY
+/* Serial of every slot that has one */
+static void cli_serial(const AppState* s){
+    bool any = false;
+    for(uint8_t u = 0; u < ODO_UNITS; u++){
+        if(!s->hist.serial[u]) continue;
+        any = true;
+        printf("unit %u: %lu\r\n", u + 1, (unsigned long)s->hist.serial[u]);
+    }
+    if(!any) printf("no serials set\r\n");
+}
 
-    /* Title */
-    canvas_set_font(c, FontPrimary);
-    canvas_set_color(c, ColorBlack);
-    canvas_draw_str(c, 4, TITLE_Y, "Settings");
+/* Exactly n decimal digits at *p, which moves past them */
+static bool cli_digits(const char** p, uint8_t n, uint32_t* out){
+    *out = 0;
+    for(uint8_t i = 0; i < n; i++, (*p)++){
+        if(**p < '0' || **p > '9') return false;
+        *out = *out * 10U + (uint32_t)(**p - '0');
+    }
+    return true;
+}
 
-    /* Body */
-    canvas_set_font(c, FontSecondary);
+/* "yyyy-mm-dd" -> RTC timestamp of its midnight */
+static bool cli_parse_date(const char* str, uint32_t* ts){
+    uint32_t y, m, d;
+    const char* p = str;
+    if(!cli_digits(&p, 4, &y) || *p++ != '-' || !cli_digits(&p, 2, &m) || *p++ != '-' ||
+       !cli_digits(&p, 2, &d) || *p != '\0') return false;
+    if(y < 2000U || y > 2099U || m < 1U || m > 12U || d < 1U || d > 31U) return false;
+    DateTime dt = {.year = (uint16_t)y, .month = (uint8_t)m, .day = (uint8_t)d};
+    *ts = datetime_datetime_to_timestamp(&dt);
+    return true;
+}
 
-    const uint8_t MAX_ROWS = 4;
-    const uint8_t ROW_TOTAL = 5;
+static void cli_history_print(const HistRecord* r, size_t n){
+    if(!n) printf("no records\r\n");
+    for(size_t i = 0; i < n; i++, r++){
+        DateTime dt;
+        datetime_timestamp_to_datetime(r->time, &dt);
+        printf("%04u-%02u-%02u %02u:%02u  unit %u  s/n %lu  %s", dt.year, dt.month, dt.day, dt.hour, dt.minute,
+            r->unit + 1, (unsigned long)r->serial, kHistKind[r->kind % HistKindCount]);
+        if(r->mode && r->mode < MODE_COUNT) printf(" %s", kModes[r->mode].name);
+        printf("  %lus  %s", (unsigned long)r->duration_s, kHistResult[r->result % HistResultCount]);
+        if(r->kind == HistBurst) printf("  %lu periods", (unsigned long)r->value);
+        else if(r->kind == HistSweep) printf("  peak %luHz %lumg", (unsigned long)(r->value >> 16), (unsigned long)(r->value & 0xFFFFU));
+        else if(r->kind == HistJitter) printf("  p99 %luns", (unsigned long)r->value);
+        printf("\r\n");
+    }
+}
 
-    uint8_t first_visible = s->first_visible;
-    if(first_visible + MAX_ROWS > ROW_TOTAL){
-        first_visible = (ROW_TOTAL > MAX_ROWS) ? (uint8_t)(ROW_TOTAL - MAX_ROWS) : 0;
+/* Runs on the CLI thread: the store is shared with the main loop under the lock */
+static void cli_history(AppState* s, FuriString* args, FuriString* word){
+    TestHistory* h = &s->hist;
+    uint32_t since = 0;
+    uint32_t serial = 0;
+    bool by_date = args_read_string_and_trim(args, word) && furi_string_cmp_str(word, "since") == 0;
+    if(by_date){
+        if(!args_read_string_and_trim(args, word) || !cli_parse_date(furi_string_get_cstr(word), &since)){
+            cli_usage();
+            return;
+        }
+    } else {
+        const char* str = furi_string_get_cstr(word);
+        char* end;
+        serial = (uint32_t)strtoul(str, &end, 10);
+        if(end == str || *end != '\0'){
+            cli_usage();
+            return;
+        }
     }
 
-    for(uint8_t i=0;i<MAX_ROWS;i++){
-        uint8_t row = (uint8_t)(first_visible + i);
-        if(row >= ROW_TOTAL) break;
-        int y = ROW_Y0 + i*ROW_DY;
+    HistRecord* out = malloc(sizeof(HistRecord) * HISTORY_FIND_MAX);
+    size_t n = 0;
+    furi_mutex_acquire(h->lock, FuriWaitForever);
+    History* db = hist_db(h, s->sup.armed);
+    if(db){
+        n = by_date ? history_since(db, since, out, HISTORY_FIND_MAX)
+                    : history_by_serial(db, serial, out, HISTORY_FIND_MAX);
+        printf("%lu records on SD\r\n", (unsigned long)history_count(db));
+    }
+    furi_mutex_release(h->lock);
+    if(db) cli_history_print(out, n);
+    else if(s->sup.armed) printf("history opens when PWM is off\r\n");
+    else printf("history not available (SD card?)\r\n");
+    free(out);
+}
+#endif
 
-        /* header "Inverter type" non-selectable (no caret) */
-        if(row == 2){
-            canvas_draw_str(c, 4, y, "Inverter type");
-            continue;
-        }
+#if FEATURE_SCHEDULE
+/* "hh:mm" (24 h) -> minutes after midnight */
+static bool cli_parse_hhmm(const char* str, int32_t* minute){
+    uint32_t h = 0, m = 0;
+    const char* p = str;
+    if(*p < '0' || *p > '9') return false;
+    while(*p >= '0' && *p <= '9') h = h * 10U + (uint32_t)(*p++ - '0');
+    if(*p++ != ':' || p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9' || p[2] != '\0') return false;
+    m = (uint32_t)(p[0] - '0') * 10U + (uint32_t)(p[1] - '0');
+    if(h > 23U || m > 59U) return false;
+    *minute = (int32_t)(h * 60U + m);
+    return true;
+}
+#endif
 
-        /* caret for selectable rows */
-        canvas_draw_str(c, 2, y, (s->cursor == row) ? ">" : " ");
+static void cli_cb(Cli* cli, FuriString* args, void* ctx){
+    UNUSED(cli);
+    AppState* s = ctx;
+    FuriString* word = furi_string_alloc();
+    AppEvent ev = {.type = AppEventCli};
+    bool post = false;
+    int val;
 
-        if(row == 0){
-            canvas_draw_str(c, 14, y, "Limit run time");
-            const char* val = s->limit_runtime ? "Yes" : "No";
-            uint16_t w = canvas_string_width(c, val);
-            uint16_t right_x = (uint16_t)(SCROLLBAR_X - TIMER_MARGIN);
-            uint16_t x = (w <= right_x) ? (uint16_t)(right_x - w) : 2;
-            canvas_draw_str(c, x, y, val);
-        } else if(row == 1){
-            canvas_draw_str(c, 14, y, "Arrow captcha");
-            const char* val = s->arrow_captcha ? "Yes" : "No";
-            uint16_t w = canvas_string_width(c, val);
-            uint16_t right_x = (uint16_t)(SCROLLBAR_X - TIMER_MARGIN);
-            uint16_t x = (w <= right_x) ? (uint16_t)(right_x - w) : 2;
-            canvas_draw_str(c, x, y, val);
-        } else if(row == 3){
-            canvas_draw_str(c, 14, y, "Embraco");
-            if(s->inverter == InvEmbraco){
-                int check_x = (int)SCROLLBAR_X - TIMER_MARGIN - 10;
-                if(check_x < 90) check_x = 90;
-                draw_checkmark(c, check_x, y);
-            }
-        } else if(row == 4){
-            canvas_draw_str(c, 14, y, "Samsung");
-            if(s->inverter == InvSamsung){
-                int check_x = (int)SCROLLBAR_X - TIMER_MARGIN - 10;
-                if(check_x < 90) check_x = 90;
-                draw_checkmark(c, check_x, y);
-            }
+    if(!args_read_string_and_trim(args, word)){
+        cli_usage();
+    } else if(furi_string_cmp_str(word, "status") == 0){
+        cli_status(s);
+#if FEATURE_ODOMETER
+    } else if(furi_string_cmp_str(word, "odo") == 0){
+        cli_odo(s);
+#endif
+    } else if(furi_string_cmp_str(word, "on") == 0){
+        ev.cli.cmd = CliCmdOn;
+        post = true;
+    } else if(furi_string_cmp_str(word, "off") == 0){
+        ev.cli.cmd = CliCmdOff;
+        post = true;
+    } else if(furi_string_cmp_str(word, "mode") == 0){
+        if(args_read_int_and_trim(args, &val) && val >= 0 && val < (int)MODE_COUNT){
+            ev.cli.cmd = CliCmdMode;
+            ev.cli.arg = val;
+            post = true;
+        } else {
+            cli_usage();
+        }
+    } else if(furi_string_cmp_str(word, "limit") == 0){
+        if(args_read_string_and_trim(args, word) &&
+           (furi_string_cmp_str(word, "on") == 0 || furi_string_cmp_str(word, "off") == 0)){
+            ev.cli.cmd = CliCmdLimit;
+            ev.cli.arg = (furi_string_cmp_str(word, "on") == 0);
+            post = true;
+        } else {
+            cli_usage();
+        }
+#if FEATURE_BURST
+    } else if(furi_string_cmp_str(word, "burst") == 0){
+        int count;
+        if(args_read_int_and_trim(args, &val) && val >= 1 && val < (int)MODE_COUNT &&
+           args_read_int_and_trim(args, &count) && count >= 1 && (uint32_t)count <= PWM_MAX_COUNTED){
+            ev.cli.cmd = CliCmdBurst;
+            ev.cli.mode = (uint8_t)val;
+            ev.cli.arg = count;
+            post = true;
+        } else {
+            cli_usage();
+        }
+#endif
+#if FEATURE_SCHEDULE
+    } else if(furi_string_cmp_str(word, "schedule") == 0){
+        int32_t minute;
+        if(args_read_string_and_trim(args, word) && furi_string_cmp_str(word, "off") == 0){
+            ev.cli.cmd = CliCmdSchedule;
+            ev.cli.arg = -1;
+            post = true;
+        } else if(cli_parse_hhmm(furi_string_get_cstr(word), &minute) &&
+                  args_read_int_and_trim(args, &val) && val >= 1 && val < (int)MODE_COUNT){
+            ev.cli.cmd = CliCmdSchedule;
+            ev.cli.mode = (uint8_t)val;
+            ev.cli.arg = minute;
+            post = true;
+        } else {
+            cli_usage();
+        }
+#endif
+#if FEATURE_SWEEP
+    } else if(furi_string_cmp_str(word, "sweep") == 0){
+        if(!args_read_string_and_trim(args, word)){
+            cli_sweep(s);
+        } else if(furi_string_cmp_str(word, "start") == 0){
+            ev.cli.cmd = CliCmdSweep;
+            post = true;
+        } else {
+            cli_usage();
         }
+#endif
+#if FEATURE_JITTER
+    } else if(furi_string_cmp_str(word, "jitter") == 0){
+        if(!args_read_string_and_trim(args, word)){
+            cli_jitter(s);
+        } else if(furi_string_cmp_str(word, "start") == 0){
+            ev.cli.cmd = CliCmdJitter;
+            post = true;
+        } else {
+            cli_usage();
+        }
+#endif
+#if FEATURE_HISTORY
+    } else if(furi_string_cmp_str(word, "serial") == 0){
+        int serial;
+        if(!args_read_int_and_trim(args, &val)){
+            cli_serial(s);
+        } else if(val >= 1 && val <= ODO_UNITS && args_read_int_and_trim(args, &serial) && serial >= 0){
+            ev.cli.cmd = CliCmdSerial;
+            ev.cli.mode = (uint8_t)(val - 1);
+            ev.cli.arg = serial;
+            post = true;
+        } else {
+            cli_usage();
+        }
+    } else if(furi_string_cmp_str(word, "history") == 0){
+        cli_history(s, args, word);
+#endif
+#if FEATURE_ESTOP
+    } else if(furi_string_cmp_str(word, "estop") == 0){
+        if(!args_read_string_and_trim(args, word)){
+            cli_estop(s);
+        } else if(furi_string_cmp_str(word, "on") == 0 || furi_string_cmp_str(word, "off") == 0){
+            ev.cli.cmd = CliCmdEstop;
+            ev.cli.arg = (furi_string_cmp_str(word, "on") == 0);
+            post = true;
+        } else {
+            cli_usage();
+        }
+#endif
+    } else if(furi_string_cmp_str(word, "exit") == 0){
+        if(bg_run_possible(s)) printf("run goes on in TIM1: no deep sleep, TIM1 held until relaunch\r\n");
+        ev.cli.cmd = CliCmdExit;
+        post = true;
+    } else {
+        cli_usage();
     }
 
-    draw_scrollbar_dotted(c, ROW_TOTAL, s->cursor);
+    if(post && furi_message_queue_put(s->q, &ev, furi_ms_to_ticks(100)) != FuriStatusOk){
+        printf("busy, try again\r\n");
+    }
+    furi_string_free(word);
 }
 
-/* ---------- Draw dispatcher ---------- */
-static void draw_cb(Canvas* c, void* ctx){
-    AppState* s = ctx;
-    switch(s->screen){
-        case ScreenSelectInverter: draw_select_inverter(c, s); break;
-        case ScreenMenu:           draw_menu(c, s); break;
-        case ScreenHelp:           draw_help(c, s); break;
-        case ScreenSettings:       draw_settings(c, s); break;
-        default:                   draw_menu(c, s); break;
+/* AppEventCli on the main loop; returns true for "exit" */
+static bool cli_execute(AppState* s, CliCmd cmd, uint8_t mode, int32_t arg){
+    switch(cmd){
+        case CliCmdOn:
+            sched_cancel(s);            /* someone is here: start now, not later */
+            if(!s->powered && !rack_busy(s)){
+                s->confirm = ConfirmNone;
+                s->screen = ScreenMenu;
+                enter_powered_menu_standby(s);
+            }
+            break;
+        case CliCmdOff:
+            sched_cancel(s);
+            safe_stop_all(s, HistStopped);
+            break;
+        case CliCmdMode:
+            if(s->powered && !rack_busy(s) && !burst_busy(s) && !sweep_busy(s) && !jitter_busy(s)){
+                apply_mode(s, (uint8_t)arg);
+                if(s->screen == ScreenMenu) s->cursor = (uint8_t)arg;
+            }
+            break;
+        case CliCmdLimit:
+            if(rack_busy(s)) break;     /* the dwell owns the countdown */
+            s->limit_runtime = (arg != 0);
+            start_tick_timer_if_needed(s);
+            break;
+        case CliCmdBurst:
+#if FEATURE_BURST
+            if(burst_start(s, mode, (uint32_t)arg) && s->screen == ScreenMenu) s->cursor = 0;
+#else
+            UNUSED(mode);
+#endif
+            break;
+        case CliCmdSweep:
+#if FEATURE_SWEEP
+            if(sweep_start(s) && s->screen == ScreenMenu) s->cursor = 0;
+#endif
+            break;
+        case CliCmdJitter:
+#if FEATURE_JITTER
+            if(jitter_start(s) && s->screen == ScreenMenu) s->cursor = 0;
+#endif
+            break;
+        case CliCmdSchedule:
+#if FEATURE_SCHEDULE
+            /* re-arming moves the alarm; only from the safe state */
+            sched_cancel(s);
+            if(arg >= 0 && !s->powered){
+                s->sched.minute = (uint16_t)arg;
+                s->sched.mode = mode;
+                sched_arm(s);
+            }
+#endif
+            break;
+        case CliCmdEstop:
+            s->estop.pin_enabled = (arg != 0);
+            estop_pin_sync(s);
+            break;
+        case CliCmdSerial:
+            if(mode < ODO_UNITS) s->hist.serial[mode] = (uint32_t)arg;
+            break;
+        case CliCmdExit:
+            return true;
     }
+    display_wake(s);
+    app_redraw(s);
+    return false;
 }
+#endif
 
-/* ---------- Input queue plumbing ---------- */
-typedef struct { FuriMessageQueue* q; } InputCtx;
-static void vp_input_cb(InputEvent* e, void* ctx){
-    InputCtx* ic = ctx;
-    InputEvent ev = *e;
-    furi_message_queue_put(ic->q, &ev, 0);
-}
+/* ---------- Persisted settings ---------- */
+/* Loaded before the first frame so the UI never flips after launch.
+ * Limit run time is deliberately not persisted: every launch starts limited. */
+#define SETTINGS_PATH    APP_DATA_PATH("settings.bin")
+#define SETTINGS_MAGIC   0x45
+#define SETTINGS_VERSION 8
 
-/* ---------- Power transitions ---------- */
-static void enter_safe_menu(AppState* s){
-    /* safe: disconnect line (Hi-Z), stop PWM/LED/timers, show minimal menu */
-    s->powered = false;
-    s->cursor = 0;
-    s->first_visible = 0;
+typedef struct {
+    uint8_t inverter;
+    uint8_t arrow_captcha;
+    uint8_t background_run;
+    uint8_t power_save;
+    uint8_t rec_rate;
+    uint8_t rack_units;
+    uint8_t rack_mode;
+    uint8_t rack_dwell;
+    uint8_t odo_unit;
+    uint8_t press_unit;
+    uint8_t sched_mode;
+    uint16_t sched_minute;
+    uint8_t estop_pin;
+    uint32_t serial[ODO_UNITS];
+} StarterSettings;
 
-    pwm_hw_stop_safe(&s->pwm_running);
-    pin_to_hiz();
-    led_apply(s, 0);
-    stop_timers(s);
-    s->remaining_ms = 0;
-    s->timeout_expired = false;
+static void settings_capture(const AppState* s, StarterSettings* out){
+    memset(out, 0, sizeof(*out));      /* padding too: compared with memcmp */
+    out->inverter = (uint8_t)s->inverter;
+    out->arrow_captcha = s->arrow_captcha;
+    out->background_run = s->background_run;
+    out->power_save = (uint8_t)s->power_save;
+    out->rec_rate = (uint8_t)s->rec_rate;
+    out->rack_units = s->rack.units;
+    out->rack_mode = s->rack.mode;
+    out->rack_dwell = s->rack.dwell;
+    out->odo_unit = s->odo.unit;
+    out->press_unit = (uint8_t)s->press.unit;
+    out->sched_mode = s->sched.mode;
+    out->sched_minute = s->sched.minute;
+    out->estop_pin = s->estop.pin_enabled;
+    memcpy(out->serial, s->hist.serial, sizeof(out->serial));
 }
 
-static void enter_powered_menu_standby(AppState* s){
-    /* after confirmation: powered menu with Stand by selected */
-    s->powered = true;
-    s->cursor = 0;                 /* caret on "Stand by" */
-    s->first_visible = 0;
-    apply_mode(s, 0);              /* Stand by — PP LOW, no timer */
+static bool settings_load(AppState* s, StarterSettings* loaded){
+    if(!saved_struct_load(SETTINGS_PATH, loaded, sizeof(*loaded), SETTINGS_MAGIC, SETTINGS_VERSION)) return false;
+    s->inverter = (loaded->inverter == InvSamsung) ? InvSamsung : InvEmbraco;
+    s->cursor = (uint8_t)s->inverter;   /* preselect on the inverter screen */
+    s->arrow_captcha = loaded->arrow_captcha != 0;
+    s->background_run = loaded->background_run != 0;
+    s->power_save = (loaded->power_save < PowerSaveCount) ? (PowerSave)loaded->power_save : PowerSaveOff;
+    s->rec_rate = (loaded->rec_rate < RecRateCount) ? (RecRate)loaded->rec_rate : RecRateOff;
+#if FEATURE_RACK
+    if(loaded->rack_units >= 1 && loaded->rack_units <= RELAY_COUNT) s->rack.units = loaded->rack_units;
+    if(loaded->rack_mode >= 1 && loaded->rack_mode < MODE_COUNT) s->rack.mode = loaded->rack_mode;
+    if(loaded->rack_dwell < COUNT_OF(kRackDwellSecs)) s->rack.dwell = loaded->rack_dwell;
+#endif
+    if(loaded->odo_unit < ODO_UNITS) s->odo.unit = loaded->odo_unit;
+    s->press.unit = (loaded->press_unit < PressUnitCount) ? (PressUnit)loaded->press_unit : PressOff;
+    if(loaded->sched_mode >= 1 && loaded->sched_mode < MODE_COUNT) s->sched.mode = loaded->sched_mode;
+    if(loaded->sched_minute < 24 * 60) s->sched.minute = loaded->sched_minute;
+    s->estop.pin_enabled = loaded->estop_pin != 0;
+    memcpy(s->hist.serial, loaded->serial, sizeof(s->hist.serial));
+    return true;
+}
+
+/* Written only when something changed: on every screen change (leaving
+ * Settings, History, inverter selection), after CLI commands and on exit,
+ * so a crash or power loss keeps what was set */
+static void settings_save_if_changed(const AppState* s, StarterSettings* saved){
+    StarterSettings now;
+    settings_capture(s, &now);
+    if(memcmp(&now, saved, sizeof(now)) == 0) return;
+    if(saved_struct_save(SETTINGS_PATH, &now, sizeof(now), SETTINGS_MAGIC, SETTINGS_VERSION)) *saved = now;
 }
 
 /* ---------- Main ---------- */
 int32_t embraco_starter(void* p){
     UNUSED(p);
+    uint32_t boot_cyc = DWT->CYCCNT;
 
-    AppState s = {
-        .screen = ScreenSelectInverter, /* по ТЗ — сначала выбор инвертора */
-        .inverter = InvEmbraco,         /* default; изменится, если выберут Samsung */
-        .powered = false,               /* в начале безопасное состояние */
-        .cursor = 0,
-        .first_visible = 0,
-        .active = 0,
-        .help_top_line = 0,
-        .limit_runtime = true,
-        .arrow_captcha = true,          /* по умолчанию Yes */
-        .notif = furi_record_open(RECORD_NOTIFICATION),
-        .led_timer = NULL,
-        .led_on = false,
-        .pwm_running = false,
-        .hint_visible = false,
-        .hint_timer = NULL,
-        .tick_timer = NULL,
-        .off_timer = NULL,
-        .remaining_ms = 0,
-        .timeout_expired = false,
-        .gui = NULL,
-        .vp = NULL,
-        .q = NULL,
-    };
+    /* off the 2 KB thread stack; everything not set here starts zero/NULL
+     * (records, timers, IO) */
+    AppState* s = malloc(sizeof(AppState));
+    memset(s, 0, sizeof(*s));
+#if FEATURE_SAMSUNG
+    s->screen = ScreenSelectInverter;   /* по ТЗ — сначала выбор инвертора */
+#else
+    s->screen = ScreenMenu;             /* Embraco only: straight to the safe menu */
+#endif
+    s->inverter = InvEmbraco;           /* default; изменится, если выберут Samsung */
+    s->limit_runtime = true;
+    s->arrow_captcha = true;            /* по умолчанию Yes */
+    s->power_save = PowerSaveOff;
+    s->disp = DispOn;
+    s->wake_key = InputKeyOk;
+    s->confirm = ConfirmNone;
+#if FEATURE_RACK
+    s->rack.units = RELAY_COUNT;
+    s->rack.mode = MODE_COUNT - 1;
+    s->rack.dwell = 1;
+#endif
+#if FEATURE_BURST
+    s->burst.mode = 1;                  /* Low speed, 100 periods */
+    s->burst.preset = 6;
+#endif
+#if FEATURE_SCHEDULE
+    s->sched.minute = 2 * 60;           /* 02:00, Low speed */
+    s->sched.mode = 1;
+#endif
+    s->boot_cyc = boot_cyc;
 
-    s.gui = furi_record_open(RECORD_GUI);
-    s.vp = view_port_alloc();
-    s.q  = furi_message_queue_alloc(8, sizeof(InputEvent));
-    InputCtx ic = {.q = s.q};
+    /* the queue must exist before anything can start a timer */
+    s->q  = furi_message_queue_alloc(8, sizeof(AppEvent));
+    supervisor_start(&s->sup, s->q);
+    trend_start(&s->trend);
 
-    view_port_draw_callback_set(s.vp, draw_cb, &s);
-    view_port_input_callback_set(s.vp, vp_input_cb, &ic);
-    gui_add_view_port(s.gui, s.vp, GuiLayerFullscreen);
+    /* persisted settings and an adopted background run are restored before
+     * the first frame; otherwise absolute safety at start */
+    StarterSettings settings_loaded;
+    if(!settings_load(s, &settings_loaded)) settings_capture(s, &settings_loaded);
+    if(s->rec_rate != RecRateOff) rec_apply(s);    /* before the timers it notes */
+    hist_start(&s->hist);
+    if(!bg_run_reattach(s)){
+        if(!s->pwm_running) pin_to_hiz();
+    }
+    estop_start(s);
 
-    /* absolute safety at start */
-    pin_to_hiz();
-    led_apply(&s, 0);
+#if FEATURE_GUI
+    InputCtx ic = {.q = s->q};
+    s->gui = furi_record_open(RECORD_GUI);
+    s->vp = view_port_alloc();
+    view_port_draw_callback_set(s->vp, draw_cb, s);
+    view_port_input_callback_set(s->vp, vp_input_cb, &ic);
+    gui_add_view_port(s->gui, s->vp, GuiLayerFullscreen);
+#endif
+#if FEATURE_CLI
+    Cli* cli = furi_record_open(RECORD_CLI);
+    cli_add_command(cli, CLI_COMMAND, CliCommandFlagParallelSafe, cli_cb, s);
+#endif
 
+    s->boot_pwm_ready_us = boot_elapsed_us(s);
+
+#if FEATURE_GUI
     const uint8_t MAX_ROWS = 4;
+    InputEvent ev;
+#endif
 
     bool exit_app = false;
-    InputEvent ev;
+    AppEvent msg;
+    ScreenId shown = s->screen;
 
     while(!exit_app){
+        /* the previous event is handled: frequency from here on */
+        trend_set_hz(&s->trend, pwm_freq_now(s));
+        if(s->screen != shown){
+            shown = s->screen;
+            settings_save_if_changed(s, &settings_loaded);
+        }
+        hist_flush(s);
+
+        /* tickless: block until input or one of our own events arrives */
+        if(furi_message_queue_get(s->q, &msg, FuriWaitForever) != FuriStatusOk) continue;
+        s->sup.last_kick = furi_get_tick();     /* any wake is a heartbeat */
+
+        if(s->sup.tripped){
+            /* PA7 is already Hi-Z; bring the UI and TIM1 ownership in line */
+            s->sup.tripped = false;
+            FURI_LOG_W(TAG, "supervisor trip after %lums, back to safe menu",
+                (unsigned long)s->sup.trip_latency_ms);
+            rec_note_timer(s, ErcTimerSupervisor);
+            safe_stop_all(s, HistTrip);
+            display_wake(s);
+            app_redraw(s);
+        }
+        if(s->estop.pending){
+            /* e-stop handler cut PA7; the event itself carries nothing else */
+            estop_service(s);
+            app_redraw(s);
+        }
+        if(msg.type == AppEventEstop) continue;
+
+        if(!s->boot_logged && s->boot_frame_us){
+            s->boot_logged = true;
+            FURI_LOG_I(TAG, "launch: PWM ready %luus, first frame %luus",
+                (unsigned long)s->boot_pwm_ready_us, (unsigned long)s->boot_frame_us);
+        }
+        if(msg.type == AppEventBoot) continue;
+
         /* service timeout event on main loop (from off_timer) */
-        if(s.timeout_expired){
-            s.timeout_expired = false;
-            /* auto switch to Stand by (not full Power off) when time expires */
-            enter_powered_menu_standby(&s);
-            view_port_update(s.vp);
+        if(s->timeout_expired){
+            s->timeout_expired = false;
+            s->hist.end = HistOk;        /* the run lasted its full time */
+            if(s->rack.phase == RackRun){
+                seq_run(s, SeqRack);   /* dwell over: next unit (or done) */
+            } else {
+                /* auto switch to Stand by (not full Power off) when time expires */
+                if(jitter_busy(s)) jitter_stop(s, true);
+                enter_powered_menu_standby(s);
+            }
+            s->hist.end = HistStopped;
+            display_wake(s);      /* safety-relevant change: always show it */
+            app_redraw(s);
+        }
+
+        if(msg.type == AppEventDisplay){
+            display_step(s);
+            continue;
+        }
+
+        if(msg.type == AppEventSeq){
+            /* a wake for a sequence cancelled meanwhile finds it idle */
+            if(msg.seq < SeqCount && seq_busy(&s->seq[msg.seq])) seq_run(s, (SeqId)msg.seq);
+            app_redraw(s);
+            continue;
+        }
+
+        if(msg.type == AppEventRecSpill){
+            rec_spill(s);
+            continue;
+        }
+
+        if(msg.type == AppEventOdoFlush){
+            odo_flush(s);
+            continue;
+        }
+
+        if(msg.type == AppEventBurst){
+            burst_step(s);
+            app_redraw(s);
+            continue;
+        }
+        if(msg.type == AppEventSchedule){
+            sched_fire(s);
+            app_redraw(s);
+            continue;
         }
+        if(msg.type == AppEventPressure){
+            /* DMA keeps raw[] current; the menu shows it, the trend keeps it */
+            press_trend(s);
+            if(s->screen == ScreenMenu && s->disp != DispOff) app_redraw(s);
+            continue;
+        }
+        if(msg.type == AppEventSweep){
+            /* every 50 ms; redraw only when a phase or step ends */
+            if(sweep_poll(s)) app_redraw(s);
+            continue;
+        }
+        if(msg.type == AppEventJitter){
+            /* every 20 ms; redraw only when a scenario ends */
+            if(jitter_poll(s)) app_redraw(s);
+            continue;
+        }
+
+        if(msg.type == AppEventTrend){
+            /* the column that just closed is the only reason to redraw */
+            trend_set_hz(&s->trend, pwm_freq_now(s));
+            bool column = s->trend.fresh & (1U << s->trend.zoom);
+            s->trend.fresh = 0;
+            trend_sync(s);
+            if(column && s->screen == ScreenTrend && s->disp != DispOff) app_redraw(s);
+            continue;
+        }
+
+        if(msg.type == AppEventPowerSample){
+            power_sample(s);
+            if(s->screen == ScreenPower && s->disp != DispOff) app_redraw(s);
+            continue;
+        }
+
+#if FEATURE_CLI
+        if(msg.type == AppEventCli){
+            exit_app = cli_execute(s, (CliCmd)msg.cli.cmd, msg.cli.mode, msg.cli.arg);
+            settings_save_if_changed(s, &settings_loaded);     /* serial, estop */
+            continue;
+        }
+#endif
+
+#if FEATURE_GUI
+        if(msg.type == AppEventInput){
+            ev = msg.input;
+#if FEATURE_RECORDER
+            rec_note_input(s, &ev);
+#endif
 
-        if(furi_message_queue_get(s.q, &ev, 100) == FuriStatusOk){
-            /* Long BACK anywhere => exit app */
+            if(estop_on_input(s, &ev)) continue;
+
+            if(display_on_input(s, &ev)){
+                app_redraw(s);
+                continue;
+            }
+
+            /* Long BACK anywhere => exit app; a run that would outlive it asks first */
             if(ev.type == InputTypeLong && ev.key == InputKeyBack){
-                exit_app = true;
-                view_port_update(s.vp);
+                if(s->confirm == ConfirmBackground) continue;
+                if(bg_run_possible(s)){
+                    s->confirm = ConfirmBackground;
+                } else {
+                    exit_app = true;
+                }
+                app_redraw(s);
+                continue;
+            }
+
+            /* confirm overlay owns the keys while visible: Right = Confirm, Left/Back = Cancel */
+            if(s->confirm != ConfirmNone){
+                if(ev.type == InputTypeShort){
+                    bool decided = false;
+                    bool accepted = false;
+                    if(ev.key == InputKeyRight){
+                        decided = true;
+                        accepted = true;
+                    } else if(ev.key == InputKeyLeft || ev.key == InputKeyBack){
+                        decided = true;
+                    }
+
+                    if(decided){
+                        ConfirmId id = s->confirm;
+                        s->confirm = ConfirmNone;
+                        if(accepted && id == ConfirmPowerOn){
+                            /* overlay is raised from the safe menu only; re-check before powering */
+                            if(s->screen == ScreenMenu && !s->powered){
+                                enter_powered_menu_standby(s);
+                            }
+#if FEATURE_SCHEDULE
+                        } else if(accepted && id == ConfirmSchedule){
+                            if(s->screen == ScreenSchedule) sched_arm(s);
+#endif
+                        } else if(accepted && id == ConfirmBackground){
+                            exit_app = true;
+                        } else if(accepted && id == ConfirmLimitOff){
+                            s->limit_runtime = false;
+                            /* cancel timers immediately */
+                            stop_timers(s);
+                            s->remaining_ms = 0;
+                        }
+                        app_redraw(s);
+                    }
+                }
                 continue;
             }
 
-            switch(s.screen){
+            switch(s->screen){
+#if FEATURE_SAMSUNG
                 /* -------- Initial inverter selection -------- */
                 case ScreenSelectInverter: {
                     if(ev.type == InputTypeShort || ev.type == InputTypeRepeat){
                         if(ev.key == InputKeyUp){
-                            s.cursor = (s.cursor == 0) ? 1 : 0;
+                            s->cursor = (s->cursor == 0) ? 1 : 0;
                         } else if(ev.key == InputKeyDown){
-                            s.cursor = (s.cursor == 1) ? 0 : 1;
+                            s->cursor = (s->cursor == 1) ? 0 : 1;
                         } else if(ev.key == InputKeyOk){
                             /* apply selection and go to SAFE MENU immediately */
-                            s.inverter = (s.cursor == 0) ? InvEmbraco : InvSamsung;
-                            enter_safe_menu(&s);
-                            s.screen = ScreenMenu;
+                            s->inverter = (s->cursor == 0) ? InvEmbraco : InvSamsung;
+                            enter_safe_menu(s);
+                            s->screen = ScreenMenu;
                         } else if(ev.key == InputKeyBack){
                             /* show hint; require long press to exit */
-                            s.hint_visible = true;
-                            if(!s.hint_timer){
-                                s.hint_timer = furi_timer_alloc(hint_timer_cb, FuriTimerTypeOnce, &s);
-                            }
-                            furi_timer_start(s.hint_timer, furi_ms_to_ticks(1500));
+                            seq_start(s, SeqHint);
                         }
                     }
                 } break;
+#endif
 
                 /* -------- Main menu -------- */
                 case ScreenMenu: {
                     /* determine dynamic row_total for navigation */
-                    const bool powered = s.powered;
-                    uint8_t row_total = powered ? (uint8_t)(MODE_COUNT + 3) : 3;
+                    const bool powered = s->powered;
+                    uint8_t row_total = menu_row_total(powered);
 
                     if(ev.type == InputTypeShort){
                         if(ev.key == InputKeyUp){
-                            if(s.cursor == 0){
-                                s.cursor = (uint8_t)(row_total - 1);
-                                s.first_visible = (row_total > MAX_ROWS) ? (uint8_t)(row_total - MAX_ROWS) : 0;
+                            if(s->cursor == 0){
+                                s->cursor = (uint8_t)(row_total - 1);
+                                s->first_visible = (row_total > MAX_ROWS) ? (uint8_t)(row_total - MAX_ROWS) : 0;
                             } else {
-                                s.cursor--;
-                                if(s.cursor < s.first_visible) s.first_visible = s.cursor;
+                                s->cursor--;
+                                if(s->cursor < s->first_visible) s->first_visible = s->cursor;
                             }
                         } else if(ev.key == InputKeyDown){
-                            if(s.cursor == (uint8_t)(row_total - 1)){
-                                s.cursor = 0;
-                                s.first_visible = 0;
+                            if(s->cursor == (uint8_t)(row_total - 1)){
+                                s->cursor = 0;
+                                s->first_visible = 0;
                             } else {
-                                s.cursor++;
-                                if(s.cursor >= s.first_visible + MAX_ROWS){
-                                    s.first_visible = (uint8_t)(s.cursor - (MAX_ROWS - 1));
+                                s->cursor++;
+                                if(s->cursor >= s->first_visible + MAX_ROWS){
+                                    s->first_visible = (uint8_t)(s->cursor - (MAX_ROWS - 1));
                                 }
                             }
                         } else if(ev.key == InputKeyOk){
-                            if(powered){
-                                /* 0..3 => modes, 4 => Power off, 5 => Settings, 6 => Help */
-                                if(s.cursor < MODE_COUNT){
-                                    apply_mode(&s, s.cursor);
-                                } else if(s.cursor == MODE_COUNT){
+                            switch(menu_item_at(powered, s->cursor)){
+                                case MenuItemMode:
+                                    apply_mode(s, s->cursor);
+                                    break;
+                                case MenuItemPowerOn:
+                                    /* show alert; powered menu only after Confirm */
+                                    s->confirm = ConfirmPowerOn;
+                                    break;
+#if FEATURE_SCHEDULE
+                                case MenuItemSchedule:
+                                    s->screen = ScreenSchedule;
+                                    s->sched.row = 0;
+                                    break;
+#endif
+                                case MenuItemPowerOff:
                                     /* Power off: go to SAFE MENU (Hi-Z) and shrink list */
-                                    enter_safe_menu(&s);
-                                } else if(s.cursor == MODE_COUNT + 1){
-                                    s.screen = ScreenSettings;
-                                    s.cursor = 0;
-                                    s.first_visible = 0;
-                                } else {
+                                    enter_safe_menu(s);
+                                    break;
+#if FEATURE_RACK
+                                case MenuItemRack:
+                                    /* Stand by until Start; the relays decide where PA7 goes */
+                                    apply_mode(s, 0);
+                                    s->screen = ScreenRack;
+                                    s->rack.phase = RackIdle;
+                                    s->rack.row = 0;
+                                    break;
+#endif
+                                case MenuItemSettings:
+                                    s->screen = ScreenSettings;
+                                    s->cursor = 0;
+                                    s->first_visible = 0;
+                                    break;
+#if FEATURE_BURST
+                                case MenuItemBurst:
+                                    /* Stand by until Start */
+                                    apply_mode(s, 0);
+                                    s->screen = ScreenBurst;
+                                    s->burst.phase = BurstIdle;
+                                    s->burst.row = 0;
+                                    break;
+#endif
+#if FEATURE_SWEEP
+                                case MenuItemSweep:
+                                    /* Stand by until OK; the last result stays on screen */
+                                    apply_mode(s, 0);
+                                    s->screen = ScreenSweep;
+                                    break;
+#endif
+#if FEATURE_JITTER
+                                case MenuItemJitter:
+                                    apply_mode(s, 0);
+                                    s->screen = ScreenJitter;
+                                    break;
+#endif
+#if FEATURE_POWER_STATS
+                                case MenuItemPowerStats:
+                                    /* mode keeps running; sampling follows the active mode */
+                                    s->screen = ScreenPower;
+                                    break;
+#endif
+#if FEATURE_TREND
+                                case MenuItemTrend:
+                                    /* read-only: the mode keeps running */
+                                    s->screen = ScreenTrend;
+                                    break;
+#endif
+#if FEATURE_ODOMETER
+                                case MenuItemOdometer:
+                                    /* read-only: the mode keeps running */
+                                    odo_need(&s->odo);
+                                    s->screen = ScreenOdometer;
+                                    s->odo.view = s->odo.unit;
+                                    break;
+#endif
+#if FEATURE_HISTORY
+                                case MenuItemHistory:
+                                    /* read-only apart from the serials: the mode keeps running */
+                                    s->screen = ScreenHistory;
+                                    s->hist.view = s->odo.unit;
+                                    s->hist.editing = false;
+                                    hist_view_load(s);
+                                    break;
+#endif
+                                case MenuItemHelp:
                                     /* Help: switch to Stand by (PP LOW), stop timers via apply_mode(0) and show help */
-                                    apply_mode(&s, 0); /* Stand by: PP LOW, no countdown */
-                                    s.screen = ScreenHelp;
-                                    s.help_top_line = 0;
-                                }
-                            } else {
-                                /* 0 => Power on (show alert), 1 => Settings, 2 => Help */
-                                if(s.cursor == 0){
-                                    if(show_power_on_confirm()){
-                                        enter_powered_menu_standby(&s);
-                                    }
-                                } else if(s.cursor == 1){
-                                    s.screen = ScreenSettings;
-                                    s.cursor = 0;
-                                    s.first_visible = 0;
-                                } else {
-                                    s.screen = ScreenHelp;
-                                    s.help_top_line = 0;
-                                }
+                                    if(powered) apply_mode(s, 0); /* Stand by: PP LOW, no countdown */
+                                    s->screen = ScreenHelp;
+                                    s->help_top_px = 0;
+                                    break;
+                                default:
+                                    break;
                             }
                         } else if(ev.key == InputKeyBack){
                             /* short back => hint (left-aligned) */
-                            s.hint_visible = true;
-                            if(!s.hint_timer){
-                                s.hint_timer = furi_timer_alloc(hint_timer_cb, FuriTimerTypeOnce, &s);
-                            }
-                            furi_timer_start(s.hint_timer, furi_ms_to_ticks(1500));
+                            seq_start(s, SeqHint);
                         }
                     }
                 } break;
@@ -792,105 +5190,416 @@ int32_t embraco_starter(void* p){
                 /* -------- Help -------- */
                 case ScreenHelp: {
                     if(ev.type == InputTypeShort || ev.type == InputTypeRepeat){
-                        const uint8_t total_lines = (s.inverter == InvEmbraco) ? HELP_EMBRACO_COUNT : HELP_SAMSUNG_COUNT;
-                        uint8_t max_lines, max_top_line;
-                        help_layout_params(total_lines, &max_lines, &max_top_line);
+                        uint8_t total_lines;
+                        help_lines(s, &total_lines);
+                        const uint16_t max_top = help_max_top_px(total_lines);
+                        const bool glide = (ev.type == InputTypeRepeat);
+                        uint16_t top = s->help_top_px;
 
+                        /* a press snaps to the next line, a held key glides pixel-wise */
                         if(ev.key == InputKeyUp){
-                            if(s.help_top_line > 0) s.help_top_line--;
+                            if(glide) top = (top > HELP_GLIDE_PX) ? (uint16_t)(top - HELP_GLIDE_PX) : 0;
+                            else top = (top > HELP_LINE_H) ? (uint16_t)((top - 1U) / HELP_LINE_H * HELP_LINE_H) : 0;
+                            s->help_top_px = top;
+                        } else if(ev.key == InputKeyDown){
+                            if(glide) top = (uint16_t)(top + HELP_GLIDE_PX);
+                            else top = (uint16_t)((top / HELP_LINE_H + 1U) * HELP_LINE_H);
+                            s->help_top_px = (top > max_top) ? max_top : top;
+                        } else if(ev.key == InputKeyBack){
+                            s->screen = ScreenMenu;
+                        }
+                    }
+                } break;
+
+#if FEATURE_POWER_STATS
+                /* -------- Power stats -------- */
+                case ScreenPower: {
+                    if(ev.type == InputTypeShort){
+                        if(ev.key == InputKeyOk){
+                            memset(s->prof.sum_ma, 0, sizeof(s->prof.sum_ma));
+                            memset(s->prof.n, 0, sizeof(s->prof.n));
+                            memset(s->prof.pol_sum_ma, 0, sizeof(s->prof.pol_sum_ma));
+                            memset(s->prof.pol_n, 0, sizeof(s->prof.pol_n));
+                        } else if(ev.key == InputKeyLeft || ev.key == InputKeyRight){
+                            s->prof.by_policy = !s->prof.by_policy;
+                        } else if(ev.key == InputKeyBack){
+                            s->screen = ScreenMenu;
+                        }
+                    }
+                } break;
+
+#endif
+
+#if FEATURE_ODOMETER
+                /* -------- Run hours -------- */
+                case ScreenOdometer: {
+                    if(ev.type == InputTypeShort || ev.type == InputTypeRepeat){
+                        if(ev.key == InputKeyLeft){
+                            s->odo.view = (s->odo.view == 0) ? (uint8_t)(ODO_UNITS - 1) : (uint8_t)(s->odo.view - 1);
+                        } else if(ev.key == InputKeyRight){
+                            s->odo.view = (uint8_t)((s->odo.view + 1) % ODO_UNITS);
+                        } else if(ev.key == InputKeyBack && ev.type == InputTypeShort){
+                            s->screen = ScreenMenu;
+                        }
+                    }
+                } break;
+
+#endif
+#if FEATURE_HISTORY
+                /* -------- History -------- */
+                case ScreenHistory: {
+                    TestHistory* h = &s->hist;
+                    if(ev.type == InputTypeShort || ev.type == InputTypeRepeat){
+                        if(h->editing){
+                            /* serial editor: Left/Right pick the digit, Up/Down change it */
+                            if(ev.key == InputKeyLeft){
+                                h->digit = step_wrap(h->digit, -1, 0, HIST_DIGITS - 1);
+                            } else if(ev.key == InputKeyRight){
+                                h->digit = step_wrap(h->digit, 1, 0, HIST_DIGITS - 1);
+                            } else if(ev.key == InputKeyUp || ev.key == InputKeyDown){
+                                hist_digit_step(h, (ev.key == InputKeyUp) ? 1 : -1);
+                            } else if(ev.type == InputTypeShort && (ev.key == InputKeyOk || ev.key == InputKeyBack)){
+                                h->editing = false;
+                                hist_view_load(s);
+                            }
+                        } else if(ev.key == InputKeyLeft || ev.key == InputKeyRight){
+                            h->view = step_wrap(h->view, (ev.key == InputKeyRight) ? 1 : -1, 0, ODO_UNITS - 1);
+                            hist_view_load(s);
+                        } else if(ev.key == InputKeyUp){
+                            if(h->top) h->top--;
+                        } else if(ev.key == InputKeyDown){
+                            if(h->top + HIST_ROWS < h->n) h->top++;
+                        } else if(ev.key == InputKeyOk && ev.type == InputTypeShort){
+                            h->editing = true;
+                            h->digit = HIST_DIGITS - 1;
+                        } else if(ev.key == InputKeyBack && ev.type == InputTypeShort){
+                            s->screen = ScreenMenu;
+                        }
+                    }
+                } break;
+
+#endif
+
+#if FEATURE_TREND
+                /* -------- Trend -------- */
+                case ScreenTrend: {
+                    Trend* t = &s->trend;
+                    if(ev.type == InputTypeShort || ev.type == InputTypeRepeat){
+                        if(ev.key == InputKeyLeft){
+                            if(t->zoom + 1U < TREND_LEVELS) t->zoom++;      /* longer window */
+                        } else if(ev.key == InputKeyRight){
+                            if(t->zoom) t->zoom--;
+                        } else if(ev.key == InputKeyUp){
+                            t->view = step_wrap(t->view, -1, 0, COUNT_OF(kTrendViews) - 1);
+                        } else if(ev.key == InputKeyDown){
+                            t->view = step_wrap(t->view, 1, 0, COUNT_OF(kTrendViews) - 1);
+                        } else if(ev.key == InputKeyBack && ev.type == InputTypeShort){
+                            s->screen = ScreenMenu;
+                        }
+                    }
+                } break;
+
+#endif
+#if FEATURE_BURST
+                /* -------- Pulse burst -------- */
+                case ScreenBurst: {
+                    BurstTest* b = &s->burst;
+                    if(ev.type == InputTypeShort || ev.type == InputTypeRepeat){
+                        if(burst_busy(s)){
+                            /* running: only BACK (abort to Stand by) */
+                            if(ev.key == InputKeyBack && ev.type == InputTypeShort) burst_finish(s, true);
+                        } else if(b->phase == BurstDone){
+                            if(ev.key == InputKeyBack || ev.key == InputKeyOk) b->phase = BurstIdle;
+                        } else if(ev.key == InputKeyUp){
+                            b->row = step_wrap(b->row, -1, 0, BurstRowCount - 1);
+                        } else if(ev.key == InputKeyDown){
+                            b->row = step_wrap(b->row, 1, 0, BurstRowCount - 1);
+                        } else if(ev.key == InputKeyLeft || ev.key == InputKeyRight){
+                            int8_t d = (ev.key == InputKeyRight) ? 1 : -1;
+                            if(b->row == BurstRowMode) b->mode = step_wrap(b->mode, d, 1, MODE_COUNT - 1);
+                            else if(b->row == BurstRowPulses) b->preset = step_wrap(b->preset, d, 0, COUNT_OF(kBurstPulses) - 1);
+                        } else if(ev.key == InputKeyOk && b->row == BurstRowStart){
+                            burst_start(s, b->mode, kBurstPulses[b->preset]);
+                        } else if(ev.key == InputKeyBack){
+                            s->screen = ScreenMenu;
+                        }
+                    }
+                } break;
+
+#endif
+#if FEATURE_SCHEDULE
+                /* -------- Delayed start -------- */
+                case ScreenSchedule: {
+                    Schedule* w = &s->sched;
+                    if(ev.type == InputTypeShort || ev.type == InputTypeRepeat){
+                        if(w->armed){
+                            /* armed: only BACK (cancel) */
+                            if(ev.key == InputKeyBack && ev.type == InputTypeShort) sched_cancel(s);
+                        } else if(ev.key == InputKeyUp){
+                            w->row = step_wrap(w->row, -1, 0, SchedRowCount - 1);
+                        } else if(ev.key == InputKeyDown){
+                            w->row = step_wrap(w->row, 1, 0, SchedRowCount - 1);
+                        } else if(ev.key == InputKeyLeft || ev.key == InputKeyRight){
+                            int8_t d = (ev.key == InputKeyRight) ? 1 : -1;
+                            if(w->row == SchedRowTime){
+                                int32_t step = (ev.type == InputTypeRepeat) ? SCHED_FAST_MIN : SCHED_STEP_MIN;
+                                int32_t m = (int32_t)w->minute - (int32_t)w->minute % step + d * step;
+                                if(d < 0 && w->minute % step) m += step;    /* snap down to the grid first */
+                                w->minute = (uint16_t)((m + 24 * 60) % (24 * 60));
+                            } else if(w->row == SchedRowMode){
+                                w->mode = step_wrap(w->mode, d, 1, MODE_COUNT - 1);
+                            }
+                        } else if(ev.key == InputKeyOk && ev.type == InputTypeShort && w->row == SchedRowArm){
+                            s->confirm = ConfirmSchedule;
+                        } else if(ev.key == InputKeyBack && ev.type == InputTypeShort){
+                            s->screen = ScreenMenu;
+                        }
+                    }
+                } break;
+
+#endif
+#if FEATURE_SWEEP
+                /* -------- Vibration sweep -------- */
+                case ScreenSweep: {
+                    Sweep* w = &s->sweep;
+                    if(ev.type == InputTypeShort || ev.type == InputTypeRepeat){
+                        if(sweep_busy(s)){
+                            /* running: only BACK (abort to Stand by) */
+                            if(ev.key == InputKeyBack && ev.type == InputTypeShort) sweep_stop(s, true);
+                        } else if(ev.key == InputKeyOk && ev.type == InputTypeShort){
+                            sweep_start(s);
+                        } else if((ev.key == InputKeyLeft || ev.key == InputKeyRight) && w->phase == SweepDone && w->step){
+                            w->cursor = step_wrap(w->cursor, (ev.key == InputKeyRight) ? 1 : -1, 0, w->step - 1);
+                        } else if(ev.key == InputKeyBack){
+                            s->screen = ScreenMenu;
+                        }
+                    }
+                } break;
+
+#endif
+#if FEATURE_JITTER
+                /* -------- PWM jitter -------- */
+                case ScreenJitter: {
+                    if(ev.type == InputTypeShort){
+                        if(jitter_busy(s)){
+                            /* running: only BACK (abort to Stand by) */
+                            if(ev.key == InputKeyBack) jitter_stop(s, true);
+                        } else if(ev.key == InputKeyOk){
+                            jitter_start(s);
+                        } else if(ev.key == InputKeyBack){
+                            s->screen = ScreenMenu;
+                        }
+                    }
+                } break;
+
+#endif
+
+#if FEATURE_RACK
+                /* -------- Rack test -------- */
+                case ScreenRack: {
+                    RackTest* r = &s->rack;
+                    if(ev.type == InputTypeShort || ev.type == InputTypeRepeat){
+                        if(rack_busy(s)){
+                            /* running: only BACK (stop) */
+                            if(ev.key == InputKeyBack && ev.type == InputTypeShort){
+                                rack_stop(s, RackIdle);
+                                s->screen = ScreenMenu;
+                            }
+                        } else if(r->phase == RackDone || r->phase == RackWired){
+                            if(ev.key == InputKeyBack || ev.key == InputKeyOk){
+                                r->phase = RackIdle;
+                                s->screen = ScreenMenu;   /* safe menu: rack_stop left it */
+                            }
+                        } else if(ev.key == InputKeyUp){
+                            r->row = step_wrap(r->row, -1, 0, RackRowCount - 1);
                         } else if(ev.key == InputKeyDown){
-                            if(s.help_top_line < max_top_line) s.help_top_line++;
+                            r->row = step_wrap(r->row, 1, 0, RackRowCount - 1);
+                        } else if(ev.key == InputKeyLeft || ev.key == InputKeyRight){
+                            rack_adjust(r, (ev.key == InputKeyRight) ? 1 : -1);
+                        } else if(ev.key == InputKeyOk && r->row == RackRowStart){
+                            seq_start(s, SeqRack);
                         } else if(ev.key == InputKeyBack){
-                            s.screen = ScreenMenu;
+                            s->screen = ScreenMenu;
                         }
                     }
                 } break;
 
+#endif
+
                 /* -------- Settings -------- */
                 case ScreenSettings: {
-                    const uint8_t ROW_TOTAL = 5;
+                    const uint8_t ROW_TOTAL = SetRowCount;
                     const uint8_t MAX_ROWS_S = 4;
 
                     if(ev.type == InputTypeShort){
                         if(ev.key == InputKeyUp){
-                            if(s.cursor == 0){
-                                s.cursor = (uint8_t)(ROW_TOTAL - 1);
-                                s.first_visible = (ROW_TOTAL > MAX_ROWS_S) ? (uint8_t)(ROW_TOTAL - MAX_ROWS_S) : 0;
+                            if(s->cursor == 0){
+                                s->cursor = (uint8_t)(ROW_TOTAL - 1);
+                                s->first_visible = (ROW_TOTAL > MAX_ROWS_S) ? (uint8_t)(ROW_TOTAL - MAX_ROWS_S) : 0;
                             } else {
-                                s.cursor--;
-                                if(s.cursor == 2) s.cursor = 1; /* skip header */
-                                if(s.cursor < s.first_visible) s.first_visible = s.cursor;
+                                s->cursor--;
+#if FEATURE_SAMSUNG
+                                if(s->cursor == SetRowInvHeader) s->cursor = SetRowInvHeader - 1; /* skip header */
+#endif
+                                if(s->cursor < s->first_visible) s->first_visible = s->cursor;
                             }
                         } else if(ev.key == InputKeyDown){
-                            if(s.cursor == (uint8_t)(ROW_TOTAL - 1)){
-                                s.cursor = 0;
-                                s.first_visible = 0;
+                            if(s->cursor == (uint8_t)(ROW_TOTAL - 1)){
+                                s->cursor = 0;
+                                s->first_visible = 0;
                             } else {
-                                s.cursor++;
-                                if(s.cursor == 2) s.cursor = 3; /* skip header */
-                                if(s.cursor >= s.first_visible + MAX_ROWS_S){
-                                    s.first_visible = (uint8_t)(s.cursor - (MAX_ROWS_S - 1));
+                                s->cursor++;
+#if FEATURE_SAMSUNG
+                                if(s->cursor == SetRowInvHeader) s->cursor = SetRowInvHeader + 1; /* skip header */
+#endif
+                                if(s->cursor >= s->first_visible + MAX_ROWS_S){
+                                    s->first_visible = (uint8_t)(s->cursor - (MAX_ROWS_S - 1));
                                 }
                             }
                         } else if(ev.key == InputKeyOk){
-                            if(s.cursor == 0){
+                            if(s->cursor == SetRowLimit){
                                 /* Limit run time toggle with alert on Yes->No */
-                                if(s.limit_runtime){
-                                    if(show_limit_alert_confirm()){
-                                        s.limit_runtime = false;
-                                        /* cancel timers immediately */
-                                        stop_timers(&s);
-                                        s.remaining_ms = 0;
-                                    }
+                                if(s->limit_runtime){
+                                    s->confirm = ConfirmLimitOff;
                                 } else {
-                                    s.limit_runtime = true;
-                                    start_tick_timer_if_needed(&s);
+                                    s->limit_runtime = true;
+                                    start_tick_timer_if_needed(s);
                                 }
-                            } else if(s.cursor == 1){
+                            } else if(s->cursor == SetRowCaptcha){
                                 /* Arrow captcha toggle (placeholder) */
-                                s.arrow_captcha = !s.arrow_captcha;
-                            } else if(s.cursor == 3){
+                                s->arrow_captcha = !s->arrow_captcha;
+#if FEATURE_BACKGROUND
+                            } else if(s->cursor == SetRowBackground){
+                                s->background_run = !s->background_run;
+#endif
+#if FEATURE_POWER_SAVE
+                            } else if(s->cursor == SetRowPowerSave){
+                                s->power_save = (PowerSave)((s->power_save + 1) % PowerSaveCount);
+                                display_policy_sync(s);
+#endif
+#if FEATURE_RECORDER
+                            } else if(s->cursor == SetRowRecorder){
+                                s->rec_rate = (RecRate)((s->rec_rate + 1) % RecRateCount);
+                                rec_apply(s);
+#endif
+#if FEATURE_ODOMETER
+                            } else if(s->cursor == SetRowUnit){
+                                /* a direct run in progress moves with the setting */
+                                odo_collect(s);
+                                s->odo.unit = (uint8_t)((s->odo.unit + 1) % ODO_UNITS);
+                                if(s->rack.phase != RackRun) s->odo.run_unit = s->odo.unit;
+#endif
+#if FEATURE_PRESSURE
+                            } else if(s->cursor == SetRowPressure){
+                                s->press.unit = (PressUnit)((s->press.unit + 1) % PressUnitCount);
+                                press_sync(s);
+#endif
+#if FEATURE_ESTOP
+                            } else if(s->cursor == SetRowEstop){
+                                /* On with the loop open while PWM runs trips right here */
+                                s->estop.pin_enabled = !s->estop.pin_enabled;
+                                estop_pin_sync(s);
+#endif
+#if FEATURE_SAMSUNG
+                            } else if(s->cursor == SetRowEmbraco){
                                 /* Choose Embraco — if already selected, do nothing */
-                                if(s.inverter != InvEmbraco){
-                                    s.inverter = InvEmbraco;
+                                if(s->inverter != InvEmbraco){
+                                    s->inverter = InvEmbraco;
                                     /* Return to SAFE MENU with 3 items and updated title */
-                                    enter_safe_menu(&s);
-                                    s.screen = ScreenMenu;
+                                    enter_safe_menu(s);
+                                    s->screen = ScreenMenu;
                                 }
-                            } else if(s.cursor == 4){
+                            } else if(s->cursor == SetRowSamsung){
                                 /* Choose Samsung */
-                                if(s.inverter != InvSamsung){
-                                    s.inverter = InvSamsung;
-                                    enter_safe_menu(&s);
-                                    s.screen = ScreenMenu;
+                                if(s->inverter != InvSamsung){
+                                    s->inverter = InvSamsung;
+                                    enter_safe_menu(s);
+                                    s->screen = ScreenMenu;
                                 }
+#endif
                             }
                         } else if(ev.key == InputKeyBack){
-                            s.screen = ScreenMenu;
-                            s.cursor = 0;
-                            s.first_visible = 0;
+                            s->screen = ScreenMenu;
+                            s->cursor = 0;
+                            s->first_visible = 0;
                         }
                     }
                 } break;
+
+                default:
+                    break;
             } /* switch(screen) */
 
-            view_port_update(s.vp);
-        } /* queue ok */
+            power_profile_sync(s);
+            trend_sync(s);
+            app_redraw(s);
+        } /* input event */
+#endif
     } /* while */
 
     /* ---------- Cleanup ---------- */
-    if(s.led_timer){ furi_timer_stop(s.led_timer); furi_timer_free(s.led_timer); s.led_timer = NULL; }
-    if(s.hint_timer){ furi_timer_stop(s.hint_timer); furi_timer_free(s.hint_timer); s.hint_timer = NULL; }
-    stop_timers(&s);
-    free_timers(&s);
-    pwm_hw_stop_safe(&s.pwm_running);
-    pin_to_hiz();
-    notification_message(s.notif, &sequence_reset_rgb);
-    furi_record_close(RECORD_NOTIFICATION);
+#if FEATURE_CLI
+    /* no command may reach the queue or the state from here on */
+    cli_delete_command(cli, CLI_COMMAND);
+    furi_record_close(RECORD_CLI);
+#endif
+    estop_stop(s);
+    supervisor_stop(&s->sup);
+    if(s->hb_timer){ furi_timer_stop(s->hb_timer); furi_timer_free(s->hb_timer); s->hb_timer = NULL; }
+    if(s->power_timer){ furi_timer_stop(s->power_timer); furi_timer_free(s->power_timer); s->power_timer = NULL; }
+    if(s->rec_timer){ furi_timer_stop(s->rec_timer); furi_timer_free(s->rec_timer); s->rec_timer = NULL; }
+
+    /* a rack test never goes to the background: cut PA7, release the relays */
+    if(rack_busy(s)) rack_stop(s, RackIdle);
+    /* nor does a burst: cut it short, Stand by */
+    if(burst_busy(s)) burst_finish(s, true);
+    if(s->burst.timer){ furi_timer_free(s->burst.timer); s->burst.timer = NULL; }
+    if(sweep_busy(s)) sweep_stop(s, true);
+    if(s->sweep.timer){ furi_timer_free(s->sweep.timer); s->sweep.timer = NULL; }
+    if(jitter_busy(s)) jitter_stop(s, true);
+    if(s->jit.timer){ furi_timer_free(s->jit.timer); s->jit.timer = NULL; }
+    /* a pending delayed start dies with the app */
+    sched_cancel(s);
+    /* the ADC goes back to the HAL whatever happens to PA7 */
+    if(s->press.timer){ furi_timer_stop(s->press.timer); furi_timer_free(s->press.timer); s->press.timer = NULL; }
+    if(s->press.running) press_stop(&s->press);
+    trend_free(&s->trend);
+
+    /* last pulse count before a handoff may re-arm TIM1 */
+    odo_release(s);
+
+    /* Background run: leave the mode in TIM1 instead of cutting PA7 */
+    bool handed_off = bg_run_handoff(s);
+
+    led_apply(s, 0);
+    for(uint8_t i = 0; i < SeqCount; i++) seq_free(&s->seq[i]);
+    display_wake(s);
+    if(s->disp_timer){ furi_timer_free(s->disp_timer); s->disp_timer = NULL; }
+    stop_timers(s);
+    free_timers(s);
+    if(!handed_off){
+        pwm_hw_stop_safe(&s->pwm_running);
+        pin_to_hiz();
+        power_hold_sync(&s->power_hold, false);
+    }
+    rec_close(s);
+    odo_close(s);
+    hist_close(s);
+    if(s->notif){
+        notification_message(s->notif, &sequence_reset_rgb);
+        furi_record_close(RECORD_NOTIFICATION);
+    }
+    settings_save_if_changed(s, &settings_loaded);
 
-    gui_remove_view_port(s.gui, s.vp);
-    view_port_free(s.vp);
-    furi_message_queue_free(s.q);
+#if FEATURE_GUI
+    gui_remove_view_port(s->gui, s->vp);
+    view_port_free(s->vp);
     furi_record_close(RECORD_GUI);
+#endif
+    furi_message_queue_free(s->q);
+    free(s);
+    /* high-water mark of this thread: size stack_size in application.fam by it */
+    FURI_LOG_I(TAG, "stack: %lu bytes never used",
+        (unsigned long)furi_thread_get_stack_space(furi_thread_get_current_id()));
     return 0;
 }
@@ -0,0 +1,175 @@
+#pragma once
+/* Embraco Starter state recording (".erc") — stream format.
+ * Shared by the app (recorder.c) and the host decoder (tools/erc_decode.c),
+ * so this header has no Furi dependencies.
+ *
+ * File:    "ERC1" once, then records back to back.
+ * Record:  varint header = (dt_ms << 3) | type, dt_ms since previous record,
+ *          followed by a type-specific payload:
+ *   Session  version (1 byte), RTC unix time (varint)  — starts a new time base
+ *   Sync     tick (varint), full state (all fields)     — after a gap/overflow
+ *   State    field mask (1 byte), zigzag varint delta per set field
+ *   Input    (key << 4) | type (1 byte)
+ *   Timer    timer id (1 byte)
+ * Unchanged state produces no record, so a steady run costs only the 1 Hz
+ * countdown change (2–3 bytes/s). */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ERC_MAGIC       "ERC1"
+#define ERC_MAGIC_LEN   4
+#define ERC_VERSION     1
+#define ERC_REC_MAX     32      /* largest encoded record */
+
+typedef enum {
+    ErcRecSession = 0,
+    ErcRecSync    = 1,
+    ErcRecState   = 2,
+    ErcRecInput   = 3,
+    ErcRecTimer   = 4,
+} ErcRecType;
+
+typedef enum {
+    ErcFieldFreq      = 1 << 0,
+    ErcFieldRunning   = 1 << 1,
+    ErcFieldRemaining = 1 << 2,
+    ErcFieldScreen    = 1 << 3,
+    ErcFieldActive    = 1 << 4,
+    ErcFieldAll       = 0x1F,
+} ErcField;
+
+typedef enum {
+    ErcTimerTick = 0,           /* 1 Hz countdown */
+    ErcTimerOff,                /* auto-off one-shot */
+    ErcTimerHint,
+    ErcTimerDisplay,
+    ErcTimerHeartbeat,
+    ErcTimerPower,
+    ErcTimerSupervisor,         /* supervisor trip */
+    ErcTimerEstop,              /* e-stop pin or key chord */
+    ErcTimerCount,
+} ErcTimerId;
+
+typedef struct {
+    uint32_t freq_hz;           /* commanded frequency, 0 = no PWM */
+    uint32_t remaining_ms;
+    uint8_t  running;           /* PWM running flag */
+    uint8_t  screen;
+    uint8_t  active;            /* kModes[] index */
+} ErcState;
+
+/* ---------- Varint / zigzag ---------- */
+static inline size_t erc_put_varint(uint8_t* out, uint32_t v){
+    size_t n = 0;
+    while(v >= 0x80U){
+        out[n++] = (uint8_t)(v | 0x80U);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+/* Returns bytes consumed, 0 on truncated/overlong input */
+static inline size_t erc_get_varint(const uint8_t* in, size_t len, uint32_t* v){
+    uint32_t r = 0;
+    for(size_t i = 0; i < len && i < 5; i++){
+        r |= (uint32_t)(in[i] & 0x7FU) << (7U * i);
+        if(!(in[i] & 0x80U)){
+            *v = r;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static inline uint32_t erc_zigzag(int32_t v){
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+static inline int32_t erc_unzigzag(uint32_t v){
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1U);
+}
+
+/* ---------- Encoders (out must hold ERC_REC_MAX bytes) ---------- */
+static inline size_t erc_put_header(uint8_t* out, uint32_t dt_ms, ErcRecType type){
+    if(dt_ms > (UINT32_MAX >> 3)) dt_ms = UINT32_MAX >> 3;
+    return erc_put_varint(out, (dt_ms << 3) | (uint32_t)type);
+}
+
+static inline size_t erc_put_fields(uint8_t* out, uint8_t mask, const ErcState* prev, const ErcState* cur){
+    size_t n = 0;
+    out[n++] = mask;
+    if(mask & ErcFieldFreq)      n += erc_put_varint(out + n, erc_zigzag((int32_t)(cur->freq_hz - prev->freq_hz)));
+    if(mask & ErcFieldRunning)   n += erc_put_varint(out + n, erc_zigzag((int32_t)cur->running - prev->running));
+    if(mask & ErcFieldRemaining) n += erc_put_varint(out + n, erc_zigzag((int32_t)(cur->remaining_ms - prev->remaining_ms)));
+    if(mask & ErcFieldScreen)    n += erc_put_varint(out + n, erc_zigzag((int32_t)cur->screen - prev->screen));
+    if(mask & ErcFieldActive)    n += erc_put_varint(out + n, erc_zigzag((int32_t)cur->active - prev->active));
+    return n;
+}
+
+static inline uint8_t erc_state_diff(const ErcState* a, const ErcState* b){
+    uint8_t mask = 0;
+    if(a->freq_hz != b->freq_hz)           mask |= ErcFieldFreq;
+    if(a->running != b->running)           mask |= ErcFieldRunning;
+    if(a->remaining_ms != b->remaining_ms) mask |= ErcFieldRemaining;
+    if(a->screen != b->screen)             mask |= ErcFieldScreen;
+    if(a->active != b->active)             mask |= ErcFieldActive;
+    return mask;
+}
+
+/* State delta; returns 0 (nothing to write) when unchanged */
+static inline size_t erc_encode_state(uint8_t* out, uint32_t dt_ms, const ErcState* prev, const ErcState* cur){
+    uint8_t mask = erc_state_diff(prev, cur);
+    if(!mask) return 0;
+    size_t n = erc_put_header(out, dt_ms, ErcRecState);
+    return n + erc_put_fields(out + n, mask, prev, cur);
+}
+
+/* Full state against zero, with an absolute tick */
+static inline size_t erc_encode_sync(uint8_t* out, uint32_t dt_ms, uint32_t tick, const ErcState* cur){
+    static const ErcState zero = {0};
+    size_t n = erc_put_header(out, dt_ms, ErcRecSync);
+    n += erc_put_varint(out + n, tick);
+    return n + erc_put_fields(out + n, ErcFieldAll, &zero, cur);
+}
+
+static inline size_t erc_encode_session(uint8_t* out, uint32_t unix_time){
+    size_t n = erc_put_header(out, 0, ErcRecSession);
+    out[n++] = ERC_VERSION;
+    return n + erc_put_varint(out + n, unix_time);
+}
+
+static inline size_t erc_encode_input(uint8_t* out, uint32_t dt_ms, uint8_t key, uint8_t type){
+    size_t n = erc_put_header(out, dt_ms, ErcRecInput);
+    out[n++] = (uint8_t)((key << 4) | (type & 0x0FU));
+    return n;
+}
+
+static inline size_t erc_encode_timer(uint8_t* out, uint32_t dt_ms, uint8_t timer_id){
+    size_t n = erc_put_header(out, dt_ms, ErcRecTimer);
+    out[n++] = timer_id;
+    return n;
+}
+
+/* ---------- Decoder ---------- */
+/* Applies one state/sync field block to `st`; returns bytes consumed or 0 */
+static inline size_t erc_get_fields(const uint8_t* in, size_t len, ErcState* st){
+    if(len < 1) return 0;
+    uint8_t mask = in[0];
+    size_t n = 1;
+    uint32_t v;
+    size_t k;
+#define ERC_FIELD(bit, field, type)                         \
+    if(mask & (bit)){                                       \
+        if(!(k = erc_get_varint(in + n, len - n, &v))) return 0; \
+        st->field = (type)(st->field + erc_unzigzag(v));    \
+        n += k;                                             \
+    }
+    ERC_FIELD(ErcFieldFreq, freq_hz, uint32_t)
+    ERC_FIELD(ErcFieldRunning, running, uint8_t)
+    ERC_FIELD(ErcFieldRemaining, remaining_ms, uint32_t)
+    ERC_FIELD(ErcFieldScreen, screen, uint8_t)
+    ERC_FIELD(ErcFieldActive, active, uint8_t)
+#undef ERC_FIELD
+    return n;
+}
@@ -0,0 +1,74 @@
+#pragma once
+/* Compile-time feature switches.
+ * Each App() in application.fam is one build variant and selects it with a
+ * cdefine; without one, the full field build is produced. A disabled feature
+ * drops its code and const data. Types and AppState fields stay, so the
+ * mode/timer/safety core is the same source in every variant. */
+
+#if defined(EMBRACO_VARIANT_BENCH)
+/* Embraco-only bench unit: fixed wiring, no inverter choice, no field extras */
+#define FEATURE_GUI         1
+#define FEATURE_CLI         0
+#define FEATURE_SAMSUNG     0   /* inverter selection screen, Samsung help/rows */
+#define FEATURE_BACKGROUND  0
+#define FEATURE_POWER_SAVE  0
+#define FEATURE_POWER_STATS 0
+#define FEATURE_RECORDER    0   /* recorder.c is left out of sources too */
+#define FEATURE_RACK        1
+#define FEATURE_ODOMETER    1   /* TIM2 pulse counter + run hours per unit */
+#define FEATURE_BURST       1   /* exact N-period bursts (TIM1 RCR + one-pulse) */
+#define FEATURE_SWEEP       1   /* speed sweep with a LIS3DH on the ext I2C pins */
+#define FEATURE_PRESSURE    1   /* suction/discharge transducers, ADC scan + DMA */
+#define FEATURE_SCHEDULE    1   /* delayed start on the RTC alarm */
+#define FEATURE_TREND       1   /* speed/pressure/battery history graph */
+#define FEATURE_JITTER      1   /* PWM period capture on a PA7 -> PA6 loopback */
+#define FEATURE_ESTOP       1   /* NC e-stop loop on PB14 (EXTI) + OK+BACK chord */
+#define FEATURE_HISTORY     1   /* test log on SD, indexed by unit serial (history.c) */
+
+#elif defined(EMBRACO_VARIANT_HEADLESS)
+/* No screen: driven from the Flipper CLI ("embraco ...") */
+#define FEATURE_GUI         0
+#define FEATURE_CLI         1
+#define FEATURE_SAMSUNG     0
+#define FEATURE_BACKGROUND  0
+#define FEATURE_POWER_SAVE  0
+#define FEATURE_POWER_STATS 0
+#define FEATURE_RECORDER    0
+#define FEATURE_RACK        0
+#define FEATURE_ODOMETER    1
+#define FEATURE_BURST       1
+#define FEATURE_SWEEP       1
+#define FEATURE_PRESSURE    0   /* shown on the menu screen only */
+#define FEATURE_SCHEDULE    1
+#define FEATURE_TREND       0
+#define FEATURE_JITTER      0
+#define FEATURE_ESTOP       1
+#define FEATURE_HISTORY     1
+
+#else
+/* Full field build */
+#define FEATURE_GUI         1
+#define FEATURE_CLI         1
+#define FEATURE_SAMSUNG     1
+#define FEATURE_BACKGROUND  1
+#define FEATURE_POWER_SAVE  1
+#define FEATURE_POWER_STATS 1
+#define FEATURE_RECORDER    1
+#define FEATURE_RACK        1
+#define FEATURE_ODOMETER    1
+#define FEATURE_BURST       1
+#define FEATURE_SWEEP       1
+#define FEATURE_PRESSURE    1
+#define FEATURE_SCHEDULE    1
+#define FEATURE_TREND       1
+#define FEATURE_JITTER      1
+#define FEATURE_ESTOP       1
+#define FEATURE_HISTORY     1
+#endif
+
+#if !FEATURE_GUI && (FEATURE_SAMSUNG || FEATURE_POWER_SAVE || FEATURE_POWER_STATS || FEATURE_RACK || FEATURE_PRESSURE || FEATURE_TREND || FEATURE_JITTER)
+#error "screen-based features need FEATURE_GUI"
+#endif
+#if !FEATURE_GUI && !FEATURE_CLI
+#error "a variant needs the GUI or the CLI"
+#endif
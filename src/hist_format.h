@@ -0,0 +1,87 @@
+#pragma once
+/* Embraco Starter test history — on-SD format.
+ * Shared by the app (history.c) and the host dump tool (tools/hist_dump.c),
+ * so this header has no Furi dependencies.
+ *
+ * history.log   HistRecord back to back, append only. Record n is at
+ *               n * sizeof(HistRecord); a torn tail (size not a multiple,
+ *               or a bad CRC) ends the log. Tests are appended as they end,
+ *               so `time` is ascending and a date lookup is a binary search
+ *               on the log itself.
+ * hist_L_S.idx  One sorted run of the serial index: HistKey ordered by
+ *               (serial, time, recno). Level L holds up to HIST_FANOUT runs;
+ *               when it is full they are merged into one run of level L + 1,
+ *               so an append never rewrites more than its own level.
+ * history.man   Two HistManifest slots written alternately; the valid one
+ *               with the higher seq says which runs exist and how many log
+ *               records they cover. Newer records are only in the log and
+ *               are re-read into RAM on open. */
+#include <stddef.h>
+#include <stdint.h>
+
+#define HIST_MAN_MAGIC  0x31494845U     /* "EHI1" */
+#define HIST_LEVELS     6
+#define HIST_FANOUT     4
+#define HIST_MEM        32              /* keys in RAM before a level-0 run is written */
+
+typedef enum {
+    HistRun = 0,                /* a mode ran (direct or one rack unit) */
+    HistBurst,                  /* value: periods sent */
+    HistSweep,                  /* value: (peak Hz << 16) | peak RMS mg */
+    HistJitter,                 /* value: worst p99 over the scenarios, ns */
+    HistKindCount,
+} HistKind;
+
+typedef enum {
+    HistOk = 0,                 /* ran to its end (time limit, count, last step) */
+    HistStopped,                /* ended by the user: mode change, Stand by, Power off */
+    HistAborted,                /* test cut short */
+    HistEstop,                  /* e-stop pin or chord */
+    HistTrip,                   /* safety supervisor */
+    HistResultCount,
+} HistResult;
+
+typedef struct {
+    uint32_t time;              /* RTC, s since 1970, at the start */
+    uint32_t serial;            /* unit serial, 0 = not set */
+    uint32_t duration_s;
+    uint32_t value;             /* per HistKind */
+    uint8_t  kind;              /* HistKind */
+    uint8_t  result;            /* HistResult */
+    uint8_t  mode;              /* kModes[] index, 0 for a sweep */
+    uint8_t  unit;              /* unit slot, 0-based */
+    uint32_t crc;               /* over everything above */
+} HistRecord;
+
+typedef struct {
+    uint32_t serial;
+    uint32_t time;
+    uint32_t recno;             /* record number in history.log */
+} HistKey;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t indexed;           /* log records [0, indexed) are in the runs */
+    uint8_t  runs[HIST_LEVELS]; /* runs per level, files hist_L_0 .. hist_L_(runs-1) */
+    uint8_t  pad[2];
+    uint32_t crc;               /* over everything above */
+} HistManifest;
+
+/* CRC-32 (IEEE) of the bytes before the struct's crc field */
+static inline uint32_t hist_crc(const void* data, size_t len){
+    const uint8_t* p = data;
+    uint32_t crc = 0xFFFFFFFFU;
+    for(size_t i = 0; i < len; i++){
+        crc ^= p[i];
+        for(uint8_t b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+    return ~crc;
+}
+
+static inline int hist_key_cmp(const HistKey* a, const HistKey* b){
+    if(a->serial != b->serial) return (a->serial < b->serial) ? -1 : 1;
+    if(a->time != b->time) return (a->time < b->time) ? -1 : 1;
+    if(a->recno != b->recno) return (a->recno < b->recno) ? -1 : 1;
+    return 0;
+}
@@ -0,0 +1,323 @@
+#include "history.h"
+
+#include <furi.h>
+#include <stdio.h>
+#include <storage/storage.h>
+
+#define TAG "EmbracoHistory"
+
+#define HIST_CHUNK  16U         /* keys per buffered read/write */
+
+struct History {
+    Storage* storage;
+    File* log;
+    File* man_file;
+    uint32_t count;             /* valid records in the log */
+    HistManifest man;
+    HistKey mem[HIST_MEM];      /* log records [man.indexed, count), sorted */
+    uint8_t mem_n;
+    bool stale;                 /* a run write failed: index again on next open */
+    HistKey found[HISTORY_FIND_MAX];
+    HistKey scratch[HIST_CHUNK];
+    char path[40];
+};
+
+typedef struct {
+    File* f;
+    HistKey buf[HIST_CHUNK];
+    uint8_t pos, len;
+} RunReader;
+
+static const char* run_path(History* h, unsigned level, unsigned run){
+    snprintf(h->path, sizeof(h->path), HISTORY_RUN_PATH, level, run);
+    return h->path;
+}
+
+/* ---------- Manifest ---------- */
+static bool man_valid(const HistManifest* m){
+    return m->magic == HIST_MAN_MAGIC && m->crc == hist_crc(m, offsetof(HistManifest, crc));
+}
+
+static void man_load(History* h){
+    HistManifest slot[2];
+    memset(&h->man, 0, sizeof(h->man));
+    h->man.magic = HIST_MAN_MAGIC;
+    if(storage_file_read(h->man_file, slot, sizeof(slot)) != sizeof(slot)) return;
+    for(uint8_t i = 0; i < 2; i++){
+        if(man_valid(&slot[i]) && slot[i].seq >= h->man.seq) h->man = slot[i];
+    }
+}
+
+/* The slot not holding the current manifest is overwritten, so a torn write
+ * leaves the previous one intact */
+static bool man_save(History* h){
+    h->man.seq++;
+    h->man.crc = hist_crc(&h->man, offsetof(HistManifest, crc));
+    if(!storage_file_seek(h->man_file, (h->man.seq & 1U) * sizeof(HistManifest), true) ||
+       storage_file_write(h->man_file, &h->man, sizeof(HistManifest)) != sizeof(HistManifest)){
+        FURI_LOG_E(TAG, "manifest write failed");
+        return false;
+    }
+    return true;
+}
+
+/* ---------- Runs ---------- */
+static bool run_write(History* h, unsigned level, unsigned run, File* f){
+    return storage_file_open(f, run_path(h, level, run), FSAM_WRITE, FSOM_CREATE_ALWAYS);
+}
+
+static bool reader_fill(RunReader* r){
+    r->len = (uint8_t)(storage_file_read(r->f, r->buf, sizeof(r->buf)) / sizeof(HistKey));
+    r->pos = 0;
+    return r->len > 0;
+}
+
+/* Streams the runs of `level` (HIST_FANOUT, or more after a failed merge)
+ * into one run of level + 1 */
+static bool merge_level(History* h, unsigned level){
+    uint8_t runs = h->man.runs[level];
+    RunReader* rd = malloc(sizeof(RunReader) * runs);
+    HistKey* out = malloc(sizeof(HistKey) * HIST_CHUNK);
+    File* dst = storage_file_alloc(h->storage);
+    bool ok = run_write(h, level + 1, h->man.runs[level + 1], dst);
+    uint8_t open = 0;
+    for(; ok && open < runs; open++){
+        rd[open].f = storage_file_alloc(h->storage);
+        if(!storage_file_open(rd[open].f, run_path(h, level, open), FSAM_READ, FSOM_OPEN_EXISTING)){
+            storage_file_free(rd[open].f);
+            ok = false;
+            break;
+        }
+        reader_fill(&rd[open]);
+    }
+
+    uint8_t n = 0;
+    while(ok){
+        int8_t pick = -1;
+        for(uint8_t i = 0; i < runs; i++){
+            if(rd[i].pos == rd[i].len) continue;
+            if(pick < 0 || hist_key_cmp(&rd[i].buf[rd[i].pos], &rd[pick].buf[rd[pick].pos]) < 0) pick = (int8_t)i;
+        }
+        if(pick < 0) break;
+        out[n++] = rd[pick].buf[rd[pick].pos++];
+        if(rd[pick].pos == rd[pick].len) reader_fill(&rd[pick]);
+        if(n == HIST_CHUNK){
+            ok = storage_file_write(dst, out, n * sizeof(HistKey)) == n * sizeof(HistKey);
+            n = 0;
+        }
+    }
+    if(ok && n) ok = storage_file_write(dst, out, n * sizeof(HistKey)) == n * sizeof(HistKey);
+
+    for(uint8_t i = 0; i < open; i++){
+        storage_file_close(rd[i].f);
+        storage_file_free(rd[i].f);
+    }
+    storage_file_close(dst);
+    storage_file_free(dst);
+    free(out);
+    free(rd);
+    if(!ok){
+        FURI_LOG_E(TAG, "merge of level %u failed", level);
+        return false;
+    }
+
+    /* the new run counts only once the manifest says so; the old files are
+     * then dead and get overwritten by the next runs of their level */
+    h->man.runs[level] = 0;
+    h->man.runs[level + 1]++;
+    if(!man_save(h)) return false;
+    for(uint8_t i = 0; i < runs; i++) storage_common_remove(h->storage, run_path(h, level, i));
+    return true;
+}
+
+/* Memtable -> level-0 run, then cascade full levels upwards */
+static void mem_flush(History* h){
+    File* f = storage_file_alloc(h->storage);
+    size_t len = h->mem_n * sizeof(HistKey);
+    bool ok = run_write(h, 0, h->man.runs[0], f) && storage_file_write(f, h->mem, len) == len;
+    storage_file_close(f);
+    storage_file_free(f);
+    if(ok){
+        h->man.runs[0]++;
+        h->man.indexed = h->count;
+        ok = man_save(h);
+    }
+    if(!ok){
+        /* the keys stay searchable in RAM; newer records are only in the log
+         * until the next open re-reads everything past man.indexed */
+        FURI_LOG_E(TAG, "run write failed");
+        h->stale = true;
+        return;
+    }
+    h->mem_n = 0;
+
+    for(unsigned level = 0; level + 1 < HIST_LEVELS; level++){
+        if(h->man.runs[level] < HIST_FANOUT) break;
+        if(!merge_level(h, level)) break;
+    }
+}
+
+static void mem_insert(History* h, uint32_t recno, const HistRecord* rec){
+    if(h->stale) return;
+    HistKey key = {.serial = rec->serial, .time = rec->time, .recno = recno};
+    uint8_t i = h->mem_n++;
+    while(i > 0 && hist_key_cmp(&h->mem[i - 1], &key) > 0){
+        h->mem[i] = h->mem[i - 1];
+        i--;
+    }
+    h->mem[i] = key;
+    if(h->mem_n == HIST_MEM) mem_flush(h);
+}
+
+/* ---------- Log ---------- */
+static bool log_read(History* h, uint32_t recno, HistRecord* rec){
+    return storage_file_seek(h->log, recno * sizeof(HistRecord), true) &&
+           storage_file_read(h->log, rec, sizeof(HistRecord)) == sizeof(HistRecord) &&
+           rec->crc == hist_crc(rec, offsetof(HistRecord, crc));
+}
+
+History* history_open(void){
+    History* h = malloc(sizeof(History));
+    memset(h, 0, sizeof(History));
+    h->storage = furi_record_open(RECORD_STORAGE);
+    h->log = storage_file_alloc(h->storage);
+    h->man_file = storage_file_alloc(h->storage);
+    if(!storage_file_open(h->log, HISTORY_LOG_PATH, FSAM_READ_WRITE, FSOM_OPEN_ALWAYS) ||
+       !storage_file_open(h->man_file, HISTORY_MAN_PATH, FSAM_READ_WRITE, FSOM_OPEN_ALWAYS)){
+        FURI_LOG_E(TAG, "open failed");
+        history_close(h);
+        return NULL;
+    }
+    man_load(h);
+
+    uint32_t size = (uint32_t)(storage_file_size(h->log) / sizeof(HistRecord));
+    if(h->man.indexed > size){
+        /* log replaced or cut under the index: rebuild it from the log */
+        FURI_LOG_W(TAG, "index ahead of log (%lu > %lu), rebuilding",
+                   (unsigned long)h->man.indexed, (unsigned long)size);
+        memset(h->man.runs, 0, sizeof(h->man.runs));
+        h->man.indexed = 0;
+        man_save(h);
+    }
+
+    /* records past the runs lived only in the memtable; a bad CRC is a torn
+     * append and ends the log */
+    HistRecord rec;
+    for(h->count = h->man.indexed; h->count < size; ){
+        if(!log_read(h, h->count, &rec)){
+            FURI_LOG_W(TAG, "log ends at record %lu of %lu", (unsigned long)h->count, (unsigned long)size);
+            break;
+        }
+        h->count++;
+        mem_insert(h, h->count - 1, &rec);
+    }
+    FURI_LOG_I(TAG, "%lu records, %u in RAM", (unsigned long)h->count, h->mem_n);
+    return h;
+}
+
+void history_close(History* h){
+    storage_file_close(h->log);
+    storage_file_free(h->log);
+    storage_file_close(h->man_file);
+    storage_file_free(h->man_file);
+    furi_record_close(RECORD_STORAGE);
+    free(h);
+}
+
+bool history_append(History* h, HistRecord* rec){
+    rec->crc = hist_crc(rec, offsetof(HistRecord, crc));
+    if(!storage_file_seek(h->log, h->count * sizeof(HistRecord), true) ||
+       storage_file_write(h->log, rec, sizeof(HistRecord)) != sizeof(HistRecord)){
+        FURI_LOG_E(TAG, "log write failed");
+        return false;
+    }
+    h->count++;
+    mem_insert(h, h->count - 1, rec);
+    return true;
+}
+
+uint32_t history_count(const History* h){
+    return h->count;
+}
+
+/* ---------- Lookups ---------- */
+/* Keeps the newest `max` keys of one serial in h->found, newest first */
+static size_t found_add(History* h, size_t n, size_t max, const HistKey* key){
+    for(size_t j = 0; j < n; j++){
+        if(h->found[j].recno == key->recno) return n;
+    }
+    size_t i = n;
+    while(i > 0 && (h->found[i - 1].time < key->time ||
+                    (h->found[i - 1].time == key->time && h->found[i - 1].recno < key->recno))){
+        i--;
+    }
+    if(i >= max) return n;
+    if(n < max) n++;
+    for(size_t j = n - 1; j > i; j--) h->found[j] = h->found[j - 1];
+    h->found[i] = *key;
+    return n;
+}
+
+/* Binary search in one run for the end of `serial`, then one read of the
+ * up to `max` keys before it */
+static size_t run_find(History* h, File* f, uint32_t serial, size_t n, size_t max){
+    uint32_t lo = 0, hi = (uint32_t)(storage_file_size(f) / sizeof(HistKey));
+    HistKey key;
+    while(lo < hi){
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(!storage_file_seek(f, mid * sizeof(HistKey), true) ||
+           storage_file_read(f, &key, sizeof(key)) != sizeof(key)) return n;
+        if(key.serial <= serial) lo = mid + 1; else hi = mid;
+    }
+    uint32_t from = (lo > max) ? lo - (uint32_t)max : 0;
+    HistKey* buf = h->scratch;
+    if(!storage_file_seek(f, from * sizeof(HistKey), true)) return n;
+    size_t got = storage_file_read(f, buf, (lo - from) * sizeof(HistKey)) / sizeof(HistKey);
+    for(size_t i = 0; i < got; i++){
+        if(buf[i].serial == serial) n = found_add(h, n, max, &buf[i]);
+    }
+    return n;
+}
+
+size_t history_by_serial(History* h, uint32_t serial, HistRecord* out, size_t max){
+    if(max > HISTORY_FIND_MAX) max = HISTORY_FIND_MAX;
+    size_t n = 0;
+    for(uint8_t i = 0; i < h->mem_n; i++){
+        if(h->mem[i].serial == serial) n = found_add(h, n, max, &h->mem[i]);
+    }
+
+    File* f = storage_file_alloc(h->storage);
+    for(unsigned level = 0; level < HIST_LEVELS; level++){
+        for(unsigned run = 0; run < h->man.runs[level]; run++){
+            if(!storage_file_open(f, run_path(h, level, run), FSAM_READ, FSOM_OPEN_EXISTING)){
+                FURI_LOG_E(TAG, "missing run %s", h->path);
+                continue;
+            }
+            n = run_find(h, f, serial, n, max);
+            storage_file_close(f);
+        }
+    }
+    storage_file_free(f);
+
+    size_t got = 0;
+    for(size_t i = 0; i < n; i++){
+        if(log_read(h, h->found[i].recno, &out[got])) got++;
+    }
+    return got;
+}
+
+size_t history_since(History* h, uint32_t time, HistRecord* out, size_t max){
+    uint32_t lo = 0, hi = h->count;
+    HistRecord rec;
+    while(lo < hi){
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(!log_read(h, mid, &rec)) return 0;
+        if(rec.time < time) lo = mid + 1; else hi = mid;
+    }
+    size_t got = 0;
+    for(; got < max && lo < h->count; lo++){
+        if(!log_read(h, lo, &out[got])) break;
+        got++;
+    }
+    return got;
+}
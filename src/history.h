@@ -0,0 +1,32 @@
+#pragma once
+/* On-SD test history: every finished test is one HistRecord in an append-only
+ * log (hist_format.h), indexed by unit serial with small sorted runs that are
+ * merged level by level, so an append costs one record plus, every
+ * HIST_MEM appends, one short sequential run write. Main loop and CLI share
+ * a History under the caller's lock; nothing here is thread safe. */
+#include "hist_format.h"
+
+#include <stdbool.h>
+
+#define HISTORY_LOG_PATH  APP_DATA_PATH("history.log")
+#define HISTORY_MAN_PATH  APP_DATA_PATH("history.man")
+#define HISTORY_RUN_PATH  APP_DATA_PATH("hist_%u_%u.idx")
+
+#define HISTORY_FIND_MAX  16    /* max records per lookup */
+
+typedef struct History History;
+
+/* Opens (or creates) the log and re-indexes records newer than the runs */
+History* history_open(void);
+void history_close(History* h);
+
+/* Fills rec->crc; false if the log write failed */
+bool history_append(History* h, HistRecord* rec);
+
+/* Newest first, at most min(max, HISTORY_FIND_MAX) records */
+size_t history_by_serial(History* h, uint32_t serial, HistRecord* out, size_t max);
+
+/* Oldest first, from the first record with time >= `time` */
+size_t history_since(History* h, uint32_t time, HistRecord* out, size_t max);
+
+uint32_t history_count(const History* h);
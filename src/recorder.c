@@ -0,0 +1,190 @@
+#include "recorder.h"
+
+#include <furi.h>
+#include <furi_hal.h>
+#include <storage/storage.h>
+
+#define TAG "EmbracoRecorder"
+
+/* 8 KB holds >10 s of worst-case 100 Hz traffic; spills run every 2 s */
+#define RECORDER_RING_SIZE  8192U
+#define RECORDER_ROTATE_AT  (1024U * 1024U)
+
+struct Recorder {
+    uint8_t ring[RECORDER_RING_SIZE];
+    volatile uint32_t head;     /* producers (under critical section) */
+    volatile uint32_t tail;     /* consumer: recorder_spill */
+    uint32_t last_tick;         /* tick of the last record written */
+    ErcState last;              /* state as the decoder will see it */
+    ErcState cur;               /* latest sampled state (kept across drops) */
+    bool lost;                  /* records dropped: next append starts with a sync */
+    uint32_t dropped;
+
+    Storage* storage;
+    File* file;
+};
+
+/* Copy one encoded record into the ring; caller holds the critical section */
+static bool ring_put(Recorder* rec, const uint8_t* data, size_t len){
+    uint32_t used = rec->head - rec->tail;
+    if(RECORDER_RING_SIZE - used < len) return false;
+    for(size_t i = 0; i < len; i++){
+        rec->ring[(rec->head + i) % RECORDER_RING_SIZE] = data[i];
+    }
+    rec->head += (uint32_t)len;
+    return true;
+}
+
+/* After an overflow the decoder needs a full state before further deltas */
+static void resync_locked(Recorder* rec, uint32_t now){
+    uint8_t buf[ERC_REC_MAX];
+    size_t n = erc_encode_sync(buf, now - rec->last_tick, now, &rec->cur);
+    if(ring_put(rec, buf, n)){
+        rec->last = rec->cur;
+        rec->last_tick = now;
+        rec->lost = false;
+    }
+}
+
+static void append(Recorder* rec, const uint8_t* buf, size_t n, uint32_t now){
+    if(!ring_put(rec, buf, n)){
+        rec->lost = true;
+        rec->dropped++;
+        return;
+    }
+    rec->last_tick = now;
+}
+
+Recorder* recorder_alloc(const ErcState* initial){
+    Recorder* rec = malloc(sizeof(Recorder));
+    memset(rec, 0, sizeof(Recorder));
+    rec->cur = *initial;
+
+    uint8_t buf[ERC_REC_MAX];
+    uint32_t now = furi_get_tick();
+    rec->last_tick = now;
+    ring_put(rec, buf, erc_encode_session(buf, furi_hal_rtc_get_timestamp()));
+    resync_locked(rec, now);
+    return rec;
+}
+
+void recorder_state(Recorder* rec, const ErcState* st){
+    uint8_t buf[ERC_REC_MAX];
+    FURI_CRITICAL_ENTER();
+    uint32_t now = furi_get_tick();
+    rec->cur = *st;
+    if(rec->lost){
+        resync_locked(rec, now);
+    } else {
+        size_t n = erc_encode_state(buf, now - rec->last_tick, &rec->last, st);
+        if(n){
+            append(rec, buf, n, now);
+            if(!rec->lost) rec->last = *st;
+        }
+    }
+    FURI_CRITICAL_EXIT();
+}
+
+void recorder_input(Recorder* rec, uint8_t key, uint8_t type){
+    uint8_t buf[ERC_REC_MAX];
+    FURI_CRITICAL_ENTER();
+    uint32_t now = furi_get_tick();
+    if(rec->lost) resync_locked(rec, now);
+    if(!rec->lost) append(rec, buf, erc_encode_input(buf, now - rec->last_tick, key, type), now);
+    FURI_CRITICAL_EXIT();
+}
+
+void recorder_timer(Recorder* rec, ErcTimerId timer){
+    uint8_t buf[ERC_REC_MAX];
+    FURI_CRITICAL_ENTER();
+    uint32_t now = furi_get_tick();
+    if(rec->lost) resync_locked(rec, now);
+    if(!rec->lost) append(rec, buf, erc_encode_timer(buf, now - rec->last_tick, (uint8_t)timer), now);
+    FURI_CRITICAL_EXIT();
+}
+
+static bool recorder_open(Recorder* rec){
+    if(rec->file) return true;
+    rec->storage = furi_record_open(RECORD_STORAGE);
+    rec->file = storage_file_alloc(rec->storage);
+
+    /* one generation of rotation keeps the SD footprint bounded; a file
+     * that fills up while open is closed by recorder_spill and lands here */
+    if(storage_file_open(rec->file, RECORDER_PATH, FSAM_READ, FSOM_OPEN_EXISTING)){
+        uint64_t size = storage_file_size(rec->file);
+        storage_file_close(rec->file);
+        if(size >= RECORDER_ROTATE_AT){
+            storage_common_remove(rec->storage, RECORDER_OLD_PATH);
+            storage_common_rename(rec->storage, RECORDER_PATH, RECORDER_OLD_PATH);
+        }
+    }
+
+    if(!storage_file_open(rec->file, RECORDER_PATH, FSAM_WRITE, FSOM_OPEN_APPEND)){
+        FURI_LOG_E(TAG, "open %s failed", RECORDER_PATH);
+        storage_file_free(rec->file);
+        rec->file = NULL;
+        furi_record_close(RECORD_STORAGE);
+        rec->storage = NULL;
+        return false;
+    }
+    if(storage_file_size(rec->file) == 0){
+        storage_file_write(rec->file, ERC_MAGIC, ERC_MAGIC_LEN);
+    }
+    return true;
+}
+
+static void recorder_close(Recorder* rec){
+    if(!rec->file) return;
+    storage_file_close(rec->file);
+    storage_file_free(rec->file);
+    rec->file = NULL;
+    furi_record_close(RECORD_STORAGE);
+    rec->storage = NULL;
+}
+
+/* Single consumer: write [tail, head) in at most two contiguous chunks */
+static uint32_t write_range(Recorder* rec, uint32_t tail, uint32_t head){
+    while(tail != head){
+        uint32_t off = tail % RECORDER_RING_SIZE;
+        uint32_t len = head - tail;
+        if(len > RECORDER_RING_SIZE - off) len = RECORDER_RING_SIZE - off;
+        if(storage_file_write(rec->file, &rec->ring[off], len) != len){
+            FURI_LOG_E(TAG, "write failed");
+            break;
+        }
+        tail += len;
+    }
+    return tail;
+}
+
+/* The file is full: what was queued before the cut ends it, the next file
+ * starts with a session and a sync of its own (recorder_open rotates) */
+static void recorder_rotate(Recorder* rec){
+    uint8_t buf[ERC_REC_MAX];
+    uint32_t unix_time = furi_hal_rtc_get_timestamp();
+    uint32_t cut;
+    FURI_CRITICAL_ENTER();
+    cut = rec->head;
+    rec->lost = true;
+    if(ring_put(rec, buf, erc_encode_session(buf, unix_time))) resync_locked(rec, furi_get_tick());
+    FURI_CRITICAL_EXIT();
+    rec->tail = write_range(rec, rec->tail, cut);
+    recorder_close(rec);
+}
+
+void recorder_spill(Recorder* rec){
+    uint32_t head = rec->head;
+    if(head == rec->tail) return;
+    if(!recorder_open(rec)) return;
+
+    rec->tail = write_range(rec, rec->tail, head);
+    if(storage_file_size(rec->file) >= RECORDER_ROTATE_AT) recorder_rotate(rec);
+    if(rec->dropped) FURI_LOG_W(TAG, "%lu records dropped", (unsigned long)rec->dropped);
+    rec->dropped = 0;
+}
+
+void recorder_free(Recorder* rec){
+    recorder_spill(rec);
+    recorder_close(rec);
+    free(rec);
+}
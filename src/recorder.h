@@ -0,0 +1,25 @@
+#pragma once
+/* High-rate state recorder: delta/varint records (erc_format.h) into a RAM
+ * ring, spilled to SD from the main loop. Appends are safe from any thread
+ * (timer service, GUI, main loop) and cost a short critical section each. */
+#include "erc_format.h"
+
+#define RECORDER_PATH     APP_DATA_PATH("recorder.erc")
+#define RECORDER_OLD_PATH APP_DATA_PATH("recorder.old.erc")
+
+typedef struct Recorder Recorder;
+
+/* Starts a session (RTC time base + sync record); nothing touches SD yet */
+Recorder* recorder_alloc(const ErcState* initial);
+
+/* Final spill, closes the file */
+void recorder_free(Recorder* rec);
+
+/* Sampled state: writes a record only for fields that changed */
+void recorder_state(Recorder* rec, const ErcState* st);
+
+void recorder_input(Recorder* rec, uint8_t key, uint8_t type);
+void recorder_timer(Recorder* rec, ErcTimerId timer);
+
+/* Main loop only: append pending ring bytes to RECORDER_PATH */
+void recorder_spill(Recorder* rec);
@@ -0,0 +1,140 @@
+/* Host decoder / replay for Embraco Starter state recordings (.erc).
+ *
+ *   erc_decode recorder.erc          event timeline
+ *   erc_decode -s recorder.erc       replay: full state after every record (CSV)
+ *
+ * Times are seconds since the start of each recording session. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/erc_format.h"
+
+static const char* const kScreens[] = {"select", "menu", "help", "settings", "power"};
+static const char* const kKeys[] = {"Up", "Down", "Right", "Left", "Ok", "Back"};
+static const char* const kTypes[] = {"press", "release", "short", "long", "repeat"};
+static const char* const kTimers[ErcTimerCount] = {
+    "tick", "off", "hint", "display", "heartbeat", "power", "supervisor", "estop",
+};
+
+#define NAME(tab, i) (((size_t)(i) < sizeof(tab) / sizeof(tab[0])) ? tab[i] : "?")
+
+static void print_state(double t, const ErcState* st, const char* what){
+    printf("%.3f,%lu,%u,%lu,%s,%u,%s\n", t, (unsigned long)st->freq_hz, st->running,
+        (unsigned long)st->remaining_ms, NAME(kScreens, st->screen), st->active, what);
+}
+
+int main(int argc, char** argv){
+    int replay = 0;
+    const char* path = NULL;
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "-s")) replay = 1;
+        else path = argv[i];
+    }
+    if(!path){
+        fprintf(stderr, "usage: %s [-s] recorder.erc\n", argv[0]);
+        return 2;
+    }
+
+    FILE* f = fopen(path, "rb");
+    if(!f){
+        perror(path);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t* buf = malloc(size > 0 ? (size_t)size : 1);
+    if(fread(buf, 1, (size_t)size, f) != (size_t)size){
+        fprintf(stderr, "%s: read error\n", path);
+        return 1;
+    }
+    fclose(f);
+
+    if(size < ERC_MAGIC_LEN || memcmp(buf, ERC_MAGIC, ERC_MAGIC_LEN) != 0){
+        fprintf(stderr, "%s: not an .erc file\n", path);
+        return 1;
+    }
+
+    if(replay) printf("t_s,freq_hz,running,remaining_ms,screen,active,event\n");
+
+    size_t pos = ERC_MAGIC_LEN;
+    size_t len = (size_t)size;
+    uint64_t t_ms = 0;
+    ErcState st = {0};
+    unsigned sessions = 0;
+    unsigned long records = 0;
+    char what[48];
+
+    while(pos < len){
+        uint32_t hdr;
+        size_t k = erc_get_varint(buf + pos, len - pos, &hdr);
+        if(!k) break;
+        pos += k;
+        ErcRecType type = (ErcRecType)(hdr & 7U);
+        t_ms += hdr >> 3;
+        records++;
+
+        switch(type){
+            case ErcRecSession: {
+                uint32_t unix_time;
+                if(pos >= len || !(k = erc_get_varint(buf + pos + 1, len - pos - 1, &unix_time))) goto truncated;
+                uint8_t version = buf[pos];
+                pos += 1 + k;
+                t_ms = 0;
+                memset(&st, 0, sizeof(st));
+                sessions++;
+                if(!replay) printf("== session %u (format v%u, unix %lu)\n", sessions, version, (unsigned long)unix_time);
+                snprintf(what, sizeof(what), "session");
+            } break;
+            case ErcRecSync: {
+                uint32_t tick;
+                if(!(k = erc_get_varint(buf + pos, len - pos, &tick))) goto truncated;
+                pos += k;
+                memset(&st, 0, sizeof(st));
+                if(!(k = erc_get_fields(buf + pos, len - pos, &st))) goto truncated;
+                pos += k;
+                snprintf(what, sizeof(what), "sync tick=%lu", (unsigned long)tick);
+            } break;
+            case ErcRecState: {
+                if(!(k = erc_get_fields(buf + pos, len - pos, &st))) goto truncated;
+                pos += k;
+                snprintf(what, sizeof(what), "state");
+            } break;
+            case ErcRecInput: {
+                if(pos >= len) goto truncated;
+                uint8_t b = buf[pos++];
+                snprintf(what, sizeof(what), "input %s %s", NAME(kKeys, b >> 4), NAME(kTypes, b & 0x0FU));
+            } break;
+            case ErcRecTimer: {
+                if(pos >= len) goto truncated;
+                snprintf(what, sizeof(what), "timer %s", NAME(kTimers, buf[pos]));
+                pos++;
+            } break;
+            default:
+                fprintf(stderr, "unknown record type %u at offset %zu\n", (unsigned)type, pos - k);
+                free(buf);
+                return 1;
+        }
+
+        double t = (double)t_ms / 1000.0;
+        if(replay){
+            print_state(t, &st, what);
+        } else if(type == ErcRecState || type == ErcRecSync){
+            printf("%10.3f  %-16s freq=%luHz run=%u left=%lums screen=%s mode=%u\n", t, what,
+                (unsigned long)st.freq_hz, st.running, (unsigned long)st.remaining_ms,
+                NAME(kScreens, st.screen), st.active);
+        } else if(type != ErcRecSession){
+            printf("%10.3f  %s\n", t, what);
+        }
+    }
+
+    fprintf(stderr, "%lu records, %u sessions, %ld bytes\n", records, sessions, size);
+    free(buf);
+    return 0;
+
+truncated:
+    fprintf(stderr, "truncated record at offset %zu (recording still in RAM?)\n", pos);
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Flash/RAM footprint of every built variant (run after `ufbt` in src/).
+# A .fap is an ELF that the loader copies into RAM as a whole, so:
+#   fap   - file size on the SD card
+#   text  - code + const data (.text/.rodata)
+#   data/bss - initialised / zeroed statics
+#   ram   - text + data + bss: heap taken when the app is loaded
+# usage: tools/fap_size.sh [dist-dir]      SIZE=<path to arm-none-eabi-size>
+set -e
+
+DIST="${1:-src/dist}"
+SIZE="${SIZE:-arm-none-eabi-size}"
+
+printf '%-18s %8s %8s %8s %8s %8s\n' variant fap text data bss ram
+for f in "$DIST"/*.fap; do
+    [ -e "$f" ] || { echo "no .fap in $DIST" >&2; exit 1; }
+    "$SIZE" -B "$f" | awk -v name="$(basename "$f" .fap)" -v fap="$(wc -c < "$f")" \
+        'NR == 2 { printf "%-18s %8d %8d %8d %8d %8d\n", name, fap, $1, $2, $3, $1 + $2 + $3 }'
+done
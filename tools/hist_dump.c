@@ -0,0 +1,58 @@
+/* Host dump of the Embraco Starter test history (history.log, hist_format.h).
+ *
+ *   hist_dump history.log            every record, CSV
+ *   hist_dump -s 4242 history.log    one unit serial only
+ *
+ * Times are UTC as the Flipper RTC keeps them. A bad CRC ends the log, as on
+ * the device. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/hist_format.h"
+
+static const char* const kKinds[HistKindCount] = {"run", "burst", "sweep", "jitter"};
+static const char* const kResults[HistResultCount] = {"ok", "stop", "abort", "e-stop", "trip"};
+
+#define NAME(tab, i) (((size_t)(i) < sizeof(tab) / sizeof(tab[0])) ? tab[i] : "?")
+
+int main(int argc, char** argv){
+    const char* path = NULL;
+    long serial = -1;
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "-s") && i + 1 < argc) serial = strtol(argv[++i], NULL, 10);
+        else path = argv[i];
+    }
+    if(!path){
+        fprintf(stderr, "usage: %s [-s serial] history.log\n", argv[0]);
+        return 2;
+    }
+
+    FILE* f = fopen(path, "rb");
+    if(!f){
+        perror(path);
+        return 1;
+    }
+
+    printf("recno,time_utc,serial,unit,kind,mode,duration_s,result,value\n");
+    HistRecord r;
+    unsigned long recno = 0, shown = 0;
+    for(; fread(&r, sizeof(r), 1, f) == 1; recno++){
+        if(r.crc != hist_crc(&r, offsetof(HistRecord, crc))){
+            fprintf(stderr, "%s: bad CRC at record %lu, log ends there\n", path, recno);
+            break;
+        }
+        if(serial >= 0 && r.serial != (unsigned long)serial) continue;
+        char when[24];
+        time_t t = (time_t)r.time;
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", gmtime(&t));
+        printf("%lu,%s,%lu,%u,%s,%u,%lu,%s,%lu\n", recno, when, (unsigned long)r.serial, r.unit + 1U,
+            NAME(kKinds, r.kind), r.mode, (unsigned long)r.duration_s, NAME(kResults, r.result),
+            (unsigned long)r.value);
+        shown++;
+    }
+    fclose(f);
+    fprintf(stderr, "%lu of %lu records\n", shown, recno);
+    return 0;
+}
@@ -0,0 +1,560 @@
+/* Host profile sweep: runs the real app logic (sim/) through start profiles
+ * and checks every resulting PA7 waveform against compressor models.
+ *
+ *   profile_sim models.csv profiles.txt     listed profiles
+ *   profile_sim -g 5000 models.csv          5000 random profiles (-s seed)
+ *   options: -j threads (default: all cores), -q only FAIL lines and totals
+ *
+ * models.csv:   model,min_hz,max_hz,max_run_s,restart_s
+ * profiles.txt: one per line, "name step step ...", '#' comments. Steps:
+ *   M@secs    mode M (kModes[] index) held for secs
+ *   limit=0|1 run-time limit off/on (the app starts with it on)
+ *   off@secs  Power off (Hi-Z) for secs, then Power on
+ *
+ * Each profile is driven over the "embraco" CLI on its own simulated device,
+ * once; the trace is then checked against every model. Mode frequencies and
+ * time limits are read from the app itself at startup, not restated here.
+ *
+ *   FAIL    the app broke a rule: late/missing auto-off, wrong frequency,
+ *           PWM where none was commanded, unsafe pin after off/exit, leaks
+ *   WARN    the run-time limit cut a profile step short
+ *   REJECT  the profile is unsafe for a model: frequency out of range, run
+ *           longer than max_run_s, restart sooner than restart_s
+ * Exit status: 1 on any FAIL, 2 on REJECTs only, else 0. */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim/pool.h"
+#include "sim/sim.h"
+
+enum {
+    MAX_MODES      = 16,
+    MAX_CMDS       = 64,
+    TRACE_CAP      = 1024,
+    START_MS       = 500,       /* "on" after launch */
+    EXIT_DELAY_MS  = 500,
+    TOL_MS         = 20,        /* scheduling slack on every expected edge */
+    RESTART_GAP_MS = 100,       /* shorter PWM gaps are speed changes */
+};
+
+typedef struct {
+    char     name[32];
+    uint32_t min_hz, max_hz;
+    uint32_t max_run_s, restart_s;
+} Model;
+
+typedef enum { CmdOn, CmdOff, CmdMode, CmdLimit } CmdKind;
+
+typedef struct {
+    uint32_t at_ms;
+    CmdKind  kind;
+    int      arg;
+} Cmd;
+
+typedef struct {
+    char     name[32];
+    Cmd      cmds[MAX_CMDS];
+    size_t   n;
+    uint32_t end_ms;
+} Profile;
+
+typedef struct {
+    char*  buf;
+    size_t len, cap;
+    unsigned fails, warns, rejects;
+} Report;
+
+typedef struct {
+    const Profile* profiles;
+    const Model* models;
+    size_t model_count;
+    Report* reports;
+    unsigned* accepted;         /* [profile * model_count + model] */
+    uint64_t* sim_ms;
+} Sweep;
+
+/* kModes[] as the app reports it */
+static unsigned g_mode_count;
+static uint32_t g_mode_hz[MAX_MODES];
+static uint32_t g_mode_secs[MAX_MODES];
+
+static void report(Report* r, const char* fmt, ...){
+    va_list ap;
+    for(;;){
+        va_start(ap, fmt);
+        int n = vsnprintf(r->buf ? r->buf + r->len : NULL, r->buf ? r->cap - r->len : 0, fmt, ap);
+        va_end(ap);
+        if(n < 0) return;
+        if(r->buf && r->len + (size_t)n < r->cap){
+            r->len += (size_t)n;
+            return;
+        }
+        size_t cap = (r->cap ? r->cap * 2 : 256) + (size_t)n;
+        char* p = realloc(r->buf, cap);
+        if(!p) abort();
+        r->buf = p;
+        r->cap = cap;
+    }
+}
+
+/* ---------- Input ---------- */
+static size_t load_models(const char* path, Model** out){
+    FILE* f = fopen(path, "r");
+    if(!f){
+        perror(path);
+        exit(2);
+    }
+    size_t n = 0, cap = 0;
+    Model* m = NULL;
+    char line[256];
+    while(fgets(line, sizeof(line), f)){
+        if(line[0] == '#' || line[0] == '\n' || !strncmp(line, "model,", 6)) continue;
+        if(n == cap){
+            cap = cap ? cap * 2 : 16;
+            m = realloc(m, cap * sizeof(*m));
+            if(!m) abort();
+        }
+        Model* x = &m[n];
+        unsigned long lo, hi, run, rst;
+        if(sscanf(line, "%31[^,],%lu,%lu,%lu,%lu", x->name, &lo, &hi, &run, &rst) != 5){
+            fprintf(stderr, "%s: bad line: %s", path, line);
+            exit(2);
+        }
+        x->min_hz = (uint32_t)lo;
+        x->max_hz = (uint32_t)hi;
+        x->max_run_s = (uint32_t)run;
+        x->restart_s = (uint32_t)rst;
+        n++;
+    }
+    fclose(f);
+    *out = m;
+    return n;
+}
+
+static bool profile_add(Profile* p, uint32_t at_ms, CmdKind kind, int arg){
+    if(p->n >= MAX_CMDS) return false;
+    p->cmds[p->n++] = (Cmd){.at_ms = at_ms, .kind = kind, .arg = arg};
+    return true;
+}
+
+/* Parses "M@secs", "limit=0|1", "off@secs" tokens into timed commands */
+static bool profile_parse(Profile* p, char* line){
+    char* tok = strtok(line, " \t\r\n");
+    if(!tok) return false;
+    snprintf(p->name, sizeof(p->name), "%s", tok);
+    p->n = 0;
+    uint32_t t = START_MS;
+    profile_add(p, t, CmdOn, 0);
+    while((tok = strtok(NULL, " \t\r\n"))){
+        unsigned a, secs;
+        bool ok;
+        if(sscanf(tok, "limit=%u", &a) == 1 && a <= 1){
+            ok = profile_add(p, t, CmdLimit, (int)a);
+        } else if(sscanf(tok, "off@%u", &secs) == 1){
+            ok = profile_add(p, t, CmdOff, 0) && profile_add(p, t + secs * 1000U, CmdOn, 0);
+            t += secs * 1000U;
+        } else if(sscanf(tok, "%u@%u", &a, &secs) == 2 && a < g_mode_count){
+            ok = profile_add(p, t, CmdMode, (int)a);
+            t += secs * 1000U;
+        } else {
+            fprintf(stderr, "%s: bad step '%s'\n", p->name, tok);
+            return false;
+        }
+        if(!ok){
+            fprintf(stderr, "%s: more than %d steps\n", p->name, MAX_CMDS);
+            return false;
+        }
+    }
+    p->end_ms = t;
+    return profile_add(p, t, CmdOff, 0);
+}
+
+static size_t load_profiles(const char* path, Profile** out){
+    FILE* f = fopen(path, "r");
+    if(!f){
+        perror(path);
+        exit(2);
+    }
+    size_t n = 0, cap = 0;
+    Profile* p = NULL;
+    char line[1024];
+    while(fgets(line, sizeof(line), f)){
+        if(line[0] == '#' || strspn(line, " \t\r\n") == strlen(line)) continue;
+        if(n == cap){
+            cap = cap ? cap * 2 : 64;
+            p = realloc(p, cap * sizeof(*p));
+            if(!p) abort();
+        }
+        if(!profile_parse(&p[n], line)) exit(2);
+        n++;
+    }
+    fclose(f);
+    *out = p;
+    return n;
+}
+
+static size_t gen_profiles(size_t count, unsigned seed, Profile** out){
+    static const unsigned kSecs[] = {5, 10, 20, 30, 45, 60, 90, 150};
+    Profile* p = calloc(count, sizeof(*p));
+    if(!p) abort();
+    srand(seed);
+    for(size_t i = 0; i < count; i++){
+        char line[1024];
+        int n = snprintf(line, sizeof(line), "rand%05zu", i);
+        unsigned steps = 3 + (unsigned)rand() % 8;
+        for(unsigned k = 0; k < steps; k++){
+            unsigned r = (unsigned)rand() % 100;
+            unsigned secs = kSecs[(unsigned)rand() % (sizeof(kSecs) / sizeof(kSecs[0]))];
+            if(r < 10) n += snprintf(line + n, sizeof(line) - (size_t)n, " limit=%u", (unsigned)rand() % 2);
+            else if(r < 20) n += snprintf(line + n, sizeof(line) - (size_t)n, " off@%u", secs);
+            else n += snprintf(line + n, sizeof(line) - (size_t)n, " %u@%u", (unsigned)rand() % g_mode_count, secs);
+        }
+        profile_parse(&p[i], line);
+    }
+    *out = p;
+    return count;
+}
+
+/* ---------- Mode table from the app ---------- */
+static bool calibrate(void){
+    char usage[256], status[MAX_MODES][256];
+    SimStep steps[2 + 2 * MAX_MODES];
+    SimRun run = {.steps = steps, .step_count = 1};
+
+    /* "embraco" with no arguments prints "mode <0-N>" */
+    steps[0] = (SimStep){.at_ms = 100, .kind = SimStepCli, .args = "", .out = usage, .out_cap = sizeof(usage)};
+    sim_run(&run);
+    const char* m = strstr(usage, "mode <0-");
+    unsigned last;
+    if(run.status != SimOk || !m || sscanf(m, "mode <0-%u>", &last) != 1 || last >= MAX_MODES){
+        fprintf(stderr, "calibration: no mode range in CLI usage\n");
+        return false;
+    }
+    g_mode_count = last + 1;
+
+    static char args[MAX_MODES][16];
+    size_t n = 0;
+    steps[n++] = (SimStep){.at_ms = 100, .kind = SimStepCli, .args = "on"};
+    for(unsigned i = 0; i < g_mode_count; i++){
+        snprintf(args[i], sizeof(args[i]), "mode %u", i);
+        steps[n++] = (SimStep){.at_ms = 200 + i * 100, .kind = SimStepCli, .args = args[i]};
+        steps[n++] = (SimStep){.at_ms = 200 + i * 100, .kind = SimStepCli, .args = "status",
+            .out = status[i], .out_cap = sizeof(status[i])};
+    }
+    run = (SimRun){.steps = steps, .step_count = n};
+    sim_run(&run);
+    for(unsigned i = 0; i < g_mode_count; i++){
+        const char* hz = strstr(status[i], "pwm: ");
+        const char* left = strstr(status[i], "remaining: ");
+        unsigned long f, secs;
+        if(run.status != SimOk || !hz || !left || sscanf(hz, "pwm: %luHz", &f) != 1 ||
+           sscanf(left, "remaining: %lus", &secs) != 1){
+            fprintf(stderr, "calibration: no status for mode %u\n", i);
+            return false;
+        }
+        g_mode_hz[i] = (uint32_t)f;
+        g_mode_secs[i] = (uint32_t)secs;    /* limit is on at launch */
+    }
+    return true;
+}
+
+/* ---------- Checks ---------- */
+typedef struct {
+    uint32_t start, stop;
+    uint32_t hz;
+    bool     matched;
+} Segment;
+
+static size_t segments(const SimTrace* tr, size_t n, uint32_t end_ms, Segment* seg, size_t cap){
+    size_t k = 0;
+    bool on = false;
+    for(size_t i = 0; i < n; i++){
+        if(tr[i].kind == SimTracePwmStart && !on && k < cap){
+            seg[k] = (Segment){.start = tr[i].t_ms, .stop = end_ms, .hz = tr[i].arg};
+            on = true;
+        } else if(tr[i].kind == SimTracePwmStop && on){
+            seg[k++].stop = tr[i].t_ms;
+            on = false;
+        }
+    }
+    if(on) k++;
+    return k;
+}
+
+/* PA7 as of time t: 1 = PWM, 0 = LOW, -1 = Hi-Z */
+static int pa7_at(const SimTrace* tr, size_t n, uint32_t t){
+    int st = -1;
+    for(size_t i = 0; i < n && tr[i].t_ms <= t; i++){
+        if(tr[i].kind == SimTracePwmStart) st = 1;
+        else if(tr[i].kind == SimTracePinLow) st = 0;
+        else if(tr[i].kind == SimTracePinHiz) st = -1;
+    }
+    return st;
+}
+
+/* The app side: every mode command yields exactly the commanded PWM, ending
+ * at the next command or at the armed limit, whichever comes first */
+static void check_app(const Profile* p, const SimRun* run, const SimTrace* tr, Segment* seg, size_t nseg, Report* r){
+    size_t n = run->trace_len < TRACE_CAP ? run->trace_len : TRACE_CAP;
+    bool limit = true;
+
+    for(size_t i = 0; i < p->n; i++){
+        const Cmd* c = &p->cmds[i];
+        if(c->kind == CmdLimit){
+            limit = c->arg;
+            continue;
+        }
+        if(c->kind == CmdOff){
+            if(pa7_at(tr, n, c->at_ms + TOL_MS) != -1){
+                report(r, "FAIL %s: PA7 not Hi-Z after off at %.3fs\n", p->name, c->at_ms / 1000.0);
+                r->fails++;
+            }
+            continue;
+        }
+        if(c->kind != CmdMode || g_mode_hz[c->arg] == 0) continue;
+
+        /* planned end: the next command that touches the output */
+        uint32_t planned = p->end_ms;
+        size_t j = i + 1;
+        for(; j < p->n; j++){
+            if(p->cmds[j].kind == CmdMode || p->cmds[j].kind == CmdOff){
+                planned = p->cmds[j].at_ms;
+                break;
+            }
+        }
+        /* armed limit: re-armed by every "limit on", dropped by "limit off" */
+        uint32_t limit_ms = g_mode_secs[c->arg] * 1000U;
+        bool armed = limit && limit_ms;
+        uint32_t deadline = c->at_ms + limit_ms;
+        for(size_t k = i + 1; k < j; k++){
+            const Cmd* l = &p->cmds[k];
+            if(l->kind != CmdLimit || (armed && deadline <= l->at_ms)) continue;
+            armed = l->arg && limit_ms;
+            deadline = l->at_ms + limit_ms;
+        }
+        bool cut = armed && deadline < planned;
+        uint32_t expect = cut ? deadline : planned;
+
+        Segment* s = NULL;
+        for(size_t k = 0; k < nseg; k++){
+            if(!seg[k].matched && seg[k].start >= c->at_ms && seg[k].start <= c->at_ms + TOL_MS){
+                s = &seg[k];
+                break;
+            }
+        }
+        if(!s){
+            report(r, "FAIL %s: mode %d at %.3fs started no PWM\n", p->name, c->arg, c->at_ms / 1000.0);
+            r->fails++;
+            continue;
+        }
+        s->matched = true;
+        if(s->hz != g_mode_hz[c->arg]){
+            report(r, "FAIL %s: mode %d ran at %luHz, expected %luHz\n", p->name, c->arg,
+                (unsigned long)s->hz, (unsigned long)g_mode_hz[c->arg]);
+            r->fails++;
+        }
+        if(s->stop + TOL_MS < expect || s->stop > expect + TOL_MS){
+            report(r, "FAIL %s: mode %d from %.3fs stopped at %.3fs, expected %.3fs%s\n", p->name, c->arg,
+                c->at_ms / 1000.0, s->stop / 1000.0, expect / 1000.0, cut ? " (auto-off)" : "");
+            r->fails++;
+        } else if(cut){
+            if(pa7_at(tr, n, s->stop + TOL_MS) != 0){
+                report(r, "FAIL %s: auto-off at %.3fs did not hold PA7 LOW\n", p->name, s->stop / 1000.0);
+                r->fails++;
+            }
+            report(r, "WARN %s: limit cut mode %d after %lus of %.0fs\n", p->name, c->arg,
+                (unsigned long)(limit_ms / 1000U), (planned - c->at_ms) / 1000.0);
+            r->warns++;
+        }
+    }
+    for(size_t k = 0; k < nseg; k++){
+        if(seg[k].matched) continue;
+        report(r, "FAIL %s: uncommanded PWM %luHz at %.3fs\n", p->name, (unsigned long)seg[k].hz, seg[k].start / 1000.0);
+        r->fails++;
+    }
+
+    if(run->status != SimOk){
+        report(r, "FAIL %s: %s\n", p->name, run->error);
+        r->fails++;
+    }
+    if(run->double_starts){
+        report(r, "FAIL %s: PWM started %u times while running\n", p->name, run->double_starts);
+        r->fails++;
+    }
+    if(!run->pin_hiz || run->pwm_on){
+        report(r, "FAIL %s: PA7 not Hi-Z at exit\n", p->name);
+        r->fails++;
+    }
+    if(run->insomnia){
+        report(r, "FAIL %s: insomnia unbalanced (%ld)\n", p->name, (long)run->insomnia);
+        r->fails++;
+    }
+    if(run->live_blocks){
+        report(r, "FAIL %s: %u blocks / %u bytes leaked\n", p->name, run->live_blocks, run->live_bytes);
+        r->fails++;
+    }
+}
+
+/* The model side: speed changes (gaps < RESTART_GAP_MS) continue a run */
+static bool check_model(const Profile* p, const Model* m, const Segment* seg, size_t nseg, Report* r){
+    bool ok = true;
+    bool hz_bad = false, run_bad = false, rst_bad = false;
+    size_t first = 0;
+    for(size_t k = 0; k < nseg; k++){
+        if(!hz_bad && (seg[k].hz < m->min_hz || seg[k].hz > m->max_hz)){
+            report(r, "REJECT %s on %s: %luHz outside %lu-%luHz\n", p->name, m->name,
+                (unsigned long)seg[k].hz, (unsigned long)m->min_hz, (unsigned long)m->max_hz);
+            hz_bad = true;
+        }
+        bool last = (k + 1 == nseg) || (seg[k + 1].start - seg[k].stop >= RESTART_GAP_MS);
+        if(!last) continue;
+        uint32_t len = seg[k].stop - seg[first].start;
+        if(!run_bad && len > m->max_run_s * 1000U){
+            report(r, "REJECT %s on %s: %.1fs run from %.3fs, max %lus\n", p->name, m->name,
+                len / 1000.0, seg[first].start / 1000.0, (unsigned long)m->max_run_s);
+            run_bad = true;
+        }
+        if(!rst_bad && k + 1 < nseg && seg[k + 1].start - seg[k].stop < m->restart_s * 1000U){
+            report(r, "REJECT %s on %s: restart after %.1fs at %.3fs, needs %lus\n", p->name, m->name,
+                (seg[k + 1].start - seg[k].stop) / 1000.0, seg[k + 1].start / 1000.0, (unsigned long)m->restart_s);
+            rst_bad = true;
+        }
+        first = k + 1;
+    }
+    ok = !hz_bad && !run_bad && !rst_bad;
+    if(!ok) r->rejects++;
+    return ok;
+}
+
+static void sweep_job(size_t index, void* ctx){
+    Sweep* sw = ctx;
+    const Profile* p = &sw->profiles[index];
+    Report* r = &sw->reports[index];
+
+    static const char* const kLimit[] = {"limit off", "limit on"};
+    char args[MAX_CMDS][16];
+    SimStep steps[MAX_CMDS];
+    for(size_t i = 0; i < p->n; i++){
+        const Cmd* c = &p->cmds[i];
+        const char* a = "on";
+        if(c->kind == CmdOff) a = "off";
+        else if(c->kind == CmdLimit) a = kLimit[c->arg];
+        else if(c->kind == CmdMode){
+            snprintf(args[i], sizeof(args[i]), "mode %d", c->arg);
+            a = args[i];
+        }
+        steps[i] = (SimStep){.at_ms = c->at_ms, .kind = SimStepCli, .args = a};
+    }
+
+    SimTrace* tr = malloc(TRACE_CAP * sizeof(*tr));
+    Segment* seg = malloc(TRACE_CAP * sizeof(*seg));
+    if(!tr || !seg) abort();
+    SimRun run = {
+        .steps = steps,
+        .step_count = p->n,
+        .exit_at_ms = p->end_ms + EXIT_DELAY_MS,
+        .trace = tr,
+        .trace_cap = TRACE_CAP,
+    };
+    sim_run(&run);
+    sw->sim_ms[index] = run.end_ms;
+
+    size_t n = run.trace_len < TRACE_CAP ? run.trace_len : TRACE_CAP;
+    if(run.trace_len > TRACE_CAP){
+        report(r, "FAIL %s: trace overflow (%zu events)\n", p->name, run.trace_len);
+        r->fails++;
+    }
+    size_t nseg = segments(tr, n, run.end_ms, seg, TRACE_CAP);
+    check_app(p, &run, tr, seg, nseg, r);
+    for(size_t m = 0; m < sw->model_count; m++){
+        sw->accepted[index * sw->model_count + m] = check_model(p, &sw->models[m], seg, nseg, r);
+    }
+    free(seg);
+    free(tr);
+}
+
+static double now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv){
+    unsigned threads = 0, seed = 1;
+    size_t gen = 0;
+    bool quiet = false;
+    const char* paths[2] = {NULL, NULL};
+    int npaths = 0;
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "-j") && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-g") && i + 1 < argc) gen = (size_t)strtoul(argv[++i], NULL, 10);
+        else if(!strcmp(argv[i], "-s") && i + 1 < argc) seed = (unsigned)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-q")) quiet = true;
+        else if(npaths < 2 && argv[i][0] != '-') paths[npaths++] = argv[i];
+        else npaths = 3;
+    }
+    if(npaths < 1 || npaths > 2 || (npaths == 1 && !gen)){
+        fprintf(stderr, "usage: %s [-j threads] [-q] [-g count [-s seed]] models.csv [profiles.txt]\n", argv[0]);
+        return 2;
+    }
+    if(!calibrate()) return 1;
+
+    Model* models;
+    size_t model_count = load_models(paths[0], &models);
+    Profile* profiles;
+    size_t count = (npaths == 2) ? load_profiles(paths[1], &profiles) : gen_profiles(gen, seed, &profiles);
+    if(!model_count || !count){
+        fprintf(stderr, "nothing to do\n");
+        return 2;
+    }
+
+    Sweep sw = {
+        .profiles = profiles,
+        .models = models,
+        .model_count = model_count,
+        .reports = calloc(count, sizeof(Report)),
+        .accepted = calloc(count * model_count, sizeof(unsigned)),
+        .sim_ms = calloc(count, sizeof(uint64_t)),
+    };
+    if(!sw.reports || !sw.accepted || !sw.sim_ms) abort();
+
+    double t0 = now_s();
+    PoolStats ps = pool_run(count, threads, sweep_job, &sw);
+    double wall = now_s() - t0;
+
+    unsigned fails = 0, warns = 0, rejects = 0;
+    uint64_t sim_ms = 0;
+    for(size_t i = 0; i < count; i++){
+        Report* r = &sw.reports[i];
+        fails += r->fails;
+        warns += r->warns;
+        rejects += r->rejects;
+        sim_ms += sw.sim_ms[i];
+        if(!r->buf) continue;
+        for(char* line = strtok(r->buf, "\n"); line; line = strtok(NULL, "\n")){
+            if(!quiet || !strncmp(line, "FAIL", 4)) puts(line);
+        }
+        free(r->buf);
+    }
+
+    printf("\n%-20s %8s %8s\n", "model", "accepted", "rejected");
+    for(size_t m = 0; m < model_count; m++){
+        unsigned ok = 0;
+        for(size_t i = 0; i < count; i++) ok += sw.accepted[i * model_count + m];
+        printf("%-20s %8u %8zu\n", models[m].name, ok, count - ok);
+    }
+    printf("\n%zu profiles x %zu models = %zu combinations, %.1f h device time\n",
+        count, model_count, count * model_count, (double)sim_ms / 3.6e6);
+    printf("%u FAIL, %u WARN, %u REJECT\n", fails, warns, rejects);
+    printf("%.3f s wall on %u threads (%llu steals)\n", wall, ps.threads, (unsigned long long)ps.steals);
+
+    free(sw.sim_ms);
+    free(sw.accepted);
+    free(sw.reports);
+    free(profiles);
+    free(models);
+    return fails ? 1 : (rejects ? 2 : 0);
+}
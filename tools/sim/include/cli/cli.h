@@ -0,0 +1,10 @@
+#pragma once
+#include <furi.h>
+typedef struct Cli Cli;
+#define RECORD_CLI "cli"
+typedef enum { CliCommandFlagDefault = 0, CliCommandFlagParallelSafe = 1 } CliCommandFlag;
+typedef void (*CliCallback)(Cli*, FuriString*, void*);
+void cli_add_command(Cli*, const char*, CliCommandFlag, CliCallback, void*);
+void cli_delete_command(Cli*, const char*);
+bool cli_cmd_interrupt_received(Cli*);
+void cli_print_usage(const char*, const char*, const char*);
@@ -0,0 +1,120 @@
+#pragma once
+/* Host stand-in for the Furi subset used by the app (see ../sim.h).
+ * Declarations follow the firmware headers; behaviour lives in sim.c. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* every heap block of the app goes through the sim, for the allocation metrics */
+void* sim_malloc(size_t size);
+void sim_free(void* ptr);
+#define malloc sim_malloc
+#define free   sim_free
+/* CLI replies go to the step that sent the command (SimStep.out) */
+int sim_printf(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+#define printf sim_printf
+
+#define UNUSED(x) (void)(x)
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define furi_check(x)  do{ if(!(x)) sim_crash("furi_check failed: " #x); }while(0)
+#define furi_assert(x) furi_check(x)
+#define furi_crash(msg) sim_crash(msg)
+_Noreturn void sim_crash(const char* msg);
+
+#define FURI_LOG_E(tag, ...) ((void)(tag))
+#define FURI_LOG_W(tag, ...) ((void)(tag))
+#define FURI_LOG_I(tag, ...) ((void)(tag))
+#define FURI_LOG_D(tag, ...) ((void)(tag))
+
+/* one simulated core: there is nothing to mask */
+#define FURI_CRITICAL_ENTER() ((void)0)
+#define FURI_CRITICAL_EXIT()  ((void)0)
+
+#define FuriWaitForever 0xFFFFFFFFU
+
+typedef enum {
+    FuriStatusOk = 0,
+    FuriStatusError = -1,
+    FuriStatusErrorTimeout = -2,
+    FuriStatusErrorResource = -3,
+} FuriStatus;
+
+/* ---------- Kernel / time (1 tick = 1 ms of virtual time) ---------- */
+uint32_t furi_get_tick(void);
+uint32_t furi_ms_to_ticks(uint32_t ms);
+void furi_delay_ms(uint32_t ms);
+void furi_delay_us(uint32_t us);
+
+/* ---------- Message queue ---------- */
+typedef struct FuriMessageQueue FuriMessageQueue;
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size);
+void furi_message_queue_free(FuriMessageQueue* q);
+FuriStatus furi_message_queue_put(FuriMessageQueue* q, const void* msg, uint32_t timeout);
+FuriStatus furi_message_queue_get(FuriMessageQueue* q, void* msg, uint32_t timeout);
+uint32_t furi_message_queue_get_count(FuriMessageQueue* q);
+
+/* ---------- Timers ---------- */
+typedef struct FuriTimer FuriTimer;
+typedef enum { FuriTimerTypeOnce = 0, FuriTimerTypePeriodic = 1 } FuriTimerType;
+typedef void (*FuriTimerCallback)(void* context);
+FuriTimer* furi_timer_alloc(FuriTimerCallback cb, FuriTimerType type, void* context);
+void furi_timer_free(FuriTimer* t);
+FuriStatus furi_timer_start(FuriTimer* t, uint32_t ticks);
+FuriStatus furi_timer_restart(FuriTimer* t, uint32_t ticks);
+FuriStatus furi_timer_stop(FuriTimer* t);
+uint32_t furi_timer_is_running(FuriTimer* t);
+
+/* ---------- Mutex (one thread runs: a held mutex is never re-taken) ---------- */
+typedef struct FuriMutex FuriMutex;
+typedef enum { FuriMutexTypeNormal = 0, FuriMutexTypeRecursive = 1 } FuriMutexType;
+FuriMutex* furi_mutex_alloc(FuriMutexType type);
+void furi_mutex_free(FuriMutex* m);
+FuriStatus furi_mutex_acquire(FuriMutex* m, uint32_t timeout);
+FuriStatus furi_mutex_release(FuriMutex* m);
+
+/* ---------- Threads (one extra, a coroutine: see sim.h) ---------- */
+typedef struct FuriThread FuriThread;
+typedef void* FuriThreadId;
+typedef int32_t (*FuriThreadCallback)(void* context);
+typedef enum {
+    FuriThreadPriorityNormal = 16,
+    FuriThreadPriorityHigh = 17,
+    FuriThreadPriorityHighest = 18,
+} FuriThreadPriority;
+FuriThread* furi_thread_alloc_ex(const char* name, uint32_t stack, FuriThreadCallback cb, void* context);
+void furi_thread_free(FuriThread* t);
+void furi_thread_set_priority(FuriThread* t, FuriThreadPriority prio);
+void furi_thread_start(FuriThread* t);
+bool furi_thread_join(FuriThread* t);
+FuriThreadId furi_thread_get_id(FuriThread* t);
+FuriThreadId furi_thread_get_current_id(void);
+uint32_t furi_thread_get_stack_space(FuriThreadId id);
+#define FuriFlagWaitAny 0U
+#define FuriFlagError   0x80000000U
+#define FuriFlagErrorTimeout 0xFFFFFFFEU
+uint32_t furi_thread_flags_set(FuriThreadId id, uint32_t flags);
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+/* ---------- Records ---------- */
+void furi_record_create(const char* name, void* data);
+bool furi_record_destroy(const char* name);
+bool furi_record_exists(const char* name);
+void* furi_record_open(const char* name);
+void furi_record_close(const char* name);
+
+/* ---------- Strings ---------- */
+typedef struct FuriString FuriString;
+FuriString* furi_string_alloc(void);
+FuriString* furi_string_alloc_set_str(const char* s);
+void furi_string_free(FuriString* s);
+const char* furi_string_get_cstr(const FuriString* s);
+int furi_string_cmp_str(const FuriString* s, const char* cstr);
@@ -0,0 +1,128 @@
+#pragma once
+#include <furi.h>
+
+/* ---------- GPIO ---------- */
+typedef struct {
+    uint8_t id;                 /* index in the sim's pin table */
+} GpioPin;
+extern const GpioPin gpio_ext_pa7, gpio_ext_pa6, gpio_ext_pa4, gpio_ext_pb3, gpio_ext_pb2,
+    gpio_ext_pc3, gpio_ext_pc1, gpio_ext_pc0, gpio_usart_tx, gpio_usart_rx, gpio_ibutton, gpio_speaker;
+
+typedef enum {
+    GpioModeInput,
+    GpioModeOutputPushPull,
+    GpioModeOutputOpenDrain,
+    GpioModeAltFunctionPushPull,
+    GpioModeAnalog,
+    GpioModeInterruptRise,
+} GpioMode;
+typedef enum { GpioPullNo, GpioPullUp, GpioPullDown } GpioPull;
+typedef enum { GpioSpeedLow, GpioSpeedMedium, GpioSpeedHigh, GpioSpeedVeryHigh } GpioSpeed;
+typedef enum { GpioAltFn14TIM16 = 14 } GpioAltFn;
+void furi_hal_gpio_init(const GpioPin* pin, GpioMode mode, GpioPull pull, GpioSpeed speed);
+void furi_hal_gpio_init_ex(const GpioPin* pin, GpioMode mode, GpioPull pull, GpioSpeed speed, GpioAltFn alt_fn);
+void furi_hal_gpio_write(const GpioPin* pin, bool state);
+bool furi_hal_gpio_read(const GpioPin* pin);
+typedef void (*GpioExtiCallback)(void* ctx);
+void furi_hal_gpio_add_int_callback(const GpioPin* pin, GpioExtiCallback cb, void* ctx);
+void furi_hal_gpio_remove_int_callback(const GpioPin* pin);
+
+/* ---------- PWM ---------- */
+typedef enum { FuriHalPwmOutputIdTim1PA7, FuriHalPwmOutputIdLptim2PA4 } FuriHalPwmOutputId;
+void furi_hal_pwm_start(FuriHalPwmOutputId channel, uint32_t freq, uint8_t duty);
+void furi_hal_pwm_stop(FuriHalPwmOutputId channel);
+void furi_hal_pwm_set_params(FuriHalPwmOutputId channel, uint32_t freq, uint8_t duty);
+
+/* ---------- Peripheral clocks ---------- */
+typedef enum { FuriHalBusTIM1, FuriHalBusTIM2, FuriHalBusTIM16 } FuriHalBus;
+void furi_hal_bus_enable(FuriHalBus bus);
+void furi_hal_bus_disable(FuriHalBus bus);
+bool furi_hal_bus_is_enabled(FuriHalBus bus);
+
+/* ---------- Interrupts ---------- */
+typedef enum { FuriHalInterruptIdTim1UpTim16 } FuriHalInterruptId;
+typedef void (*FuriHalInterruptISR)(void* context);
+void furi_hal_interrupt_set_isr(FuriHalInterruptId index, FuriHalInterruptISR isr, void* context);
+
+/* ---------- Speaker (owner of TIM16: bus clock + PB8) ---------- */
+bool furi_hal_speaker_acquire(uint32_t timeout);
+void furi_hal_speaker_release(void);
+
+/* ---------- Bluetooth extra beacon (advertised by the radio core) ---------- */
+#define EXTRA_BEACON_MAX_DATA_SIZE 31
+#define EXTRA_BEACON_MAC_ADDR_SIZE 6
+typedef enum { GapAdvChannelMap37 = 0x1, GapAdvChannelMap38 = 0x2, GapAdvChannelMap39 = 0x4, GapAdvChannelMapAll = 0x7 } GapAdvChannelMap;
+typedef enum { GapAdvPowerLevel_Neg40dBm = 0x00, GapAdvPowerLevel_0dBm = 0x19, GapAdvPowerLevel_6dBm = 0x1F } GapAdvPowerLevelInd;
+typedef enum { GapAddressTypePublic = 0, GapAddressTypeRandom = 1 } GapAddressType;
+typedef struct {
+    uint16_t min_adv_interval_ms, max_adv_interval_ms;
+    GapAdvChannelMap adv_channel_map;
+    GapAdvPowerLevelInd adv_power_level;
+    GapAddressType address_type;
+    uint8_t address[EXTRA_BEACON_MAC_ADDR_SIZE];
+} GapExtraBeaconConfig;
+bool furi_hal_bt_extra_beacon_set_config(const GapExtraBeaconConfig* config);
+bool furi_hal_bt_extra_beacon_set_data(const uint8_t* data, uint8_t len);
+bool furi_hal_bt_extra_beacon_start(void);
+bool furi_hal_bt_extra_beacon_stop(void);
+bool furi_hal_bt_extra_beacon_is_active(void);
+
+/* ---------- I2C (external bus: SCL C0, SDA C1) ---------- */
+typedef struct FuriHalI2cBusHandle { int unused; } FuriHalI2cBusHandle;
+extern FuriHalI2cBusHandle furi_hal_i2c_handle_external;
+void furi_hal_i2c_acquire(FuriHalI2cBusHandle* handle);
+void furi_hal_i2c_release(FuriHalI2cBusHandle* handle);
+bool furi_hal_i2c_is_device_ready(FuriHalI2cBusHandle* handle, uint8_t i2c_addr, uint32_t timeout);
+bool furi_hal_i2c_read_reg_8(FuriHalI2cBusHandle* handle, uint8_t i2c_addr, uint8_t reg_addr, uint8_t* data, uint32_t timeout);
+bool furi_hal_i2c_write_reg_8(FuriHalI2cBusHandle* handle, uint8_t i2c_addr, uint8_t reg_addr, uint8_t data, uint32_t timeout);
+bool furi_hal_i2c_read_mem(FuriHalI2cBusHandle* handle, uint8_t i2c_addr, uint8_t mem_addr, uint8_t* data, size_t len, uint32_t timeout);
+
+/* ---------- ADC ---------- */
+typedef struct FuriHalAdcHandle { int unused; } FuriHalAdcHandle;
+typedef enum { FuriHalAdcScale2048, FuriHalAdcScale2500 } FuriHalAdcScale;
+typedef enum { FuriHalAdcClockSync16, FuriHalAdcClockSync32, FuriHalAdcClockSync64 } FuriHalAdcClock;
+typedef enum {
+    FuriHalAdcOversampleNone, FuriHalAdcOversample2, FuriHalAdcOversample4, FuriHalAdcOversample8,
+    FuriHalAdcOversample16, FuriHalAdcOversample32, FuriHalAdcOversample64, FuriHalAdcOversample128,
+    FuriHalAdcOversample256,
+} FuriHalAdcOversample;
+typedef enum {
+    FuriHalAdcSamplingtime2_5, FuriHalAdcSamplingtime6_5, FuriHalAdcSamplingtime12_5, FuriHalAdcSamplingtime24_5,
+    FuriHalAdcSamplingtime47_5, FuriHalAdcSamplingtime92_5, FuriHalAdcSamplingtime247_5, FuriHalAdcSamplingtime640_5,
+} FuriHalAdcSamplingTime;
+FuriHalAdcHandle* furi_hal_adc_acquire(void);
+void furi_hal_adc_release(FuriHalAdcHandle* handle);
+void furi_hal_adc_configure_ex(FuriHalAdcHandle* handle, FuriHalAdcScale scale, FuriHalAdcClock clock,
+    FuriHalAdcOversample oversample, FuriHalAdcSamplingTime sampling_time);
+
+/* ---------- Power ---------- */
+typedef enum { FuriHalPowerICCharger, FuriHalPowerICFuelGauge } FuriHalPowerIC;
+float furi_hal_power_get_battery_current(FuriHalPowerIC ic);
+float furi_hal_power_get_battery_voltage(FuriHalPowerIC ic);
+uint8_t furi_hal_power_get_pct(void);
+uint32_t furi_hal_power_get_battery_remaining_capacity(void);
+bool furi_hal_power_is_charging(void);
+void furi_hal_power_insomnia_enter(void);
+void furi_hal_power_insomnia_exit(void);
+
+/* ---------- RTC / cycle counter ---------- */
+typedef struct {
+    uint8_t hour, minute, second;
+    uint8_t day, month;
+    uint16_t year;
+    uint8_t weekday;            /* 1 = Monday */
+} DateTime;
+typedef void (*FuriHalRtcAlarmCallback)(void* context);
+uint32_t furi_hal_rtc_get_timestamp(void);
+void furi_hal_rtc_get_datetime(DateTime* datetime);
+uint32_t datetime_datetime_to_timestamp(DateTime* datetime);
+void datetime_timestamp_to_datetime(uint32_t timestamp, DateTime* datetime);
+void furi_hal_rtc_set_alarm(const DateTime* datetime, bool enabled);      /* daily: matches h:m:s */
+void furi_hal_rtc_set_alarm_callback(FuriHalRtcAlarmCallback callback, void* context);
+uint32_t furi_hal_cortex_instructions_per_microsecond(void);
+
+typedef struct {
+    volatile uint32_t CYCCNT;
+} SimDwt;
+SimDwt* sim_dwt(void);          /* CYCCNT follows the virtual clock */
+#define DWT (sim_dwt())
@@ -0,0 +1,21 @@
+#pragma once
+#include <furi.h>
+typedef struct Canvas Canvas;
+typedef enum { FontPrimary, FontSecondary, FontKeyboard, FontBigNumbers } Font;
+typedef enum { ColorWhite, ColorBlack, ColorXOR } Color;
+typedef enum { AlignLeft, AlignRight, AlignTop, AlignBottom, AlignCenter } Align;
+void canvas_clear(Canvas*);
+void canvas_set_font(Canvas*, Font);
+void canvas_set_color(Canvas*, Color);
+void canvas_draw_str(Canvas*, int32_t, int32_t, const char*);
+void canvas_draw_str_aligned(Canvas*, int32_t, int32_t, Align, Align, const char*);
+uint16_t canvas_string_width(Canvas*, const char*);
+void canvas_draw_dot(Canvas*, int32_t, int32_t);
+void canvas_draw_box(Canvas*, int32_t, int32_t, size_t, size_t);
+void canvas_draw_frame(Canvas*, int32_t, int32_t, size_t, size_t);
+void canvas_draw_rframe(Canvas*, int32_t, int32_t, size_t, size_t, size_t);
+void canvas_draw_rbox(Canvas*, int32_t, int32_t, size_t, size_t, size_t);
+void canvas_draw_line(Canvas*, int32_t, int32_t, int32_t, int32_t);
+void canvas_draw_xbm(Canvas*, int32_t, int32_t, size_t, size_t, const uint8_t*);
+size_t canvas_width(const Canvas*);
+size_t canvas_height(const Canvas*);
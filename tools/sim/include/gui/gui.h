@@ -0,0 +1,8 @@
+#pragma once
+#include <gui/view_port.h>
+typedef struct Gui Gui;
+#define RECORD_GUI "gui"
+typedef enum { GuiLayerDesktop, GuiLayerWindow, GuiLayerStatusBarLeft, GuiLayerStatusBarRight, GuiLayerFullscreen } GuiLayer;
+void gui_add_view_port(Gui*, ViewPort*, GuiLayer);
+void gui_remove_view_port(Gui*, ViewPort*);
+void gui_view_port_send_to_front(Gui*, ViewPort*);
@@ -0,0 +1,13 @@
+#pragma once
+#include <gui/canvas.h>
+#include <input/input.h>
+typedef struct ViewPort ViewPort;
+typedef void (*ViewPortDrawCallback)(Canvas*, void*);
+typedef void (*ViewPortInputCallback)(InputEvent*, void*);
+ViewPort* view_port_alloc(void);
+void view_port_free(ViewPort*);
+void view_port_draw_callback_set(ViewPort*, ViewPortDrawCallback, void*);
+void view_port_input_callback_set(ViewPort*, ViewPortInputCallback, void*);
+void view_port_update(ViewPort*);
+void view_port_enabled_set(ViewPort*, bool);
+void view_port_set_width(ViewPort*, uint8_t);
@@ -0,0 +1,11 @@
+#pragma once
+#include <furi.h>
+typedef enum { InputKeyUp, InputKeyDown, InputKeyRight, InputKeyLeft, InputKeyOk, InputKeyBack, InputKeyMAX } InputKey;
+typedef enum { InputTypePress, InputTypeRelease, InputTypeShort, InputTypeLong, InputTypeRepeat, InputTypeMAX } InputType;
+typedef struct { uint32_t sequence; InputKey key; InputType type; } InputEvent;
+#define RECORD_INPUT_EVENTS "input_events"
+typedef struct FuriPubSub FuriPubSub;
+typedef struct FuriPubSubSubscription FuriPubSubSubscription;
+typedef void (*FuriPubSubCallback)(const void*, void*);
+FuriPubSubSubscription* furi_pubsub_subscribe(FuriPubSub*, FuriPubSubCallback, void*);
+void furi_pubsub_unsubscribe(FuriPubSub*, FuriPubSubSubscription*);
@@ -0,0 +1,9 @@
+#pragma once
+#include <furi.h>
+typedef struct NotificationApp NotificationApp;
+#define RECORD_NOTIFICATION "notification"
+typedef struct NotificationMessage NotificationMessage;
+typedef const NotificationMessage* NotificationSequence[];
+void notification_message(NotificationApp*, const NotificationSequence*);
+void notification_message_block(NotificationApp*, const NotificationSequence*);
+void notification_internal_message(NotificationApp*, const NotificationSequence*);
@@ -0,0 +1,12 @@
+#pragma once
+#include <notification/notification.h>
+typedef enum { LightRed = 1, LightGreen = 2, LightBlue = 4, LightBacklight = 8 } Light;
+typedef enum { NotificationMessageTypeLedBlinkStart, NotificationMessageTypeLedBlinkStop, NotificationMessageTypeLedBlinkColor, NotificationMessageTypeForceDisplayBrightnessSetting, NotificationMessageTypeLedDisplayBacklight, NotificationMessageTypeDelay, NotificationMessageTypeDoNotReset } NotificationMessageType;
+typedef struct { uint8_t value; } NotificationMessageDataLed;
+typedef struct { uint16_t on_time; uint16_t period; Light color; } NotificationMessageDataLedBlink;
+typedef struct { uint32_t length; } NotificationMessageDataDelay;
+typedef struct { float speaker_volume; bool vibro; float display_brightness; } NotificationMessageDataForcedSettings;
+typedef union { NotificationMessageDataLed led; NotificationMessageDataLedBlink led_blink; NotificationMessageDataDelay delay; NotificationMessageDataForcedSettings forced_settings; } NotificationMessageData;
+struct NotificationMessage { NotificationMessageType type; NotificationMessageData data; };
+extern const NotificationMessage message_blink_stop, message_blink_set_color_green, message_display_backlight_on, message_display_backlight_off, message_display_backlight_enforce_on, message_display_backlight_enforce_auto, message_do_not_reset, message_green_255, message_green_0, message_force_display_brightness_setting_1f;
+extern const NotificationSequence sequence_set_green_255, sequence_reset_rgb, sequence_display_backlight_on, sequence_display_backlight_off, sequence_blink_stop, sequence_reset_green, sequence_display_backlight_enforce_on, sequence_display_backlight_enforce_auto;
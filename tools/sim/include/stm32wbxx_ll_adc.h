@@ -0,0 +1,32 @@
+#pragma once
+/* ADC1 as the pressure scan drives it: configuration is accepted, and only
+ * the start/stop order against the HAL handle is checked */
+#include <stdint.h>
+
+typedef struct SimAdc ADC_TypeDef;
+extern ADC_TypeDef* const ADC1;
+
+#define LL_ADC_REG_SEQ_SCAN_DISABLE         0U
+#define LL_ADC_REG_SEQ_SCAN_ENABLE_2RANKS   1U
+#define LL_ADC_REG_RANK_1                   6U
+#define LL_ADC_REG_RANK_2                   12U
+#define LL_ADC_CHANNEL_4                    4U
+#define LL_ADC_CHANNEL_9                    9U
+#define LL_ADC_SAMPLINGTIME_640CYCLES_5     7U
+#define LL_ADC_REG_CONV_SINGLE              0U
+#define LL_ADC_REG_CONV_CONTINUOUS          1U
+#define LL_ADC_REG_OVR_DATA_OVERWRITTEN     1U
+#define LL_ADC_REG_DMA_TRANSFER_NONE        0U
+#define LL_ADC_REG_DMA_TRANSFER_UNLIMITED   3U
+#define LL_ADC_DMA_REG_REGULAR_DATA         0U
+
+void LL_ADC_REG_SetSequencerLength(ADC_TypeDef* adc, uint32_t len);
+void LL_ADC_REG_SetSequencerRanks(ADC_TypeDef* adc, uint32_t rank, uint32_t channel);
+void LL_ADC_SetChannelSamplingTime(ADC_TypeDef* adc, uint32_t channel, uint32_t time);
+void LL_ADC_REG_SetContinuousMode(ADC_TypeDef* adc, uint32_t mode);
+void LL_ADC_REG_SetOverrun(ADC_TypeDef* adc, uint32_t mode);
+void LL_ADC_REG_SetDMATransfer(ADC_TypeDef* adc, uint32_t mode);
+uint32_t LL_ADC_DMA_GetRegAddr(ADC_TypeDef* adc, uint32_t reg);
+void LL_ADC_REG_StartConversion(ADC_TypeDef* adc);
+void LL_ADC_REG_StopConversion(ADC_TypeDef* adc);
+uint32_t LL_ADC_REG_IsStopConversionOngoing(ADC_TypeDef* adc);
@@ -0,0 +1,34 @@
+#pragma once
+/* DMA channels as used by the app. Addresses are 32-bit on the target and
+ * cannot carry a host pointer, so transfers are tracked but never performed:
+ * a DMA target keeps whatever the app put there. */
+#include <stdint.h>
+
+typedef struct SimDma DMA_TypeDef;
+extern DMA_TypeDef* const DMA1;
+extern DMA_TypeDef* const DMA2;
+
+#define LL_DMA_CHANNEL_6                    5U
+#define LL_DMA_CHANNEL_7                    6U
+#define LL_DMA_DIRECTION_PERIPH_TO_MEMORY   0U
+#define LL_DMA_MODE_CIRCULAR                0x20U
+#define LL_DMA_PERIPH_NOINCREMENT           0U
+#define LL_DMA_MEMORY_INCREMENT             0x80U
+#define LL_DMA_PDATAALIGN_HALFWORD          0x100U
+#define LL_DMA_MDATAALIGN_HALFWORD          0x400U
+#define LL_DMA_DIRECTION_MEMORY_TO_PERIPH   0x10U
+#define LL_DMA_MODE_NORMAL                  0U
+#define LL_DMA_MEMORY_NOINCREMENT           0U
+#define LL_DMA_PDATAALIGN_WORD              0x200U
+#define LL_DMA_MDATAALIGN_WORD              0x800U
+#define LL_DMA_PRIORITY_LOW                 0U
+#define LL_DMA_PRIORITY_HIGH                0x2000U
+#define LL_DMAMUX_REQ_ADC1                  5U
+#define LL_DMAMUX_REQ_TIM1_UP               0x2CU
+
+void LL_DMA_ConfigTransfer(DMA_TypeDef* dma, uint32_t channel, uint32_t config);
+void LL_DMA_ConfigAddresses(DMA_TypeDef* dma, uint32_t channel, uint32_t src, uint32_t dst, uint32_t direction);
+void LL_DMA_SetDataLength(DMA_TypeDef* dma, uint32_t channel, uint32_t len);
+void LL_DMA_SetPeriphRequest(DMA_TypeDef* dma, uint32_t channel, uint32_t request);
+void LL_DMA_EnableChannel(DMA_TypeDef* dma, uint32_t channel);
+void LL_DMA_DisableChannel(DMA_TypeDef* dma, uint32_t channel);
@@ -0,0 +1,63 @@
+#pragma once
+/* TIM1 as seen by furi_hal_pwm in the sim (enable state and mode only),
+ * TIM2 as the odometer's slave counter of TIM1 update events and TIM16 CH1
+ * as an input capture of PA7's rising edges (SimRun.loopback) */
+#include <stdint.h>
+
+typedef struct SimTim {
+    volatile uint32_t BDTR;         /* storage only: see LL_TIM_SetOffStates */
+} TIM_TypeDef;
+extern TIM_TypeDef* const TIM1;
+extern TIM_TypeDef* const TIM2;
+extern TIM_TypeDef* const TIM16;
+
+#define LL_TIM_CHANNEL_CH1             1U
+#define LL_TIM_OCMODE_PWM1             0x60U
+#define LL_TIM_OCMODE_PWM2             0x70U
+#define LL_TIM_ONEPULSEMODE_SINGLE     1U
+#define LL_TIM_ONEPULSEMODE_REPETITIVE 0U
+#define LL_TIM_TRGO_RESET              0U
+#define LL_TIM_TRGO_UPDATE             0x20U
+#define LL_TIM_TS_ITR0                 0U
+#define LL_TIM_CLOCKSOURCE_INTERNAL    0U
+#define LL_TIM_CLOCKSOURCE_EXT_MODE1   7U
+#define LL_TIM_ACTIVEINPUT_DIRECTTI    1U
+#define LL_TIM_ICPSC_DIV1              0U
+#define LL_TIM_IC_FILTER_FDIV1         0U
+#define LL_TIM_IC_POLARITY_RISING      0U
+#define LL_TIM_OSSI_DISABLE            0U
+#define LL_TIM_OSSR_DISABLE            0U
+#define TIM_BDTR_MOE                   0x8000U
+
+void LL_TIM_EnableCounter(TIM_TypeDef* tim);
+void LL_TIM_DisableCounter(TIM_TypeDef* tim);
+uint32_t LL_TIM_IsEnabledCounter(TIM_TypeDef* tim);
+void LL_TIM_DisableAllOutputs(TIM_TypeDef* tim);
+void LL_TIM_OC_SetMode(TIM_TypeDef* tim, uint32_t channel, uint32_t mode);
+void LL_TIM_SetRepetitionCounter(TIM_TypeDef* tim, uint32_t rcr);
+void LL_TIM_SetOnePulseMode(TIM_TypeDef* tim, uint32_t mode);
+void LL_TIM_GenerateEvent_UPDATE(TIM_TypeDef* tim);
+void LL_TIM_ClearFlag_UPDATE(TIM_TypeDef* tim);
+void LL_TIM_ClearFlag_CC1(TIM_TypeDef* tim);
+uint32_t LL_TIM_IsActiveFlag_CC1(TIM_TypeDef* tim);
+void LL_TIM_SetTriggerOutput(TIM_TypeDef* tim, uint32_t trgo);
+void LL_TIM_SetTriggerInput(TIM_TypeDef* tim, uint32_t ts);
+void LL_TIM_SetClockSource(TIM_TypeDef* tim, uint32_t source);
+void LL_TIM_SetPrescaler(TIM_TypeDef* tim, uint32_t psc);
+void LL_TIM_SetAutoReload(TIM_TypeDef* tim, uint32_t arr);
+void LL_TIM_SetCounter(TIM_TypeDef* tim, uint32_t cnt);
+uint32_t LL_TIM_GetCounter(TIM_TypeDef* tim);
+void LL_TIM_IC_SetActiveInput(TIM_TypeDef* tim, uint32_t channel, uint32_t input);
+void LL_TIM_IC_SetPrescaler(TIM_TypeDef* tim, uint32_t channel, uint32_t psc);
+void LL_TIM_IC_SetFilter(TIM_TypeDef* tim, uint32_t channel, uint32_t filter);
+void LL_TIM_IC_SetPolarity(TIM_TypeDef* tim, uint32_t channel, uint32_t polarity);
+uint32_t LL_TIM_IC_GetCaptureCH1(TIM_TypeDef* tim);
+void LL_TIM_CC_EnableChannel(TIM_TypeDef* tim, uint32_t channels);
+void LL_TIM_CC_DisableChannel(TIM_TypeDef* tim, uint32_t channels);
+void LL_TIM_EnableIT_CC1(TIM_TypeDef* tim);
+void LL_TIM_DisableIT_CC1(TIM_TypeDef* tim);
+uint32_t LL_TIM_IsActiveFlag_CC1OVR(TIM_TypeDef* tim);
+void LL_TIM_ClearFlag_CC1OVR(TIM_TypeDef* tim);
+void LL_TIM_SetOffStates(TIM_TypeDef* tim, uint32_t ossi, uint32_t ossr);
+void LL_TIM_EnableDMAReq_UPDATE(TIM_TypeDef* tim);
+void LL_TIM_DisableDMAReq_UPDATE(TIM_TypeDef* tim);
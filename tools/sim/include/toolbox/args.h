@@ -0,0 +1,4 @@
+#pragma once
+#include <furi.h>
+bool args_read_string_and_trim(FuriString*, FuriString*);
+bool args_read_int_and_trim(FuriString*, int*);
@@ -0,0 +1,4 @@
+#pragma once
+#include <furi.h>
+bool saved_struct_load(const char*, void*, size_t, uint8_t, uint8_t);
+bool saved_struct_save(const char*, const void*, size_t, uint8_t, uint8_t);
@@ -0,0 +1,110 @@
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct Pool Pool;
+
+typedef struct {
+    pthread_mutex_t lock;
+    size_t lo, hi;              /* pending range [lo, hi) */
+    uint64_t steals;
+    unsigned id;
+    Pool* pool;
+} Worker;
+
+struct Pool {
+    Worker* workers;
+    unsigned n;
+    PoolJob job;
+    void* ctx;
+};
+
+unsigned pool_default_threads(void){
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (unsigned)n : 1U;
+}
+
+static bool take_own(Worker* w, size_t* index){
+    bool ok = false;
+    pthread_mutex_lock(&w->lock);
+    if(w->lo < w->hi){
+        *index = w->lo++;
+        ok = true;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return ok;
+}
+
+/* Moves the back half of some victim's range into w; false once all are empty */
+static bool steal(Worker* w){
+    Pool* p = w->pool;
+    for(unsigned k = 1; k < p->n; k++){
+        Worker* v = &p->workers[(w->id + k) % p->n];
+        pthread_mutex_lock(&v->lock);
+        size_t left = v->hi - v->lo;
+        if(left == 0){
+            pthread_mutex_unlock(&v->lock);
+            continue;
+        }
+        size_t mid = v->hi - (left + 1) / 2;
+        size_t hi = v->hi;
+        v->hi = mid;
+        pthread_mutex_unlock(&v->lock);
+
+        pthread_mutex_lock(&w->lock);
+        w->lo = mid;
+        w->hi = hi;
+        w->steals++;
+        pthread_mutex_unlock(&w->lock);
+        return true;
+    }
+    return false;
+}
+
+static void* worker_main(void* arg){
+    Worker* w = arg;
+    size_t index;
+    for(;;){
+        while(take_own(w, &index)) w->pool->job(index, w->pool->ctx);
+        /* no job ever creates work, so one empty sweep means we are done */
+        if(!steal(w)) break;
+    }
+    return NULL;
+}
+
+PoolStats pool_run(size_t count, unsigned threads, PoolJob job, void* ctx){
+    PoolStats st = {.threads = threads ? threads : pool_default_threads()};
+    if(count && st.threads > count) st.threads = (unsigned)count;
+    if(!st.threads) st.threads = 1;
+
+    Pool p = {.n = st.threads, .job = job, .ctx = ctx};
+    p.workers = calloc(p.n, sizeof(Worker));
+    pthread_t* tid = calloc(p.n, sizeof(pthread_t));
+    if(!p.workers || !tid) abort();
+
+    for(unsigned i = 0; i < p.n; i++){
+        Worker* w = &p.workers[i];
+        pthread_mutex_init(&w->lock, NULL);
+        w->id = i;
+        w->pool = &p;
+        w->lo = count * i / p.n;
+        w->hi = count * (i + 1) / p.n;
+    }
+    /* worker 0 is the calling thread */
+    for(unsigned i = 1; i < p.n; i++){
+        if(pthread_create(&tid[i], NULL, worker_main, &p.workers[i]) != 0) abort();
+    }
+    worker_main(&p.workers[0]);
+    for(unsigned i = 1; i < p.n; i++) pthread_join(tid[i], NULL);
+
+    for(unsigned i = 0; i < p.n; i++){
+        st.steals += p.workers[i].steals;
+        pthread_mutex_destroy(&p.workers[i].lock);
+    }
+    free(tid);
+    free(p.workers);
+    return st;
+}
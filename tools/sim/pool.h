@@ -0,0 +1,20 @@
+#pragma once
+/* Work-stealing pool for embarrassingly parallel sweeps.
+ * Jobs are the indices [0, count). Each worker starts with an equal slice and
+ * takes from its front; a worker that runs dry steals the back half of the
+ * next non-empty worker's range, so a few slow jobs do not leave cores idle. */
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void (*PoolJob)(size_t index, void* ctx);
+
+typedef struct {
+    unsigned threads;
+    uint64_t steals;            /* successful steal operations */
+} PoolStats;
+
+unsigned pool_default_threads(void);
+
+/* Runs job(i, ctx) once for every i; returns when all are done.
+ * threads == 0 uses pool_default_threads(). */
+PoolStats pool_run(size_t count, unsigned threads, PoolJob job, void* ctx);
@@ -0,0 +1,1651 @@
+/* Virtual-clock Furi runtime for the starter app (see sim.h) */
+#include "sim.h"
+
+#include <furi.h>
+#include <furi_hal.h>
+#include <stm32wbxx_ll_tim.h>
+#include <stm32wbxx_ll_adc.h>
+#include <stm32wbxx_ll_dma.h>
+#include <gui/gui.h>
+#include <gui/elements.h>
+#include <notification/notification_messages.h>
+#include <storage/storage.h>
+#include <toolbox/saved_struct.h>
+#include <toolbox/args.h>
+#include <cli/cli.h>
+
+/* the app's allocator/printf are ours; this file uses the real ones */
+#undef malloc
+#undef free
+#undef printf
+
+#include <math.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <ucontext.h>
+
+int32_t embraco_starter(void* p);
+
+_Static_assert(SimKeyBack == (SimKey)InputKeyBack && SimKeyOk == (SimKey)InputKeyOk, "SimKey must follow InputKey");
+
+enum {
+    SIM_TIMERS      = 24,
+    SIM_RECORDS     = 8,
+    SIM_PINS        = 12,
+    SIM_INPUTS      = 8,
+    SIM_CPU_MHZ     = 64,
+    SIM_EXIT_GRACE_MS = 60000,
+    SIM_SHORT_MS    = 80,
+    SIM_LONG_MS     = 500,
+    SIM_LONG_UP_MS  = 600,
+    SIM_ACC_ADDR    = 0x18 << 1,
+    SIM_ACC_FIFO    = 32,
+    SIM_ACC_PERIOD_US = 2500,   /* 400 Hz */
+    SIM_DAY_S       = 86400,
+    SIM_THREAD_STACK = 64 * 1024,  /* host frames, not the 1 KiB asked for */
+    SIM_MAIN_STACK  = 256 * 1024,  /* the app thread, painted for a high-water mark */
+    SIM_STACK_PAINT = 0xA5,
+};
+
+#define SIM_EPOCH 1767225600U   /* launch = 2026-01-01 00:00:00 */
+
+#define SIM_NEVER UINT64_MAX
+
+/* ---------- Objects handed to the app ---------- */
+struct FuriTimer {
+    FuriTimerCallback cb;
+    void*    ctx;
+    FuriTimerType type;
+    bool     running;
+    uint32_t period_ms;
+    uint64_t due_us;
+};
+
+struct FuriMessageQueue {
+    uint32_t n, size, head, count;
+    uint8_t  buf[];
+};
+
+struct FuriThread {
+    FuriThreadCallback cb;
+    void* ctx;
+    bool     done;
+    bool     waiting;           /* in furi_thread_flags_wait */
+    uint32_t flags;             /* set, not yet taken */
+    uint32_t wait_mask;
+    uint32_t wait_result;
+    uint64_t wait_due_us;       /* SIM_NEVER = untimed */
+};
+
+struct FuriString {
+    char s[128];
+};
+
+struct ViewPort {
+    ViewPortDrawCallback  draw;
+    void* draw_ctx;
+    ViewPortInputCallback input;
+    void* input_ctx;
+    bool  dirty;
+};
+
+struct File {
+    bool open;
+};
+
+struct Canvas { int unused; };
+struct Gui { int unused; };
+struct Cli { int unused; };
+struct NotificationApp { int unused; };
+struct Storage { int unused; };
+
+/* ---------- Per-thread device ---------- */
+typedef struct Block {
+    struct Block *prev, *next;
+    size_t size;
+    _Alignas(max_align_t) unsigned char data[];
+} Block;
+
+typedef enum { Pa7Hiz, Pa7Low, Pa7High, Pa7Pwm } Pa7State;
+
+typedef struct {
+    uint32_t due_ms;
+    InputKey key;
+    InputType type;
+} PendingInput;
+
+typedef struct {
+    SimRun* run;
+    jmp_buf jmp;
+    uint64_t now_us;
+    uint32_t exit_at_ms;
+    bool     exit_sent;
+    size_t   next_step;
+
+    FuriTimer* timers[SIM_TIMERS];
+    FuriMessageQueue* queue;
+    uint64_t wake_us;           /* main loop last took a message */
+
+    /* the one extra Furi thread, a coroutine on this host thread */
+    FuriThread* thread;
+    FuriThread* running;        /* ... while it runs */
+    ucontext_t thread_uc;
+    ucontext_t host;            /* whoever resumed it */
+    void*    thread_stack;
+    ucontext_t main_uc;         /* the app thread ... */
+    ucontext_t boot_uc;         /* ... and sim_run, which it returns to */
+    uint8_t* main_stack;
+    ViewPort* vp;
+    struct Canvas canvas;
+    struct { CliCallback cb; void* ctx; } cli;
+    struct { const char* name; void* data; } records[SIM_RECORDS];
+
+    PendingInput inputs[SIM_INPUTS];
+    uint8_t  input_count;
+    uint32_t input_seq;
+
+    char*    out;               /* reply buffer of the CLI step being run */
+    size_t   out_cap, out_len;
+
+    Block    heap;              /* list head of live app blocks */
+    uint32_t live_bytes;
+
+    /* GPIO / TIM1 */
+    GpioMode pin_mode[SIM_PINS];
+    bool     pin_level[SIM_PINS];
+    bool     hal_pwm;           /* between furi_hal_pwm_start and _stop */
+    bool     tim_enabled, tim_outputs, tim_opm;
+    uint32_t tim_freq, tim_rcr;
+    uint64_t tim_end_us;        /* one-pulse run ends here */
+    bool     tim_trgo;          /* TIM1 update -> TRGO */
+    bool     tim_ude;           /* TIM1 update -> DMA request */
+    bool     bus_tim2, tim2_enabled, tim2_ext;
+    uint32_t tim2_cnt;
+    uint64_t tim2_mark_us;      /* TIM1 updates counted up to here ... */
+    uint64_t tim2_frac;         /* ... plus this many Hz*us of a period */
+    uint64_t wave_origin_ns;    /* a PA7 rising edge; the next are tim_freq apart */
+    uint64_t wave_k;            /* edges since the origin already captured */
+    Pa7State pa7;
+    uint32_t pa7_freq;
+    uint64_t last_stop_us;
+    bool     stopped_once;
+    int32_t  insomnia;
+
+    /* RTC alarm A */
+    bool     alarm_on;
+    uint32_t alarm_sod;         /* second of day it matches */
+    FuriHalRtcAlarmCallback alarm_cb;
+    void*    alarm_ctx;
+
+    /* TIM16 CH1 capture (speaker owns the clock) + TIM1_UP_TIM16 vector */
+    bool     speaker_held;
+    bool     beacon_on;         /* extra beacon advertising */
+    bool     tim16_enabled, tim16_cc1, tim16_ie;
+    bool     tim16_cc1if, tim16_cc1of;
+    uint16_t tim16_ccr;
+    uint32_t tim16_psc;
+    uint64_t tim16_start_ns;
+    FuriHalInterruptISR isr;
+    void*    isr_ctx;
+
+    /* EXTI per pin + the input events pubsub (one subscriber) */
+    GpioExtiCallback exti_cb[SIM_PINS];
+    void*    exti_ctx[SIM_PINS];
+    FuriPubSubCallback input_sub;
+    void*    input_sub_ctx;
+
+    /* ADC1 scan */
+    bool     adc_held, adc_converting, adc_dma, dma_on;
+    uint32_t dma_req[8];        /* DMAMUX request per channel (DMA1 and DMA2 share) */
+    bool     dma_chan[8];
+
+    /* LIS3DH */
+    bool     i2c_held;
+    uint8_t  acc_reg[0x40];
+    uint64_t acc_mark_us;       /* FIFO samples produced up to here */
+    double   acc_turns;         /* shaft angle */
+
+    SimDwt   dwt;
+} Sim;
+
+static _Thread_local Sim* g;
+
+/* ---------- Failure ---------- */
+static _Noreturn void sim_fail(SimStatus status, const char* msg){
+    g->run->status = status;
+    snprintf(g->run->error, sizeof(g->run->error), "%s", msg);
+    longjmp(g->jmp, 1);
+}
+
+_Noreturn void sim_crash(const char* msg){
+    sim_fail(SimCrashed, msg);
+}
+
+/* ---------- Heap ---------- */
+void* sim_malloc(size_t size){
+    Block* b = malloc(sizeof(Block) + size);
+    if(!b) sim_crash("out of host memory");
+    b->size = size;
+    b->next = g->heap.next;
+    b->prev = &g->heap;
+    g->heap.next->prev = b;
+    g->heap.next = b;
+    SimMetrics* m = &g->run->metrics;
+    m->allocs++;
+    m->alloc_bytes += (uint32_t)size;
+    g->live_bytes += (uint32_t)size;
+    if(g->live_bytes > m->peak_bytes) m->peak_bytes = g->live_bytes;
+    return b->data;
+}
+
+void sim_free(void* ptr){
+    if(!ptr) return;
+    Block* b = (Block*)((unsigned char*)ptr - offsetof(Block, data));
+    b->prev->next = b->next;
+    b->next->prev = b->prev;
+    g->live_bytes -= (uint32_t)b->size;
+    free(b);
+}
+
+int sim_printf(const char* fmt, ...){
+    if(!g->out || g->out_len + 1 >= g->out_cap) return 0;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(g->out + g->out_len, g->out_cap - g->out_len, fmt, ap);
+    va_end(ap);
+    if(n > 0) g->out_len = MIN(g->out_len + (size_t)n, g->out_cap - 1);
+    return n;
+}
+
+/* ---------- PA7 observer ---------- */
+const GpioPin gpio_ext_pa7 = {0}, gpio_ext_pa6 = {1}, gpio_ext_pa4 = {2}, gpio_ext_pb3 = {3},
+    gpio_ext_pb2 = {4}, gpio_ext_pc3 = {5}, gpio_ext_pc1 = {6}, gpio_ext_pc0 = {7},
+    gpio_usart_tx = {8}, gpio_usart_rx = {9}, gpio_ibutton = {10}, gpio_speaker = {11};
+
+static void trace(uint64_t at_us, SimTraceKind kind, uint32_t arg){
+    SimRun* r = g->run;
+    if(r->trace && r->trace_len < r->trace_cap){
+        r->trace[r->trace_len] = (SimTrace){.t_ms = (uint32_t)(at_us / 1000U), .kind = kind, .arg = arg};
+    }
+    r->trace_len++;
+}
+
+static bool tim_wave(uint64_t at_us){
+    return g->tim_enabled && g->tim_outputs && (!g->tim_opm || at_us < g->tim_end_us);
+}
+
+/* A channel on TIM1_UP with the request enabled: the end of a one-pulse run
+ * writes BDTR with MOE clear (OSSI=0 is the only off state modelled) */
+static bool tim_float_at_end(void){
+    if(!g->tim_ude) return false;
+    for(uint8_t i = 0; i < 8; i++){
+        if(g->dma_chan[i] && g->dma_req[i] == LL_DMAMUX_REQ_TIM1_UP) return true;
+    }
+    return false;
+}
+
+/* Collapses everything done at one instant (e.g. the counter stop/start
+ * around a counted-run switch) into the level the inverter would see. Called
+ * before time moves on. */
+static void pa7_sync(void){
+    uint64_t at = g->now_us;
+    Pa7State st;
+    if(tim_wave(at)){
+        st = Pa7Pwm;
+    } else {
+        if(g->tim_enabled && g->tim_opm && g->tim_end_us < at) at = g->tim_end_us;
+        GpioMode mode = g->pin_mode[gpio_ext_pa7.id];
+        if(mode == GpioModeOutputPushPull || mode == GpioModeOutputOpenDrain){
+            st = g->pin_level[gpio_ext_pa7.id] ? Pa7High : Pa7Low;
+        } else if(mode == GpioModeAltFunctionPushPull){
+            /* timer stopped with the output inactive, unless its last update
+             * cleared MOE through DMA: then it lets go of the pin */
+            st = tim_float_at_end() && g->tim_enabled && g->tim_opm && g->tim_end_us <= at ? Pa7Hiz : Pa7Low;
+        } else {
+            st = Pa7Hiz;
+        }
+    }
+    if(st == g->pa7 && (st != Pa7Pwm || g->tim_freq == g->pa7_freq)) return;
+
+    SimMetrics* m = &g->run->metrics;
+    if(g->pa7 == Pa7Pwm){
+        trace(at, SimTracePwmStop, 0);
+        m->pwm_stops++;
+        g->last_stop_us = at;
+        g->stopped_once = true;
+    }
+    if(st == Pa7Pwm){
+        trace(at, SimTracePwmStart, g->tim_freq);
+        m->pwm_starts++;
+        g->pa7_freq = g->tim_freq;
+        if(g->stopped_once){
+            uint64_t gap = at - g->last_stop_us;
+            m->gap_count++;
+            m->gap_sum_us += gap;
+            if(gap > m->gap_max_us) m->gap_max_us = (uint32_t)MIN(gap, UINT32_MAX);
+        }
+    } else if(st == Pa7Hiz){
+        trace(at, SimTracePinHiz, 0);
+    } else if(st == Pa7Low){
+        trace(at, SimTracePinLow, 0);
+    }
+    g->pa7 = st;
+}
+
+/* ---------- Threads ---------- */
+/* Runs the thread until it waits again or returns. It has the highest
+ * priority, so it runs the moment it is made ready. */
+static void thread_resume(FuriThread* t, uint32_t result){
+    if(g->running) return;
+    t->waiting = false;
+    t->wait_result = result;
+    pa7_sync();
+    bool was_pwm = g->pa7 == Pa7Pwm;
+    g->running = t;
+    swapcontext(&g->host, &g->thread_uc);
+    g->running = NULL;
+    pa7_sync();
+    if(was_pwm && g->pa7 != Pa7Pwm){
+        SimRun* r = g->run;
+        uint32_t ms = (uint32_t)((g->now_us - g->wake_us) / 1000U);
+        r->thread_cuts++;
+        if(ms > r->thread_cut_ms) r->thread_cut_ms = ms;
+    }
+}
+
+static void thread_entry(void){
+    FuriThread* t = g->running;
+    t->cb(t->ctx);
+    t->done = true;
+    setcontext(&g->host);
+}
+
+/* The only way the clock moves forward: time with PWM off is booked for the
+ * idle-current estimate, split by whether Stop mode was allowed */
+static void clock_set(uint64_t at_us){
+    if(at_us <= g->now_us) return;
+    if(g->pa7 != Pa7Pwm){
+        SimMetrics* m = &g->run->metrics;
+        m->idle_us += at_us - g->now_us;
+        if(g->insomnia > 0) m->idle_insomnia_us += at_us - g->now_us;
+    }
+    g->now_us = at_us;
+}
+
+/* A timed wait that ends on the way to `at_us` preempts whoever is moving
+ * the clock (a busy main loop, a delay) at its deadline */
+static void thread_preempt(uint64_t at_us){
+    FuriThread* t = g->thread;
+    while(t && t->waiting && t->wait_due_us <= at_us && !g->running){
+        pa7_sync();
+        clock_set(t->wait_due_us);
+        thread_resume(t, FuriFlagErrorTimeout);
+    }
+}
+
+static void advance_to(uint64_t at_us){
+    pa7_sync();
+    thread_preempt(at_us);
+    clock_set(at_us);
+    pa7_sync();
+}
+
+/* ---------- Script ---------- */
+static void input_schedule(uint32_t at_ms, InputKey key, InputType type){
+    if(g->input_count >= SIM_INPUTS) sim_crash("sim: too many pending inputs");
+    uint8_t i = g->input_count++;
+    while(i > 0 && g->inputs[i - 1].due_ms > at_ms){
+        g->inputs[i] = g->inputs[i - 1];
+        i--;
+    }
+    g->inputs[i] = (PendingInput){.due_ms = at_ms, .key = key, .type = type};
+}
+
+static void key_script(uint32_t at_ms, InputKey key, bool long_press){
+    input_schedule(at_ms, key, InputTypePress);
+    if(long_press){
+        input_schedule(at_ms + SIM_LONG_MS, key, InputTypeLong);
+        input_schedule(at_ms + SIM_LONG_UP_MS, key, InputTypeRelease);
+    } else {
+        input_schedule(at_ms + SIM_SHORT_MS, key, InputTypeShort);
+        input_schedule(at_ms + SIM_SHORT_MS, key, InputTypeRelease);
+    }
+}
+
+static void input_fire(void){
+    PendingInput in = g->inputs[0];
+    g->input_count--;
+    memmove(&g->inputs[0], &g->inputs[1], g->input_count * sizeof(g->inputs[0]));
+    InputEvent ev = {.sequence = ++g->input_seq, .key = in.key, .type = in.type};
+    if(g->input_sub) g->input_sub(&ev, g->input_sub_ctx);
+    if(!g->vp || !g->vp->input) return;
+    g->vp->input(&ev, g->vp->input_ctx);
+}
+
+/* The loop pulls 17 (1W) to GND; open, the pin's pull-up wins */
+static void estop_loop_set(bool closed){
+    bool rise = !g->pin_level[gpio_ibutton.id] && !closed;
+    g->pin_level[gpio_ibutton.id] = !closed;
+    if(rise && g->pin_mode[gpio_ibutton.id] == GpioModeInterruptRise && g->exti_cb[gpio_ibutton.id]){
+        g->exti_cb[gpio_ibutton.id](g->exti_ctx[gpio_ibutton.id]);
+    }
+}
+
+static void cli_send(const char* args, char* out, size_t out_cap){
+    if(!g->cli.cb) return;
+    FuriString* s = furi_string_alloc_set_str(args ? args : "");
+    g->out = out;
+    g->out_cap = out_cap;
+    g->out_len = 0;
+    if(out && out_cap) out[0] = '\0';
+    g->cli.cb((Cli*)&g->canvas, s, g->cli.ctx);
+    g->out = NULL;
+    furi_string_free(s);
+}
+
+/* The main loop stops taking events for `ms`: timers, ISRs and the other
+ * thread go on, the queue fills, nothing is drawn */
+static bool sim_step(uint64_t limit_us);
+static void main_stall(uint32_t ms){
+    uint64_t end = g->now_us + (uint64_t)ms * 1000U;
+    while(sim_step(end)){
+    }
+    advance_to(end);
+}
+
+static void step_fire(void){
+    const SimStep* st = &g->run->steps[g->next_step++];
+    switch(st->kind){
+        case SimStepShort: key_script(st->at_ms, (InputKey)st->key, false); break;
+        case SimStepLong:  key_script(st->at_ms, (InputKey)st->key, true);  break;
+        case SimStepCli:   cli_send(st->args, st->out, st->out_cap);        break;
+        case SimStepEstopOpen:  estop_loop_set(false); break;
+        case SimStepEstopClose: estop_loop_set(true);  break;
+        case SimStepStall: main_stall(st->ms); break;
+    }
+}
+
+static void exit_fire(void){
+    g->exit_sent = true;
+    if(g->cli.cb) cli_send("exit", NULL, 0);
+    else if(g->vp && g->vp->input) key_script((uint32_t)(g->now_us / 1000U), InputKeyBack, true);
+    else sim_fail(SimNoExit, "no CLI or input to request exit");
+}
+
+/* ---------- Loopback capture ---------- */
+/* Rising edges of PA7 at exact multiples of the period from the last
+ * (re)start, as TIM16 would latch them; the ISR runs at the next whole us */
+static uint64_t wave_edge_ns(uint64_t k){
+    return g->wave_origin_ns + k * 1000000000U / MAX(g->tim_freq, 1U);
+}
+
+static void wave_restart(void){
+    g->wave_origin_ns = g->now_us * 1000U;
+    g->wave_k = 0;
+}
+
+static uint64_t capture_next_us(void){
+    if(!g->run->loopback || g->pin_mode[gpio_ext_pa6.id] != GpioModeAltFunctionPushPull) return SIM_NEVER;
+    if(!g->speaker_held || !g->tim16_enabled || !g->tim16_cc1 || !g->tim16_ie || !g->isr) return SIM_NEVER;
+    if(!tim_wave(g->now_us)) return SIM_NEVER;
+    uint64_t at = (wave_edge_ns(g->wave_k) + 999U) / 1000U;
+    return tim_wave(at) ? at : SIM_NEVER;
+}
+
+static void capture_fire(void){
+    uint64_t edge = wave_edge_ns(g->wave_k++);
+    uint64_t ticks = (edge - MIN(edge, g->tim16_start_ns)) * SIM_CPU_MHZ / 1000U / (g->tim16_psc + 1U);
+    if(g->tim16_cc1if) g->tim16_cc1of = true;
+    g->tim16_cc1if = true;
+    g->tim16_ccr = (uint16_t)ticks;
+    g->isr(g->isr_ctx);
+}
+
+/* Sleeps until the next thing that can wake the app and runs it. Returns
+ * false when nothing is left to happen before `limit_us`. */
+static bool sim_step(uint64_t limit_us){
+    enum { SrcNone, SrcTim, SrcCapture, SrcThread, SrcTimer, SrcAlarm, SrcInput, SrcStep, SrcExit } src = SrcNone;
+    uint64_t t = SIM_NEVER;
+    FuriTimer* timer = NULL;
+
+    if(g->tim_enabled && g->tim_opm && g->pa7 == Pa7Pwm){
+        t = g->tim_end_us;
+        src = SrcTim;
+    }
+    uint64_t cap_us = capture_next_us();
+    if(cap_us < t){
+        t = cap_us;
+        src = SrcCapture;
+    }
+    if(g->thread && g->thread->waiting && g->thread->wait_due_us < t){
+        t = g->thread->wait_due_us;
+        src = SrcThread;
+    }
+    for(size_t i = 0; i < SIM_TIMERS; i++){
+        FuriTimer* tm = g->timers[i];
+        if(tm && tm->running && tm->due_us < t){
+            t = tm->due_us;
+            timer = tm;
+            src = SrcTimer;
+        }
+    }
+    if(g->alarm_on && g->alarm_cb){
+        /* next whole second matching the alarm's time of day */
+        uint64_t now_s = g->now_us / 1000000U + 1U;
+        uint64_t sod = (SIM_EPOCH + now_s) % SIM_DAY_S;
+        uint64_t at = (now_s + (g->alarm_sod + SIM_DAY_S - sod) % SIM_DAY_S) * 1000000U;
+        if(at < t){
+            t = at;
+            src = SrcAlarm;
+        }
+    }
+    if(g->input_count && (uint64_t)g->inputs[0].due_ms * 1000U < t){
+        t = (uint64_t)g->inputs[0].due_ms * 1000U;
+        src = SrcInput;
+    }
+    if(g->next_step < g->run->step_count && (uint64_t)g->run->steps[g->next_step].at_ms * 1000U < t){
+        t = (uint64_t)g->run->steps[g->next_step].at_ms * 1000U;
+        src = SrcStep;
+    }
+    if(!g->exit_sent && (uint64_t)g->exit_at_ms * 1000U < t){
+        t = (uint64_t)g->exit_at_ms * 1000U;
+        src = SrcExit;
+    }
+    if(src == SrcNone || t > limit_us) return false;
+
+    advance_to(t);
+    switch(src){
+        case SrcTimer:
+            g->run->metrics.timer_fires++;
+            if(timer->type == FuriTimerTypePeriodic) timer->due_us += (uint64_t)timer->period_ms * 1000U;
+            else timer->running = false;
+            timer->cb(timer->ctx);
+            break;
+        case SrcCapture: capture_fire(); break;
+        case SrcThread: break;      /* advance_to ran it */
+        case SrcAlarm: g->alarm_cb(g->alarm_ctx); break;
+        case SrcInput: input_fire(); break;
+        case SrcStep:  step_fire();  break;
+        case SrcExit:  exit_fire();  break;
+        default: break;
+    }
+    return true;
+}
+
+/* ---------- Kernel ---------- */
+uint32_t furi_get_tick(void){
+    return (uint32_t)(g->now_us / 1000U);
+}
+uint32_t furi_ms_to_ticks(uint32_t ms){
+    return ms;
+}
+void furi_delay_ms(uint32_t ms){
+    advance_to(g->now_us + (uint64_t)ms * 1000U);
+}
+void furi_delay_us(uint32_t us){
+    advance_to(g->now_us + us);
+}
+
+/* ---------- Message queue ---------- */
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size){
+    FuriMessageQueue* q = sim_malloc(sizeof(*q) + (size_t)msg_count * msg_size);
+    *q = (FuriMessageQueue){.n = msg_count, .size = msg_size};
+    if(!g->queue) g->queue = q;
+    return q;
+}
+void furi_message_queue_free(FuriMessageQueue* q){
+    if(g->queue == q) g->queue = NULL;
+    sim_free(q);
+}
+FuriStatus furi_message_queue_put(FuriMessageQueue* q, const void* msg, uint32_t timeout){
+    UNUSED(timeout);            /* nobody else runs while a sender would wait */
+    if(q->count == q->n){
+        g->run->metrics.queue_drops++;
+        return FuriStatusErrorResource;
+    }
+    uint32_t slot = (q->head + q->count) % q->n;
+    memcpy(q->buf + (size_t)slot * q->size, msg, q->size);
+    q->count++;
+    return FuriStatusOk;
+}
+FuriStatus furi_message_queue_get(FuriMessageQueue* q, void* msg, uint32_t timeout){
+    uint64_t limit = (timeout == FuriWaitForever) ? SIM_NEVER : g->now_us + (uint64_t)timeout * 1000U;
+    uint64_t grace = ((uint64_t)g->exit_at_ms + SIM_EXIT_GRACE_MS) * 1000U;
+    for(;;){
+        pa7_sync();
+        if(q->count){
+            memcpy(msg, q->buf + (size_t)q->head * q->size, q->size);
+            q->head = (q->head + 1) % q->n;
+            q->count--;
+            g->run->metrics.wakeups++;
+            g->wake_us = g->now_us;
+            if(g->pa7 != Pa7Pwm) g->run->metrics.idle_wakeups++;
+            return FuriStatusOk;
+        }
+        if(g->vp && g->vp->dirty){
+            /* the GUI thread draws before the app gets to sleep */
+            g->vp->dirty = false;
+            g->run->metrics.frames++;
+            if(g->vp->draw) g->vp->draw(&g->canvas, g->vp->draw_ctx);
+            continue;
+        }
+        if(!sim_step(MIN(limit, grace))){
+            if(limit != SIM_NEVER && limit <= grace){
+                advance_to(limit);
+                return FuriStatusErrorTimeout;
+            }
+            sim_fail(SimNoExit, g->exit_sent ? "app did not exit" : "main loop blocked with nothing to wake it");
+        }
+    }
+}
+uint32_t furi_message_queue_get_count(FuriMessageQueue* q){
+    return q->count;
+}
+
+/* ---------- Timers ---------- */
+FuriTimer* furi_timer_alloc(FuriTimerCallback cb, FuriTimerType type, void* context){
+    for(size_t i = 0; i < SIM_TIMERS; i++){
+        if(g->timers[i]) continue;
+        FuriTimer* t = sim_malloc(sizeof(*t));
+        *t = (FuriTimer){.cb = cb, .ctx = context, .type = type};
+        g->timers[i] = t;
+        return t;
+    }
+    sim_crash("sim: timer table full");
+}
+void furi_timer_free(FuriTimer* t){
+    for(size_t i = 0; i < SIM_TIMERS; i++){
+        if(g->timers[i] == t) g->timers[i] = NULL;
+    }
+    sim_free(t);
+}
+FuriStatus furi_timer_start(FuriTimer* t, uint32_t ticks){
+    t->running = true;
+    t->period_ms = ticks ? ticks : 1;
+    t->due_us = g->now_us + (uint64_t)t->period_ms * 1000U;
+    return FuriStatusOk;
+}
+FuriStatus furi_timer_restart(FuriTimer* t, uint32_t ticks){
+    return furi_timer_start(t, ticks);
+}
+FuriStatus furi_timer_stop(FuriTimer* t){
+    t->running = false;
+    return FuriStatusOk;
+}
+uint32_t furi_timer_is_running(FuriTimer* t){
+    return t->running;
+}
+
+/* ---------- Mutex ---------- */
+struct FuriMutex { bool held; };
+
+FuriMutex* furi_mutex_alloc(FuriMutexType type){
+    UNUSED(type);
+    FuriMutex* m = sim_malloc(sizeof(*m));
+    m->held = false;
+    return m;
+}
+void furi_mutex_free(FuriMutex* m){
+    if(m->held) sim_crash("sim: mutex freed while held");
+    sim_free(m);
+}
+FuriStatus furi_mutex_acquire(FuriMutex* m, uint32_t timeout){
+    UNUSED(timeout);
+    if(m->held) sim_crash("sim: mutex taken twice (would deadlock)");
+    m->held = true;
+    return FuriStatusOk;
+}
+FuriStatus furi_mutex_release(FuriMutex* m){
+    if(!m->held) sim_crash("sim: mutex released but not held");
+    m->held = false;
+    return FuriStatusOk;
+}
+
+/* ---------- Threads ---------- */
+FuriThread* furi_thread_alloc_ex(const char* name, uint32_t stack, FuriThreadCallback cb, void* context){
+    UNUSED(name);
+    UNUSED(stack);
+    FuriThread* t = sim_malloc(sizeof(*t));
+    *t = (FuriThread){.cb = cb, .ctx = context};
+    return t;
+}
+void furi_thread_free(FuriThread* t){
+    if(g->thread == t) sim_crash("furi_thread_free: thread not joined");
+    sim_free(t);
+}
+void furi_thread_set_priority(FuriThread* t, FuriThreadPriority prio){
+    UNUSED(t);
+    UNUSED(prio);
+}
+void furi_thread_start(FuriThread* t){
+    if(g->thread) sim_crash("sim: only one extra thread is modelled");
+    if(!g->thread_stack) g->thread_stack = malloc(SIM_THREAD_STACK);
+    if(!g->thread_stack) abort();
+    getcontext(&g->thread_uc);
+    g->thread_uc.uc_stack.ss_sp = g->thread_stack;
+    g->thread_uc.uc_stack.ss_size = SIM_THREAD_STACK;
+    g->thread_uc.uc_link = NULL;
+    makecontext(&g->thread_uc, thread_entry, 0);
+    g->thread = t;
+    thread_resume(t, 0);
+}
+bool furi_thread_join(FuriThread* t){
+    if(g->thread != t) return true;
+    if(!t->done) sim_crash("furi_thread_join: thread still blocked");
+    g->thread = NULL;
+    return true;
+}
+FuriThreadId furi_thread_get_id(FuriThread* t){
+    return t;
+}
+FuriThreadId furi_thread_get_current_id(void){
+    return g->running;          /* NULL: the app thread */
+}
+/* Bytes of the app thread's stack never written so far (host frames, and the
+ * sim's own on top: the GUI and CLI callbacks run on it too) */
+static uint32_t main_stack_space(void){
+    uint32_t n = 0;
+    while(n < SIM_MAIN_STACK && g->main_stack[n] == SIM_STACK_PAINT) n++;
+    return n;
+}
+uint32_t furi_thread_get_stack_space(FuriThreadId id){
+    return id ? SIM_THREAD_STACK : main_stack_space();
+}
+uint32_t furi_thread_flags_set(FuriThreadId id, uint32_t flags){
+    FuriThread* t = id;
+    t->flags |= flags;
+    uint32_t got = t->flags & t->wait_mask;
+    if(t->waiting && got){
+        t->flags &= ~got;
+        thread_resume(t, got);
+    }
+    return t->flags;
+}
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout){
+    UNUSED(options);            /* FuriFlagWaitAny, clear on exit */
+    FuriThread* t = g->running;
+    if(!t) sim_crash("furi_thread_flags_wait outside a thread");
+    uint32_t got = t->flags & flags;
+    if(got){
+        t->flags &= ~got;
+        return got;
+    }
+    if(!timeout) return FuriFlagErrorTimeout;
+    t->waiting = true;
+    t->wait_mask = flags;
+    t->wait_due_us = (timeout == FuriWaitForever) ? SIM_NEVER : g->now_us + (uint64_t)timeout * 1000U;
+    swapcontext(&g->thread_uc, &g->host);
+    return t->wait_result;
+}
+
+/* ---------- Records ---------- */
+static struct Gui sim_gui;
+static struct Cli sim_cli;
+static struct NotificationApp sim_notification;
+static struct Storage sim_storage;
+struct FuriPubSub { int unused; };
+static FuriPubSub sim_input_events;
+
+void furi_record_create(const char* name, void* data){
+    for(size_t i = 0; i < SIM_RECORDS; i++){
+        if(g->records[i].name) continue;
+        g->records[i].name = name;
+        g->records[i].data = data;
+        return;
+    }
+    sim_crash("sim: record table full");
+}
+bool furi_record_destroy(const char* name){
+    for(size_t i = 0; i < SIM_RECORDS; i++){
+        if(g->records[i].name && strcmp(g->records[i].name, name) == 0){
+            g->records[i].name = NULL;
+            return true;
+        }
+    }
+    return false;
+}
+bool furi_record_exists(const char* name){
+    for(size_t i = 0; i < SIM_RECORDS; i++){
+        if(g->records[i].name && strcmp(g->records[i].name, name) == 0) return true;
+    }
+    return false;
+}
+void* furi_record_open(const char* name){
+    if(strcmp(name, RECORD_GUI) == 0) return &sim_gui;
+    if(strcmp(name, RECORD_CLI) == 0) return &sim_cli;
+    if(strcmp(name, RECORD_NOTIFICATION) == 0) return &sim_notification;
+    if(strcmp(name, RECORD_STORAGE) == 0) return &sim_storage;
+    if(strcmp(name, RECORD_INPUT_EVENTS) == 0) return &sim_input_events;
+    for(size_t i = 0; i < SIM_RECORDS; i++){
+        if(g->records[i].name && strcmp(g->records[i].name, name) == 0) return g->records[i].data;
+    }
+    sim_crash("furi_record_open: no such record");
+}
+void furi_record_close(const char* name){
+    UNUSED(name);
+}
+
+/* ---------- Strings / args ---------- */
+FuriString* furi_string_alloc(void){
+    FuriString* s = sim_malloc(sizeof(*s));
+    s->s[0] = '\0';
+    return s;
+}
+FuriString* furi_string_alloc_set_str(const char* cstr){
+    FuriString* s = furi_string_alloc();
+    snprintf(s->s, sizeof(s->s), "%s", cstr);
+    return s;
+}
+void furi_string_free(FuriString* s){
+    sim_free(s);
+}
+const char* furi_string_get_cstr(const FuriString* s){
+    return s->s;
+}
+int furi_string_cmp_str(const FuriString* s, const char* cstr){
+    return strcmp(s->s, cstr);
+}
+
+bool args_read_string_and_trim(FuriString* args, FuriString* value){
+    char* p = args->s;
+    while(*p == ' ') p++;
+    size_t n = strcspn(p, " ");
+    if(n == 0) return false;
+    snprintf(value->s, sizeof(value->s), "%.*s", (int)n, p);
+    p += n;
+    while(*p == ' ') p++;
+    memmove(args->s, p, strlen(p) + 1);
+    return true;
+}
+bool args_read_int_and_trim(FuriString* args, int* value){
+    char* p = args->s;
+    while(*p == ' ') p++;
+    char* end;
+    long v = strtol(p, &end, 10);
+    if(end == p || (*end != ' ' && *end != '\0')) return false;
+    *value = (int)v;
+    while(*end == ' ') end++;
+    memmove(args->s, end, strlen(end) + 1);
+    return true;
+}
+
+/* ---------- CLI ---------- */
+void cli_add_command(Cli* cli, const char* name, CliCommandFlag flags, CliCallback cb, void* context){
+    UNUSED(cli);
+    UNUSED(name);
+    UNUSED(flags);
+    g->cli.cb = cb;
+    g->cli.ctx = context;
+}
+void cli_delete_command(Cli* cli, const char* name){
+    UNUSED(cli);
+    UNUSED(name);
+    g->cli.cb = NULL;
+}
+
+/* ---------- GUI ---------- */
+ViewPort* view_port_alloc(void){
+    ViewPort* vp = sim_malloc(sizeof(*vp));
+    *vp = (ViewPort){0};
+    g->vp = vp;
+    return vp;
+}
+void view_port_free(ViewPort* vp){
+    if(g->vp == vp) g->vp = NULL;
+    sim_free(vp);
+}
+void view_port_draw_callback_set(ViewPort* vp, ViewPortDrawCallback cb, void* ctx){
+    vp->draw = cb;
+    vp->draw_ctx = ctx;
+}
+void view_port_input_callback_set(ViewPort* vp, ViewPortInputCallback cb, void* ctx){
+    vp->input = cb;
+    vp->input_ctx = ctx;
+}
+void view_port_update(ViewPort* vp){
+    vp->dirty = true;
+    g->run->metrics.redraw_requests++;
+}
+void view_port_enabled_set(ViewPort* vp, bool enabled){
+    UNUSED(vp);
+    UNUSED(enabled);
+}
+void gui_add_view_port(Gui* gui, ViewPort* vp, GuiLayer layer){
+    UNUSED(gui);
+    UNUSED(layer);
+    vp->dirty = true;
+}
+void gui_remove_view_port(Gui* gui, ViewPort* vp){
+    UNUSED(gui);
+    vp->dirty = false;
+}
+
+/* Drawing costs nothing here; only frames and rasterised characters (the
+ * expensive part on the device) are counted */
+void canvas_clear(Canvas* c){ UNUSED(c); }
+void canvas_set_font(Canvas* c, Font f){ UNUSED(c); UNUSED(f); }
+void canvas_set_color(Canvas* c, Color col){ UNUSED(c); UNUSED(col); }
+void canvas_draw_str(Canvas* c, int32_t x, int32_t y, const char* s){
+    UNUSED(c); UNUSED(x); UNUSED(y);
+    g->run->metrics.glyphs += (uint32_t)strlen(s);
+}
+void canvas_draw_str_aligned(Canvas* c, int32_t x, int32_t y, Align h, Align v, const char* s){
+    UNUSED(c); UNUSED(x); UNUSED(y); UNUSED(h); UNUSED(v);
+    g->run->metrics.glyphs += (uint32_t)strlen(s);
+}
+uint16_t canvas_string_width(Canvas* c, const char* s){
+    UNUSED(c);
+    return (uint16_t)(strlen(s) * 6U);
+}
+void canvas_draw_dot(Canvas* c, int32_t x, int32_t y){ UNUSED(c); UNUSED(x); UNUSED(y); }
+void canvas_draw_box(Canvas* c, int32_t x, int32_t y, size_t w, size_t h){ UNUSED(c); UNUSED(x); UNUSED(y); UNUSED(w); UNUSED(h); }
+void canvas_draw_frame(Canvas* c, int32_t x, int32_t y, size_t w, size_t h){ UNUSED(c); UNUSED(x); UNUSED(y); UNUSED(w); UNUSED(h); }
+void canvas_draw_line(Canvas* c, int32_t x1, int32_t y1, int32_t x2, int32_t y2){
+    UNUSED(c); UNUSED(x1); UNUSED(y1); UNUSED(x2); UNUSED(y2);
+}
+void canvas_draw_xbm(Canvas* c, int32_t x, int32_t y, size_t w, size_t h, const uint8_t* bits){
+    UNUSED(c); UNUSED(x); UNUSED(y); UNUSED(w); UNUSED(h); UNUSED(bits);
+}
+size_t canvas_width(const Canvas* c){ UNUSED(c); return 128; }
+size_t canvas_height(const Canvas* c){ UNUSED(c); return 64; }
+void elements_button_left(Canvas* c, const char* s){ UNUSED(c); UNUSED(s); }
+void elements_button_right(Canvas* c, const char* s){ UNUSED(c); UNUSED(s); }
+void elements_button_center(Canvas* c, const char* s){ UNUSED(c); UNUSED(s); }
+void elements_multiline_text_aligned(Canvas* c, int32_t x, int32_t y, Align h, Align v, const char* s){
+    UNUSED(c); UNUSED(x); UNUSED(y); UNUSED(h); UNUSED(v);
+    g->run->metrics.glyphs += (uint32_t)strlen(s);
+}
+void elements_progress_bar(Canvas* c, int32_t x, int32_t y, size_t w, float p){
+    UNUSED(c); UNUSED(x); UNUSED(y); UNUSED(w); UNUSED(p);
+}
+
+/* ---------- Notification ---------- */
+const NotificationMessage message_blink_set_color_green, message_display_backlight_on, message_do_not_reset;
+const NotificationSequence sequence_blink_stop = {NULL}, sequence_display_backlight_off = {NULL},
+    sequence_display_backlight_on = {NULL}, sequence_reset_rgb = {NULL},
+    sequence_set_green_255 = {NULL}, sequence_reset_green = {NULL};
+
+void notification_message(NotificationApp* app, const NotificationSequence* seq){
+    UNUSED(app);
+    UNUSED(seq);
+}
+
+/* ---------- Storage: nothing persists, every write succeeds ---------- */
+bool saved_struct_load(const char* path, void* data, size_t size, uint8_t magic, uint8_t version){
+    UNUSED(path); UNUSED(data); UNUSED(size); UNUSED(magic); UNUSED(version);
+    return false;
+}
+bool saved_struct_save(const char* path, const void* data, size_t size, uint8_t magic, uint8_t version){
+    UNUSED(path); UNUSED(data); UNUSED(size); UNUSED(magic); UNUSED(version);
+    return true;
+}
+File* storage_file_alloc(Storage* storage){
+    UNUSED(storage);
+    File* f = sim_malloc(sizeof(*f));
+    f->open = false;
+    return f;
+}
+void storage_file_free(File* f){
+    sim_free(f);
+}
+bool storage_file_open(File* f, const char* path, FS_AccessMode access, FS_OpenMode mode){
+    UNUSED(path); UNUSED(access); UNUSED(mode);
+    f->open = true;
+    return true;
+}
+bool storage_file_close(File* f){
+    f->open = false;
+    return true;
+}
+size_t storage_file_read(File* f, void* buf, size_t size){
+    UNUSED(f); UNUSED(buf); UNUSED(size);
+    return 0;
+}
+bool storage_file_seek(File* f, uint32_t offset, bool from_start){
+    UNUSED(offset); UNUSED(from_start);
+    return f->open;
+}
+size_t storage_file_write(File* f, const void* buf, size_t size){
+    UNUSED(buf);
+    return f->open ? size : 0;
+}
+uint64_t storage_file_size(File* f){
+    UNUSED(f);
+    return 0;
+}
+FS_Error storage_common_remove(Storage* storage, const char* path){
+    UNUSED(storage); UNUSED(path);
+    return FSE_OK;
+}
+FS_Error storage_common_rename(Storage* storage, const char* from, const char* to){
+    UNUSED(storage); UNUSED(from); UNUSED(to);
+    return FSE_OK;
+}
+
+/* ---------- GPIO / PWM / TIM1 / TIM2 ---------- */
+/* TIM2 counts TIM1 update events (one per PA7 period) while TIM1 drives
+ * TRGO and TIM2 is in external clock mode; folded in before any change */
+static void tim2_fold(void){
+    uint64_t to = g->now_us;
+    if(g->tim_opm && g->tim_end_us < to) to = g->tim_end_us;
+    if(g->tim_enabled && g->tim_trgo && g->tim2_enabled && g->tim2_ext && to > g->tim2_mark_us){
+        g->tim2_frac += (to - g->tim2_mark_us) * g->tim_freq;
+        g->tim2_cnt += (uint32_t)(g->tim2_frac / 1000000U);
+        g->tim2_frac %= 1000000U;
+    }
+    g->tim2_mark_us = g->now_us;
+}
+
+void furi_hal_bus_enable(FuriHalBus bus){
+    if(bus == FuriHalBusTIM2) g->bus_tim2 = true;
+}
+void furi_hal_bus_disable(FuriHalBus bus){
+    if(bus != FuriHalBusTIM2) return;
+    tim2_fold();
+    g->bus_tim2 = g->tim2_enabled = g->tim2_ext = false;
+}
+bool furi_hal_bus_is_enabled(FuriHalBus bus){
+    return bus == FuriHalBusTIM2 ? g->bus_tim2 : true;
+}
+
+void furi_hal_gpio_init(const GpioPin* pin, GpioMode mode, GpioPull pull, GpioSpeed speed){
+    UNUSED(pull);
+    UNUSED(speed);
+    g->pin_mode[pin->id] = mode;
+}
+void furi_hal_gpio_init_ex(const GpioPin* pin, GpioMode mode, GpioPull pull, GpioSpeed speed, GpioAltFn alt_fn){
+    UNUSED(alt_fn);
+    furi_hal_gpio_init(pin, mode, pull, speed);
+}
+void furi_hal_gpio_write(const GpioPin* pin, bool state){
+    g->pin_level[pin->id] = state;
+}
+/* With the loopback wire an input on A7 or A6 reads the other pin's output */
+bool furi_hal_gpio_read(const GpioPin* pin){
+    if(g->run->loopback && (pin->id == gpio_ext_pa7.id || pin->id == gpio_ext_pa6.id)){
+        uint8_t other = (pin->id == gpio_ext_pa7.id) ? gpio_ext_pa6.id : gpio_ext_pa7.id;
+        if(g->pin_mode[other] == GpioModeOutputPushPull) return g->pin_level[other];
+    }
+    return g->pin_level[pin->id];
+}
+/* Same checks as the firmware: one callback per EXTI line */
+void furi_hal_gpio_add_int_callback(const GpioPin* pin, GpioExtiCallback cb, void* ctx){
+    if(g->exti_cb[pin->id]) sim_crash("furi_check failed: EXTI callback already set");
+    g->exti_cb[pin->id] = cb;
+    g->exti_ctx[pin->id] = ctx;
+}
+void furi_hal_gpio_remove_int_callback(const GpioPin* pin){
+    g->exti_cb[pin->id] = NULL;
+    g->exti_ctx[pin->id] = NULL;
+}
+
+FuriPubSubSubscription* furi_pubsub_subscribe(FuriPubSub* pubsub, FuriPubSubCallback cb, void* ctx){
+    if(pubsub != &sim_input_events) sim_crash("furi_pubsub_subscribe: unknown pubsub");
+    if(g->input_sub) sim_crash("sim: one input events subscriber only");
+    g->input_sub = cb;
+    g->input_sub_ctx = ctx;
+    return (FuriPubSubSubscription*)&g->input_sub;
+}
+void furi_pubsub_unsubscribe(FuriPubSub* pubsub, FuriPubSubSubscription* sub){
+    if(pubsub != &sim_input_events || sub != (FuriPubSubSubscription*)&g->input_sub) sim_crash("furi_pubsub_unsubscribe: unknown subscription");
+    g->input_sub = NULL;
+}
+
+void furi_hal_pwm_start(FuriHalPwmOutputId channel, uint32_t freq, uint8_t duty){
+    UNUSED(duty);
+    if(channel != FuriHalPwmOutputIdTim1PA7) return;
+    if(g->hal_pwm) g->run->double_starts++;
+    pa7_sync();
+    tim2_fold();
+    g->tim_trgo = g->tim_ude = false;   /* the HAL re-inits TIM1 */
+    g->hal_pwm = true;
+    g->pin_mode[gpio_ext_pa7.id] = GpioModeAltFunctionPushPull;
+    g->tim_freq = freq;
+    g->tim_enabled = g->tim_outputs = true;
+    g->tim_opm = false;
+    wave_restart();
+}
+void furi_hal_pwm_set_params(FuriHalPwmOutputId channel, uint32_t freq, uint8_t duty){
+    UNUSED(duty);
+    if(channel != FuriHalPwmOutputIdTim1PA7 || !g->hal_pwm) return;
+    pa7_sync();
+    tim2_fold();
+    /* new ARR at the next update: no gap, that edge starts the new period */
+    uint64_t k = g->wave_k;
+    while(wave_edge_ns(k) < g->now_us * 1000U) k++;
+    g->wave_origin_ns = wave_edge_ns(k);
+    g->wave_k = 0;
+    g->tim_freq = freq;
+}
+void furi_hal_pwm_stop(FuriHalPwmOutputId channel){
+    if(channel != FuriHalPwmOutputIdTim1PA7) return;
+    tim2_fold();
+    g->hal_pwm = false;
+    g->tim_enabled = g->tim_outputs = g->tim_opm = g->tim_ude = false;
+    g->pin_mode[gpio_ext_pa7.id] = GpioModeAnalog;
+}
+
+static TIM_TypeDef sim_tim1, sim_tim2, sim_tim16;
+TIM_TypeDef* const TIM1 = &sim_tim1;
+TIM_TypeDef* const TIM2 = &sim_tim2;
+TIM_TypeDef* const TIM16 = &sim_tim16;
+
+void LL_TIM_EnableCounter(TIM_TypeDef* tim){
+    if(tim == TIM16){
+        if(!g->speaker_held) sim_crash("TIM16 used without holding the speaker");
+        g->tim16_enabled = true;
+        g->tim16_start_ns = g->now_us * 1000U;
+        return;
+    }
+    tim2_fold();
+    if(tim == TIM2){
+        if(!g->bus_tim2) sim_crash("TIM2 used with its clock off");
+        g->tim2_enabled = true;
+        return;
+    }
+    g->tim_enabled = true;
+    wave_restart();
+    if(g->tim_opm) g->tim_end_us = g->now_us + ((uint64_t)g->tim_rcr + 1U) * 1000000U / MAX(g->tim_freq, 1U);
+}
+void LL_TIM_DisableCounter(TIM_TypeDef* tim){
+    if(tim == TIM16){
+        g->tim16_enabled = false;
+        return;
+    }
+    tim2_fold();
+    if(tim == TIM2) g->tim2_enabled = false;
+    else g->tim_enabled = false;
+}
+uint32_t LL_TIM_IsEnabledCounter(TIM_TypeDef* tim){
+    if(tim == TIM16) return g->tim16_enabled;
+    return g->tim_enabled && (!g->tim_opm || g->now_us < g->tim_end_us);
+}
+void LL_TIM_DisableAllOutputs(TIM_TypeDef* tim){
+    UNUSED(tim);
+    g->tim_outputs = false;
+}
+void LL_TIM_OC_SetMode(TIM_TypeDef* tim, uint32_t channel, uint32_t mode){
+    UNUSED(tim); UNUSED(channel); UNUSED(mode);
+}
+void LL_TIM_SetRepetitionCounter(TIM_TypeDef* tim, uint32_t rcr){
+    UNUSED(tim);
+    g->tim_rcr = rcr;
+}
+void LL_TIM_SetOnePulseMode(TIM_TypeDef* tim, uint32_t mode){
+    UNUSED(tim);
+    tim2_fold();
+    g->tim_opm = (mode == LL_TIM_ONEPULSEMODE_SINGLE);
+}
+void LL_TIM_GenerateEvent_UPDATE(TIM_TypeDef* tim){ UNUSED(tim); }
+void LL_TIM_ClearFlag_UPDATE(TIM_TypeDef* tim){ UNUSED(tim); }
+void LL_TIM_ClearFlag_CC1(TIM_TypeDef* tim){ UNUSED(tim); }
+uint32_t LL_TIM_IsActiveFlag_CC1(TIM_TypeDef* tim){
+    if(tim == TIM16) return g->tim16_cc1if;
+    return 1;                   /* TIM1: the falling edge is always "just now" */
+}
+void LL_TIM_SetTriggerOutput(TIM_TypeDef* tim, uint32_t trgo){
+    if(tim != TIM1) return;
+    tim2_fold();
+    g->tim_trgo = (trgo == LL_TIM_TRGO_UPDATE);
+}
+void LL_TIM_SetTriggerInput(TIM_TypeDef* tim, uint32_t ts){
+    UNUSED(tim); UNUSED(ts);    /* ITR0 is the only link modelled */
+}
+void LL_TIM_SetClockSource(TIM_TypeDef* tim, uint32_t source){
+    if(tim != TIM2) return;
+    tim2_fold();
+    g->tim2_ext = (source == LL_TIM_CLOCKSOURCE_EXT_MODE1);
+}
+void LL_TIM_SetPrescaler(TIM_TypeDef* tim, uint32_t psc){
+    if(tim == TIM16) g->tim16_psc = psc;
+}
+void LL_TIM_SetAutoReload(TIM_TypeDef* tim, uint32_t arr){ UNUSED(tim); UNUSED(arr); }
+void LL_TIM_SetCounter(TIM_TypeDef* tim, uint32_t cnt){
+    if(tim != TIM2) return;
+    tim2_fold();
+    g->tim2_cnt = cnt;
+    g->tim2_frac = 0;
+}
+uint32_t LL_TIM_GetCounter(TIM_TypeDef* tim){
+    if(tim != TIM2) return 0;
+    tim2_fold();
+    return g->tim2_cnt;
+}
+
+/* TIM16: CH1 capture of PA6 only */
+void LL_TIM_IC_SetActiveInput(TIM_TypeDef* tim, uint32_t channel, uint32_t input){
+    UNUSED(tim); UNUSED(channel); UNUSED(input);
+}
+void LL_TIM_IC_SetPrescaler(TIM_TypeDef* tim, uint32_t channel, uint32_t psc){
+    UNUSED(tim); UNUSED(channel); UNUSED(psc);
+}
+void LL_TIM_IC_SetFilter(TIM_TypeDef* tim, uint32_t channel, uint32_t filter){
+    UNUSED(tim); UNUSED(channel); UNUSED(filter);
+}
+void LL_TIM_IC_SetPolarity(TIM_TypeDef* tim, uint32_t channel, uint32_t polarity){
+    UNUSED(tim); UNUSED(channel); UNUSED(polarity);
+}
+uint32_t LL_TIM_IC_GetCaptureCH1(TIM_TypeDef* tim){
+    if(tim != TIM16) return 0;
+    g->tim16_cc1if = false;
+    return g->tim16_ccr;
+}
+void LL_TIM_CC_EnableChannel(TIM_TypeDef* tim, uint32_t channels){
+    if(tim == TIM16 && (channels & LL_TIM_CHANNEL_CH1)) g->tim16_cc1 = true;
+}
+void LL_TIM_CC_DisableChannel(TIM_TypeDef* tim, uint32_t channels){
+    if(tim == TIM16 && (channels & LL_TIM_CHANNEL_CH1)) g->tim16_cc1 = false;
+}
+void LL_TIM_EnableIT_CC1(TIM_TypeDef* tim){
+    if(tim == TIM16) g->tim16_ie = true;
+}
+void LL_TIM_DisableIT_CC1(TIM_TypeDef* tim){
+    if(tim == TIM16) g->tim16_ie = false;
+}
+uint32_t LL_TIM_IsActiveFlag_CC1OVR(TIM_TypeDef* tim){
+    return tim == TIM16 && g->tim16_cc1of;
+}
+void LL_TIM_ClearFlag_CC1OVR(TIM_TypeDef* tim){
+    if(tim == TIM16) g->tim16_cc1of = false;
+}
+void LL_TIM_SetOffStates(TIM_TypeDef* tim, uint32_t ossi, uint32_t ossr){ UNUSED(tim); UNUSED(ossi); UNUSED(ossr); }
+void LL_TIM_EnableDMAReq_UPDATE(TIM_TypeDef* tim){
+    if(tim != TIM1) return;
+    pa7_sync();
+    g->tim_ude = true;
+}
+void LL_TIM_DisableDMAReq_UPDATE(TIM_TypeDef* tim){
+    if(tim != TIM1) return;
+    pa7_sync();
+    g->tim_ude = false;
+}
+
+/* Same checks as the firmware: one handler per vector */
+void furi_hal_interrupt_set_isr(FuriHalInterruptId index, FuriHalInterruptISR isr, void* context){
+    UNUSED(index);
+    if(isr && g->isr) sim_crash("furi_check failed: ISR already set");
+    g->isr = isr;
+    g->isr_ctx = context;
+}
+
+/* The speaker mutex is what keeps the notification service off TIM16 */
+bool furi_hal_speaker_acquire(uint32_t timeout){
+    UNUSED(timeout);
+    if(g->speaker_held) sim_crash("speaker acquired twice");
+    g->speaker_held = true;
+    g->insomnia++;
+    g->pin_mode[gpio_speaker.id] = GpioModeAltFunctionPushPull;
+    return true;
+}
+void furi_hal_speaker_release(void){
+    if(!g->speaker_held) sim_crash("speaker released while free");
+    g->speaker_held = false;
+    g->insomnia--;
+    g->tim16_enabled = g->tim16_cc1 = g->tim16_ie = g->tim16_cc1if = g->tim16_cc1of = false;
+    g->pin_mode[gpio_speaker.id] = GpioModeAnalog;
+}
+
+/* ---------- Bluetooth extra beacon ---------- */
+/* The radio core does the advertising: only the calls are checked */
+bool furi_hal_bt_extra_beacon_set_config(const GapExtraBeaconConfig* config){
+    if(g->beacon_on) return false;      /* like the HAL: not while advertising */
+    if(config->min_adv_interval_ms < 20U || config->max_adv_interval_ms < config->min_adv_interval_ms){
+        sim_crash("extra beacon: bad advertising interval");
+    }
+    return true;
+}
+bool furi_hal_bt_extra_beacon_set_data(const uint8_t* data, uint8_t len){
+    UNUSED(data);
+    if(len > EXTRA_BEACON_MAX_DATA_SIZE) sim_crash("extra beacon: data too long");
+    return true;
+}
+bool furi_hal_bt_extra_beacon_start(void){
+    if(g->beacon_on) return false;
+    g->beacon_on = true;
+    return true;
+}
+bool furi_hal_bt_extra_beacon_stop(void){
+    if(!g->beacon_on) return false;
+    g->beacon_on = false;
+    return true;
+}
+bool furi_hal_bt_extra_beacon_is_active(void){
+    return g->beacon_on;
+}
+
+/* ---------- ADC1 / DMA ---------- */
+/* Ownership and order only: converting without the HAL handle, or handing
+ * the handle back mid-scan, is a crash; so is an ADC still held at exit */
+static FuriHalAdcHandle sim_adc_handle;
+static struct SimAdc { int unused; } sim_adc1;
+static struct SimDma { int unused; } sim_dma1, sim_dma2;
+ADC_TypeDef* const ADC1 = &sim_adc1;
+DMA_TypeDef* const DMA1 = &sim_dma1;
+DMA_TypeDef* const DMA2 = &sim_dma2;
+
+FuriHalAdcHandle* furi_hal_adc_acquire(void){
+    if(g->adc_held) sim_crash("ADC acquired twice");
+    g->adc_held = true;
+    return &sim_adc_handle;
+}
+void furi_hal_adc_release(FuriHalAdcHandle* handle){
+    if(handle != &sim_adc_handle || !g->adc_held) sim_crash("ADC released while free");
+    if(g->adc_converting || g->adc_dma) sim_crash("ADC released with a scan configured");
+    g->adc_held = false;
+}
+void furi_hal_adc_configure_ex(FuriHalAdcHandle* handle, FuriHalAdcScale scale, FuriHalAdcClock clock,
+    FuriHalAdcOversample oversample, FuriHalAdcSamplingTime sampling_time){
+    UNUSED(scale); UNUSED(clock); UNUSED(oversample); UNUSED(sampling_time);
+    if(handle != &sim_adc_handle || !g->adc_held) sim_crash("ADC configured without acquire");
+}
+static void adc_owned(void){
+    if(!g->adc_held) sim_crash("ADC1 used without furi_hal_adc_acquire");
+}
+void LL_ADC_REG_SetSequencerLength(ADC_TypeDef* adc, uint32_t len){ UNUSED(adc); UNUSED(len); adc_owned(); }
+void LL_ADC_REG_SetSequencerRanks(ADC_TypeDef* adc, uint32_t rank, uint32_t channel){
+    UNUSED(adc); UNUSED(rank); UNUSED(channel);
+    adc_owned();
+}
+void LL_ADC_SetChannelSamplingTime(ADC_TypeDef* adc, uint32_t channel, uint32_t time){
+    UNUSED(adc); UNUSED(channel); UNUSED(time);
+    adc_owned();
+}
+void LL_ADC_REG_SetContinuousMode(ADC_TypeDef* adc, uint32_t mode){ UNUSED(adc); UNUSED(mode); adc_owned(); }
+void LL_ADC_REG_SetOverrun(ADC_TypeDef* adc, uint32_t mode){ UNUSED(adc); UNUSED(mode); adc_owned(); }
+void LL_ADC_REG_SetDMATransfer(ADC_TypeDef* adc, uint32_t mode){
+    UNUSED(adc);
+    adc_owned();
+    g->adc_dma = (mode != LL_ADC_REG_DMA_TRANSFER_NONE);
+}
+uint32_t LL_ADC_DMA_GetRegAddr(ADC_TypeDef* adc, uint32_t reg){
+    UNUSED(adc); UNUSED(reg);
+    return 0x50040040U;         /* ADC1->DR */
+}
+void LL_ADC_REG_StartConversion(ADC_TypeDef* adc){
+    UNUSED(adc);
+    adc_owned();
+    if(g->adc_dma && !g->dma_on) sim_crash("ADC scan started before its DMA channel");
+    g->adc_converting = true;
+}
+void LL_ADC_REG_StopConversion(ADC_TypeDef* adc){
+    UNUSED(adc);
+    adc_owned();
+    g->adc_converting = false;
+}
+uint32_t LL_ADC_REG_IsStopConversionOngoing(ADC_TypeDef* adc){
+    UNUSED(adc);
+    return 0;
+}
+void LL_DMA_ConfigTransfer(DMA_TypeDef* dma, uint32_t channel, uint32_t config){ UNUSED(dma); UNUSED(channel); UNUSED(config); }
+void LL_DMA_ConfigAddresses(DMA_TypeDef* dma, uint32_t channel, uint32_t src, uint32_t dst, uint32_t direction){
+    UNUSED(dma); UNUSED(channel); UNUSED(src); UNUSED(dst); UNUSED(direction);
+}
+void LL_DMA_SetDataLength(DMA_TypeDef* dma, uint32_t channel, uint32_t len){ UNUSED(dma); UNUSED(channel); UNUSED(len); }
+void LL_DMA_SetPeriphRequest(DMA_TypeDef* dma, uint32_t channel, uint32_t request){
+    UNUSED(dma);
+    g->dma_req[channel & 7U] = request;
+}
+void LL_DMA_EnableChannel(DMA_TypeDef* dma, uint32_t channel){
+    UNUSED(dma);
+    pa7_sync();
+    g->dma_chan[channel & 7U] = true;
+    if(g->dma_req[channel & 7U] == LL_DMAMUX_REQ_ADC1) g->dma_on = true;
+}
+void LL_DMA_DisableChannel(DMA_TypeDef* dma, uint32_t channel){
+    UNUSED(dma);
+    pa7_sync();
+    g->dma_chan[channel & 7U] = false;
+    if(g->dma_req[channel & 7U] != LL_DMAMUX_REQ_ADC1) return;
+    if(g->adc_converting) sim_crash("DMA stopped under a running ADC scan");
+    g->dma_on = false;
+}
+
+/* ---------- I2C: LIS3DH ---------- */
+/* Stream-mode FIFO at 400 Hz. Samples are made when read, from the PA7
+ * frequency at that moment; older ones are lost after 32, like the part. */
+FuriHalI2cBusHandle furi_hal_i2c_handle_external;
+
+static bool acc_streaming(void){
+    return (g->acc_reg[0x20] & 0xF0) && (g->acc_reg[0x24] & 0x40) && (g->acc_reg[0x2E] & 0xC0) == 0x80;
+}
+
+static uint32_t acc_pending(void){
+    return acc_streaming() ? (uint32_t)((g->now_us - g->acc_mark_us) / SIM_ACC_PERIOD_US) : 0;
+}
+
+/* Shaft speed through the nominal mode points, rev/s */
+static double acc_shaft_hz(uint32_t drive_hz){
+    double rpm = (drive_hz <= 100U) ? 2000.0 + (drive_hz - 55.0) * 1000.0 / 45.0
+                                    : 3000.0 + (drive_hz - 100.0) * 1500.0 / 60.0;
+    return (rpm > 0.0) ? rpm / 60.0 : 0.0;
+}
+
+static void acc_sample(uint8_t out[6]){
+    uint32_t f = tim_wave(g->now_us) ? g->tim_freq : 0;
+    double a = 0.0, shaft = 0.0;
+    if(f){
+        double d = ((double)f - 100.0) / 6.0;
+        a = 20.0 + 280.0 / (1.0 + d * d);
+        shaft = acc_shaft_hz(f);
+    }
+    g->acc_turns += shaft * SIM_ACC_PERIOD_US / 1e6;
+    double w = 2.0 * 3.14159265358979 * g->acc_turns;
+    int16_t mg[3] = {
+        (int16_t)lround(a * sin(w)),
+        (int16_t)lround(a / 3.0 * sin(2.0 * w)),
+        1000,
+    };
+    for(int k = 0; k < 3; k++){
+        uint16_t raw = (uint16_t)(mg[k] * 16);      /* HR: left-justified 12 bits */
+        out[k * 2] = (uint8_t)raw;
+        out[k * 2 + 1] = (uint8_t)(raw >> 8);
+    }
+}
+
+void furi_hal_i2c_acquire(FuriHalI2cBusHandle* handle){
+    UNUSED(handle);
+    if(g->i2c_held) sim_crash("I2C bus acquired twice");
+    g->i2c_held = true;
+}
+void furi_hal_i2c_release(FuriHalI2cBusHandle* handle){
+    UNUSED(handle);
+    if(!g->i2c_held) sim_crash("I2C bus released while free");
+    g->i2c_held = false;
+}
+static bool acc_here(uint8_t addr){
+    if(!g->i2c_held) sim_crash("I2C used without acquire");
+    return g->run->accel && addr == SIM_ACC_ADDR;
+}
+bool furi_hal_i2c_is_device_ready(FuriHalI2cBusHandle* handle, uint8_t i2c_addr, uint32_t timeout){
+    UNUSED(handle);
+    UNUSED(timeout);
+    return acc_here(i2c_addr);
+}
+bool furi_hal_i2c_read_reg_8(FuriHalI2cBusHandle* handle, uint8_t i2c_addr, uint8_t reg_addr, uint8_t* data, uint32_t timeout){
+    UNUSED(handle);
+    UNUSED(timeout);
+    if(!acc_here(i2c_addr)) return false;
+    reg_addr &= 0x3F;
+    if(reg_addr == 0x0F){
+        *data = 0x33;
+    } else if(reg_addr == 0x2F){
+        uint32_t n = acc_pending();
+        *data = (n >= SIM_ACC_FIFO) ? (0x40 | 0x1F) : (uint8_t)n;
+    } else {
+        *data = g->acc_reg[reg_addr];
+    }
+    return true;
+}
+bool furi_hal_i2c_write_reg_8(FuriHalI2cBusHandle* handle, uint8_t i2c_addr, uint8_t reg_addr, uint8_t data, uint32_t timeout){
+    UNUSED(handle);
+    UNUSED(timeout);
+    if(!acc_here(i2c_addr)) return false;
+    reg_addr &= 0x3F;
+    g->acc_reg[reg_addr] = data;
+    if(reg_addr == 0x20 || reg_addr == 0x2E) g->acc_mark_us = g->now_us;  /* FIFO restarts empty */
+    return true;
+}
+bool furi_hal_i2c_read_mem(FuriHalI2cBusHandle* handle, uint8_t i2c_addr, uint8_t mem_addr, uint8_t* data, size_t len, uint32_t timeout){
+    UNUSED(handle);
+    UNUSED(timeout);
+    if(!acc_here(i2c_addr)) return false;
+    if((mem_addr & 0x7F) != 0x28 || !(mem_addr & 0x80) || len % 6) sim_crash("LIS3DH: only auto-increment XYZ reads are modelled");
+    uint32_t n = acc_pending();
+    if(n > SIM_ACC_FIFO){
+        g->acc_mark_us += (uint64_t)(n - SIM_ACC_FIFO) * SIM_ACC_PERIOD_US;    /* overwritten */
+        n = SIM_ACC_FIFO;
+    }
+    for(size_t i = 0; i < len / 6; i++){
+        if(i < n){
+            acc_sample(data + i * 6);
+            g->acc_mark_us += SIM_ACC_PERIOD_US;
+        } else {
+            memset(data + i * 6, 0, 6);     /* reading an empty FIFO repeats nothing useful */
+        }
+    }
+    return true;
+}
+
+/* ---------- Power / clocks ---------- */
+float furi_hal_power_get_battery_current(FuriHalPowerIC ic){
+    UNUSED(ic);
+    return (g->pa7 == Pa7Pwm) ? -0.085f : -0.032f;
+}
+float furi_hal_power_get_battery_voltage(FuriHalPowerIC ic){
+    UNUSED(ic);
+    return 3.95f;
+}
+uint8_t furi_hal_power_get_pct(void){
+    return 80;
+}
+uint32_t furi_hal_power_get_battery_remaining_capacity(void){
+    return 1680;
+}
+bool furi_hal_power_is_charging(void){
+    return false;
+}
+void furi_hal_power_insomnia_enter(void){
+    g->insomnia++;
+}
+void furi_hal_power_insomnia_exit(void){
+    g->insomnia--;
+}
+uint32_t furi_hal_rtc_get_timestamp(void){
+    return SIM_EPOCH + (uint32_t)(g->now_us / 1000000U);
+}
+
+/* Civil date <-> days since 1970 (proleptic Gregorian) */
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d){
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153U * (m + (m > 2 ? -3 : 9)) + 2U) / 5U + d - 1U;
+    unsigned doe = yoe * 365U + yoe / 4U - yoe / 100U + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+uint32_t datetime_datetime_to_timestamp(DateTime* dt){
+    int64_t days = days_from_civil(dt->year, dt->month, dt->day);
+    return (uint32_t)(days * SIM_DAY_S + dt->hour * 3600 + dt->minute * 60 + dt->second);
+}
+void datetime_timestamp_to_datetime(uint32_t ts, DateTime* dt){
+    int64_t z = ts / SIM_DAY_S + 719468;
+    uint32_t sod = ts % SIM_DAY_S;
+    int64_t era = z / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460U + doe / 36524U - doe / 146096U) / 365U;
+    unsigned doy = doe - (365U * yoe + yoe / 4U - yoe / 100U);
+    unsigned mp = (5U * doy + 2U) / 153U;
+    unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    dt->year = (uint16_t)(yoe + era * 400 + (m <= 2));
+    dt->month = (uint8_t)m;
+    dt->day = (uint8_t)(doy - (153U * mp + 2U) / 5U + 1U);
+    dt->hour = (uint8_t)(sod / 3600U);
+    dt->minute = (uint8_t)(sod / 60U % 60U);
+    dt->second = (uint8_t)(sod % 60U);
+    dt->weekday = (uint8_t)((ts / SIM_DAY_S + 3U) % 7U + 1U);   /* 1970-01-01 was a Thursday */
+}
+void furi_hal_rtc_get_datetime(DateTime* dt){
+    datetime_timestamp_to_datetime(furi_hal_rtc_get_timestamp(), dt);
+}
+void furi_hal_rtc_set_alarm(const DateTime* dt, bool enabled){
+    if(dt) g->alarm_sod = dt->hour * 3600U + dt->minute * 60U + dt->second;
+    g->alarm_on = enabled;
+}
+void furi_hal_rtc_set_alarm_callback(FuriHalRtcAlarmCallback callback, void* context){
+    g->alarm_cb = callback;
+    g->alarm_ctx = context;
+}
+uint32_t furi_hal_cortex_instructions_per_microsecond(void){
+    return SIM_CPU_MHZ;
+}
+SimDwt* sim_dwt(void){
+    g->dwt.CYCCNT = (uint32_t)(g->now_us * SIM_CPU_MHZ);
+    return &g->dwt;
+}
+
+/* ---------- Entry ---------- */
+static void main_entry(void){
+    embraco_starter(NULL);
+    setcontext(&g->boot_uc);
+}
+
+void sim_run(SimRun* run){
+    Sim* sim = calloc(1, sizeof(*sim));
+    if(!sim) abort();
+    sim->run = run;
+    sim->heap.next = sim->heap.prev = &sim->heap;
+    sim->pin_mode[gpio_ext_pa7.id] = GpioModeAnalog;   /* reset state */
+    sim->pa7 = Pa7Hiz;
+    sim->pin_level[gpio_ibutton.id] = !run->estop_loop;
+    if(run->exit_at_ms) sim->exit_at_ms = run->exit_at_ms;
+    else sim->exit_at_ms = (run->step_count ? run->steps[run->step_count - 1].at_ms : 0) + 1000U;
+
+    run->status = SimOk;
+    run->error[0] = '\0';
+    run->trace_len = 0;
+    run->metrics = (SimMetrics){0};
+    run->double_starts = 0;
+    run->thread_cuts = 0;
+    run->thread_cut_ms = 0;
+
+    sim->main_stack = malloc(SIM_MAIN_STACK);
+    if(!sim->main_stack) abort();
+    memset(sim->main_stack, SIM_STACK_PAINT, SIM_MAIN_STACK);
+    getcontext(&sim->main_uc);
+    sim->main_uc.uc_stack.ss_sp = sim->main_stack;
+    sim->main_uc.uc_stack.ss_size = SIM_MAIN_STACK;
+    sim->main_uc.uc_link = NULL;
+    makecontext(&sim->main_uc, main_entry, 0);
+
+    g = sim;
+    if(!setjmp(sim->jmp)){
+        swapcontext(&sim->boot_uc, &sim->main_uc);
+        if(sim->adc_held) sim_crash("ADC still held at exit");
+        if(sim->alarm_on || sim->alarm_cb) sim_crash("RTC alarm left armed at exit");
+        if(sim->speaker_held || sim->isr) sim_crash("TIM16 capture left running at exit");
+        if(sim->beacon_on) sim_crash("extra beacon left advertising at exit");
+        if(sim->exti_cb[gpio_ibutton.id]) sim_crash("e-stop EXTI left armed at exit");
+        if(sim->input_sub) sim_crash("input events subscription left at exit");
+        if(sim->thread) sim_crash("thread left running at exit");
+    }
+    pa7_sync();
+
+    run->end_ms = (uint32_t)(sim->now_us / 1000U);
+    run->insomnia = sim->insomnia;
+    run->pwm_on = (sim->pa7 == Pa7Pwm) || sim->hal_pwm;
+    run->pin_hiz = (sim->pa7 == Pa7Hiz) && sim->pin_mode[gpio_ext_pa7.id] == GpioModeInput;
+    run->live_blocks = 0;
+    run->live_bytes = sim->live_bytes;
+    run->stack_used = SIM_MAIN_STACK - main_stack_space();
+    while(sim->heap.next != &sim->heap){
+        Block* b = sim->heap.next;
+        sim->heap.next = b->next;
+        run->live_blocks++;
+        free(b);
+    }
+    g = NULL;
+    free(sim->thread_stack);
+    free(sim->main_stack);
+    free(sim);
+}
@@ -0,0 +1,131 @@
+#pragma once
+/* Host simulation of one Flipper running the starter app.
+ *
+ * The real src/embraco_starter.c is compiled against the stand-in Furi
+ * headers in sim/include and runs synchronously on the calling thread with a
+ * virtual millisecond clock: every furi_message_queue_get(FuriWaitForever)
+ * is a scheduling point where pending redraws are drawn, then the clock jumps
+ * to the next timer expiry or scripted step and fires it inline. A run of
+ * several minutes of device time costs microseconds of host time, and each
+ * host thread can run its own device (all sim state is thread-local).
+ *
+ * The one extra Furi thread (the safety supervisor) is a coroutine on the same
+ * host thread. It runs as soon as its flags are set, and its timed waits end on
+ * the virtual clock, preempting a busy main loop or a delay.
+ *
+ * Not modelled: interrupts other than the TIM16 capture, real canvas output,
+ * persisted settings and run hours (every launch sees factory defaults). With
+ * the loopback wire, TIM16 latches PA7's ideal rising edges and its ISR runs
+ * at the next whole microsecond; only gaps the app itself causes (stop/start)
+ * show up as jitter. Opening the e-stop loop runs the EXTI callback inline, and
+ * key events reach the input events pubsub subscriber before the view port. The optional accelerometer sees a
+ * synthetic compressor: a sine at shaft speed with one resonance near 100 Hz
+ * drive, plus a smaller second harmonic. The RTC starts at 00:00:00 and its
+ * daily alarm fires at the matching second. ADC1/DMA are checked for ownership
+ * and order only; DMA transfers are not performed. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* ---------- Script ---------- */
+typedef enum {
+    SimKeyUp,                   /* same order as InputKey */
+    SimKeyDown,
+    SimKeyRight,
+    SimKeyLeft,
+    SimKeyOk,
+    SimKeyBack,
+} SimKey;
+
+typedef enum {
+    SimStepShort,               /* Press, Short + Release 80 ms later */
+    SimStepLong,                /* Press, Long at +500 ms, Release at +600 ms */
+    SimStepCli,                 /* "embraco <args>" from the CLI */
+    SimStepEstopOpen,           /* the e-stop loop on 17 (1W) opens (button hit) */
+    SimStepEstopClose,          /* ... and closes again */
+    SimStepStall,               /* the main loop takes no events for `ms` (a handler that blocks) */
+} SimStepKind;
+
+typedef struct {
+    uint32_t    at_ms;          /* virtual time since launch, non-decreasing */
+    SimStepKind kind;
+    SimKey      key;            /* Short/Long */
+    const char* args;           /* Cli: everything after the command name */
+    char*       out;            /* Cli: optional reply buffer, NUL-terminated */
+    size_t      out_cap;
+    uint32_t    ms;             /* Stall */
+} SimStep;
+
+/* ---------- Trace (PA7 as the inverter sees it) ---------- */
+typedef enum {
+    SimTracePwmStart,           /* arg = frequency, Hz */
+    SimTracePwmStop,
+    SimTracePinHiz,
+    SimTracePinLow,
+} SimTraceKind;
+
+typedef struct {
+    uint32_t     t_ms;
+    SimTraceKind kind;
+    uint32_t     arg;
+} SimTrace;
+
+/* ---------- Result ---------- */
+typedef struct {
+    uint32_t redraw_requests;   /* view_port_update calls */
+    uint32_t frames;            /* draw callbacks actually run */
+    uint32_t glyphs;            /* characters rasterised by the text draws */
+    uint32_t timer_fires;
+    uint32_t wakeups;           /* messages handed to the main loop */
+    uint32_t idle_wakeups;      /* ... of which with PWM off */
+    uint64_t idle_us;           /* virtual time with PWM off */
+    uint64_t idle_insomnia_us;  /* ... of which with insomnia held (no Stop mode) */
+    uint32_t queue_drops;       /* furi_message_queue_put on a full queue */
+    uint32_t allocs;
+    uint32_t alloc_bytes;
+    uint32_t peak_bytes;
+    uint32_t pwm_starts;
+    uint32_t pwm_stops;
+    uint32_t gap_count;         /* PWM stop -> next start */
+    uint32_t gap_max_us;
+    uint64_t gap_sum_us;
+} SimMetrics;
+
+typedef enum {
+    SimOk = 0,
+    SimCrashed,                 /* furi_check / furi_crash; see SimRun.error */
+    SimNoExit,                  /* still running 60 s after the exit request */
+} SimStatus;
+
+typedef struct {
+    /* in */
+    const SimStep* steps;
+    size_t   step_count;
+    uint32_t exit_at_ms;        /* exit request (CLI "exit", else long Back); 0 = after last step + 1 s */
+    SimTrace* trace;            /* optional; events past trace_cap are counted, not stored */
+    size_t   trace_cap;
+    bool     accel;             /* LIS3DH on the external I2C bus (vibration sweep) */
+    bool     loopback;          /* 2 (A7) wired to 3 (A6): PWM jitter capture */
+    bool     estop_loop;        /* closed NC e-stop from 17 (1W) to GND; else the pin floats high */
+
+    /* out */
+    SimStatus  status;
+    char       error[96];
+    size_t     trace_len;
+    uint32_t   end_ms;          /* virtual time when the app returned */
+    SimMetrics metrics;
+    /* invariants at exit */
+    uint32_t   double_starts;   /* PWM started while already running */
+    int32_t    insomnia;        /* enter - exit, must be 0 */
+    uint32_t   live_blocks;     /* leaked allocations */
+    uint32_t   live_bytes;
+    bool       pin_hiz;         /* PA7 ended as input, no pull */
+    bool       pwm_on;          /* TIM1 still driving PA7 */
+    /* PA7 cut by the other thread (supervisor trip) */
+    uint32_t   thread_cuts;
+    uint32_t   thread_cut_ms;   /* worst time from the main loop's last wake */
+    uint32_t   stack_used;      /* app thread high-water mark, host bytes (see furi_thread_get_stack_space) */
+} SimRun;
+
+/* Runs the app once from launch to exit on the calling thread */
+void sim_run(SimRun* run);
@@ -0,0 +1,370 @@
+/* Host benchmark: scripted scenarios against the app logic (sim/), metrics
+ * as JSON, optional comparison against a stored baseline.
+ *
+ *   sim_bench                               table on stderr, JSON on stdout
+ *   sim_bench -o sim_data/bench_baseline.json   refresh the baseline
+ *   sim_bench -b sim_data/bench_baseline.json [-t pct]
+ *                                           fail (exit 1) when any metric
+ *                                           grows more than pct % (default 10)
+ *
+ * Every metric is "lower is better" and, with the virtual clock, exactly
+ * reproducible: a changed number means the app changed. A scenario whose
+ * script no longer reaches its goal (menu layout changed) exits 2. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim/sim.h"
+
+enum {
+    MAX_STEPS  = 512,
+    TRACE_CAP  = 4096,
+    KEY_MS     = 150,           /* pacing of scripted key presses */
+    SUP_BOUND_MS = 1050,        /* src: SUP_STALL_MS + SUP_POLL_MS */
+};
+
+/* Idle current model (MCU only, STM32WB55 typical figures at 3.3 V; display,
+ * backlight and radio not included). With PWM off the core is in Stop2
+ * unless insomnia is held (then WFI sleep at 64 MHz), except for a fixed
+ * awake time per main-loop wake, its redraw included. */
+enum {
+    IDLE_STOP_UA  = 2,          /* Stop2, SRAM kept, RTC on */
+    IDLE_SLEEP_UA = 1800,       /* Sleep, 64 MHz */
+    IDLE_RUN_UA   = 6400,       /* Run, 64 MHz from flash */
+    IDLE_WAKE_US  = 500,        /* awake per main-loop wake */
+};
+
+typedef struct {
+    SimStep  steps[MAX_STEPS];
+    size_t   n;
+    uint32_t t;
+    bool     stalls;            /* the supervisor must trip */
+    char     status[256];       /* reply of a scripted "status", if any */
+} Script;
+
+static void key(Script* s, SimKey k){
+    if(s->n < MAX_STEPS) s->steps[s->n++] = (SimStep){.at_ms = s->t, .kind = SimStepShort, .key = k};
+    s->t += KEY_MS;
+}
+static void keys(Script* s, SimKey k, unsigned count){
+    while(count--) key(s, k);
+}
+static void cli(Script* s, const char* args, char* out, size_t out_cap){
+    if(s->n < MAX_STEPS) s->steps[s->n++] = (SimStep){.at_ms = s->t, .kind = SimStepCli, .args = args, .out = out, .out_cap = out_cap};
+    s->t += KEY_MS;
+}
+static void stall(Script* s, uint32_t ms){
+    if(s->n < MAX_STEPS) s->steps[s->n++] = (SimStep){.at_ms = s->t, .kind = SimStepStall, .ms = ms};
+    s->t += ms;
+    s->stalls = true;
+}
+static void wait_s(Script* s, uint32_t secs){
+    s->t += secs * 1000U;
+}
+
+/* Launch -> Embraco -> safe menu -> Power on -> Confirm: powered, Stand by */
+static void power_on(Script* s){
+    s->t = 300;
+    key(s, SimKeyOk);           /* inverter selection: Embraco */
+    key(s, SimKeyOk);           /* Power on */
+    key(s, SimKeyRight);        /* Confirm */
+}
+
+/* ---------- Scenarios ---------- */
+static void sc_cold_start(Script* s){
+    s->t = 300;
+    key(s, SimKeyOk);
+    wait_s(s, 1);
+}
+
+static void sc_max_timeout(Script* s){
+    power_on(s);
+    keys(s, SimKeyDown, 3);     /* Max speed */
+    key(s, SimKeyOk);
+    cli(s, "status", s->status, sizeof(s->status));
+    wait_s(s, 35);              /* past the Max limit */
+}
+
+static void sc_mode_hopping(Script* s){
+    power_on(s);
+    key(s, SimKeyDown);
+    key(s, SimKeyOk);           /* Low */
+    for(unsigned i = 0; i < 20; i++){
+        SimKey k = (i % 4 < 2) ? SimKeyDown : SimKeyUp;    /* Low -> Mid -> Max -> Mid -> Low */
+        key(s, k);
+        key(s, SimKeyOk);
+    }
+    cli(s, "off", NULL, 0);
+}
+
+static void sc_help_storm(Script* s){
+    s->t = 300;
+    key(s, SimKeyOk);
+    key(s, SimKeyUp);           /* wraps to Help */
+    key(s, SimKeyOk);
+    for(unsigned i = 0; i < 5; i++){
+        keys(s, SimKeyDown, 30);
+        keys(s, SimKeyUp, 30);
+    }
+    key(s, SimKeyBack);
+}
+
+static void sc_long_unlimited(Script* s){
+    power_on(s);
+    keys(s, SimKeyUp, 6);       /* wraps to Settings: ... Settings, Power stats, Trend, Run hours, History, Help */
+    key(s, SimKeyOk);
+    key(s, SimKeyOk);           /* Limit run time */
+    key(s, SimKeyRight);        /* Confirm No */
+    key(s, SimKeyBack);
+    key(s, SimKeyDown);
+    key(s, SimKeyOk);           /* Low */
+    wait_s(s, 3600);
+    cli(s, "off", NULL, 0);
+}
+
+/* A handler blocks for 3 s with PWM live: PA7 must go Hi-Z by itself */
+static void sc_main_stall(Script* s){
+    power_on(s);
+    key(s, SimKeyDown);
+    key(s, SimKeyOk);           /* Low */
+    wait_s(s, 2);
+    stall(s, 3000);
+    wait_s(s, 2);
+}
+
+typedef struct {
+    const char* name;
+    void (*build)(Script* s);
+    uint32_t min_starts;        /* the script reached its goal */
+} Scenario;
+
+static const Scenario kScenarios[] = {
+    {"cold_start",    sc_cold_start,    0},
+    {"max_timeout",   sc_max_timeout,   1},
+    {"mode_hopping",  sc_mode_hopping,  21},
+    {"help_storm",    sc_help_storm,    0},
+    {"long_unlimited", sc_long_unlimited, 1},
+    {"main_stall",    sc_main_stall,    1},
+};
+#define SCENARIO_COUNT (sizeof(kScenarios) / sizeof(kScenarios[0]))
+
+/* ---------- Metrics ---------- */
+typedef enum {
+    MetRedraws,
+    MetFrames,
+    MetGlyphs,
+    MetTimerWakeups,
+    MetWakeups,
+    MetIdleWakeups,
+    MetIdleUa,
+    MetGapMaxUs,
+    MetGapMeanUs,
+    MetAutoOffLatencyMs,
+    MetAllocs,
+    MetAllocBytes,
+    MetPeakBytes,
+    MetLeakedBlocks,
+    MetQueueDrops,
+    MetTripLatencyMs,
+    MetStackBytes,
+    MetCount,
+} Metric;
+
+static const char* const kMetricNames[MetCount] = {
+    "redraws", "frames", "glyphs", "timer_wakeups", "wakeups", "idle_wakeups", "idle_ua", "pwm_gap_max_us",
+    "pwm_gap_mean_us", "autooff_latency_ms", "allocs", "alloc_bytes", "peak_bytes",
+    "leaked_blocks", "queue_drops", "trip_latency_ms", "stack_bytes",
+};
+
+/* Mean estimated MCU current while PWM is off, uA; -1 without idle time */
+static int64_t idle_current_ua(const SimMetrics* m){
+    if(!m->idle_us) return -1;
+    uint64_t awake = (uint64_t)m->idle_wakeups * IDLE_WAKE_US;
+    uint64_t sleep = m->idle_insomnia_us;
+    if(awake > m->idle_us - sleep) awake = m->idle_us - sleep;
+    uint64_t stop = m->idle_us - sleep - awake;
+    uint64_t ua_us = stop * IDLE_STOP_UA + sleep * IDLE_SLEEP_UA + awake * IDLE_RUN_UA;
+    return (int64_t)((ua_us + m->idle_us / 2U) / m->idle_us);
+}
+
+/* PWM stop minus (start + the limit "status" reported right after it) */
+static int64_t autooff_latency(const Script* s, const SimRun* run){
+    const char* left = strstr(s->status, "remaining: ");
+    unsigned long secs;
+    if(!left || sscanf(left, "remaining: %lus", &secs) != 1 || !secs) return -1;
+    size_t n = run->trace_len < TRACE_CAP ? run->trace_len : TRACE_CAP;
+    for(size_t i = 0; i < n; i++){
+        if(run->trace[i].kind != SimTracePwmStart) continue;
+        for(size_t j = i + 1; j < n; j++){
+            if(run->trace[j].kind == SimTracePwmStop){
+                return (int64_t)run->trace[j].t_ms - run->trace[i].t_ms - (int64_t)secs * 1000;
+            }
+        }
+        return -1;
+    }
+    return -1;
+}
+
+static bool run_scenario(const Scenario* sc, int64_t* out){
+    static Script s;
+    static SimTrace trace[TRACE_CAP];
+    memset(&s, 0, sizeof(s));
+    sc->build(&s);
+    SimRun run = {
+        .steps = s.steps,
+        .step_count = s.n,
+        .exit_at_ms = s.t + 1000U,
+        .trace = trace,
+        .trace_cap = TRACE_CAP,
+    };
+    sim_run(&run);
+
+    const SimMetrics* m = &run.metrics;
+    out[MetRedraws] = m->redraw_requests;
+    out[MetFrames] = m->frames;
+    out[MetGlyphs] = m->glyphs;
+    out[MetTimerWakeups] = m->timer_fires;
+    out[MetWakeups] = m->wakeups;
+    out[MetIdleWakeups] = m->idle_wakeups;
+    out[MetIdleUa] = idle_current_ua(m);
+    out[MetGapMaxUs] = m->gap_max_us;
+    out[MetGapMeanUs] = m->gap_count ? (int64_t)(m->gap_sum_us / m->gap_count) : 0;
+    out[MetAutoOffLatencyMs] = autooff_latency(&s, &run);
+    out[MetAllocs] = m->allocs;
+    out[MetAllocBytes] = m->alloc_bytes;
+    out[MetPeakBytes] = m->peak_bytes;
+    out[MetLeakedBlocks] = run.live_blocks;
+    out[MetQueueDrops] = m->queue_drops;
+    out[MetTripLatencyMs] = run.thread_cuts ? (int64_t)run.thread_cut_ms : -1;
+    out[MetStackBytes] = run.stack_used;
+
+    if(run.status != SimOk || s.n >= MAX_STEPS || m->pwm_starts < sc->min_starts || !run.pin_hiz){
+        fprintf(stderr, "%s: scenario broken (%s, %u PWM starts, PA7 %s)\n", sc->name,
+            run.status == SimOk ? "exited" : run.error, m->pwm_starts, run.pin_hiz ? "Hi-Z" : "driven");
+        return false;
+    }
+    if(s.stalls && (!run.thread_cuts || run.thread_cut_ms > SUP_BOUND_MS)){
+        fprintf(stderr, "%s: scenario broken (main loop stalled, PA7 %s)\n", sc->name,
+            run.thread_cuts ? "cut too late" : "never cut");
+        return false;
+    }
+    return true;
+}
+
+/* ---------- JSON ---------- */
+static void write_json(FILE* f, int64_t res[][MetCount]){
+    fprintf(f, "{\n");
+    for(size_t i = 0; i < SCENARIO_COUNT; i++){
+        fprintf(f, "  \"%s\": {", kScenarios[i].name);
+        bool first = true;
+        for(int k = 0; k < MetCount; k++){
+            if(res[i][k] < 0) continue;     /* not measured in this scenario */
+            fprintf(f, "%s\"%s\": %lld", first ? "" : ", ", kMetricNames[k], (long long)res[i][k]);
+            first = false;
+        }
+        fprintf(f, "}%s\n", (i + 1 < SCENARIO_COUNT) ? "," : "");
+    }
+    fprintf(f, "}\n");
+}
+
+/* Reads the two-level {"scenario": {"metric": n}} files written above */
+static bool read_json(const char* path, int64_t base[][MetCount]){
+    FILE* f = fopen(path, "r");
+    if(!f){
+        perror(path);
+        return false;
+    }
+    for(size_t i = 0; i < SCENARIO_COUNT; i++){
+        for(int k = 0; k < MetCount; k++) base[i][k] = -1;
+    }
+    char word[64];
+    int depth = 0, c;
+    long sc = -1;
+    while((c = fgetc(f)) != EOF){
+        if(c == '{') depth++;
+        else if(c == '}') depth--;
+        else if(c == '"'){
+            size_t n = 0;
+            while((c = fgetc(f)) != EOF && c != '"') if(n + 1 < sizeof(word)) word[n++] = (char)c;
+            word[n] = '\0';
+            if(depth == 1){
+                sc = -1;
+                for(size_t i = 0; i < SCENARIO_COUNT; i++) if(!strcmp(word, kScenarios[i].name)) sc = (long)i;
+            } else if(depth == 2 && sc >= 0){
+                long long v;
+                if(fscanf(f, " : %lld", &v) != 1) break;
+                for(int k = 0; k < MetCount; k++) if(!strcmp(word, kMetricNames[k])) base[sc][k] = v;
+            }
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv){
+    const char* out_path = NULL;
+    const char* base_path = NULL;
+    double threshold = 10.0;
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "-o") && i + 1 < argc) out_path = argv[++i];
+        else if(!strcmp(argv[i], "-b") && i + 1 < argc) base_path = argv[++i];
+        else if(!strcmp(argv[i], "-t") && i + 1 < argc) threshold = atof(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [-o out.json] [-b baseline.json [-t pct]]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    static int64_t res[SCENARIO_COUNT][MetCount];
+    bool broken = false;
+    for(size_t i = 0; i < SCENARIO_COUNT; i++){
+        if(!run_scenario(&kScenarios[i], res[i])) broken = true;
+    }
+
+    fprintf(stderr, "%-16s", "");
+    for(size_t i = 0; i < SCENARIO_COUNT; i++) fprintf(stderr, " %14s", kScenarios[i].name);
+    fprintf(stderr, "\n");
+    for(int k = 0; k < MetCount; k++){
+        fprintf(stderr, "%-18s", kMetricNames[k]);
+        for(size_t i = 0; i < SCENARIO_COUNT; i++){
+            if(res[i][k] < 0) fprintf(stderr, " %14s", "-");
+            else fprintf(stderr, " %14lld", (long long)res[i][k]);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    if(out_path){
+        FILE* f = fopen(out_path, "w");
+        if(!f){
+            perror(out_path);
+            return 2;
+        }
+        write_json(f, res);
+        fclose(f);
+    } else if(!base_path){
+        write_json(stdout, res);
+    }
+    if(broken) return 2;
+    if(!base_path) return 0;
+
+    static int64_t base[SCENARIO_COUNT][MetCount];
+    if(!read_json(base_path, base)) return 2;
+    unsigned regressions = 0;
+    for(size_t i = 0; i < SCENARIO_COUNT; i++){
+        for(int k = 0; k < MetCount; k++){
+            int64_t b = base[i][k], v = res[i][k];
+            if(b < 0) continue;
+            if(v < 0){
+                printf("MISSING %s.%s (baseline %lld)\n", kScenarios[i].name, kMetricNames[k], (long long)b);
+                regressions++;
+            } else if((double)v > (double)b * (1.0 + threshold / 100.0) && v != b){
+                printf("REGRESSION %s.%s: %lld -> %lld\n", kScenarios[i].name, kMetricNames[k], (long long)b, (long long)v);
+                regressions++;
+            } else if(v < b){
+                printf("improved %s.%s: %lld -> %lld\n", kScenarios[i].name, kMetricNames[k], (long long)b, (long long)v);
+            }
+        }
+    }
+    printf("%u regression(s) beyond %.0f%% against %s\n", regressions, threshold, base_path);
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,791 @@
+/* End-of-line station daemon: drives up to 16 Flippers running the app over
+ * their USB serial ports (Flipper CLI, "embraco ..." commands) from a single
+ * epoll loop, and serves a line API on a Unix socket for the station
+ * software.
+ *
+ *   station [-l sock] [-p poll_ms] /dev/ttyACM0 /dev/ttyACM1 ...
+ *   station [-l sock] -S 16 [-L ms]     16 simulated devices on ptys
+ *   station -c sock [-r N] command      client: one command, N times with latency
+ *
+ * Socket API, one command per line; every reply ends with a line ".":
+ *   list                    id, port, state, queued commands
+ *   status                  last polled `embraco status` of every device
+ *   send <id|all> <args>    "embraco <args>" on one or all devices at once;
+ *                           "<id> <line>" per output line (or "<id> ok") as
+ *                           each one answers
+ *   stats                   round trips per device: count, p50, p99, max (us)
+ * Commands of one client run in order; clients and devices run concurrently.
+ * Between commands every idle device is polled with `embraco status`.
+ *
+ * A device is idle, busy (one command on the wire) or offline. An unplugged or
+ * silent port fails its queued commands ("<id> error ...") and is reopened
+ * every RETRY_MS, so a Flipper can be swapped while the station runs.
+ *
+ * The simulated backend (-S) forks a child that plays the Flipper CLI on the
+ * master side of N ptys: echo, prompt, and the on/off/mode/limit/status
+ * commands with the app's modes and time limits; -L adds a response delay.
+ * The daemon opens the pty slaves exactly like real ports. */
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+enum {
+    MAX_DEVS     = 16,
+    MAX_CLIENTS  = 32,
+    RX_CAP       = 4096,        /* one command's output */
+    TX_CAP       = 256,
+    QUEUE_CAP    = 16,          /* commands waiting per device */
+    LINE_MAX     = 200,
+    STATUS_CAP   = 256,
+    LAT_CAP      = 1024,        /* round trips kept per device for stats */
+    CMD_MS       = 3000,        /* answer deadline */
+    SYNC_MS      = 1000,        /* first prompt after opening a port */
+    RETRY_MS     = 2000,
+    POLL_MS      = 1000,
+    OUT_MAX      = 1 << 20,     /* a client this far behind is dropped */
+};
+
+#define DEFAULT_SOCK "/tmp/embraco-station.sock"
+#define PROMPT       "\n>: "    /* Flipper CLI prompt, after "\r" */
+
+/* ---------- Time ---------- */
+static uint64_t now_us(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U;
+}
+
+/* ---------- Types ---------- */
+typedef enum { DevOffline, DevSync, DevIdle, DevBusy } DevState;
+static const char* const kDevStates[] = {"offline", "sync", "idle", "busy"};
+
+typedef struct {
+    int      client;            /* -1: status poll */
+    uint32_t gen;               /* client slot generation when queued */
+    char     args[LINE_MAX];
+} Req;
+
+typedef struct {
+    int      fd;
+    char     path[64];
+    DevState state;
+    char     rx[RX_CAP];
+    size_t   rx_len;
+    char     tx[TX_CAP];
+    size_t   tx_len;
+    Req      q[QUEUE_CAP];
+    uint8_t  qh, qn;
+    Req      cur;
+    uint64_t sent_us;
+    uint64_t due_us;            /* deadline (sync/busy), next poll (idle), reopen (offline) */
+    char     status[STATUS_CAP];
+    uint32_t lat[LAT_CAP];      /* round trips, us (ring) */
+    uint32_t lat_n;
+    uint32_t errors;
+} Dev;
+
+typedef struct {
+    int      fd;                /* -1: free */
+    uint32_t gen;
+    char     in[1024];
+    size_t   in_len;
+    char*    out;
+    size_t   out_len, out_cap;
+    uint8_t  pending;           /* device answers still due for the current command */
+} Client;
+
+/* epoll tags: kind in the high word, index in the low word */
+enum { TagListen = 1, TagSignal, TagClient, TagDev };
+#define TAG(kind, i) (((uint64_t)(kind) << 32) | (uint32_t)(i))
+
+static int ep = -1;
+static Dev devs[MAX_DEVS];
+static unsigned ndevs;
+static Client clients[MAX_CLIENTS];
+static uint32_t poll_ms = POLL_MS;
+
+static void ep_set(int op, int fd, uint32_t events, uint64_t tag){
+    struct epoll_event ev = {.events = events, .data.u64 = tag};
+    if(epoll_ctl(ep, op, fd, &ev) != 0 && op != EPOLL_CTL_DEL) perror("epoll_ctl");
+}
+
+/* ---------- Clients ---------- */
+static void client_close(Client* c){
+    if(c->fd < 0) return;
+    close(c->fd);
+    c->fd = -1;
+    c->gen++;
+    free(c->out);
+    c->out = NULL;
+    c->out_len = c->out_cap = 0;
+    c->in_len = 0;
+    c->pending = 0;
+}
+
+static void client_flush(Client* c){
+    size_t done = 0;
+    while(done < c->out_len){
+        ssize_t n = write(c->fd, c->out + done, c->out_len - done);
+        if(n > 0){
+            done += (size_t)n;
+        } else if(n < 0 && errno == EINTR){
+            continue;
+        } else if(n < 0 && errno == EAGAIN){
+            break;
+        } else {
+            client_close(c);
+            return;
+        }
+    }
+    memmove(c->out, c->out + done, c->out_len - done);
+    c->out_len -= done;
+    ep_set(EPOLL_CTL_MOD, c->fd, EPOLLIN | (c->out_len ? EPOLLOUT : 0), TAG(TagClient, c - clients));
+}
+
+static void client_printf(Client* c, const char* fmt, ...){
+    if(c->fd < 0) return;
+    char line[LINE_MAX + 64];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if(n < 0) return;
+    if((size_t)n >= sizeof(line)) n = (int)sizeof(line) - 1;
+    if(c->out_len + (size_t)n > OUT_MAX){
+        fprintf(stderr, "client %d: not reading, dropped\n", (int)(c - clients));
+        client_close(c);
+        return;
+    }
+    if(c->out_len + (size_t)n > c->out_cap){
+        c->out_cap = (c->out_len + (size_t)n) * 2;
+        c->out = realloc(c->out, c->out_cap);
+    }
+    memcpy(c->out + c->out_len, line, (size_t)n);
+    c->out_len += (size_t)n;
+}
+
+/* ---------- Devices ---------- */
+static void dev_kick(Dev* d);
+static void client_run(Client* c);
+
+static int tty_open(const char* path){
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if(fd < 0) return -1;
+    struct termios t;
+    if(tcgetattr(fd, &t) == 0){
+        cfmakeraw(&t);
+        cfsetspeed(&t, B230400);    /* USB CDC ignores it; a UART bridge does not */
+        t.c_cflag |= CLOCAL | CREAD;
+        tcsetattr(fd, TCSANOW, &t);
+        tcflush(fd, TCIOFLUSH);
+    }
+    return fd;
+}
+
+static void dev_send(Dev* d, const char* fmt, ...){
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(d->tx + d->tx_len, TX_CAP - d->tx_len, fmt, ap);
+    va_end(ap);
+    if(n > 0) d->tx_len += ((size_t)n < TX_CAP - d->tx_len) ? (size_t)n : TX_CAP - d->tx_len - 1;
+    ssize_t w = write(d->fd, d->tx, d->tx_len);
+    if(w > 0){
+        memmove(d->tx, d->tx + w, d->tx_len - (size_t)w);
+        d->tx_len -= (size_t)w;
+    }
+    ep_set(EPOLL_CTL_MOD, d->fd, EPOLLIN | (d->tx_len ? EPOLLOUT : 0), TAG(TagDev, d - devs));
+}
+
+/* One answer line to whoever asked; the last one closes the client's reply */
+static void req_line(const Dev* d, const Req* r, const char* line){
+    if(r->client < 0) return;
+    Client* c = &clients[r->client];
+    if(c->fd < 0 || c->gen != r->gen) return;
+    client_printf(c, "%u %s\n", (unsigned)(d - devs), line);
+}
+
+static void req_done(const Req* r){
+    if(r->client < 0) return;
+    Client* c = &clients[r->client];
+    if(c->fd < 0 || c->gen != r->gen) return;
+    if(c->pending && --c->pending == 0){
+        client_printf(c, ".\n");
+        client_flush(c);
+        if(c->fd >= 0) client_run(c);
+    }
+}
+
+static void dev_open(Dev* d, uint64_t now){
+    d->fd = tty_open(d->path);
+    if(d->fd < 0){
+        d->state = DevOffline;
+        d->due_us = now + RETRY_MS * 1000ULL;
+        return;
+    }
+    ep_set(EPOLL_CTL_ADD, d->fd, EPOLLIN, TAG(TagDev, d - devs));
+    d->rx_len = d->tx_len = 0;
+    d->state = DevSync;
+    d->due_us = now + SYNC_MS * 1000ULL;
+    dev_send(d, "\r");          /* an empty line answers with a prompt */
+}
+
+/* Port gone or silent: everything queued fails, the port is retried later */
+static void dev_fail(Dev* d, const char* why, uint64_t now){
+    if(d->state != DevOffline) fprintf(stderr, "dev %u %s: %s\n", (unsigned)(d - devs), d->path, why);
+    if(d->state == DevBusy){
+        req_line(d, &d->cur, why);
+        req_done(&d->cur);
+    }
+    while(d->qn){
+        Req* r = &d->q[d->qh];
+        d->qh = (uint8_t)((d->qh + 1) % QUEUE_CAP);
+        d->qn--;
+        req_line(d, r, why);
+        req_done(r);
+    }
+    if(d->fd >= 0) close(d->fd);
+    d->fd = -1;
+    d->errors++;
+    d->state = DevOffline;
+    d->due_us = now + RETRY_MS * 1000ULL;
+    d->status[0] = '\0';
+}
+
+static bool dev_queue(Dev* d, int client, const char* args){
+    if(d->state == DevOffline || d->qn == QUEUE_CAP) return false;
+    Req* r = &d->q[(d->qh + d->qn) % QUEUE_CAP];
+    r->client = client;
+    r->gen = (client >= 0) ? clients[client].gen : 0;
+    snprintf(r->args, sizeof(r->args), "%s", args);
+    d->qn++;
+    dev_kick(d);
+    return true;
+}
+
+/* Idle: next queued command, or a status poll when one is due */
+static void dev_kick(Dev* d){
+    if(d->state != DevIdle) return;
+    uint64_t now = now_us();
+    if(!d->qn){
+        if(now < d->due_us) return;
+        d->cur = (Req){.client = -1};
+        snprintf(d->cur.args, sizeof(d->cur.args), "status");
+    } else {
+        d->cur = d->q[d->qh];
+        d->qh = (uint8_t)((d->qh + 1) % QUEUE_CAP);
+        d->qn--;
+    }
+    d->state = DevBusy;
+    d->rx_len = 0;
+    d->sent_us = now;
+    d->due_us = now + CMD_MS * 1000ULL;
+    dev_send(d, "embraco %s\r", d->cur.args);
+}
+
+/* Output between the echoed command line and the prompt */
+static void dev_answer(Dev* d, char* body, uint64_t now){
+    d->lat[d->lat_n++ % LAT_CAP] = (uint32_t)(now - d->sent_us);
+    bool poll = (d->cur.client < 0);
+    if(poll) d->status[0] = '\0';
+    size_t used = 0;
+    char* save = NULL;
+    char* line = strtok_r(body, "\r\n", &save);
+    if(line && strncmp(line, "embraco", 7) == 0) line = strtok_r(NULL, "\r\n", &save);  /* echo */
+    if(!line && !poll) req_line(d, &d->cur, "ok");   /* on, off, mode... answer nothing */
+    for(; line; line = strtok_r(NULL, "\r\n", &save)){
+        if(!poll){
+            req_line(d, &d->cur, line);
+        } else if(used + strlen(line) + 3 < STATUS_CAP){
+            used += (size_t)snprintf(d->status + used, STATUS_CAP - used, "%s%s", used ? "; " : "", line);
+        }
+    }
+    Req done = d->cur;
+    d->state = DevIdle;
+    d->due_us = now + poll_ms * 1000ULL;
+    req_done(&done);
+    dev_kick(d);
+}
+
+static void dev_readable(Dev* d){
+    uint64_t now = now_us();
+    for(;;){
+        if(d->rx_len == RX_CAP - 1){
+            /* runaway output: keep the tail, the prompt is at the end */
+            memmove(d->rx, d->rx + RX_CAP / 2, d->rx_len - RX_CAP / 2);
+            d->rx_len -= RX_CAP / 2;
+        }
+        ssize_t n = read(d->fd, d->rx + d->rx_len, RX_CAP - 1 - d->rx_len);
+        if(n > 0){
+            d->rx_len += (size_t)n;
+            continue;
+        }
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0 && errno == EAGAIN) break;
+        dev_fail(d, "error port closed", now);
+        return;
+    }
+    d->rx[d->rx_len] = '\0';
+    char* prompt = strstr(d->rx, PROMPT);
+    if(!prompt) return;
+    *prompt = '\0';
+    if(d->state == DevSync){
+        fprintf(stderr, "dev %u %s: online\n", (unsigned)(d - devs), d->path);
+        d->state = DevIdle;
+        d->due_us = now;
+        d->rx_len = 0;
+        dev_kick(d);
+    } else if(d->state == DevBusy){
+        dev_answer(d, d->rx, now);
+    } else {
+        d->rx_len = 0;          /* stray prompt */
+    }
+}
+
+static void dev_timers(uint64_t now){
+    for(unsigned i = 0; i < ndevs; i++){
+        Dev* d = &devs[i];
+        if(now < d->due_us) continue;
+        switch(d->state){
+            case DevOffline: dev_open(d, now); break;
+            case DevSync:    dev_fail(d, "error no prompt", now); break;
+            case DevBusy:    dev_fail(d, "error timeout", now); break;
+            case DevIdle:    dev_kick(d); break;
+        }
+    }
+}
+
+static int next_timeout_ms(uint64_t now){
+    uint64_t due = UINT64_MAX;
+    for(unsigned i = 0; i < ndevs; i++) if(devs[i].due_us < due) due = devs[i].due_us;
+    if(due == UINT64_MAX) return -1;
+    return (due <= now) ? 0 : (int)((due - now + 999U) / 1000U);
+}
+
+/* ---------- API ---------- */
+static int cmp_u32(const void* a, const void* b){
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void api_stats(Client* c){
+    static uint32_t sorted[LAT_CAP];
+    for(unsigned i = 0; i < ndevs; i++){
+        const Dev* d = &devs[i];
+        uint32_t n = (d->lat_n < LAT_CAP) ? d->lat_n : LAT_CAP;
+        if(!n){
+            client_printf(c, "%u n=0 errors=%u\n", i, d->errors);
+            continue;
+        }
+        memcpy(sorted, d->lat, n * sizeof(uint32_t));
+        qsort(sorted, n, sizeof(uint32_t), cmp_u32);
+        client_printf(c, "%u n=%u p50=%u p99=%u max=%u errors=%u\n", i, d->lat_n,
+            sorted[n / 2], sorted[(n * 99U) / 100U], sorted[n - 1], d->errors);
+    }
+}
+
+/* One command line; "send" leaves the reply open until every device answered */
+static void client_exec(Client* c, char* line){
+    char* save = NULL;
+    char* word = strtok_r(line, " \t", &save);
+    if(!word){
+        client_printf(c, ".\n");
+    } else if(!strcmp(word, "list")){
+        for(unsigned i = 0; i < ndevs; i++){
+            client_printf(c, "%u %s %s queued=%u\n", i, devs[i].path, kDevStates[devs[i].state],
+                devs[i].qn + (devs[i].state == DevBusy && devs[i].cur.client >= 0));
+        }
+        client_printf(c, ".\n");
+    } else if(!strcmp(word, "status")){
+        for(unsigned i = 0; i < ndevs; i++){
+            client_printf(c, "%u %s\n", i, devs[i].status[0] ? devs[i].status : kDevStates[devs[i].state]);
+        }
+        client_printf(c, ".\n");
+    } else if(!strcmp(word, "stats")){
+        api_stats(c);
+        client_printf(c, ".\n");
+    } else if(!strcmp(word, "send")){
+        char* target = strtok_r(NULL, " \t", &save);
+        char* args = save ? save + strspn(save, " \t") : NULL;
+        char* end = NULL;
+        unsigned long id = target ? strtoul(target, &end, 10) : 0;
+        bool all = target && !strcmp(target, "all");
+        if(!target || !args || !*args || (!all && (*end || id >= ndevs))){
+            client_printf(c, "error usage: send <id|all> <embraco args>\n.\n");
+            return;
+        }
+        int ci = (int)(c - clients);
+        for(unsigned i = all ? 0 : (unsigned)id; i < (all ? ndevs : (unsigned)id + 1U); i++){
+            c->pending++;
+            if(!dev_queue(&devs[i], ci, args)){
+                client_printf(c, "%u error %s\n", i, (devs[i].state == DevOffline) ? "offline" : "queue full");
+                c->pending--;
+            }
+        }
+        if(!c->pending) client_printf(c, ".\n");
+    } else {
+        client_printf(c, "error unknown command (list, status, send, stats)\n.\n");
+    }
+}
+
+/* Next complete lines, while no command of this client is in flight */
+static void client_run(Client* c){
+    while(c->fd >= 0 && !c->pending){
+        char* nl = memchr(c->in, '\n', c->in_len);
+        if(!nl) break;
+        *nl = '\0';
+        if(nl > c->in && nl[-1] == '\r') nl[-1] = '\0';
+        char line[sizeof(c->in)];
+        memcpy(line, c->in, (size_t)(nl - c->in) + 1U);
+        c->in_len -= (size_t)(nl - c->in) + 1U;
+        memmove(c->in, nl + 1, c->in_len);
+        client_exec(c, line);
+    }
+    if(c->fd >= 0) client_flush(c);
+}
+
+static void client_readable(Client* c){
+    for(;;){
+        if(c->in_len == sizeof(c->in)){
+            client_printf(c, "error line too long\n");
+            client_flush(c);
+            client_close(c);
+            return;
+        }
+        ssize_t n = read(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len);
+        if(n > 0){
+            c->in_len += (size_t)n;
+            continue;
+        }
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0 && errno == EAGAIN) break;
+        client_close(c);
+        return;
+    }
+    client_run(c);
+}
+
+static void listen_accept(int lfd){
+    for(;;){
+        int fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0) return;
+        Client* c = NULL;
+        for(unsigned i = 0; i < MAX_CLIENTS && !c; i++) if(clients[i].fd < 0) c = &clients[i];
+        if(!c){
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->in_len = c->out_len = 0;
+        c->pending = 0;
+        ep_set(EPOLL_CTL_ADD, fd, EPOLLIN, TAG(TagClient, c - clients));
+    }
+}
+
+static int listen_open(const char* path){
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    unlink(path);
+    if(fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0){
+        perror(path);
+        exit(1);
+    }
+    return fd;
+}
+
+/* ---------- Simulated devices ---------- */
+/* The app's modes as the CLI reports them; time limits with `limit on` */
+static const struct { const char* name; unsigned hz, secs; } kSimModes[] = {
+    {"Stand by", 0, 0}, {"Low speed", 55, 120}, {"Mid speed", 100, 60}, {"Max speed", 160, 30},
+};
+
+typedef struct {
+    int      fd;                /* pty master */
+    char     line[LINE_MAX];
+    size_t   len;
+    bool     powered, limit;
+    unsigned mode;
+    uint64_t off_us;            /* auto-off, 0 = none */
+    char     out[2048];         /* answer held back by the simulated latency */
+    size_t   out_len;
+    uint64_t out_us;
+} SimDev;
+
+static void sim_out(SimDev* s, const char* fmt, ...){
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(s->out + s->out_len, sizeof(s->out) - s->out_len, fmt, ap);
+    va_end(ap);
+    if(n > 0) s->out_len += ((size_t)n < sizeof(s->out) - s->out_len) ? (size_t)n : sizeof(s->out) - s->out_len - 1;
+}
+
+static void sim_set_mode(SimDev* s, unsigned mode, uint64_t now){
+    s->mode = mode;
+    s->off_us = (s->limit && kSimModes[mode].secs) ? now + kSimModes[mode].secs * 1000000ULL : 0;
+}
+
+static void sim_exec(SimDev* s, char* line, uint64_t now){
+    if(s->off_us && now >= s->off_us) sim_set_mode(s, 0, now);
+    char* save = NULL;
+    char* cmd = strtok_r(line, " ", &save);
+    if(!cmd){
+        /* empty line: prompt only */
+    } else if(strcmp(cmd, "embraco")){
+        sim_out(s, "`%s` command not found\r\n", cmd);
+    } else {
+        char* w = strtok_r(NULL, " ", &save);
+        char* a = strtok_r(NULL, " ", &save);
+        if(w && !strcmp(w, "status")){
+            unsigned left = (s->off_us > now) ? (unsigned)((s->off_us - now + 999999U) / 1000000U) : 0;
+            sim_out(s, "powered: %s\r\nmode: %s\r\npwm: %uHz\r\nlimit: %s\r\nremaining: %us\r\n",
+                s->powered ? "yes" : "no", s->powered ? kSimModes[s->mode].name : "Hi-Z",
+                s->powered ? kSimModes[s->mode].hz : 0, s->limit ? "on" : "off", left);
+        } else if(w && !strcmp(w, "on")){
+            if(!s->powered){
+                s->powered = true;
+                sim_set_mode(s, 0, now);
+            }
+        } else if(w && !strcmp(w, "off")){
+            s->powered = false;
+            sim_set_mode(s, 0, now);
+        } else if(w && !strcmp(w, "mode") && a && a[0] >= '0' && a[0] <= '3' && !a[1]){
+            if(s->powered) sim_set_mode(s, (unsigned)(a[0] - '0'), now);
+        } else if(w && !strcmp(w, "limit") && a && (!strcmp(a, "on") || !strcmp(a, "off"))){
+            s->limit = !strcmp(a, "on");
+            sim_set_mode(s, s->mode, now);
+        } else {
+            sim_out(s, "Usage: embraco on | off | mode <0-3> | limit <on|off> | status\r\n");
+        }
+    }
+    sim_out(s, "\r\n>: ");
+}
+
+/* Child process: the CLI side of every pty, until the daemon exits */
+static void sim_main(SimDev* sims, unsigned n, uint32_t latency_ms){
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    int sep = epoll_create1(EPOLL_CLOEXEC);
+    for(unsigned i = 0; i < n; i++){
+        struct epoll_event ev = {.events = EPOLLIN, .data.u32 = i};
+        epoll_ctl(sep, EPOLL_CTL_ADD, sims[i].fd, &ev);
+    }
+    for(;;){
+        uint64_t now = now_us();
+        int timeout = -1;
+        for(unsigned i = 0; i < n; i++){
+            SimDev* s = &sims[i];
+            if(!s->out_len) continue;
+            if(s->out_us <= now){
+                /* the daemon reads as fast as we write; a full pty drops the rest */
+                ssize_t w = write(s->fd, s->out, s->out_len);
+                if(w > 0) memmove(s->out, s->out + w, s->out_len - (size_t)w), s->out_len -= (size_t)w;
+                else s->out_len = 0;
+            } else {
+                int ms = (int)((s->out_us - now + 999U) / 1000U);
+                if(timeout < 0 || ms < timeout) timeout = ms;
+            }
+        }
+        struct epoll_event evs[MAX_DEVS];
+        int k = epoll_wait(sep, evs, MAX_DEVS, timeout);
+        now = now_us();
+        for(int e = 0; e < k; e++){
+            SimDev* s = &sims[evs[e].data.u32];
+            char buf[256];
+            ssize_t r = read(s->fd, buf, sizeof(buf));
+            for(ssize_t j = 0; j < r; j++){
+                char ch = buf[j];
+                if(ch == '\r' || ch == '\n'){
+                    if(ch == '\n') continue;
+                    s->line[s->len] = '\0';
+                    sim_out(s, "\r\n");             /* end of the echo */
+                    sim_exec(s, s->line, now);
+                    s->len = 0;
+                    s->out_us = now + latency_ms * 1000ULL;
+                } else if(s->len + 1 < sizeof(s->line)){
+                    s->line[s->len++] = ch;
+                    sim_out(s, "%c", ch);           /* echo, as the Flipper CLI does */
+                }
+            }
+        }
+    }
+}
+
+/* n ptys; the child keeps the masters (and a slave each, so a master never
+ * sees a hangup before the daemon opens it), the daemon gets the slave paths */
+static void sim_spawn(unsigned n, uint32_t latency_ms){
+    static SimDev sims[MAX_DEVS];
+    int keep[MAX_DEVS];
+    for(unsigned i = 0; i < n; i++){
+        int m = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if(m < 0 || grantpt(m) != 0 || unlockpt(m) != 0){
+            perror("posix_openpt");
+            exit(1);
+        }
+        sims[i] = (SimDev){.fd = m, .limit = true};
+        snprintf(devs[i].path, sizeof(devs[i].path), "%s", ptsname(m));
+        keep[i] = tty_open(devs[i].path);
+    }
+    pid_t pid = fork();
+    if(pid < 0){
+        perror("fork");
+        exit(1);
+    }
+    if(pid == 0) sim_main(sims, n, latency_ms);
+    for(unsigned i = 0; i < n; i++){
+        close(sims[i].fd);
+        close(keep[i]);
+    }
+    fprintf(stderr, "simulating %u devices (pid %d), %ums per answer\n", n, (int)pid, latency_ms);
+}
+
+/* ---------- Client mode ---------- */
+/* Sends `cmd` `rounds` times, one after the other; prints the first reply
+ * and, for more than one round, the latency spread */
+static int client_main(const char* path, const char* cmd, unsigned rounds){
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    if(fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0){
+        perror(path);
+        return 1;
+    }
+    uint32_t* lat = calloc(rounds, sizeof(uint32_t));
+    FILE* in = fdopen(dup(fd), "r");
+    char line[1024];
+    for(unsigned r = 0; r < rounds; r++){
+        uint64_t t0 = now_us();
+        dprintf(fd, "%s\n", cmd);
+        for(;;){
+            if(!fgets(line, sizeof(line), in)){
+                fprintf(stderr, "station closed the connection\n");
+                return 1;
+            }
+            if(!strcmp(line, ".\n")) break;
+            if(r == 0) fputs(line, stdout);
+        }
+        lat[r] = (uint32_t)(now_us() - t0);
+    }
+    if(rounds > 1){
+        qsort(lat, rounds, sizeof(uint32_t), cmp_u32);
+        uint64_t sum = 0;
+        for(unsigned r = 0; r < rounds; r++) sum += lat[r];
+        printf("%u rounds: mean %lluus p50 %uus p99 %uus max %uus\n", rounds,
+            (unsigned long long)(sum / rounds), lat[rounds / 2], lat[(rounds * 99U) / 100U], lat[rounds - 1]);
+    }
+    free(lat);
+    fclose(in);
+    close(fd);
+    return 0;
+}
+
+/* ---------- Main ---------- */
+int main(int argc, char** argv){
+    const char* sock = DEFAULT_SOCK;
+    const char* connect_to = NULL;
+    unsigned sims = 0, rounds = 1;
+    uint32_t latency_ms = 5;
+    char cmd[LINE_MAX] = "";
+    int i = 1;
+    for(; i < argc; i++){
+        if(!strcmp(argv[i], "-l") && i + 1 < argc) sock = argv[++i];
+        else if(!strcmp(argv[i], "-p") && i + 1 < argc) poll_ms = (uint32_t)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-S") && i + 1 < argc) sims = (unsigned)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-L") && i + 1 < argc) latency_ms = (uint32_t)atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-c") && i + 1 < argc) connect_to = argv[++i];
+        else if(!strcmp(argv[i], "-r") && i + 1 < argc) rounds = (unsigned)atoi(argv[++i]);
+        else if(argv[i][0] == '-'){ ndevs = MAX_DEVS + 1; break; }
+        else if(connect_to){
+            size_t used = strlen(cmd);
+            snprintf(cmd + used, sizeof(cmd) - used, "%s%s", used ? " " : "", argv[i]);
+        } else if(ndevs < MAX_DEVS){
+            snprintf(devs[ndevs++].path, sizeof(devs[0].path), "%s", argv[i]);
+        } else {
+            ndevs = MAX_DEVS + 1;
+        }
+    }
+    if(connect_to && cmd[0] && rounds) return client_main(connect_to, cmd, rounds);
+    if(sims > MAX_DEVS || (sims && ndevs) || ndevs > MAX_DEVS || (!sims && !ndevs) || connect_to){
+        fprintf(stderr,
+            "usage: %s [-l sock] [-p poll_ms] port...      (up to %u ports)\n"
+            "       %s [-l sock] [-p poll_ms] -S count [-L ms]  simulated devices\n"
+            "       %s -c sock [-r rounds] command\n", argv[0], MAX_DEVS, argv[0], argv[0]);
+        return 2;
+    }
+
+    ep = epoll_create1(EPOLL_CLOEXEC);
+    for(unsigned c = 0; c < MAX_CLIENTS; c++) clients[c].fd = -1;
+    if(sims){
+        sim_spawn(sims, latency_ms);
+        ndevs = sims;
+    }
+
+    /* SIGINT/SIGTERM arrive as an event; SIGPIPE from a vanished client is ignored */
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    int sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    ep_set(EPOLL_CTL_ADD, sfd, EPOLLIN, TAG(TagSignal, 0));
+    int lfd = listen_open(sock);
+    ep_set(EPOLL_CTL_ADD, lfd, EPOLLIN, TAG(TagListen, 0));
+
+    uint64_t now = now_us();
+    for(unsigned d = 0; d < ndevs; d++){
+        devs[d].fd = -1;
+        dev_open(&devs[d], now);
+    }
+    fprintf(stderr, "station: %u devices, API on %s\n", ndevs, sock);
+
+    bool run = true;
+    while(run){
+        struct epoll_event evs[MAX_DEVS + MAX_CLIENTS + 2];
+        int n = epoll_wait(ep, evs, (int)(sizeof(evs) / sizeof(evs[0])), next_timeout_ms(now_us()));
+        if(n < 0 && errno != EINTR){
+            perror("epoll_wait");
+            break;
+        }
+        for(int e = 0; e < n; e++){
+            uint32_t kind = (uint32_t)(evs[e].data.u64 >> 32);
+            uint32_t idx = (uint32_t)evs[e].data.u64;
+            if(kind == TagSignal){
+                run = false;
+            } else if(kind == TagListen){
+                listen_accept(lfd);
+            } else if(kind == TagClient){
+                Client* c = &clients[idx];
+                if(c->fd < 0) continue;
+                if(evs[e].events & EPOLLOUT) client_flush(c);
+                if(c->fd >= 0 && (evs[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) client_readable(c);
+            } else if(kind == TagDev){
+                Dev* d = &devs[idx];
+                if(d->fd < 0) continue;
+                if(evs[e].events & EPOLLOUT) dev_send(d, "%s", "");
+                if(d->fd >= 0 && (evs[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) dev_readable(d);
+            }
+        }
+        dev_timers(now_us());
+    }
+
+    for(unsigned c = 0; c < MAX_CLIENTS; c++) client_close(&clients[c]);
+    for(unsigned d = 0; d < ndevs; d++) if(devs[d].fd >= 0) close(devs[d].fd);
+    close(lfd);
+    unlink(sock);
+    fprintf(stderr, "station: stopped\n");
+    return 0;
+}